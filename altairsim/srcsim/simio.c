@@ -31,12 +31,12 @@
  * 08-OCT-2019 (Mike Douglas) added OUT 161 trap to simbdos.c for host file I/O
  * 31-JUL-2021 allow building machine without frontpanel
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 18-OCT-2026 write disk sectors behind
+ * 18-OCT-2026 10ms timer runs in simulated time
  */
 
 #include <errno.h>
 #include <fcntl.h>
-#include <signal.h>
-#include <sys/time.h>
 #include <unistd.h>
 
 #include "sim.h"
@@ -47,11 +47,13 @@
 #include "simcore.h"
 #endif
 #include "simio.h"
+#include "simevent.h"
 
 #include "altair-88-2sio.h"
 #include "altair-88-dcdd.h"
 #include "altair-88-sio.h"
 #include "cromemco-dazzler.h"
+#include "diskwb.h"
 #include "proctec-vdm.h"
 #include "simbdos.h"
 #include "tarbell_fdc.h"
@@ -80,6 +82,9 @@ static BYTE io_no_card_in(void);
 static int printer;		/* fd for file "printer.txt" */
 static BYTE hwctl_lock = 0xff;	/* lock status hardware control port */
 
+static void int_timer(void);
+static event_t timer_ev = { .ev_func = int_timer }; /* 10ms timer event */
+
 unix_connector_t ucons[NUMUSOC]; /* socket connections for SIO's */
 
 /*
@@ -168,6 +173,9 @@ void exit_io(void)
 {
 	register int i;
 
+	/* write the disk sectors still queued */
+	dwb_exit();
+
 	/* close line printer file */
 	if (printer != 0)
 		close(printer);
@@ -247,9 +255,9 @@ static void fp_out(BYTE data)
 /*
  *	timer interrupt causes RST 38 in IM 0 and IM 1
  */
-static void int_timer(int sig)
+static void int_timer(void)
 {
-	UNUSED(sig);
+	ev_repeat(&timer_ev, ev_us(10000));
 
 	int_int = true;
 	int_data = 0xff;	/* RST 38H for IM 0 */
@@ -279,9 +287,6 @@ static BYTE hwctl_in(void)
  */
 static void hwctl_out(BYTE data)
 {
-	static struct itimerval tim;
-	static struct sigaction newact;
-
 	/* if port is locked do nothing */
 	if (hwctl_lock && (data != 0xaa))
 		return;
@@ -313,25 +318,10 @@ static void hwctl_out(BYTE data)
 	}
 #endif
 
-	if (data & 1) {
-		newact.sa_handler = int_timer;
-		sigemptyset(&newact.sa_mask);
-		newact.sa_flags = 0;
-		sigaction(SIGALRM, &newact, NULL);
-		tim.it_value.tv_sec = 0;
-		tim.it_value.tv_usec = 10000;
-		tim.it_interval.tv_sec = 0;
-		tim.it_interval.tv_usec = 10000;
-		setitimer(ITIMER_REAL, &tim, NULL);
-	} else {
-		newact.sa_handler = SIG_IGN;
-		sigemptyset(&newact.sa_mask);
-		newact.sa_flags = 0;
-		sigaction(SIGALRM, &newact, NULL);
-		tim.it_value.tv_sec = 0;
-		tim.it_value.tv_usec = 0;
-		setitimer(ITIMER_REAL, &tim, NULL);
-	}
+	if (data & 1)
+		ev_schedule(&timer_ev, ev_us(10000));
+	else
+		ev_cancel(&timer_ev);
 }
 
 /*
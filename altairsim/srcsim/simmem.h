@@ -19,6 +19,7 @@
  * 31-JUL-2021 allow building machine without frontpanel
  * 29-AUG-2021 new memory configuration sections
  * 14-DEC-2024 added hardware breakpoint support
+ * 18-OCT-2026 breakpoints are checked in bitmaps
  */
 
 #ifndef SIMMEM_INC
@@ -92,8 +93,8 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && hb_test(hb_wr, addr))
+		hb_hit(addr, HB_WRITE);
 #endif
 
 	if (p_tab[addr >> 8] == MEM_RW) {
@@ -107,15 +108,8 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
-		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
-		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
-		}
-	}
+	if (hb_flag && !(cpu_bus & CPU_M1) && hb_test(hb_rd, addr))
+		hb_hit(addr, HB_READ);
 #endif
 
 	if (tarbell_rom_active && tarbell_rom_enabled) {
@@ -29,6 +29,7 @@ FDCOP	EQU	13		;fdc-port: command
 FDCST	EQU	14		;fdc-port: status
 DMAL	EQU	15		;dma-port: dma address low
 DMAH	EQU	16		;dma-port: dma address high
+FDCSC	EQU	18		;fdc-port: # of sectors for multi sector i/o
 ;
 	ORG	BIOS		;origin of this program
 ;
@@ -126,7 +127,7 @@ HDBLK:  DEFW    128		;sectors per track
 ;
 ;	messages
 ;
-SIGNON: DEFM	'64K CP/M Vers. 2.2 (Z80 CBIOS V1.2 for Z80SIM, '
+SIGNON: DEFM	'64K CP/M Vers. 2.2 (Z80 CBIOS V1.3 for Z80SIM, '
 	DEFM	'Copyright 1988-2007 by Udo Munk)'
 	DEFB	13,10,0
 ;
@@ -160,56 +161,28 @@ BOOT:   LD	SP,80H		;use space below buffer for stack
 	LD	(CDISK),A	;select disk zero
 	JP	GOCPM		;initialize and go to cp/m
 ;
-;	simplest case is to read the disk until all sectors loaded
+;	read the system tracks with one multi sector read
 ;
 WBOOT:  LD	SP,80H		;use space below buffer for stack
 	LD	C,0		;select disk 0
 	CALL	SELDSK
 	CALL	HOME		;go to track 00
-;
-	LD	B,NSECTS	;b counts # of sectors to load
-	LD	C,0		;c has the current track number
-	LD	D,2		;d has the next sector to read
 ;	note that we begin by reading track 0, sector 2 since sector 1
 ;	contains the cold start loader, which is skipped in a warm start
-	LD	HL,CCP		;base of cp/m (initial load point)
-LOAD1:				;load one more sector
-	PUSH	BC		;save sector count, current track
-	PUSH	DE		;save next sector to read
-	PUSH	HL		;save dma address
-	LD	C,D		;get sector address to register c
-	CALL	SETSEC		;set sector address from register c
-	POP	BC		;recall dma address to b,c
-	PUSH	BC		;replace on stack for later recall
-	CALL	SETDMA		;set dma address from b,c
-;	drive set to 0, track set, sector set, dma address set
-	CALL	READ
+	LD	C,2		;first sector to read
+	CALL	SETSEC
+	LD	BC,CCP		;base of cp/m (initial load point)
+	CALL	SETDMA
+	LD	A,NSECTS	;# of sectors to load, the fdc
+	OUT	(FDCSC),A	;continues with the next track
+	LD	A,2		;read multiple sectors command -> A
+	CALL	WAITIO
 	OR	A		;any errors?
-	JP	Z,LOAD2		;no, continue
+	JP	Z,GOCPM		;no, transfer to cp/m
 	LD	HL,LDERR	;error, print message
 	CALL	PRTMSG
 	DI			;and halt the machine
 	HALT
-;	no error, move to next sector
-LOAD2:	POP	HL		;recall dma address
-	LD	DE,128		;dma=dma+128
-	ADD	HL,DE		;new dma address is in h,l
-	POP	DE		;recall sector address
-	POP	BC		;recall number of sectors remaining,
-				;and current trk
-	DEC	B		;sectors=sectors-1
-	JP	Z,GOCPM		;transfer to cp/m if all have been loaded
-;	more sectors remain to load, check for track change
-	INC	D
-	LD	A,D		;sector=27?, if so, change tracks
-	CP	27
-	JP	C,LOAD1		;carry generated if sector<27
-;	end of current track, go to next track
-	LD	D,1		;begin with first sector of next track
-	INC	C		;track=track+1
-;	save register state, and change tracks
-	CALL	SETTRK		;track address set from register c
-	JP	LOAD1		;for another sector
 ;	end of load operation, set parameters and go to cp/m
 GOCPM:
 	LD	A,0C3H		;c3 is a jmp instruction
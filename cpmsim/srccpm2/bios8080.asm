@@ -29,6 +29,7 @@ FDCOP	EQU	13		;fdc-port: command
 FDCST	EQU	14		;fdc-port: status
 DMAL	EQU	15		;dma-port: dma address low
 DMAH	EQU	16		;dma-port: dma address high
+FDCSC	EQU	18		;fdc-port: # of sectors for multi sector i/o
 ;
 	ORG	1600H		;origin of this program
 ;
@@ -126,7 +127,7 @@ HDBLK:  DW	128		;sectors per track
 ;
 ;	message
 ;
-SIGNON: DB	'64K CP/M Vers. 2.2 (8080 CBIOS V1.2 for Z80SIM, '
+SIGNON: DB	'64K CP/M Vers. 2.2 (8080 CBIOS V1.3 for Z80SIM, '
 	DB	'Copyright 1988-2007 by Udo Munk)'
 	DB	13,10,0
 ;
@@ -161,56 +162,28 @@ BOOT:   LXI	SP,80H		;use space below buffer for stack
 	STA	CDISK		;select disk zero
 	JMP	GOCPM		;initialize and go to cp/m
 ;
-;	simplest case is to read the disk until all sectors loaded
+;	read the system tracks with one multi sector read
 ;
 WBOOT:  LXI	SP,80H		;use space below buffer for stack
 	MVI	C,0		;select disk 0
 	CALL	SELDSK
 	CALL	HOME		;go to track 00
-;
-	MVI	B,NSECTS	;b counts # of sectors to load
-	MVI	C,0		;c has the current track number
-	MVI	D,2		;d has the next sector to read
 ;	note that we begin by reading track 0, sector 2 since sector 1
 ;	contains the cold start loader, which is skipped in a warm start
-	LXI	H,CCP		;base of cp/m (initial load point)
-LOAD1:				;load one more sector
-	PUSH	B		;save sector count, current track
-	PUSH	D		;save next sector to read
-	PUSH	H		;save dma address
-	MOV	C,D		;get sector address to register c
-	CALL	SETSEC		;set sector address from register c
-	POP	B		;recall dma address to b,c
-	PUSH	B		;replace on stack for later recall
-	CALL	SETDMA		;set dma address from b,c
-;	drive set to 0, track set, sector set, dma address set
-	CALL	READ
+	MVI	C,2		;first sector to read
+	CALL	SETSEC
+	LXI	B,CCP		;base of cp/m (initial load point)
+	CALL	SETDMA
+	MVI	A,NSECTS	;# of sectors to load, the fdc
+	OUT	FDCSC		;continues with the next track
+	MVI	A,2		;read multiple sectors command -> A
+	CALL	WAITIO
 	ORA	A		;any errors?
-	JZ	LOAD2		;no, continue
+	JZ	GOCPM		;no, transfer to cp/m
 	LXI	H,LDERR		;error, print message
 	CALL	PRTMSG
 	DI			;and halt the machine
 	HLT
-;	no error, move to next sector
-LOAD2:	POP	H		;recall dma address
-	LXI	D,128		;dma=dma+128
-	DAD	D		;new dma address is in h,l
-	POP	D		;recall sector address
-	POP	B		;recall number of sectors remaining,
-				;and current trk
-	DCR	B		;sectors=sectors-1
-	JZ	GOCPM		;transfer to cp/m if all have been loaded
-;	more sectors remain to load, check for track change
-	INR	D
-	MOV	A,D		;sector=27?, if so, change tracks
-	CPI	27
-	JC	LOAD1		;carry generated if sector<27
-;	end of current track, go to next track
-	MVI	D,1		;begin with first sector of next track
-	INR	C		;track=track+1
-;	save register state, and change tracks
-	CALL	SETTRK		;track address set from register c
-	JMP	LOAD1		;for another sector
 ;	end of load operation, set parameters and go to cp/m
 GOCPM:
 	MVI	A,0C3H		;c3 is a jmp instruction
@@ -17,34 +17,32 @@ FDCOP   EQU	13		;fdc-port: command
 FDCST   EQU	14		;fdc-port: status
 DMAL    EQU	15		;dma-port: dma address low
 DMAH    EQU	16		;dma-port: dma address high
+FDCSC   EQU	18		;fdc-port: # of sectors for multi sector i/o
 ;
 	JP	COLD
 ;
 ERRMSG: DEFM	'BOOT: error booting'
 	DEFB	13,10,0
 ;
-;	begin the load operation
+;	begin the load operation, all sectors are read with one
+;	multi sector read
 ;
-COLD:	LD	C,2		;c=sector 2
-	LD	D,SECTS		;d=# sectors to load
-	LD	HL,BOOT		;base transfer address
-	LD	A,0		;select drive A
+COLD:	XOR	A		;select drive A
 	OUT	(DRIVE),A
-	OUT	(TRACK),A	;set track 0
-;
-;	load the next sector
-;
-LSECT:	LD	A,C		;set sector
+	OUT	(TRACK),A	;track 0
+	LD	A,2		;sector 2
 	OUT	(SECTOR),A
-	LD	A,L		;set dma address low
+	LD	A,BOOT AND 0FFH	;set dma address low
 	OUT	(DMAL),A
-	LD	A,H		;set dma address high
+	LD	A,BOOT SHR 8	;set dma address high
 	OUT	(DMAH),A
-	XOR	A		;read sector
+	LD	A,SECTS		;# sectors to load
+	OUT	(FDCSC),A
+	LD	A,2		;read multiple sectors
 	OUT	(FDCOP),A
 	IN	A,(FDCST)	;get status of fdc
 	OR	A		;read successful ?
-	JP	Z,CONT		;yes, continue
+	JP	Z,BOOT		;yes, head for cpmldr
 	LD	HL,ERRMSG	;no, print error
 PRTMSG:	LD	A,(HL)
 	OR	A
@@ -54,20 +52,5 @@ PRTMSG:	LD	A,(HL)
 	JP	PRTMSG
 STOP:	DI
 	HALT			;and halt cpu
-;
-CONT:
-				;go to next sector if load is incomplete
-	DEC	D		;sects=sects-1
-	JP	Z,BOOT		;head for cpmldr
-;
-;	more sectors to load
-;
-;	we aren't using a stack, so use <sp> as scratch register
-;	to hold the load address increment
-;
-	LD	SP,128		;128 bytes per sector
-	ADD	HL,SP		;<hl> = <hl> + 128
-	INC	C		;sector = sector + 1
-	JP	LSECT		;go read another
 ;
 	END			;of boot loader
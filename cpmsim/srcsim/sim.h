@@ -15,6 +15,7 @@
 #define CPU_SPEED 0	/* default CPU speed 0=unlimited */
 /*#define ALT_I8080*/	/* use alt. 8080 sim. primarily optimized for size */
 /*#define ALT_Z80*/	/* use alt. Z80 sim. primarily optimized for size */
+/*#define THR_Z80*/	/* use threaded Z80 sim. primarily optimized for speed */
 #define UNDOC_INST	/* compile undocumented instrs. (required by ALT_*) */
 #ifndef EXCLUDE_Z80
 #define FAST_BLOCK	/* much faster but not accurate Z80 block instr. */
@@ -26,9 +27,12 @@
 /*#define HISIZE  1000*//* no history */
 /*#define SBSIZE  10*/	/* no software breakpoints */
 /*#define WANT_HB*/	/* no hardware breakpoint */
+/*#define WANT_PROF*/	/* no execution profiler */
 #endif
 
 #define HAS_DISKS	/* uses disk images */
+#define HAS_FORKSRV	/* fork server for batch jobs, -j */
+#define HAS_SNAPSHOT	/* saves its full state in snapshots, -s/-l */
 /*#define HAS_CONFIG*/	/* has no configuration file */
 
 #define PIPES		/* use named pipes for auxiliary device */
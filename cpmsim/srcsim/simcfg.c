@@ -8,8 +8,80 @@
  *
  * History:
  * 20-DEC-2016 dummy, no configuration implemented yet
+ * 18-OCT-2026 flush policy of the mapped disk images configurable
  */
 
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simio.h"
+#include "simcfg.h"
+
+/* #define LOG_LOCAL_LEVEL LOG_DEBUG */
+#include "log.h"
+static const char *TAG = "config";
+
+#define BUFSIZE 256		/* max line length of command buffer */
+
+static const char *flush_name[] = { "none", "async", "sync" };
+
 void config(void)
 {
+	FILE *fp;
+	char buf[BUFSIZE];
+	char *s, *t1, *t2, *t3;
+	char fn[MAX_LFN - 1];
+	int i, d;
+
+	strcpy(fn, confdir);
+	strcat(fn, "/system.conf");
+
+	if ((fp = fopen(fn, "r")) == NULL)
+		return;
+
+	while (fgets(buf, BUFSIZE, fp) != NULL) {
+		s = buf;
+		if ((*s == '\n') || (*s == '\r') || (*s == '#'))
+			continue;
+		if ((t1 = strtok(s, " \t")) == NULL) {
+			LOGW(TAG, "missing command");
+			continue;
+		}
+		if ((t2 = strtok(NULL, " \t,")) == NULL) {
+			LOGW(TAG, "missing parameter for %s", t1);
+			continue;
+		}
+		if (!strcmp(t1, "disk_flush")) {
+			if ((t3 = strtok(NULL, " \t,\r\n")) == NULL) {
+				LOGW(TAG, "missing policy for %s %s", t1, t2);
+				continue;
+			}
+			d = toupper((unsigned char) *t2) - 'A';
+			if (t2[1] != '\0' || d < 0 || d > 15) {
+				LOGW(TAG, "invalid drive for %s: %s", t1, t2);
+				continue;
+			}
+			for (i = DSK_FLUSH_NONE; i <= DSK_FLUSH_SYNC; i++)
+				if (!strcmp(t3, flush_name[i]))
+					break;
+			if (i > DSK_FLUSH_SYNC) {
+				LOGW(TAG, "invalid value for %s %s: %s",
+				     t1, t2, t3);
+				continue;
+			}
+			disks[d].flush = i;
+		} else
+			LOGW(TAG, "unknown command: %s", t1);
+	}
+
+	fclose(fp);
+
+	for (d = 0; d <= 15; d++)
+		if (disks[d].flush != DSK_FLUSH_NONE)
+			LOG(TAG, "Disk %c flush policy: %s\r\n", d + 'A',
+			    flush_name[disks[d].flush]);
 }
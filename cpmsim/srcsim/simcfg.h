@@ -8,6 +8,7 @@
  *
  * History:
  * 20-DEC-2016 dummy, no configuration implemented yet
+ * 18-OCT-2026 flush policy of the mapped disk images configurable
  */
 
 #ifndef SIMCFG_INC
@@ -58,6 +58,18 @@
  * 08-OCT-2019 (Mike Douglas) added OUT 161 trap to simbdos.c for host file I/O
  * 24-OCT-2019 move RTC to I/O module for usage by any machine
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 18-OCT-2026 disk images are memory mapped
+ * 18-OCT-2026 added FDC commands for multiple sector I/O
+ * 18-OCT-2026 MMU changes re-map the page table
+ * 18-OCT-2026 10ms timer runs in simulated time
+ * 18-OCT-2026 idle console polling is detected in the core
+ * 18-OCT-2026 save the FDC and timer into snapshots
+ * 18-OCT-2026 disk images are private in jobs of the fork server
+ * 18-OCT-2026 stop the CPU on EOF of console 0
+ * 18-OCT-2026 console 0 input for batch mode
+ * 18-OCT-2026 console 0 input is received by the reactor thread
+ * 18-OCT-2026 output is sent by the reactor thread
+ * 18-OCT-2026 end of the input ends a batch run with status 4
  */
 
 /*
@@ -85,6 +97,7 @@
  *	16 - DMA destination address high
  *
  *	17 - FDC sector high
+ *	18 - FDC sector count for multiple sector I/O
  *
  *	20 - MMU initialization
  *	21 - MMU bank select
@@ -120,7 +133,7 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <sys/stat.h>
-#include <sys/time.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 
 #include "sim.h"
@@ -131,7 +144,11 @@
 #include "simctl.h"
 #include "simport.h"
 #include "simio.h"
+#include "simevent.h"
+#include "simsnap.h"
+#include "simfork.h"
 
+#include "unix_reactor.h"
 #include "rtc80.h"
 #include "simbdos.h"
 
@@ -149,16 +166,17 @@
 static const char *TAG = "IO";
 
 #define BUFSIZE 256		/* max line length of command buffer */
-#define MAX_BUSY_COUNT 10	/* max counter to detect I/O busy waiting
-				   on the console status port */
+#define BATCH_POLLS 16		/* console polls until input in batch mode */
 
 static BYTE drive;		/* current drive A..P (0..15) */
 static BYTE track;		/* current track (0..255) */
 static unsigned int sector;	/* current sector (0..65535) */
+static BYTE seccnt;		/* sector count for multiple sector I/O */
 static BYTE status;		/* status of last I/O operation on FDC */
 static BYTE dmadl;		/* current DMA address destination low */
 static BYTE dmadh;		/* current DMA address destination high */
 static BYTE timer;		/* 10ms timer */
+static int batch_polls;		/* console polls without console I/O */
 static int drivea;		/* fd for file "drivea.dsk" */
 static int driveb;		/* fd for file "driveb.dsk" */
 static int drivec;		/* fd for file "drivec.dsk" */
@@ -176,6 +194,7 @@ static int driven;		/* fd for file "driven.dsk" */
 static int driveo;		/* fd for file "driveo.dsk" */
 static int drivep;		/* fd for file "drivep.dsk" */
 static int printer;		/* fd for file "printer.txt" */
+static int printer_tx = -1;	/* transmit channel for printer */
 static char fn[MAX_LFN];	/* path/filename for disk images */
 static int speed;		/* to reset CPU speed */
 static BYTE hwctl_lock = 0xff;	/* lock status hardware control port */
@@ -183,12 +202,14 @@ static BYTE hwctl_lock = 0xff;	/* lock status hardware control port */
 #ifdef PIPES
 static int auxin;		/* fd for pipe "auxin" */
 static int auxout;		/* fd for pipe "auxout" */
+static int auxout_tx = -1;	/* transmit channel for auxout */
 static int aux_in_eof;		/* status of pipe "auxin" (<>0 means EOF) */
 static int pid_rec;		/* PID of the receiving process for auxiliary */
 #else
 static int aux_in;		/* fd for file "auxiliaryin.txt" */
 static int aux_in_lf;		/* linefeed flag for aux_in */
 static int aux_out;		/* fd for file "auxiliaryout.txt" */
+static int aux_out_tx = -1;	/* transmit channel for aux_out */
 #endif
 
 #ifdef NETWORKING
@@ -197,9 +218,11 @@ static int aux_out;		/* fd for file "auxiliaryout.txt" */
 
 static int ss[NUMSOC];		/* server socket descriptors */
 static int ssc[NUMSOC];		/* connected server socket descriptors */
+static int ssc_tx[NUMSOC];	/* transmit channels for ssc */
 static int ss_port[NUMSOC];	/* TCP/IP port for server sockets */
 static int ss_telnet[NUMSOC];	/* telnet protocol flag for server sockets */
 static int cs;			/* client socket #1 descriptor */
+static int cs_tx = -1;		/* transmit channel for cs */
 static int cs_port;		/* TCP/IP port for cs */
 static char cs_host[BUFSIZE];	/* hostname for cs */
 
@@ -214,22 +237,22 @@ static int sdirection = -1; /* protocol direction, 0 = send 1 = receive */
 #endif /* NETWORKING */
 
 dskdef_t disks[16] = {
-	{ "drivea.dsk", &drivea, 77, 26 },
-	{ "driveb.dsk", &driveb, 77, 26 },
-	{ "drivec.dsk", &drivec, 77, 26 },
-	{ "drived.dsk", &drived, 77, 26 },
-	{ "drivee.dsk", &drivee,  0,  0 },
-	{ "drivef.dsk", &drivef,  0,  0 },
-	{ "driveg.dsk", &driveg,  0,  0 },
-	{ "driveh.dsk", &driveh,  0,  0 },
-	{ "drivei.dsk", &drivei, 255, 128 },
-	{ "drivej.dsk", &drivej, 255, 128 },
-	{ "drivek.dsk", &drivek, 255, 128 },
-	{ "drivel.dsk", &drivel, 255, 128 },
-	{ "drivem.dsk", &drivem,  0,  0 },
-	{ "driven.dsk", &driven,  0,  0 },
-	{ "driveo.dsk", &driveo,  0,  0 },
-	{ "drivep.dsk", &drivep, 256, 16384 }
+	{ "drivea.dsk", &drivea, 77, 26, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "driveb.dsk", &driveb, 77, 26, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivec.dsk", &drivec, 77, 26, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drived.dsk", &drived, 77, 26, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivee.dsk", &drivee,  0,  0, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivef.dsk", &drivef,  0,  0, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "driveg.dsk", &driveg,  0,  0, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "driveh.dsk", &driveh,  0,  0, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivei.dsk", &drivei, 255, 128, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivej.dsk", &drivej, 255, 128, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivek.dsk", &drivek, 255, 128, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivel.dsk", &drivel, 255, 128, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivem.dsk", &drivem,  0,  0, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "driven.dsk", &driven,  0,  0, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "driveo.dsk", &driveo,  0,  0, DSK_FLUSH_NONE, false, NULL, 0 },
+	{ "drivep.dsk", &drivep, 256, 16384, DSK_FLUSH_NONE, false, NULL, 0 }
 };
 
 /*
@@ -251,8 +274,18 @@ static BYTE fdcsh_in(void);
 static void fdcsh_out(BYTE data);
 static BYTE fdco_in(void);
 static void fdco_out(BYTE data);
+static BYTE fdc_check(void);
+static void fdc_multi(BYTE cmd);
+static BYTE fdc_sector(BYTE cmd, WORD addr);
+static void map_disk(int i);
+static void flush_disk(int i, off_t pos);
+#ifdef HAS_FORKSRV
+static void fork_disks(void);
+#endif
 static BYTE fdcx_in(void);
 static void fdcx_out(BYTE data);
+static BYTE fdcn_in(void);
+static void fdcn_out(BYTE data);
 static BYTE dmal_in(void);
 static void dmal_out(BYTE data);
 static BYTE dmah_in(void);
@@ -283,16 +316,22 @@ static void netd1_out(BYTE data), nets1_out(BYTE data);
 /*
  *	Forward declaration of support functions
  */
-static void int_timer(int sig);
+static void int_timer(void);
+static void save_io(void);
+static bool load_io(snap_chunk_t *c);
 
 #ifdef NETWORKING
 static void net_server_config(void), net_client_config(void);
 static void init_server_socket(int n), telnet_negotiation(int fd);
+static bool sock_put(int *fd, int *tx, BYTE data);
+static void sock_close(int *fd, int *tx);
 #ifdef TCPASYNC
 static void int_io(int sig);
 #endif
 #endif
 
+static event_t timer_ev = { .ev_func = int_timer }; /* 10ms timer event */
+
 /*
  *	This array contains function pointers for every
  *	input port.
@@ -312,6 +351,7 @@ in_func_t *const port_in[256] = {
 	[ 15] = dmal_in,
 	[ 16] = dmah_in,
 	[ 17] = fdcsh_in,
+	[ 18] = fdcn_in,
 	[ 20] = mmui_in,
 	[ 21] = mmus_in,
 	[ 22] = mmuc_in,
@@ -354,6 +394,7 @@ out_func_t *const port_out[256] = {
 	[ 15] = dmal_out,
 	[ 16] = dmah_out,
 	[ 17] = fdcsh_out,
+	[ 18] = fdcn_out,
 	[ 20] = mmui_out,
 	[ 21] = mmus_out,
 	[ 22] = mmuc_out,
@@ -385,7 +426,8 @@ out_func_t *const port_out[256] = {
  *	2. Fork the process for receiving from the auxiliary serial port.
  *	3. Open the named pipes "auxin" and "auxout" for simulation
  *	   of the auxiliary serial port.
- *	4. Open the files which emulate the disk drives.
+ *	4. Open the files which emulate the disk drives and map
+ *	   them into memory.
  *	   Errors for opening one of the drives results
  *	   in a NULL pointer for fd in the dskdef structure,
  *	   so that this drive can't be used.
@@ -458,9 +500,15 @@ void init_io(void)
 		strcat(fn, "/");
 		strcat(fn, disks[i].fn);
 
-		if ((*disks[i].fd = open(fn, O_RDWR)) == -1)
-			if ((*disks[i].fd = open(fn, O_RDONLY)) == -1)
+		disks[i].ro = false;
+		if ((*disks[i].fd = open(fn, O_RDWR)) == -1) {
+			if ((*disks[i].fd = open(fn, O_RDONLY)) == -1) {
 				disks[i].fd = NULL;
+				continue;
+			}
+			disks[i].ro = true;
+		}
+		map_disk(i);
 	}
 
 #ifdef NETWORKING
@@ -474,9 +522,57 @@ void init_io(void)
 	sigaction(SIGIO, &newact, NULL);
 #endif
 
-	for (i = 0; i < NUMSOC; i++)
+	for (i = 0; i < NUMSOC; i++) {
+		ssc_tx[i] = -1;
 		init_server_socket(i);
+	}
 #endif /* NETWORKING */
+
+	snap_register("IO  ", save_io, load_io);
+#ifdef HAS_FORKSRV
+	fork_register(fork_disks);
+#endif
+}
+
+/*
+ *	Save the state of the FDC and the timer into a snapshot
+ */
+static void save_io(void)
+{
+	BYTE regs[8] = { drive, track, sector & 0xff, sector >> 8, seccnt,
+			 status, dmadl, dmadh };
+
+	snap_put(regs, sizeof(regs));
+	snap_put(&timer, sizeof(timer));
+	snap_put(&hwctl_lock, sizeof(hwctl_lock));
+}
+
+/*
+ *	Load the state of the FDC and the timer from a snapshot
+ */
+static bool load_io(snap_chunk_t *c)
+{
+	BYTE regs[8];
+
+	if (!snap_get(c, regs, sizeof(regs)) ||
+	    !snap_get(c, &timer, sizeof(timer)) ||
+	    !snap_get(c, &hwctl_lock, sizeof(hwctl_lock)))
+		return false;
+
+	drive = regs[0];
+	track = regs[1];
+	sector = regs[2] | (regs[3] << 8);
+	seccnt = regs[4];
+	status = regs[5];
+	dmadl = regs[6];
+	dmadh = regs[7];
+
+	if (timer)
+		ev_schedule(&timer_ev, ev_us(10000));
+	else
+		ev_cancel(&timer_ev);
+
+	return true;
 }
 
 #ifdef NETWORKING
@@ -603,12 +699,41 @@ static void net_client_config(void)
 		fclose(fp);
 	}
 }
+
+/*
+ *	Put a byte for output to the connected socket *fd into its
+ *	transmit channel *tx, which is opened when used the first
+ *	time, the output is lost if the socket isn't connected
+ */
+static bool sock_put(int *fd, int *tx, BYTE data)
+{
+	if (*fd == 0)
+		return true;
+
+	if (*tx == -1 && (*tx = tx_open(*fd)) == -1)
+		return false;
+
+	return tx_put(*tx, data);
+}
+
+/*
+ *	Close the connected socket *fd and its transmit channel *tx
+ */
+static void sock_close(int *fd, int *tx)
+{
+	if (*tx != -1) {
+		tx_close(*tx);
+		*tx = -1;
+	}
+	close(*fd);
+	*fd = 0;
+}
 #endif /* NETWORKING */
 
 /*
  *	This function stops the I/O handlers:
  *
- *	1. The files emulating the disk drives are closed.
+ *	1. The files emulating the disk drives are unmapped and closed.
  *	2. The file "printer.txt" emulating a printer is closed.
  *	3. The named pipes "auxin" and "auxout" are closed.
  *	4. The receiving process for the aux serial port is stopped.
@@ -619,14 +744,24 @@ void exit_io(void)
 	register int i;
 
 	for (i = 0; i <= 15; i++)
-		if (disks[i].fd != NULL)
+		if (disks[i].fd != NULL) {
+			if (disks[i].map != NULL) {
+				munmap(disks[i].map, disks[i].size);
+				disks[i].map = NULL;
+			}
 			close(*disks[i].fd);
+		}
 
-	if (printer != 0)
+	if (printer != 0) {
+		if (printer_tx != -1)
+			tx_close(printer_tx);
 		close(printer);
+	}
 
 #ifdef PIPES
 	close(auxin);
+	if (auxout_tx != -1)
+		tx_close(auxout_tx);
 	close(auxout);
 	kill(pid_rec, SIGHUP);
 #endif
@@ -634,9 +769,9 @@ void exit_io(void)
 #ifdef NETWORKING
 	for (i = 0; i < NUMSOC; i++)
 		if (ssc[i])
-			close(ssc[i]);
+			sock_close(&ssc[i], &ssc_tx[i]);
 	if (cs)
-		close(cs);
+		sock_close(&cs, &cs_tx);
 #endif
 }
 
@@ -658,6 +793,7 @@ void reset_system(void)
 	}
 	selbnk = 0;
 	segsize = SEGSIZ;
+	map_memory();
 
 	/* reset CPU */
 	reset_cpu();
@@ -670,21 +806,21 @@ void reset_system(void)
  *	I/O handler for read console 0 status:
  *	0xff : input available
  *	0x00 : no input available
+ *
+ *	In batch mode the input of the script is available only, when
+ *	the status was polled several times without console I/O in
+ *	between, that is when the program waits for input. Otherwise
+ *	programs checking for a key to abort output would eat the
+ *	following input of the script.
  */
 static BYTE cons_in(void)
 {
-	struct pollfd p[1];
+	int ch;
 
-	if (++busy_loop_cnt >= MAX_BUSY_COUNT) {
-		sleep_for_ms(1);
-		busy_loop_cnt = 0;
-	}
+	if (B_flag && ++batch_polls < BATCH_POLLS)
+		return (BYTE) 0x00;
 
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (p[0].revents & POLLIN)
+	if ((ch = rx_stdin()) != -1 && rx_ready(ch))
 		return (BYTE) 0xff;
 	else
 		return (BYTE) 0x00;
@@ -745,17 +881,16 @@ ss0_done:
 
 	if (ssc[0] != 0) {
 		p[0].fd = ssc[0];
-		p[0].events = POLLIN | POLLOUT;
+		p[0].events = POLLIN;
 		p[0].revents = 0;
 		poll(p, 1, 0);
 		if (p[0].revents & POLLHUP) {
-			close(ssc[0]);
-			ssc[0] = 0;
+			sock_close(&ssc[0], &ssc_tx[0]);
 			return 0;
 		}
 		if (p[0].revents & POLLIN)
 			status |= 1;
-		if (p[0].revents & POLLOUT)
+		if (ssc_tx[0] == -1 || tx_ready(ssc_tx[0]))
 			status |= 2;
 	}
 #endif /* NETWORKING */
@@ -817,17 +952,16 @@ ss1_done:
 
 	if (ssc[1] != 0) {
 		p[0].fd = ssc[1];
-		p[0].events = POLLIN | POLLOUT;
+		p[0].events = POLLIN;
 		p[0].revents = 0;
 		poll(p, 1, 0);
 		if (p[0].revents & POLLHUP) {
-			close(ssc[1]);
-			ssc[1] = 0;
+			sock_close(&ssc[1], &ssc_tx[1]);
 			return 0;
 		}
 		if (p[0].revents & POLLIN)
 			status |= 1;
-		if (p[0].revents & POLLOUT)
+		if (ssc_tx[1] == -1 || tx_ready(ssc_tx[1]))
 			status |= 2;
 	}
 #endif /* NETWORKING */
@@ -889,17 +1023,16 @@ ss2_done:
 
 	if (ssc[2] != 0) {
 		p[0].fd = ssc[2];
-		p[0].events = POLLIN | POLLOUT;
+		p[0].events = POLLIN;
 		p[0].revents = 0;
 		poll(p, 1, 0);
 		if (p[0].revents & POLLHUP) {
-			close(ssc[2]);
-			ssc[2] = 0;
+			sock_close(&ssc[2], &ssc_tx[2]);
 			return 0;
 		}
 		if (p[0].revents & POLLIN)
 			status |= 1;
-		if (p[0].revents & POLLOUT)
+		if (ssc_tx[2] == -1 || tx_ready(ssc_tx[2]))
 			status |= 2;
 	}
 #endif /* NETWORKING */
@@ -961,17 +1094,16 @@ ss3_done:
 
 	if (ssc[3] != 0) {
 		p[0].fd = ssc[3];
-		p[0].events = POLLIN | POLLOUT;
+		p[0].events = POLLIN;
 		p[0].revents = 0;
 		poll(p, 1, 0);
 		if (p[0].revents & POLLHUP) {
-			close(ssc[3]);
-			ssc[3] = 0;
+			sock_close(&ssc[3], &ssc_tx[3]);
 			return 0;
 		}
 		if (p[0].revents & POLLIN)
 			status |= 1;
-		if (p[0].revents & POLLOUT)
+		if (ssc_tx[3] == -1 || tx_ready(ssc_tx[3]))
 			status |= 2;
 	}
 #endif /* NETWORKING */
@@ -1035,17 +1167,16 @@ static BYTE nets1_in(void)
 
 	if (cs != 0) {
 		p[0].fd = cs;
-		p[0].events = POLLIN | POLLOUT;
+		p[0].events = POLLIN;
 		p[0].revents = 0;
 		poll(p, 1, 0);
 		if (p[0].revents & POLLHUP) {
-			close(cs);
-			cs = 0;
+			sock_close(&cs, &cs_tx);
 			return (BYTE) 0;
 		}
 		if (p[0].revents & POLLIN)
 			status |= 1;
-		if (p[0].revents & POLLOUT)
+		if (cs_tx == -1 || tx_ready(cs_tx))
 			status |= 2;
 	}
 #endif /* NETWORKING */
@@ -1111,11 +1242,41 @@ static void nets1_out(BYTE data)
  */
 static BYTE cond_in(void)
 {
-	char c;
+	int ch, c = RX_EOF;
 
 	busy_loop_cnt = 0;
-	if (read(fileno(stdin), &c, 1) != 1)
+	batch_polls = 0;
+#ifdef HAS_FORKSRV
+	/* booted and waiting for input, start the fork server */
+	if (j_flag && cons_in() == 0) {
+		fork_server();
+		if (cpu_error != NONE)
+			return (BYTE) 0;
+	}
+#endif
+	if ((ch = rx_stdin()) != -1) {
+		/* stop, if no input arrives in the time given with -I */
+		if (!rx_wait(ch, I_value ? I_value : -1)) {
+			if (cpu_error == NONE) {
+				cpu_error = IDLETIME;
+				cpu_state = ST_STOPPED;
+			}
+			return (BYTE) 0;
+		}
+		c = rx_get(ch);
+	}
+	if (c == RX_EOF && B_flag) {
+		/* end of the input script ends a batch run */
+		cpu_error = INPUTEOF;
+		cpu_state = ST_STOPPED;
+		return (BYTE) 0;
+	}
+	if (c < 0) {
 		LOGE(TAG, "can't read console 0");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
+		return (BYTE) 0;
+	}
 	return (BYTE) c;
 }
 
@@ -1130,8 +1291,7 @@ static BYTE cond1_in(void)
 
 	if (read(ssc[0], &c, 1) != 1) {
 		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[0]);
-			ssc[0] = 0;
+			sock_close(&ssc[0], &ssc_tx[0]);
 			return (BYTE) 0;
 		} else {
 			LOGE(TAG, "can't read console 1");
@@ -1167,8 +1327,7 @@ static BYTE cond2_in(void)
 
 	if (read(ssc[1], &c, 1) != 1) {
 		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[1]);
-			ssc[1] = 0;
+			sock_close(&ssc[1], &ssc_tx[1]);
 			return (BYTE) 0;
 		} else {
 			LOGE(TAG, "can't read console 2");
@@ -1204,8 +1363,7 @@ static BYTE cond3_in(void)
 
 	if (read(ssc[2], &c, 1) != 1) {
 		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[2]);
-			ssc[2] = 0;
+			sock_close(&ssc[2], &ssc_tx[2]);
 			return (BYTE) 0;
 		} else {
 			LOGE(TAG, "can't read console 3");
@@ -1241,8 +1399,7 @@ static BYTE cond4_in(void)
 
 	if (read(ssc[3], &c, 1) != 1) {
 		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[3]);
-			ssc[3] = 0;
+			sock_close(&ssc[3], &ssc_tx[3]);
 			return (BYTE) 0;
 		} else {
 			LOGE(TAG, "can't read console 4");
@@ -1300,15 +1457,13 @@ static BYTE netd1_in(void)
  */
 static void cond_out(BYTE data)
 {
-again:
-	if (write(fileno(stdout), (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 0");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	int ch;
+
+	batch_polls = 0;
+	if ((ch = tx_stdout()) == -1 || !tx_put(ch, data)) {
+		LOGE(TAG, "can't write console 0");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 }
 
@@ -1326,15 +1481,10 @@ static void cond1_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[0], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 1");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if (!sock_put(&ssc[0], &ssc_tx[0], data)) {
+		LOGE(TAG, "can't write console 1");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 #else /* !NETWORKING */
 	UNUSED(data);
@@ -1355,15 +1505,10 @@ static void cond2_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[1], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 2");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if (!sock_put(&ssc[1], &ssc_tx[1], data)) {
+		LOGE(TAG, "can't write console 2");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 #else /* !NETWORKING */
 	UNUSED(data);
@@ -1384,15 +1529,10 @@ static void cond3_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[2], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 3");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if (!sock_put(&ssc[2], &ssc_tx[2], data)) {
+		LOGE(TAG, "can't write console 3");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 #else /* !NETWORKING */
 	UNUSED(data);
@@ -1413,15 +1553,10 @@ static void cond4_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[3], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 4");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if (!sock_put(&ssc[3], &ssc_tx[3], data)) {
+		LOGE(TAG, "can't write console 4");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 #else /* !NETWORKING */
 	UNUSED(data);
@@ -1442,15 +1577,10 @@ static void netd1_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(cs, (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write client socket");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if (!sock_put(&cs, &cs_tx, data)) {
+		LOGE(TAG, "can't write client socket");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 #else /* !NETWORKING */
 	UNUSED(data);
@@ -1501,15 +1631,12 @@ static void prtd_out(BYTE data)
 	}
 
 	if (data != '\r') {
-again:
-		if (write(printer, (char *) &data, 1) != 1) {
-			if (errno == EINTR) {
-				goto again;
-			} else {
-				LOGE(TAG, "can't write to printer.txt");
-				cpu_error = IOERROR;
-				cpu_state = ST_STOPPED;
-			}
+		if ((printer_tx == -1 &&
+		     (printer_tx = tx_open(printer)) == -1) ||
+		    !tx_put(printer_tx, data)) {
+			LOGE(TAG, "can't write to printer.txt");
+			cpu_error = IOERROR;
+			cpu_state = ST_STOPPED;
 		}
 	}
 }
@@ -1596,7 +1723,9 @@ static void auxd_out(BYTE data)
 		return;
 
 	if (data != '\r')
-		if (write(auxout, (char *) &data, 1) != 1)
+		if ((auxout_tx == -1 &&
+		     (auxout_tx = tx_open(auxout)) == -1) ||
+		    !tx_put(auxout_tx, data))
 			LOGE(TAG, "can't write to auxout pipe");
 #else
 	if (data == 0)
@@ -1612,13 +1741,19 @@ static void auxd_out(BYTE data)
 	}
 
 	if (data == 0x1a) {
+		if (aux_out_tx != -1) {
+			tx_close(aux_out_tx);
+			aux_out_tx = -1;
+		}
 		close(aux_out);
 		aux_out = 0;
 		return;
 	}
 
 	if (data != '\r')
-		if (write(aux_out, (char *) &data, 1) != 1)
+		if ((aux_out_tx == -1 &&
+		     (aux_out_tx = tx_open(aux_out)) == -1) ||
+		    !tx_put(aux_out_tx, data))
 			LOGE(TAG, "can't write to auxiliaryout.txt");
 #endif
 }
@@ -1695,6 +1830,25 @@ static void fdcsh_out(BYTE data)
 	sector = (sector & 0xff) + (data << 8);
 }
 
+/*
+ *	I/O handler for read FDC sector count:
+ *	return the sector count for multiple sector I/O
+ */
+static BYTE fdcn_in(void)
+{
+	return seccnt;
+}
+
+/*
+ *	I/O handler for write FDC sector count:
+ *	set the sector count for multiple sector I/O,
+ *	0 = up to the end of the track
+ */
+static void fdcn_out(BYTE data)
+{
+	seccnt = data;
+}
+
 /*
  *	I/O handler for read FDC command:
  *	always returns 0
@@ -1706,8 +1860,10 @@ static BYTE fdco_in(void)
 
 /*
  *	I/O handler for write FDC command:
- *	transfer one sector in the wanted direction,
- *	0 = read, 1 = write
+ *	0 = read one sector
+ *	1 = write one sector
+ *	2 = read the number of sectors set with the sector count port
+ *	3 = write the number of sectors set with the sector count port
  *
  *	The status byte of the FDC is set as follows:
  *	  0 - ok
@@ -1718,53 +1874,209 @@ static BYTE fdco_in(void)
  *	  5 - read error
  *	  6 - write error
  *	  7 - invalid command to FDC
+ *	  8 - DMA overrun
  */
 static void fdco_out(BYTE data)
+{
+	switch (data) {
+	case 0:	/* read */
+	case 1:	/* write */
+		status = fdc_sector(data, (dmadh << 8) + dmadl);
+		break;
+	case 2:	/* read multiple sectors */
+	case 3:	/* write multiple sectors */
+		fdc_multi(data - 2);
+		break;
+	default:	/* invalid command */
+		if ((status = fdc_check()) == 0)
+			status = 7;
+		break;
+	}
+}
+
+/*
+ *	Check the drive, track and sector registers, so that a missing
+ *	disk or a bad position is reported before a bad command
+ */
+static BYTE fdc_check(void)
+{
+	if (disks[drive].fd == NULL)
+		return 1;
+	if (track > disks[drive].tracks)
+		return 2;
+	if (sector > disks[drive].sectors)
+		return 3;
+	return 0;
+}
+
+/*
+ *	Transfer the sectors of a multiple sector command, starting
+ *	with the current track and sector at the current DMA address.
+ *	A sector count of 0 transfers the rest of the track, the
+ *	transfer continues at sector 1 of the next track when the
+ *	end of a track is reached.
+ *
+ *	Afterwards track, sector and DMA address are set to the next
+ *	sector not transferred, and the sector count to the number of
+ *	sectors not transferred, so that the failing sector can be
+ *	found in case of an error. Transfers which would wrap around
+ *	the end of memory aren't started and return a DMA overrun.
+ */
+static void fdc_multi(BYTE cmd)
+{
+	register int n;
+	WORD addr = (dmadh << 8) + dmadl;
+
+	if ((status = fdc_check()) != 0)
+		return;
+	if ((n = seccnt) == 0)
+		n = (int) disks[drive].sectors - (int) sector + 1;
+
+	if (addr + (n << 7) > 65536) {
+		status = 8;
+		return;
+	}
+
+	status = 0;
+	while (n > 0) {
+		if ((status = fdc_sector(cmd, addr)) != 0)
+			break;
+		addr += 128;
+		n--;
+		if (++sector > disks[drive].sectors) {
+			sector = 1;
+			track++;
+		}
+	}
+
+	seccnt = (BYTE) n;
+	dmadl = addr & 0xff;
+	dmadh = addr >> 8;
+}
+
+/*
+ *	Transfer the current sector from/to addr, 0 = read, 1 = write,
+ *	and return the status of the operation.
+ *
+ *	Sectors of mapped disk images are copied from/to memory,
+ *	the others and those beyond the end of the mapping are
+ *	transferred with read/write calls.
+ */
+static BYTE fdc_sector(BYTE cmd, WORD addr)
 {
 	register int i;
 	off_t pos;
 	static char buf[128];
 
-	if (disks[drive].fd == NULL) {
-		status = 1;
-		return;
+	if ((i = fdc_check()) != 0)
+		return i;
+	pos = (((off_t) track) * ((off_t) disks[drive].sectors) + sector - 1) << 7;
+	if (disks[drive].map != NULL && pos + 128 <= (off_t) disks[drive].size) {
+		if (cmd == 0) {
+			dma_write_block(addr, disks[drive].map + pos, 128);
+			return 0;
+		}
+		if (disks[drive].ro)
+			return 6;
+		dma_read_block(addr, disks[drive].map + pos, 128);
+		flush_disk(drive, pos);
+		return 0;
+	}
+	if (lseek(*disks[drive].fd, pos, SEEK_SET) == -1L)
+		return 4;
+	if (cmd == 0) {
+		if (read(*disks[drive].fd, buf, 128) != 128)
+			return 5;
+		for (i = 0; i < 128; i++)
+			dma_write(addr + i, buf[i]);
+	} else {
+		for (i = 0; i < 128; i++)
+			buf[i] = dma_read(addr + i);
+		if (write(*disks[drive].fd, buf, 128) != 128)
+			return 6;
 	}
-	if (track > disks[drive].tracks) {
-		status = 2;
+	return 0;
+}
+
+/*
+ *	Map the image of disk drive i into memory, if this isn't
+ *	possible the drive is used with read/write calls
+ */
+static void map_disk(int i)
+{
+	struct stat sbuf;
+	void *p;
+
+	disks[i].map = NULL;
+	disks[i].size = 0;
+
+	if (fstat(*disks[i].fd, &sbuf) == -1 || sbuf.st_size == 0)
 		return;
-	}
-	if (sector > disks[drive].sectors) {
-		status = 3;
+
+	p = mmap(NULL, (size_t) sbuf.st_size,
+		 disks[i].ro ? PROT_READ : PROT_READ | PROT_WRITE,
+		 MAP_SHARED, *disks[i].fd, 0);
+	if (p == MAP_FAILED) {
+		LOGW(TAG, "can't map disk image %s", disks[i].fn);
 		return;
 	}
-	pos = (((off_t) track) * ((off_t) disks[drive].sectors) + sector - 1) << 7;
-	if (lseek(*disks[drive].fd, pos, SEEK_SET) == -1L) {
-		status = 4;
+
+	disks[i].map = (BYTE *) p;
+	disks[i].size = (size_t) sbuf.st_size;
+}
+
+/*
+ *	Write back the sector at pos of the mapped image of
+ *	disk drive i, as wanted by the flush policy of the drive
+ */
+static void flush_disk(int i, off_t pos)
+{
+	static off_t pgmask;
+	off_t start;
+
+	if (disks[i].flush == DSK_FLUSH_NONE)
 		return;
-	}
-	switch (data) {
-	case 0:	/* read */
-		if (read(*disks[drive].fd, buf, 128) != 128)
-			status = 5;
-		else {
-			for (i = 0; i < 128; i++)
-				dma_write((dmadh << 8) + dmadl + i, buf[i]);
-			status = 0;
+
+	if (pgmask == 0)
+		pgmask = ~((off_t) sysconf(_SC_PAGESIZE) - 1);
+	start = pos & pgmask;
+
+	if (msync(disks[i].map + start, (size_t) (pos + 128 - start),
+		  (disks[i].flush == DSK_FLUSH_SYNC) ? MS_SYNC : MS_ASYNC)
+	    == -1)
+		LOGW(TAG, "can't flush disk image %s", disks[i].fn);
+}
+
+/*
+ *	Called in a job of the fork server, the mapped disk images
+ *	are mapped again private, so that writes of the job go to
+ *	copy-on-write pages and the images stay unchanged for the
+ *	other jobs. Drives which couldn't be mapped are write protected.
+ */
+#ifdef HAS_FORKSRV
+static void fork_disks(void)
+{
+	register int i;
+
+	for (i = 0; i <= 15; i++) {
+		if (disks[i].fd == NULL)
+			continue;
+		if (disks[i].map != NULL) {
+			if (mmap(disks[i].map, disks[i].size,
+				 disks[i].ro ? PROT_READ : PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_FIXED, *disks[i].fd, 0)
+			    != MAP_FAILED) {
+				disks[i].flush = DSK_FLUSH_NONE;
+				continue;
+			}
+			LOGW(TAG, "can't map disk image %s private", disks[i].fn);
+			disks[i].map = NULL;
+			disks[i].size = 0;
 		}
-		break;
-	case 1:	/* write */
-		for (i = 0; i < 128; i++)
-			buf[i] = dma_read((dmadh << 8) + dmadl + i);
-		if (write(*disks[drive].fd, buf, 128) != 128)
-			status = 6;
-		else
-			status = 0;
-		break;
-	default:		/* invalid command */
-		status = 7;
-		break;
+		disks[i].ro = true;
 	}
 }
+#endif
 
 /*
  *	I/O handler for read FDC status:
@@ -1888,6 +2200,7 @@ static void mmus_out(BYTE data)
 		return;
 	}
 	selbnk = data;
+	map_memory();
 }
 
 /*
@@ -1913,6 +2226,7 @@ static void mmuc_out(BYTE data)
 		return;
 	}
 	segsize = data << 8;
+	map_memory();
 }
 
 /*
@@ -1929,6 +2243,7 @@ static BYTE mmup_in(void)
 static void mmup_out(BYTE data)
 {
 	wp_common = data;
+	map_memory();
 }
 
 /*
@@ -1937,29 +2252,12 @@ static void mmup_out(BYTE data)
  */
 static void time_out(BYTE data)
 {
-	static struct itimerval tim;
-	static struct sigaction newact;
-
 	if (data == 1) {
 		timer = 1;
-		newact.sa_handler = int_timer;
-		sigemptyset(&newact.sa_mask);
-		newact.sa_flags = 0;
-		sigaction(SIGALRM, &newact, NULL);
-		tim.it_value.tv_sec = 0;
-		tim.it_value.tv_usec = 10000;
-		tim.it_interval.tv_sec = 0;
-		tim.it_interval.tv_usec = 10000;
-		setitimer(ITIMER_REAL, &tim, NULL);
+		ev_schedule(&timer_ev, ev_us(10000));
 	} else {
 		timer = 0;
-		newact.sa_handler = SIG_IGN;
-		sigemptyset(&newact.sa_mask);
-		newact.sa_flags = 0;
-		sigaction(SIGALRM, &newact, NULL);
-		tim.it_value.tv_sec = 0;
-		tim.it_value.tv_usec = 0;
-		setitimer(ITIMER_REAL, &tim, NULL);
+		ev_cancel(&timer_ev);
 	}
 }
 
@@ -2094,9 +2392,9 @@ static BYTE speedh_in(void)
 /*
  *	timer interrupt causes maskable CPU interrupt
  */
-static void int_timer(int sig)
+static void int_timer(void)
 {
-	UNUSED(sig);
+	ev_repeat(&timer_ev, ev_us(10000));
 
 	int_int = true;
 	int_data = 0xff;	/* RST 38H for IM 0, 0FFH for IM 2 */
@@ -7,11 +7,18 @@
 #ifndef SIMIO_INC
 #define SIMIO_INC
 
+#include <stddef.h>
+
 #include "sim.h"
 #include "simdefs.h"
 
 #define IO_DATA_UNUSED	0xff	/* data returned on unused ports */
 
+				/* flush policies for mapped disk images */
+#define DSK_FLUSH_NONE	0	/* write back left to the OS */
+#define DSK_FLUSH_ASYNC	1	/* start write back after every write */
+#define DSK_FLUSH_SYNC	2	/* wait for write back after every write */
+
 /*
  *	Structure for the disk images
  */
@@ -20,6 +27,10 @@ typedef struct dskdef {
 	int *fd;			/* file descriptor */
 	unsigned int tracks;		/* number of tracks */
 	unsigned int sectors;		/* number of sectors */
+	int flush;			/* flush policy if mapped */
+	bool ro;			/* image is read only */
+	BYTE *map;			/* mapped image or NULL */
+	size_t size;			/* size of the mapped image */
 } dskdef_t;
 
 extern dskdef_t disks[16];
@@ -26,6 +26,8 @@
  * 21-DEC-2016 moved banked memory implementation to here
  * 03-FEB-2017 added ROM initialization
  * 09-APR-2018 modified MMU write protect port as used by Alan Cox for FUZIX
+ * 18-OCT-2026 use the page table of the core for the memory map
+ * 18-OCT-2026 save the banks into snapshots
  */
 
 #include <stdlib.h>
@@ -34,6 +36,7 @@
 #include "simdefs.h"
 #include "simglb.h"
 #include "simmem.h"
+#include "simsnap.h"
 
 #include "log.h"
 static const char *TAG = "memory";
@@ -44,6 +47,9 @@ int maxbnk;			/* number of allocated banks */
 int segsize = SEGSIZ;		/* segment size of banks, default 48KB */
 int wp_common;			/* write protect/unprotect common segment */
 
+static void save_memory(void);
+static bool load_memory(snap_chunk_t *c);
+
 void init_memory(void)
 {
 	register int i;
@@ -57,6 +63,9 @@ void init_memory(void)
 	}
 	maxbnk = 1;
 	selbnk = 0;
+	pg_init();
+	map_memory();
+	snap_register("MEM ", save_memory, load_memory);
 
 	/* fill memory content of bank 0 with some initial value */
 	if (m_value >= 0) {
@@ -67,3 +76,71 @@ void init_memory(void)
 			putmem(i, (BYTE) (rand() % 256));
 	}
 }
+
+/*
+ *	Map the selected bank below segsize and the common segment
+ *	of bank 0 above it into the page table, must be called after
+ *	the bank, the segment size or the write protection changed
+ */
+void map_memory(void)
+{
+	pg_ram(0, segsize, memory[selbnk]);
+	pg_ram(segsize, 65536 - segsize, memory[0] + segsize);
+
+	pg_clr_flags(0, 65536, PG_WPROT);
+	if (wp_common != 0)
+		pg_set_flags(segsize, 65536 - segsize, PG_WPROT);
+}
+
+/*
+ *	Save the MMU and all banks into a snapshot
+ */
+static void save_memory(void)
+{
+	register int i;
+	int mmu[4] = { maxbnk, selbnk, segsize, wp_common };
+
+	snap_put(mmu, sizeof(mmu));
+	snap_put_mem(memory[0], 65536);
+	for (i = 1; i < maxbnk; i++)
+		snap_put_mem(memory[i], segsize);
+}
+
+/*
+ *	Load the MMU and all banks from a snapshot
+ */
+static bool load_memory(snap_chunk_t *c)
+{
+	register int i;
+	int mmu[4];
+
+	if (!snap_get(c, mmu, sizeof(mmu)) || mmu[0] < 1 ||
+	    mmu[0] > MAXSEG || mmu[1] < 0 || mmu[1] >= mmu[0] ||
+	    mmu[2] <= 0 || mmu[2] > 65536 || (mmu[2] & 0xff))
+		return false;
+
+	for (i = 1; i < MAXSEG; i++) {
+		free(memory[i]);
+		memory[i] = NULL;
+	}
+	maxbnk = 1;
+	segsize = mmu[2];
+	for (i = 1; i < mmu[0]; i++) {
+		if ((memory[i] = (BYTE *) malloc(segsize)) == NULL) {
+			LOGE(TAG, "can't allocate memory for bank %d", i);
+			return false;
+		}
+		maxbnk++;
+	}
+	selbnk = mmu[1];
+	wp_common = mmu[3];
+
+	if (!snap_get_mem(c, memory[0], 65536))
+		return false;
+	for (i = 1; i < maxbnk; i++)
+		if (!snap_get_mem(c, memory[i], segsize))
+			return false;
+
+	map_memory();
+	return true;
+}
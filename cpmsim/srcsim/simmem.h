@@ -29,13 +29,19 @@
  * 09-APR-2018 modified MMU write protect port as used by Alan Cox for FUZIX
  * 04-NOV-2019 add functions for direct memory access
  * 14-DEC-2024 added hardware breakpoint support
+ * 18-OCT-2026 added block transfers for DMA devices
+ * 18-OCT-2026 use the page table of the core for the memory map
+ * 18-OCT-2026 breakpoints are checked in bitmaps
  */
 
 #ifndef SIMMEM_INC
 #define SIMMEM_INC
 
+#include <string.h>
+
 #include "sim.h"
 #include "simdefs.h"
+#include "simpage.h"
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
@@ -48,10 +54,13 @@
 #define SEGSIZ 49152		/* default size of one bank = 48 KBytes */
 
 extern void init_memory(void);
+extern void map_memory(void);
 
 extern BYTE *memory[MAXSEG];
 extern int selbnk, maxbnk, segsize, wp_common;
 
+#define BP_BANK selbnk		/* bank of the breakpoints */
+
 /*
  * memory access for the CPU cores
  */
@@ -62,11 +71,11 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && hb_test(hb_wr, addr))
+		hb_hit(addr, HB_WRITE);
 #endif
 
-	if ((addr >= segsize) && (wp_common != 0)) {
+	if (pg_flags(addr) & PG_WPROT) {
 		wp_common |= 0x80;
 #ifndef EXCLUDE_Z80
 		if (wp_common & 0x40)
@@ -75,14 +84,7 @@ static inline void memwrt(WORD addr, BYTE data)
 		return;
 	}
 
-	if (selbnk == 0) {
-		*(memory[0] + addr) = data;
-	} else {
-		if (addr >= segsize)
-			*(memory[0] + addr) = data;
-		else
-			*(memory[selbnk] + addr) = data;
-	}
+	pg_write(addr, data);
 }
 
 static inline BYTE memrdr(WORD addr)
@@ -90,25 +92,11 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
-		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
-		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
-		}
-	}
+	if (hb_flag && !(cpu_bus & CPU_M1) && hb_test(hb_rd, addr))
+		hb_hit(addr, HB_READ);
 #endif
 
-	if (selbnk == 0) {
-		data = *(memory[0] + addr);
-	} else {
-		if (addr >= segsize)
-			data = *(memory[0] + addr);
-		else
-			data = *(memory[selbnk] + addr);
-	}
+	data = pg_read(addr);
 
 #ifdef BUS_8080
 	cpu_bus &= ~CPU_M1;
@@ -123,30 +111,47 @@ static inline BYTE memrdr(WORD addr)
  */
 static inline void dma_write(WORD addr, BYTE data)
 {
-	if ((addr >= segsize) && (wp_common != 0)) {
+	if (pg_flags(addr) & PG_WPROT) {
 		wp_common |= 0x80;
 		return;
 	}
 
-	if (selbnk == 0) {
-		*(memory[0] + addr) = data;
-	} else {
-		if (addr >= segsize)
-			*(memory[0] + addr) = data;
-		else
-			*(memory[selbnk] + addr) = data;
-	}
+	pg_write(addr, data);
 }
 
 static inline BYTE dma_read(WORD addr)
 {
-	if (selbnk == 0)
-		return *(memory[0] + addr);
+	return pg_read(addr);
+}
+
+/*
+ * block memory access for DMA devices, blocks contiguous in host
+ * memory are copied at once, all others byte by byte
+ */
+static inline void dma_write_block(WORD addr, const BYTE *src, int len)
+{
+	register int i;
+	register BYTE *p;
 
-	if (addr >= segsize)
-		return *(memory[0] + addr);
+	if ((p = pg_host(addr, len, true)) == NULL) {
+		for (i = 0; i < len; i++)
+			dma_write(addr + i, src[i]);
+		return;
+	}
+
+	memcpy(p, src, len);
+}
+
+static inline void dma_read_block(WORD addr, BYTE *dst, int len)
+{
+	register int i;
+	register BYTE *p;
+
+	if ((p = pg_host(addr, len, false)) != NULL)
+		memcpy(dst, p, len);
 	else
-		return *(memory[selbnk] + addr);
+		for (i = 0; i < len; i++)
+			dst[i] = dma_read(addr + i);
 }
 
 /*
@@ -154,25 +159,13 @@ static inline BYTE dma_read(WORD addr)
  */
 static inline void putmem(WORD addr, BYTE data)
 {
-	if (selbnk == 0) {
-		*(memory[0] + addr) = data;
-	} else {
-		if (addr >= segsize)
-			*(memory[0] + addr) = data;
-		else
-			*(memory[selbnk] + addr) = data;
-	}
+
+	pg_write(addr, data);
 }
 
 static inline BYTE getmem(WORD addr)
 {
-	if (selbnk == 0)
-		return *(memory[0] + addr);
-
-	if (addr >= segsize)
-		return *(memory[0] + addr);
-	else
-		return *(memory[selbnk] + addr);
+	return pg_read(addr);
 }
 
 #endif /* !SIMMEM_INC */
@@ -40,6 +40,7 @@
 #define CPU_SPEED 4	/* default CPU speed */
 /*#define ALT_I8080*/	/* use alt. 8080 sim. primarily optimized for size */
 /*#define ALT_Z80*/	/* use alt. Z80 sim. primarily optimized for size */
+/*#define THR_Z80*/	/* use threaded Z80 sim. primarily optimized for speed */
 #define UNDOC_INST	/* compile undocumented instrs. (required by ALT_*) */
 #ifndef EXCLUDE_Z80
 /*#define FAST_BLOCK*/	/* much faster but not accurate Z80 block instr. */
@@ -51,6 +52,7 @@
 /*#define HISIZE  1000*//* no history */
 /*#define SBSIZE  10*/	/* no software breakpoints */
 /*#define WANT_HB*/	/* no hardware breakpoint */
+/*#define WANT_PROF*/	/* no execution profiler */
 #endif
 
 #define HAS_DAZZLER	/* has simulated I/O for Cromemco Dazzler */
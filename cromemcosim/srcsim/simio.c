@@ -32,9 +32,10 @@
  * 17-JUN-2021 allow building machine without frontpanel
  * 29-JUL-2021 add boot config for machine without frontpanel
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 18-OCT-2026 write disk sectors behind
+ * 18-OCT-2026 timing and interrupts are events in simulated time
  */
 
-#include <pthread.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -43,7 +44,6 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <sys/poll.h>
-#include <sys/time.h>
 
 #include "sim.h"
 #include "simdefs.h"
@@ -52,6 +52,7 @@
 #include "simmem.h"
 #include "simio.h"
 #include "simport.h"
+#include "simevent.h"
 #if !defined (EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
 #include "simcore.h"
 #endif
@@ -62,6 +63,7 @@
 #include "cromemco-hal.h"
 #include "cromemco-tu-art.h"
 #include "cromemco-wdi.h"
+#include "diskwb.h"
 #include "simbdos.h"
 #include "unix_network.h"
 #include "unix_terminal.h"
@@ -88,8 +90,8 @@ static void hwctl_out(BYTE data);
 /*
  *	Forward declarations for support functions
  */
-static void *timing(void *arg);
-static void interrupt(int sig);
+static void timing(void);
+static void interrupt(void);
 
 static bool rtc;		/* flag for 512ms RTC interrupt */
 int lpt1, lpt2;			/* fds for lpt printer files */
@@ -99,7 +101,8 @@ static BYTE hwctl_lock = 0xff;	/* lock status hardware control port */
 /* network connections for serial ports on the TU-ART's */
 net_connector_t ncons[NUMNSOC];
 
-static bool th_suspend;		/* timing thread suspend flag */
+static event_t timing_ev = { .ev_func = timing }; /* 1ms timing event */
+static event_t int_ev = { .ev_func = interrupt }; /* 10ms interrupt event */
 
 /*
  *	This array contains function pointers for every
@@ -223,9 +226,9 @@ out_func_t *const port_out[256] = {
 void init_io(void)
 {
 	register int i;
-	pthread_t thread;
-	static struct itimerval tim;
+#ifdef TCPASYNC
 	static struct sigaction newact;
+#endif
 
 	/* initialize TCP/IP networking */
 #ifdef TCPASYNC
@@ -246,11 +249,8 @@ void init_io(void)
 	uart1a_int = 0xff;
 	uart1b_int = 0xff;
 
-	/* create the thread for timer and interrupt handling */
-	if (pthread_create(&thread, NULL, timing, (void *) NULL)) {
-		LOGE(TAG, "can't create timing thread");
-		exit(EXIT_FAILURE);
-	}
+	/* start timer and interrupt handling */
+	ev_schedule(&timing_ev, ev_us(1000));
 
 #ifdef HAS_MODEM
 	modem_device_init();
@@ -262,19 +262,7 @@ void init_io(void)
 	wdi_init();
 
 	/* start 10ms interrupt timer, delayed! */
-#ifndef WANT_ICE
-	newact.sa_handler = interrupt;
-#else
-	newact.sa_handler = SIG_IGN;
-#endif
-	sigemptyset(&newact.sa_mask);
-	newact.sa_flags = 0;
-	sigaction(SIGALRM, &newact, NULL);
-	tim.it_value.tv_sec = 5;
-	tim.it_value.tv_usec = 0;
-	tim.it_interval.tv_sec = 0;
-	tim.it_interval.tv_usec = 10000;
-	setitimer(ITIMER_REAL, &tim, NULL);
+	ev_schedule(&int_ev, ev_us(5000000));
 }
 
 /*
@@ -286,6 +274,7 @@ void exit_io(void)
 	register int i;
 
 	wdi_exit();
+	dwb_exit();
 
 	/* close line printer files */
 	if (lpt1 != 0)
@@ -309,11 +298,8 @@ void exit_io(void)
  */
 void reset_io(void)
 {
-	th_suspend = true;	/* suspend timing thread */
-	sleep_for_ms(20);	/* give it enough time to suspend */
 	cromemco_tuart_reset();
 	cromemco_fdc_reset();
-	th_suspend = false;	/* resume timing thread */
 	selbnk = 0;
 	cromemco_dazzler_off();
 	wdi_exit();
@@ -475,260 +461,246 @@ static void mmu_out(BYTE data)
 }
 
 /*
- *	Thread for timing and interrupts
+ *	Event for timing and interrupts, every 1 msec
  */
-static void *timing(void *arg)
+static void timing(void)
 {
-	UNUSED(arg);
-
-	while (true) {	/* 1 msec per loop iteration */
-
-		/* do nothing if thread is suspended */
-		if (th_suspend)
-			goto next;
-
-		/* make sure index pulse is there long enough */
-		if (index_pulse)
-			index_pulse++;
-
-		/* the tty transmit clear happens irrespective of anything */
-		if (uart0a_tbe == 0)
-			uart0a_tbe = 2;
-
-		/* count down the timers */
-		/* 64 usec steps, so 15*64 usec per loop iteration */
-		if (uart0a_timer1 > 0) {
-			uart0a_timer1 -= 15;
-			if (uart0a_timer1 <= 0) {
-				uart0a_timer1 = -1; /* interrupt pending */
-			}
+	ev_repeat(&timing_ev, ev_us(1000));
+
+	/* reset disk index pulse */
+	if (index_pulse > 2)
+		index_pulse = 0;
+
+	/* make sure index pulse is there long enough */
+	if (index_pulse)
+		index_pulse++;
+
+	/* the tty transmit clear happens irrespective of anything */
+	if (uart0a_tbe == 0)
+		uart0a_tbe = 2;
+
+	/* count down the timers */
+	/* 64 usec steps, so 15*64 usec per loop iteration */
+	if (uart0a_timer1 > 0) {
+		uart0a_timer1 -= 15;
+		if (uart0a_timer1 <= 0) {
+			uart0a_timer1 = -1; /* interrupt pending */
 		}
-		if (uart0a_timer2 > 0) {
-			uart0a_timer2 -= 15;
-			if (uart0a_timer2 <= 0) {
-				uart0a_timer2 = -1; /* interrupt pending */
-			}
+	}
+	if (uart0a_timer2 > 0) {
+		uart0a_timer2 -= 15;
+		if (uart0a_timer2 <= 0) {
+			uart0a_timer2 = -1; /* interrupt pending */
 		}
-		if (uart0a_timer3 > 0) {
-			uart0a_timer3 -= 15;
-			if (uart0a_timer3 <= 0) {
-				uart0a_timer3 = -1; /* interrupt pending */
-			}
+	}
+	if (uart0a_timer3 > 0) {
+		uart0a_timer3 -= 15;
+		if (uart0a_timer3 <= 0) {
+			uart0a_timer3 = -1; /* interrupt pending */
 		}
-		if (uart0a_timer4 > 0) {
-			uart0a_timer4 -= 15;
-			if (uart0a_timer4 <= 0) {
-				uart0a_timer4 = -1; /* interrupt pending */
-			}
+	}
+	if (uart0a_timer4 > 0) {
+		uart0a_timer4 -= 15;
+		if (uart0a_timer4 <= 0) {
+			uart0a_timer4 = -1; /* interrupt pending */
 		}
-		if (uart0a_timer5 > 0) {
-			uart0a_timer5 -= 15;
-			if (uart0a_timer5 <= 0) {
-				uart0a_timer5 = -1; /* interrupt pending */
-			}
+	}
+	if (uart0a_timer5 > 0) {
+		uart0a_timer5 -= 15;
+		if (uart0a_timer5 <= 0) {
+			uart0a_timer5 = -1; /* interrupt pending */
 		}
+	}
 
-		/* check for interrupts from highest priority to lowest */
+	/* check for interrupts from highest priority to lowest */
 
-		/* if last interrupt not acknowledged by CPU no new one yet */
-		if (int_int)
-			goto next;
+	/* if last interrupt not acknowledged by CPU no new one yet */
+	if (int_int)
+		return;
 
-		/* UART 0A timer 1 */
-		if ((uart0a_timer1 == -1) && (uart0a_int_mask & 1)) {
-			uart0a_int = 0xc7;
-			uart0a_int_pending = true;
-			int_data = 0xc7;
-			int_int = true;
-			uart0a_timer1 = 0;
-			goto next;
-		}
+	/* UART 0A timer 1 */
+	if ((uart0a_timer1 == -1) && (uart0a_int_mask & 1)) {
+		uart0a_int = 0xc7;
+		uart0a_int_pending = true;
+		int_data = 0xc7;
+		int_int = true;
+		uart0a_timer1 = 0;
+		return;
+	}
 
-		/* UART 0A timer 2 */
-		if ((uart0a_timer2 == -1) && (uart0a_int_mask & 2)) {
-			uart0a_int = 0xcf;
-			uart0a_int_pending = true;
-			int_data = 0xcf;
-			int_int = true;
-			uart0a_timer2 = 0;
-			goto next;
-		}
+	/* UART 0A timer 2 */
+	if ((uart0a_timer2 == -1) && (uart0a_int_mask & 2)) {
+		uart0a_int = 0xcf;
+		uart0a_int_pending = true;
+		int_data = 0xcf;
+		int_int = true;
+		uart0a_timer2 = 0;
+		return;
+	}
 
-		/* EOJ from disk */
-		if ((fdc_flags & 1) && (uart0a_int_mask & 4)) {
-			uart0a_int = 0xd7;
-			uart0a_int_pending = true;
-			int_data = 0xd7;
-			int_int = true;
-			goto next;
-		}
+	/* EOJ from disk */
+	if ((fdc_flags & 1) && (uart0a_int_mask & 4)) {
+		uart0a_int = 0xd7;
+		uart0a_int_pending = true;
+		int_data = 0xd7;
+		int_int = true;
+		return;
+	}
 
-		/* UART 0A timer 3 */
-		if ((uart0a_timer3 == -1) && (uart0a_int_mask & 8)) {
-			uart0a_int = 0xdf;
-			uart0a_int_pending = true;
-			int_data = 0xdf;
-			int_int = true;
-			uart0a_timer3 = 0;
-			goto next;
-		}
+	/* UART 0A timer 3 */
+	if ((uart0a_timer3 == -1) && (uart0a_int_mask & 8)) {
+		uart0a_int = 0xdf;
+		uart0a_int_pending = true;
+		int_data = 0xdf;
+		int_int = true;
+		uart0a_timer3 = 0;
+		return;
+	}
+
+	/* UART 0A receive data available */
+	if ((uart0a_rda) && (uart0a_int_mask & 16)) {
+		uart0a_int = 0xe7;
+		uart0a_int_pending = true;
+		int_data = 0xe7;
+		int_int = true;
+		return;
+	}
 
-		/* UART 0A receive data available */
-		if ((uart0a_rda) && (uart0a_int_mask & 16)) {
-			uart0a_int = 0xe7;
+	/* UART 0A transmit buffer empty */
+	/* We use 2 to mean has gone empty->full but an IRQ is
+	   pending */
+	if (uart0a_tbe == 2) {
+		uart0a_tbe = 1;
+		if (uart0a_int_mask & 32) {
+			uart0a_int = 0xef;
 			uart0a_int_pending = true;
-			int_data = 0xe7;
+			int_data = 0xef;
 			int_int = true;
-			goto next;
+			return;
 		}
+	}
 
-		/* UART 0A transmit buffer empty */
-		/* We use 2 to mean has gone empty->full but an IRQ is
-		   pending */
-		if (uart0a_tbe == 2) {
-			uart0a_tbe = 1;
-			if (uart0a_int_mask & 32) {
-				uart0a_int = 0xef;
-				uart0a_int_pending = true;
-				int_data = 0xef;
-				int_int = true;
-				goto next;
-			}
-		}
+	/* UART 0A timer 4 */
+	if ((uart0a_timer4 == -1) && (uart0a_int_mask & 64)) {
+		uart0a_int = 0xf7;
+		uart0a_int_pending = true;
+		int_data = 0xf7;
+		int_int = true;
+		uart0a_timer4 = 0;
+		return;
+	}
 
-		/* UART 0A timer 4 */
-		if ((uart0a_timer4 == -1) && (uart0a_int_mask & 64)) {
-			uart0a_int = 0xf7;
-			uart0a_int_pending = true;
-			int_data = 0xf7;
-			int_int = true;
-			uart0a_timer4 = 0;
-			goto next;
-		}
+	/* UART 0A timer 5 */
+	if ((uart0a_timer5 == -1) && (uart0a_int_mask & 128) && !uart0a_rst7) {
+		uart0a_int = 0xff;
+		uart0a_int_pending = true;
+		int_data = 0xff;
+		int_int = true;
+		uart0a_timer5 = 0;
+		return;
+	}
 
-		/* UART 0A timer 5 */
-		if ((uart0a_timer5 == -1) && (uart0a_int_mask & 128) && !uart0a_rst7) {
+	/* 512ms RTC */
+	if (rtc && uart0a_rst7) {
+		rtc = false;
+		if (uart0a_int_mask & 128) {
 			uart0a_int = 0xff;
 			uart0a_int_pending = true;
 			int_data = 0xff;
 			int_int = true;
-			uart0a_timer5 = 0;
-			goto next;
+			return;
 		}
+	}
 
-		/* 512ms RTC */
-		if (rtc && uart0a_rst7) {
-			rtc = false;
-			if (uart0a_int_mask & 128) {
-				uart0a_int = 0xff;
-				uart0a_int_pending = true;
-				int_data = 0xff;
-				int_int = true;
-				goto next;
-			}
+	/* UART 0A no pending interrupt */
+	uart0a_int = 0xff;
+	uart0a_int_pending = false;
+
+	/* UART 1A parallel port sense */
+	uart1a_lpt_busy = false;
+	if (uart1a_sense) {
+		uart1a_int_pending = true;
+		uart1a_int = 0xd7;
+		if (uart1a_int_mask & 4) {
+			uart1a_sense = false;
+			int_data = 0x24;
+			int_int = true;
+			return;
 		}
+	}
 
-		/* UART 0A no pending interrupt */
-		uart0a_int = 0xff;
-		uart0a_int_pending = false;
-
-		/* UART 1A parallel port sense */
-		uart1a_lpt_busy = false;
-		if (uart1a_sense) {
-			uart1a_int_pending = true;
-			uart1a_int = 0xd7;
-			if (uart1a_int_mask & 4) {
-				uart1a_sense = false;
-				int_data = 0x24;
-				int_int = true;
-				goto next;
-			}
-		}
+	/* UART 1A receive data available */
+	if ((uart1a_rda) && (uart1a_int_mask & 16)) {
+		uart1a_int = 0xe7;
+		uart1a_int_pending = true;
+		int_data = 0x28;
+		int_int = true;
+		return;
+	}
 
-		/* UART 1A receive data available */
-		if ((uart1a_rda) && (uart1a_int_mask & 16)) {
-			uart1a_int = 0xe7;
+	/* UART 1A transmit buffer empty */
+	if (!uart1a_tbe) {
+		uart1a_tbe = true;
+		if (uart1a_int_mask & 32) {
+			uart1a_int = 0xef;
 			uart1a_int_pending = true;
-			int_data = 0x28;
+			int_data = 0x2a;
 			int_int = true;
-			goto next;
-		}
-
-		/* UART 1A transmit buffer empty */
-		if (!uart1a_tbe) {
-			uart1a_tbe = true;
-			if (uart1a_int_mask & 32) {
-				uart1a_int = 0xef;
-				uart1a_int_pending = true;
-				int_data = 0x2a;
-				int_int = true;
-				goto next;
-			}
+			return;
 		}
+	}
 
-		/* UART 1A no pending interrupt */
-		uart1a_int_pending = false;
-		uart1a_int = 0xff;
+	/* UART 1A no pending interrupt */
+	uart1a_int_pending = false;
+	uart1a_int = 0xff;
 
-		/* UART 1B parallel port sense */
-		uart1b_lpt_busy = false;
-		if (uart1b_sense) {
-			uart1b_int_pending = true;
-			uart1b_int = 0xd7;
-			if (uart1b_int_mask & 4) {
-				uart1b_sense = false;
-				int_data = 0x34;
-				int_int = true;
-				goto next;
-			}
+	/* UART 1B parallel port sense */
+	uart1b_lpt_busy = false;
+	if (uart1b_sense) {
+		uart1b_int_pending = true;
+		uart1b_int = 0xd7;
+		if (uart1b_int_mask & 4) {
+			uart1b_sense = false;
+			int_data = 0x34;
+			int_int = true;
+			return;
 		}
+	}
+
+	/* UART 1B receive data available */
+	if ((uart1b_rda) && (uart1b_int_mask & 16)) {
+		uart1b_int = 0xe7;
+		uart1b_int_pending = true;
+		int_data = 0x38;
+		int_int = true;
+		return;
+	}
 
-		/* UART 1B receive data available */
-		if ((uart1b_rda) && (uart1b_int_mask & 16)) {
-			uart1b_int = 0xe7;
+	/* UART 1B transmit buffer empty */
+	if (!uart1b_tbe) {
+		uart1b_tbe = true;
+		if (uart1b_int_mask & 32) {
+			uart1b_int = 0xef;
 			uart1b_int_pending = true;
-			int_data = 0x38;
+			int_data = 0x3a;
 			int_int = true;
-			goto next;
+			return;
 		}
-
-		/* UART 1B transmit buffer empty */
-		if (!uart1b_tbe) {
-			uart1b_tbe = true;
-			if (uart1b_int_mask & 32) {
-				uart1b_int = 0xef;
-				uart1b_int_pending = true;
-				int_data = 0x3a;
-				int_int = true;
-				goto next;
-			}
-		}
-
-		/* UART 1B no pending interrupt */
-		uart1b_int_pending = false;
-		uart1b_int = 0xff;
-
-next:
-		/* sleep for 1 millisecond */
-		sleep_for_ms(1);
-
-		/* reset disk index pulse */
-		if (index_pulse > 2)
-			index_pulse = 0;
 	}
 
-	/* never reached, this thread is running endless */
-	pthread_exit(NULL);
+	/* UART 1B no pending interrupt */
+	uart1b_int_pending = false;
+	uart1b_int = 0xff;
 }
 
 /*
- *	10ms interrupt handler
+ *	10ms interrupt event
  */
-static void interrupt(int sig)
+static void interrupt(void)
 {
 	static unsigned long counter = 0L;
 
-	UNUSED(sig);
+	ev_repeat(&int_ev, ev_us(10000));
 
 	counter++;
 
@@ -792,14 +764,7 @@ static void interrupt(int sig)
  */
 void ice_go(void)
 {
-	static struct sigaction newact;
-
 	set_unix_terminal();
-
-	newact.sa_handler = interrupt;
-	sigemptyset(&newact.sa_mask);
-	newact.sa_flags = 0;
-	sigaction(SIGALRM, &newact, NULL);
 }
 
 /*
@@ -807,13 +772,6 @@ void ice_go(void)
  */
 void ice_break(void)
 {
-	static struct sigaction newact;
-
-	newact.sa_handler = SIG_IGN;
-	sigemptyset(&newact.sa_mask);
-	newact.sa_flags = 0;
-	sigaction(SIGALRM, &newact, NULL);
-
 	reset_unix_terminal();
 }
 #endif
@@ -14,11 +14,15 @@
  * 01-OCT-2019 optimization
  * 30-AUG-2021 new memory configuration sections
  * 02-SEP-2021 implement banked ROM
+ * 18-OCT-2026 map common memory once for all banks
+ * 18-OCT-2026 share the common memory, copy pages before private writes
  */
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "sim.h"
 #include "simdefs.h"
@@ -40,12 +44,122 @@ int selbnk;			/* current selected bank */
 bool common;			/* flag for common writes to all banks */
 int bankio;			/* data written to banking I/O port */
 
+BYTE *commem;			/* shared mapping of the common memory */
+int com_shift;			/* shift of address to host page */
+bool com_priv[MAXSEG][COMPAGES]; /* bank has private copy of host page */
+int com_npriv[COMPAGES];	/* number of banks with private copy */
+
 int num_banks = MAXSEG;
 
 /* page table with memory configuration/state */
 int p_tab[MAXPAGES];		/* 256 pages of 256 bytes */
 int _p_tab[MAXPAGES];		/* copy of p_tab[] for RAM only */
 
+/*
+ *	Map the banks, so that they share the common memory
+ *	until a bank writes to it without common
+ */
+static bool map_banks(void)
+{
+	char fn[] = "/tmp/cromemcosim.XXXXXX";
+	long psz = sysconf(_SC_PAGESIZE);
+	BYTE *p;
+	int fd, i;
+
+	/* drop the mappings and private pages of a previous call */
+	if (commem != NULL) {
+		for (i = 0; i < MAXSEG; i++) {
+			munmap(memory[i], SEGSIZ);
+			memory[i] = NULL;
+		}
+		munmap(commem, COMBASE);
+		commem = NULL;
+	}
+	memset(com_priv, 0, sizeof(com_priv));
+	memset(com_npriv, 0, sizeof(com_npriv));
+
+	if (psz <= 0 || psz > COMBASE)
+		return false;
+	for (com_shift = 12; (1L << com_shift) < psz; com_shift++)
+		;
+
+	/* the common memory is an unlinked temporary file */
+	if ((fd = mkstemp(fn)) == -1)
+		return false;
+	unlink(fn);
+	i = 0;
+	if (ftruncate(fd, COMBASE) == -1)
+		goto error;
+
+	commem = mmap(NULL, COMBASE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (commem == MAP_FAILED)
+		goto error;
+
+	/* the common memory is mapped shared into all banks, so
+	   that a common write is seen by all of them */
+	for (i = 0; i < MAXSEG; i++) {
+		p = mmap(NULL, SEGSIZ, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			goto error;
+		if (mmap(p + COMBASE, COMBASE, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			munmap(p, SEGSIZ);
+			goto error;
+		}
+		memory[i] = p;
+	}
+
+	close(fd);
+	return true;
+
+error:
+	while (--i >= 0) {
+		munmap(memory[i], SEGSIZ);
+		memory[i] = NULL;
+	}
+	if (commem != NULL && commem != MAP_FAILED)
+		munmap(commem, COMBASE);
+	commem = NULL;
+	close(fd);
+	return false;
+}
+
+/*
+ *	Give bank a private copy of host page h of the common memory,
+ *	before it writes to it without common. The shared page is
+ *	replaced by an anonymous page with the same contents, later
+ *	common writes are copied to it by memwrt().
+ */
+void com_unshare(int bank, int h)
+{
+	static BYTE buf[COMBASE];
+	size_t psz = (size_t) 1 << com_shift;
+	BYTE *p = memory[bank] + COMBASE + (h << com_shift);
+
+	memcpy(buf, p, psz);
+	if (mmap(p, psz, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+		LOGE(TAG, "can't map private page of bank %d", bank);
+		exit(EXIT_FAILURE);
+	}
+	memcpy(p, buf, psz);
+	com_priv[bank][h] = true;
+	com_npriv[h]++;
+}
+
+/*
+ *	Initialize a byte of bank 0, bytes in the common memory
+ *	are initialized for all banks
+ */
+static inline void init_byte(int addr, BYTE data)
+{
+	if (addr >= COMBASE && commem != NULL)
+		commem[addr - COMBASE] = data;
+	else
+		memory[0][addr] = data;
+}
+
 void init_memory(void)
 {
 	register int i, j;
@@ -68,10 +182,13 @@ void init_memory(void)
 	for (i = 0; i < MAXPAGES; i++)
 		p_tab[i] = MEM_NONE;
 
-	for (i = 0; i < MAXSEG; i++) {
-		if ((memory[i] = (BYTE *) malloc(SEGSIZ)) == NULL) {
-			LOGE(TAG, "can't allocate memory for bank %d", i);
-			exit(EXIT_FAILURE);
+	if (!map_banks()) {
+		LOGW(TAG, "can't map common memory, writing it to all banks");
+		for (i = 0; i < MAXSEG; i++) {
+			if ((memory[i] = (BYTE *) malloc(SEGSIZ)) == NULL) {
+				LOGE(TAG, "can't allocate memory for bank %d", i);
+				exit(EXIT_FAILURE);
+			}
 		}
 	}
 
@@ -89,9 +206,9 @@ void init_memory(void)
 				     j < (memconf[M_value][i].spage + memconf[M_value][i].size) << 8;
 				     j++) {
 					if (m_value >= 0) {
-						memory[0][j] = m_value;
+						init_byte(j, m_value);
 					} else {
-						memory[0][j] = (BYTE) (rand() % 256);
+						init_byte(j, (BYTE) (rand() % 256));
 					}
 				}
 
@@ -150,10 +267,10 @@ void init_memory(void)
 					MEM_RESERVE_ROM(memconf[M_value][i].spage + j);
 
 				/* fill the ROM's with 0xff in case no firmware loaded */
-				for (j = memconf[M_value][i].spage;
-				     j < (memconf[M_value][i].spage + memconf[M_value][i].size);
+				for (j = memconf[M_value][i].spage << 8;
+				     j < (memconf[M_value][i].spage + memconf[M_value][i].size) << 8;
 				     j++) {
-					memset(&memory[0][j << 8], 0xff, 256);
+					init_byte(j, 0xff);
 				}
 
 				/* load firmware into ROM if specified */
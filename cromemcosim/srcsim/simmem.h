@@ -18,6 +18,9 @@
  * 30-AUG-2021 new memory configuration sections
  * 02-SEP-2021 implement banked ROM
  * 14-DEC-2024 added hardware breakpoint support
+ * 18-OCT-2026 map common memory once for all banks
+ * 18-OCT-2026 breakpoints are checked in bitmaps
+ * 18-OCT-2026 private copies of common pages are made before the write
  */
 
 #ifndef SIMMEM_INC
@@ -42,6 +45,8 @@
 #define MAXPAGES	256
 #define MAXSEG		7	/* max. number of 64KB memory banks */
 #define SEGSIZ		65536	/* size of the memory segments, 64 KBytes */
+#define COMBASE		32768	/* start of the common memory */
+#define COMPAGES	(32768 >> 12) /* max. number of host pages in it */
 
 #define MEM_RW		0	/* memory is readable and writeable */
 #define MEM_RO		1	/* memory is read-only */
@@ -70,6 +75,36 @@ extern BYTE *memory[MAXSEG];
 extern int selbnk, bankio, num_banks;
 extern bool common;
 
+#define BP_BANK selbnk		/* bank of the breakpoints */
+
+/*
+ * The common memory of all banks is a shared mapping, which is
+ * mapped shared into each bank too. Common writes go to the shared
+ * mapping once, and only to the banks which have a private copy
+ * of the host page, because it was written without common. Such a
+ * copy is made by com_unshare() before the write.
+ * If the mapping isn't possible commem is NULL, and common writes
+ * go to all banks.
+ */
+extern BYTE *commem;
+extern int com_shift;
+extern bool com_priv[MAXSEG][COMPAGES];
+extern int com_npriv[COMPAGES];
+
+extern void com_unshare(int bank, int h);
+
+/* a write to a bank without common needs a private host page */
+static inline void com_private(WORD addr)
+{
+	register int h;
+
+	if (addr >= COMBASE && commem != NULL) {
+		h = (addr - COMBASE) >> com_shift;
+		if (!com_priv[selbnk][h])
+			com_unshare(selbnk, h);
+	}
+}
+
 extern int p_tab[MAXPAGES];		/* 256 pages of 256 bytes */
 
 /* return page to RAM pool */
@@ -89,7 +124,7 @@ extern void reset_fdc_rom_map(void);
  */
 static inline void memwrt(WORD addr, BYTE data)
 {
-	register int i;
+	register int i, h;
 
 #ifdef BUS_8080
 #ifndef FRONTPANEL
@@ -110,22 +145,27 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && hb_test(hb_wr, addr))
+		hb_hit(addr, HB_WRITE);
 #endif
 
 	if (fdc_rom_active && (addr >> 13) == 0x6) { /* Covers C000 to DFFF */
 		return;
 	} else if (selbnk || p_tab[addr >> 8] == MEM_RW) {
 
-		if (!common) {
+		if (!common || addr < COMBASE) {
+			com_private(addr);
 			*(memory[selbnk] + addr) = data;
+		} else if (commem == NULL) {
+			for (i = 0; i < MAXSEG; i++)
+				*(memory[i] + addr) = data;
 		} else {
-			if (addr < 32768)
-				*(memory[selbnk] + addr) = data;
-			else {
+			*(commem + addr - COMBASE) = data;
+			h = (addr - COMBASE) >> com_shift;
+			if (com_npriv[h]) {
 				for (i = 0; i < MAXSEG; i++)
-					*(memory[i] + addr) = data;
+					if (com_priv[i][h])
+						*(memory[i] + addr) = data;
 			}
 		}
 	}
@@ -136,15 +176,8 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
-		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
-		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
-		}
-	}
+	if (hb_flag && !(cpu_bus & CPU_M1) && hb_test(hb_rd, addr))
+		hb_hit(addr, HB_READ);
 #endif
 
 	if (fdc_rom_active && (addr >> 13) == 0x6) { /* Covers C000 to DFFF */
@@ -195,6 +228,7 @@ static inline void dma_write(WORD addr, BYTE data)
 	if (fdc_rom_active && (addr >> 13) == 0x6) { /* Covers C000 to DFFF */
 		return;
 	} else if (selbnk || p_tab[addr >> 8] == MEM_RW) {
+		com_private(addr);
 		*(memory[selbnk] + addr) = data;
 	}
 }
@@ -218,6 +252,7 @@ static inline void putmem(WORD addr, BYTE data)
 	if (fdc_rom_active && (addr >> 13) == 0x6) { /* Covers C000 to DFFF */
 		*(fdc_banked_rom + addr - 0xC000) = data;
 	} else {
+		com_private(addr);
 		*(memory[selbnk] + addr) = data;
 	}
 }
@@ -38,6 +38,7 @@ static int material_flag[MAX_MATERIALS];	/* true = material set by user */
 static int material_used_flag[MAX_MATERIALS];	/* true = material is used */
 static int material_alpha_flag[MAX_MATERIALS];	/* true = material has an alpha component < 1.0 */
 static int list_offset = 0;
+static int currmat = -1;	/* material bound last */
 
 void lp_init_materials_flags(void)
 {
@@ -317,8 +318,6 @@ void lp_set_user_material_params(int n,						/* material num */
 
 void lp_bind_material(int n)
 {
-	static int currmat = -1;
-
 	if (n >= MAX_MATERIALS)
 		return;
 
@@ -338,3 +337,9 @@ void lp_bind_material(int n)
 		currmat = n;
 	}
 }
+
+/* forget the material bound last, after a display list changed it */
+void lp_unbind_material(void)
+{
+	currmat = -1;
+}
@@ -36,6 +36,7 @@ extern void	lp_set_user_material_params(int n,		/* material num */
 			float Er, float Eg, float Eb, float Ea); /* emission rgba */
 
 extern void	lp_bind_material(int n);
+extern void	lp_unbind_material(void);
 extern void	lp_init_materials(void);
 extern void	lp_init_materials_dlist(void);
 extern bool	lp_is_material_alpha(int n);
@@ -1159,6 +1159,11 @@ void Lpanel_initGraphics(Lpanel_t *p)
 
 	lp_init_materials_dlist();
 
+	// the display lists of the objects are recorded in the new context
+
+	p->objects_list = 0;
+	p->alpha_objects_list = 0;
+
 	// define lights in case we use them
 
 	glMatrixMode(GL_MODELVIEW);
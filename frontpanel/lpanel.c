@@ -270,6 +270,68 @@ static void sampleData64invert(lpLight_t *p)
 	p->state = bit;
 }
 
+// sample the data of a block and update all its lights, the loop runs
+// over all slots of the block, unused ones are ignored
+
+static void sampleBlock(lpLightBlock_t *b)
+{
+	uint64_t data, clock, bit;
+	int i;
+
+	switch (b->datatype) {
+	case 1:
+		data = *(uint8_t *) b->dataptr;
+		break;
+	case 2:
+		data = *(uint16_t *) b->dataptr;
+		break;
+	case 4:
+		data = *(uint32_t *) b->dataptr;
+		break;
+	default:
+		data = *(uint64_t *) b->dataptr;
+		break;
+	}
+	clock = *b->simclock;
+
+	for (i = 0; i < LP_BLOCK_LIGHTS; i++) {
+		bit = ((data >> b->bitnum[i]) ^ b->invert[i]) & 0x01;
+		b->on_time[i] += (clock - b->old_clock[i]) & -bit;
+		b->old_clock[i] = clock;
+		b->state[i] = bit;
+		b->dirty[i] = true;
+	}
+}
+
+// sample the data of a block for one of its lights
+
+static void sampleBlockLight(lpLightBlock_t *b, int i)
+{
+	uint64_t data, bit;
+
+	switch (b->datatype) {
+	case 1:
+		data = *(uint8_t *) b->dataptr;
+		break;
+	case 2:
+		data = *(uint16_t *) b->dataptr;
+		break;
+	case 4:
+		data = *(uint32_t *) b->dataptr;
+		break;
+	default:
+		data = *(uint64_t *) b->dataptr;
+		break;
+	}
+
+	bit = ((data >> b->bitnum[i]) ^ b->invert[i]) & 0x01;
+	if (bit)
+		b->on_time[i] += (*b->simclock - b->old_clock[i]);
+	b->old_clock[i] = *b->simclock;
+	b->state[i] = bit;
+	b->dirty[i] = true;
+}
+
 Lpanel_t *Lpanel_new(void)
 {
 	Lpanel_t *p = (Lpanel_t *) calloc(1, sizeof(Lpanel_t));
@@ -308,6 +370,20 @@ void Lpanel_init(Lpanel_t *p)		// initializer
 	p->max_lights = 0;
 	p->lights = NULL;
 
+	p->num_light_blocks = 0;
+	p->light_blocks = NULL;
+	p->num_unblocked_lights = 0;
+	p->unblocked_lights = NULL;
+	p->light_blocks_valid = false;
+
+	p->objects_list = 0;
+	p->alpha_objects_list = 0;
+	p->num_batch_verts = 0;
+	p->num_batch_index = 0;
+	p->batch_verts = NULL;
+	p->batch_colors = NULL;
+	p->batch_index = NULL;
+
 	p->num_switches = p->max_switches = 0;
 	p->switches = NULL;
 	p->mom_switch_pressed = NULL;
@@ -414,6 +490,9 @@ void Lpanel_fini(Lpanel_t *p)		// finalizer
 		Mix_FreeChunk(p->fan_sound);
 #endif
 
+	Lpanel_freeLightBlocks(p);
+	Lpanel_freeGraphicsData(p);
+
 	for (i = 0; i < p->num_lights; i++)
 		if (p->lights[i])
 			lpLight_delete(p->lights[i]);
@@ -979,12 +1058,78 @@ void Lpanel_bindSimclock(Lpanel_t *p, uint64_t *addr)
 
 	for (i = 0; i < p->num_lights; i++)
 		lpLight_bindSimclock(p->lights[i], (uint64_t *) addr, &p->clock_warp);
+	p->light_blocks_valid = false;
+
+}
+
+static void drawObjects(Lpanel_t *p, bool alpha)
+{
+	int i;
 
+	if (alpha) {
+		for (i = 0; i < p->num_alpha_objects; i++)
+			lpObject_draw(p->alpha_objects[i]);
+	} else {
+		for (i = 0; i < p->num_objects; i++)
+			if (!p->objects[i]->is_alpha)
+				lpObject_draw(p->objects[i]);
+	}
+}
+
+// the objects don't change, so they are recorded in a display list
+// on the first draw and this list is called afterwards
+
+static void drawObjectsList(Lpanel_t *p, GLuint *list, bool alpha)
+{
+	if (*list == 0) {
+		// draw them once, which sets up the materials used
+		drawObjects(p, alpha);
+
+		*list = glGenLists(1);
+		lp_unbind_material();
+		glNewList(*list, GL_COMPILE);
+		drawObjects(p, alpha);
+		glEndList();
+	} else
+		glCallList(*list);
+
+	// the list changed the material behind the back of lp_bind_material()
+	lp_unbind_material();
+}
+
+// copy the color of a light into the inner vertices of its batch
+// geometry, if it changed
+
+static void setBatchColor(Lpanel_t *p, lpLight_t *light)
+{
+	float *c = &p->batch_colors[light->batch_vert * 3];
+	int i;
+
+	if (memcmp(c, light->color, sizeof(light->color)) == 0)
+		return;
+
+	for (i = 0; i < cir2d_nverts - 1; i++)
+		memcpy(&c[i * 3], light->color, sizeof(light->color));
+}
+
+static void drawLightBatch(Lpanel_t *p)
+{
+	if (p->num_batch_index == 0)
+		return;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, p->batch_verts);
+	glColorPointer(3, GL_FLOAT, 0, p->batch_colors);
+	glDrawElements(GL_TRIANGLES, p->num_batch_index, GL_UNSIGNED_INT, p->batch_index);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 void Lpanel_draw(Lpanel_t *p)
 {
 	int i;
+	lpLight_t *light;
 
 #ifdef WANT_SDL
 	if (*p->powerflag != p->old_powerflag) {
@@ -1009,17 +1154,22 @@ void Lpanel_draw(Lpanel_t *p)
 
 	// draw graphics objects
 
-	for (i = 0; i < p->num_objects; i++)
-		if (!p->objects[i]->is_alpha)
-			lpObject_draw(p->objects[i]);
+	drawObjectsList(p, &p->objects_list, false);
 
-	// draw lights
+	// draw lights, the ones not referencing an object in one batch
 
 	glEnable(GL_POLYGON_OFFSET_FILL);
 	glPolygonOffset(0., -10.);
 
-	for (i = 0; i < p->num_lights; i++)
-		lpLight_draw(p->lights[i]);
+	for (i = 0; i < p->num_lights; i++) {
+		light = p->lights[i];
+		if (light->batch_vert >= 0) {
+			lpLight_calcColor(light);
+			setBatchColor(p, light);
+		} else
+			lpLight_draw(light);
+	}
+	drawLightBatch(p);
 
 	// draw switches
 
@@ -1030,8 +1180,7 @@ void Lpanel_draw(Lpanel_t *p)
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		glEnable(GL_BLEND);
 
-		for (i = 0; i < p->num_alpha_objects; i++)
-			lpObject_draw(p->alpha_objects[i]);
+		drawObjectsList(p, &p->alpha_objects_list, true);
 
 		glDisable(GL_BLEND);
 	}
@@ -1056,6 +1205,180 @@ void Lpanel_growLights(Lpanel_t *p)
 	p->lights = new_lights;
 }
 
+// group the lights bound to integer data into blocks by their data
+
+void Lpanel_buildLightBlocks(Lpanel_t *p)
+{
+	lpLightBlock_t *b;
+	lpLight_t *light;
+	int i, j, k;
+
+	Lpanel_freeLightBlocks(p);
+
+	p->light_blocks = (lpLightBlock_t **) malloc(sizeof(lpLightBlock_t *) *
+						      (p->num_lights + 1));
+	p->unblocked_lights = (lpLight_t **) malloc(sizeof(lpLight_t *) *
+						    (p->num_lights + 1));
+
+	for (i = 0; i < p->num_lights; i++) {
+		light = p->lights[i];
+
+		if (light->bindtype != LBINDTYPE_BIT || light->datatype == 0) {
+			p->unblocked_lights[p->num_unblocked_lights++] = light;
+			continue;
+		}
+
+		// find a block for the data with a free slot
+		b = NULL;
+		for (j = 0; j < p->num_light_blocks; j++) {
+			if (p->light_blocks[j]->dataptr == light->dataptr &&
+			    p->light_blocks[j]->datatype == light->datatype &&
+			    p->light_blocks[j]->num_lights < LP_BLOCK_LIGHTS) {
+				b = p->light_blocks[j];
+				break;
+			}
+		}
+		if (b == NULL) {
+			b = (lpLightBlock_t *) calloc(1, sizeof(lpLightBlock_t));
+			b->dataptr = light->dataptr;
+			b->datatype = light->datatype;
+			b->simclock = light->simclock;
+			for (k = 0; k < LP_BLOCK_LIGHTS; k++)
+				b->old_clock[k] = *light->simclock;
+			p->light_blocks[p->num_light_blocks++] = b;
+		}
+
+		k = b->num_lights++;
+		b->lights[k] = light;
+		b->bitnum[k] = light->bitnum;
+		b->invert[k] = light->invert;
+		b->on_time[k] = light->on_time;
+		b->old_clock[k] = light->old_clock;
+		b->state[k] = light->state;
+		b->dirty[k] = light->dirty;
+		light->block = b;
+		light->block_idx = k;
+	}
+
+	p->light_blocks_valid = true;
+}
+
+// free the light blocks, the lights keep their sampled values
+
+void Lpanel_freeLightBlocks(Lpanel_t *p)
+{
+	int i, j;
+
+	for (i = 0; i < p->num_light_blocks; i++) {
+		for (j = 0; j < p->light_blocks[i]->num_lights; j++) {
+			lpLight_syncBlock(p->light_blocks[i]->lights[j]);
+			p->light_blocks[i]->lights[j]->block = NULL;
+		}
+		free(p->light_blocks[i]);
+	}
+	if (p->light_blocks)
+		free(p->light_blocks);
+	if (p->unblocked_lights)
+		free(p->unblocked_lights);
+
+	p->light_blocks = NULL;
+	p->num_light_blocks = 0;
+	p->unblocked_lights = NULL;
+	p->num_unblocked_lights = 0;
+	p->light_blocks_valid = false;
+}
+
+// build the geometry of all lights drawn by drawLightGraphics() in
+// vertex arrays, the inner circle of a light has its color, the outer
+// circle is black, the colors are updated when a light changes
+
+void Lpanel_buildLightBatch(Lpanel_t *p)
+{
+	lpLight_t *light;
+	float *v;
+	GLuint *x;
+	int n = cir2d_nverts - 1;	// vertices of a circle
+	int i, j, k, num;
+
+	Lpanel_freeGraphicsData(p);
+
+	num = 0;
+	for (i = 0; i < p->num_lights; i++)
+		if (p->lights[i]->drawFunc == drawLightGraphics)
+			num++;
+
+	p->batch_verts = (float *) malloc(sizeof(float) * num * 2 * n * 3);
+	p->batch_colors = (float *) calloc(num * 2 * n * 3, sizeof(float));
+	p->batch_index = (GLuint *) malloc(sizeof(GLuint) * num * (3 * (n - 2) + 6 * n));
+
+	for (i = 0; i < p->num_lights; i++) {
+		light = p->lights[i];
+		if (light->drawFunc != drawLightGraphics) {
+			light->batch_vert = -1;
+			continue;
+		}
+
+		k = light->batch_vert = p->num_batch_verts;
+		p->num_batch_verts += 2 * n;
+
+		v = &p->batch_verts[k * 3];
+		for (j = 0; j < n; j++) {
+			v[j * 3 + 0] = light->parms->pos[0] +
+				       light->parms->scale[0] * cir2d_data2[j][0];
+			v[j * 3 + 1] = light->parms->pos[1] +
+				       light->parms->scale[1] * cir2d_data2[j][1];
+			v[j * 3 + 2] = light->parms->pos[2];
+			v[(n + j) * 3 + 0] = light->parms->pos[0] +
+					     light->parms->scale[0] * cir2d_data[j][0];
+			v[(n + j) * 3 + 1] = light->parms->pos[1] +
+					     light->parms->scale[1] * cir2d_data[j][1];
+			v[(n + j) * 3 + 2] = light->parms->pos[2];
+		}
+
+		x = &p->batch_index[p->num_batch_index];
+
+		// inner circle as a triangle fan
+		for (j = 1; j < n - 1; j++) {
+			*x++ = k;
+			*x++ = k + j;
+			*x++ = k + j + 1;
+		}
+
+		// ring between the inner and the outer circle
+		for (j = 0; j < n; j++) {
+			*x++ = k + j;
+			*x++ = k + n + j;
+			*x++ = k + (j + 1) % n;
+			*x++ = k + n + j;
+			*x++ = k + n + (j + 1) % n;
+			*x++ = k + (j + 1) % n;
+		}
+
+		p->num_batch_index = x - p->batch_index;
+	}
+}
+
+// free the retained graphics data, the display lists are gone
+// with the GL context
+
+void Lpanel_freeGraphicsData(Lpanel_t *p)
+{
+	if (p->batch_verts)
+		free(p->batch_verts);
+	if (p->batch_colors)
+		free(p->batch_colors);
+	if (p->batch_index)
+		free(p->batch_index);
+
+	p->batch_verts = NULL;
+	p->batch_colors = NULL;
+	p->batch_index = NULL;
+	p->num_batch_verts = 0;
+	p->num_batch_index = 0;
+	p->objects_list = 0;
+	p->alpha_objects_list = 0;
+}
+
 void Lpanel_growSwitches(Lpanel_t *p)
 {
 	lpSwitch_t **new_switches;
@@ -1662,6 +1985,8 @@ bool Lpanel_readConfig(Lpanel_t *p, const char *_fname)
 
 		for (i = 0; i < p->num_switches; i++)
 			lpSwitch_setupData(p->switches[i], i);
+
+		Lpanel_buildLightBatch(p);
 	}
 	return !bailout;
 } // end Lpanel_readConfig()
@@ -1728,8 +2053,13 @@ void Lpanel_sampleData(Lpanel_t *p)
 	}
 	p->old_clock = *p->simclock;
 
-	for (i = 0; i < p->num_lights; i++)
-		lpLight_sampleData(p->lights[i]);
+	if (!p->light_blocks_valid)
+		Lpanel_buildLightBlocks(p);
+
+	for (i = 0; i < p->num_light_blocks; i++)
+		sampleBlock(p->light_blocks[i]);
+	for (i = 0; i < p->num_unblocked_lights; i++)
+		lpLight_sampleData(p->unblocked_lights[i]);
 }
 
 void Lpanel_sampleDataWarp(Lpanel_t *p, int clockwarp)
@@ -1738,8 +2068,13 @@ void Lpanel_sampleDataWarp(Lpanel_t *p, int clockwarp)
 
 	p->clock_warp = clockwarp;
 
-	for (i = 0; i < p->num_lights; i++)
-		lpLight_sampleData(p->lights[i]);
+	if (!p->light_blocks_valid)
+		Lpanel_buildLightBlocks(p);
+
+	for (i = 0; i < p->num_light_blocks; i++)
+		sampleBlock(p->light_blocks[i]);
+	for (i = 0; i < p->num_unblocked_lights; i++)
+		lpLight_sampleData(p->unblocked_lights[i]);
 
 	p->clock_warp = 0;
 }
@@ -1810,6 +2145,11 @@ void lpLight_init(lpLight_t *p)
 	p->obj_refname = NULL;
 	p->obj_ref = NULL;
 	p->sampleDataFunc = sampleData8_error;
+	p->datatype = 0;
+	p->invert = false;
+	p->block = NULL;
+	p->block_idx = 0;
+	p->batch_vert = -1;
 	p->drawFunc = drawLightGraphics;
 	p->t1 = p->t2 = p->on_time = 1;
 	p->start_clock = 0;
@@ -1851,11 +2191,13 @@ void lpLight_bindSimclock(lpLight_t *p, uint64_t *addr, int *clockwarp)
 	p->clock_warp = clockwarp;
 }
 
-void lpLight_draw(lpLight_t *p)
+void lpLight_calcColor(lpLight_t *p)
 {
 	int i;
 	// float *fp;
 
+	lpLight_syncBlock(p);
+
 	switch (p->bindtype) {
 
 	case LBINDTYPE_BIT:
@@ -1905,6 +2247,11 @@ void lpLight_draw(lpLight_t *p)
 			fprintf(stderr, "draw: %s %f\n", p->name, p->intensity);
 		}
 #endif
+}
+
+void lpLight_draw(lpLight_t *p)
+{
+	lpLight_calcColor(p);
 
 	glPushMatrix();
 	glTranslatef(p->parms->pos[0], p->parms->pos[1], p->parms->pos[2]);
@@ -1933,60 +2280,62 @@ void lpLight_print(lpLight_t *p)
 	       p->parms->color[2]);
 }
 
+static void bindData(lpLight_t *p, lp_light_sdf_t func, void *ptr, int datatype,
+		     bool invert)
+{
+	p->sampleDataFunc = func;
+	p->dataptr = ptr;
+	p->datatype = datatype;
+	p->invert = invert;
+	if (p->panel)
+		p->panel->light_blocks_valid = false;
+}
+
 void lpLight_bindData8(lpLight_t *p, uint8_t *ptr)
 {
-	p->sampleDataFunc = sampleData8;
-	p->dataptr = (uint8_t *) ptr;
+	bindData(p, sampleData8, ptr, sizeof(uint8_t), false);
 }
 
 void lpLight_bindData8invert(lpLight_t *p, uint8_t *ptr)
 {
-	p->sampleDataFunc = sampleData8invert;
-	p->dataptr = (uint8_t *) ptr;
+	bindData(p, sampleData8invert, ptr, sizeof(uint8_t), true);
 }
 
 void lpLight_bindData16(lpLight_t *p, uint16_t *ptr)
 {
 	// xyzzy
-	p->sampleDataFunc = sampleData16;
-	p->dataptr = (uint16_t *) ptr;
+	bindData(p, sampleData16, ptr, sizeof(uint16_t), false);
 }
 
 void lpLight_bindDatafv(lpLight_t *p, float *ptr)
 {
-	p->sampleDataFunc = sampleDatafv;
-	p->dataptr = (float *) ptr;
+	bindData(p, sampleDatafv, ptr, 0, false);
 	p->bindtype = LBINDTYPE_FLOATV;
 }
 
 void lpLight_bindData16invert(lpLight_t *p, uint16_t *ptr)
 {
-	p->sampleDataFunc = sampleData16invert;
-	p->dataptr = (uint16_t *) ptr;
+	bindData(p, sampleData16invert, ptr, sizeof(uint16_t), true);
 }
 
 void lpLight_bindData32(lpLight_t *p, uint32_t *ptr)
 {
-	p->sampleDataFunc = sampleData32;
-	p->dataptr = (uint32_t *) ptr;
+	bindData(p, sampleData32, ptr, sizeof(uint32_t), false);
 }
 
 void lpLight_bindData32invert(lpLight_t *p, uint32_t *ptr)
 {
-	p->sampleDataFunc = sampleData32invert;
-	p->dataptr = (uint32_t *) ptr;
+	bindData(p, sampleData32invert, ptr, sizeof(uint32_t), true);
 }
 
 void lpLight_bindData64(lpLight_t *p, uint64_t *ptr)
 {
-	p->sampleDataFunc = sampleData64;
-	p->dataptr = (uint64_t *) ptr;
+	bindData(p, sampleData64, ptr, sizeof(uint64_t), false);
 }
 
 void lpLight_bindData64invert(lpLight_t *p, uint64_t *ptr)
 {
-	p->sampleDataFunc = sampleData64invert;
-	p->dataptr = (uint64_t *) ptr;
+	bindData(p, sampleData64invert, ptr, sizeof(uint64_t), true);
 }
 
 void lpLight_calcIntensity(lpLight_t *p)
@@ -2019,6 +2368,8 @@ void lpLight_calcIntensity(lpLight_t *p)
 	p->start_clock = *p->simclock;
 	p->on_time = 0;
 	p->dirty = false;
+	if (p->block)
+		p->block->on_time[p->block_idx] = 0;
 
 	for (i = 0; i < 3; i++) {
 		p->color[i] = p->parms->color[i] * p->intensity + p->parms->color[i] * .2;
@@ -2030,7 +2381,29 @@ void lpLight_calcIntensity(lpLight_t *p)
 
 void lpLight_sampleData(lpLight_t *p)
 {
-	(*p->sampleDataFunc)(p);
+	if (p->block)
+		sampleBlockLight(p->block, p->block_idx);
+	else
+		(*p->sampleDataFunc)(p);
+}
+
+// copy the values sampled in the block of the light into it
+
+void lpLight_syncBlock(lpLight_t *p)
+{
+	lpLightBlock_t *b = p->block;
+	int i = p->block_idx;
+
+	if (b == NULL)
+		return;
+
+	p->on_time = b->on_time[i];
+	p->old_clock = b->old_clock[i];
+	p->state = b->state[i];
+	if (b->dirty[i]) {
+		p->dirty = true;
+		b->dirty[i] = false;
+	}
 }
 
 void lpLight_setupData(lpLight_t *p)
@@ -2058,6 +2431,8 @@ void lpLight_setName(lpLight_t *p, const char *name)
 void lpLight_setBitNumber(lpLight_t *p, int bitnum)
 {
 	p->bitnum = bitnum;
+	if (p->panel)
+		p->panel->light_blocks_valid = false;
 };
 
 bool Lpanel_smoothLight(Lpanel_t *p, const char *name, int nframes)
@@ -107,6 +107,21 @@ typedef struct Lpanel {
 
 	struct lpLight	**lights;
 
+	int		num_light_blocks;
+	struct lpLightBlock **light_blocks;	// lights grouped by bound data for sampling
+	struct lpLight	**unblocked_lights;	// lights sampled one by one
+	int		num_unblocked_lights;
+	bool		light_blocks_valid;
+
+	// retained graphics data
+	GLuint		objects_list,		// display list of the objects
+			alpha_objects_list;	// display list of the alpha objects
+	int		num_batch_verts,	// lights drawn in one batch
+			num_batch_index;
+	float		*batch_verts,		// xyz of the batch vertices
+			*batch_colors;		// rgb of the batch vertices
+	GLuint		*batch_index;		// triangles of the batch
+
 	lp_light_group_t light_groups[LP_MAX_LIGHT_GROUPS];
 
 	lpSwitch_t	**switches;
@@ -205,6 +220,10 @@ extern void		Lpanel_fini(Lpanel_t *p);
 
 extern void		Lpanel_genGraphicsData(Lpanel_t *p);
 extern void		Lpanel_growLights(Lpanel_t *p);
+extern void		Lpanel_buildLightBlocks(Lpanel_t *p);
+extern void		Lpanel_freeLightBlocks(Lpanel_t *p);
+extern void		Lpanel_buildLightBatch(Lpanel_t *p);
+extern void		Lpanel_freeGraphicsData(Lpanel_t *p);
 extern void		Lpanel_growObjects(Lpanel_t *p);
 extern void		Lpanel_growAlphaObjects(Lpanel_t *p);
 extern void		Lpanel_growSwitches(Lpanel_t *p);
@@ -329,6 +348,12 @@ typedef struct lpLight {
 	void		*dataptr;	// pointer to data to sample
 	int		datatype;	// datatype dataptr points to
 	int		bitnum;		// bit in data controlling this light
+	bool		invert;		// light is on if the bit is 0
+
+	struct lpLightBlock *block;	// sample block this light is in
+	int		block_idx;	// index of the light in the block
+
+	int		batch_vert;	// first vertex in the light batch, -1 = not batched
 
 	char		*obj_refname;	// name of object if this light references one.
 	lpObject_t	*obj_ref;	// pointer to object if this light references one.
@@ -356,6 +381,28 @@ typedef struct lpLight {
 	lp_light_sdf_t	sampleDataFunc;
 } lpLight_t;
 
+// lights bound to the same data are sampled together in blocks, the
+// per light values are kept in arrays, so that one load of the data
+// updates all lights of the block in a loop the compiler can vectorize
+
+#define LP_BLOCK_LIGHTS 16		// max. number of lights in a block
+
+typedef struct lpLightBlock {
+	void		*dataptr;	// pointer to data to sample
+	int		datatype;	// size of the data in bytes
+	int		num_lights;
+	uint64_t	*simclock;
+
+	uint64_t	bitnum[LP_BLOCK_LIGHTS],
+			invert[LP_BLOCK_LIGHTS],
+			on_time[LP_BLOCK_LIGHTS],
+			old_clock[LP_BLOCK_LIGHTS];
+	uint8_t		state[LP_BLOCK_LIGHTS],
+			dirty[LP_BLOCK_LIGHTS];
+
+	lpLight_t	*lights[LP_BLOCK_LIGHTS];
+} lpLightBlock_t;
+
 extern lpLight_t	*lpLight_new(void);
 extern void		lpLight_delete(lpLight_t *p);
 extern void		lpLight_init(lpLight_t *p);
@@ -378,11 +425,13 @@ extern void		lpLight_bindData64invert(lpLight_t *p, uint64_t *ptr);
 extern void		lpLight_bindSimclock(lpLight_t *p, uint64_t *addr, int *clockwarp);
 
 extern void		lpLight_calcIntensity(lpLight_t *p);
+extern void		lpLight_calcColor(lpLight_t *p);
 extern void		lpLight_draw(lpLight_t *p);
 extern void		lpLight_print(lpLight_t *p);
 
 extern void		lpLight_setupData(lpLight_t *p);
 extern void		lpLight_sampleData(lpLight_t *p);
+extern void		lpLight_syncBlock(lpLight_t *p);
 
 extern void		lpLight_setName(lpLight_t *p, const char *name);
 extern void		lpLight_setBitNumber(lpLight_t *p, int bitnum);
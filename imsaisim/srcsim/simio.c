@@ -38,6 +38,7 @@
  * 05-AUG-2021 add boot config for machine without frontpanel
  * 07-AUG-2021 add APU emulation
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 18-OCT-2026 10ms timer runs in simulated time
  */
 
 #include <unistd.h>
@@ -45,9 +46,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
-#include <signal.h>
 #include <fcntl.h>
-#include <sys/time.h>
 
 #include "sim.h"
 #include "simdefs.h"
@@ -55,6 +54,7 @@
 #include "simcfg.h"
 #include "simmem.h"
 #include "simio.h"
+#include "simevent.h"
 #if !defined (EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
 #include "simcore.h"
 #endif
@@ -118,6 +118,9 @@ static void apu_status_out(BYTE data);
 static int printer;		/* fd for file "printer.txt" */
 unix_connector_t ucons[NUMUSOC]; /* socket connections for SIO's */
 static BYTE hwctl_lock = 0xff;	/* lock status hardware control port */
+
+static void int_timer(void);
+static event_t timer_ev = { .ev_func = int_timer }; /* 10ms timer event */
 #ifdef HAS_APU
 static void *am9511 = NULL;	/* am9511 instantiation */
 #endif
@@ -403,9 +406,9 @@ static void fp_out(BYTE data)
 /*
  *	timer interrupt causes RST 38 in IM 0 and IM 1
  */
-static void int_timer(int sig)
+static void int_timer(void)
 {
-	UNUSED(sig);
+	ev_repeat(&timer_ev, ev_us(10000));
 
 	int_int = true;
 	int_data = 0xff;	/* RST 38H */
@@ -435,9 +438,6 @@ static BYTE hwctl_in(void)
  */
 static void hwctl_out(BYTE data)
 {
-	static struct itimerval tim;
-	static struct sigaction newact;
-
 	/* if port is locked do nothing */
 	if (hwctl_lock && (data != 0xaa))
 		return;
@@ -469,25 +469,10 @@ static void hwctl_out(BYTE data)
 	}
 #endif
 
-	if (data & 1) {
-		newact.sa_handler = int_timer;
-		sigemptyset(&newact.sa_mask);
-		newact.sa_flags = 0;
-		sigaction(SIGALRM, &newact, NULL);
-		tim.it_value.tv_sec = 0;
-		tim.it_value.tv_usec = 10000;
-		tim.it_interval.tv_sec = 0;
-		tim.it_interval.tv_usec = 10000;
-		setitimer(ITIMER_REAL, &tim, NULL);
-	} else {
-		newact.sa_handler = SIG_IGN;
-		sigemptyset(&newact.sa_mask);
-		newact.sa_flags = 0;
-		sigaction(SIGALRM, &newact, NULL);
-		tim.it_value.tv_sec = 0;
-		tim.it_value.tv_usec = 0;
-		setitimer(ITIMER_REAL, &tim, NULL);
-	}
+	if (data & 1)
+		ev_schedule(&timer_ev, ev_us(10000));
+	else
+		ev_cancel(&timer_ev);
 }
 
 void lpt_reset(void)
@@ -17,6 +17,7 @@
  * 18-OCT-2019 add MMU and memory banks
  * 20-JUL-2021 log banked memory
  * 29-AUG-2021 new memory configuration sections
+ * 18-OCT-2026 write watch for the VIO video RAM
  */
 
 #include <stdlib.h>
@@ -53,6 +54,9 @@ static BYTE groupsel;
 int p_tab[MAXPAGES];		/* 256 pages of 256 bytes */
 int _p_tab[MAXPAGES];		/* copy of p_tab[] for RAM only */
 
+/* cells of the VIO video RAM written since the last refresh */
+uint64_t vio_dirty[VIO_SIZE / 64];
+
 /* additional memory banks */
 static BYTE bnk1[SEGSIZ];
 static BYTE bnk2[SEGSIZ];
@@ -22,6 +22,8 @@
  * 20-JUL-2021 log banked memory
  * 29-AUG-2021 new memory configuration sections
  * 14-DEC-2024 added hardware breakpoint support
+ * 18-OCT-2026 write watch for the VIO video RAM
+ * 18-OCT-2026 breakpoints are checked in bitmaps
  */
 
 #ifndef SIMMEM_INC
@@ -73,6 +75,8 @@ extern int p_tab[MAXPAGES];
 extern int _p_tab[MAXPAGES];
 extern int selbnk, num_banks;
 
+#define BP_BANK selbnk		/* bank of the breakpoints */
+
 extern void ctrl_port_out(BYTE data);
 extern BYTE ctrl_port_in(void);
 
@@ -107,6 +111,24 @@ extern int cyclecount;
 extern void init_memory(void), reset_memory(void);
 extern void groupswap(void);
 
+/*
+ * write watch for the VIO video RAM, one bit per cell, so that
+ * the display refresh only renders the cells which were written
+ */
+#define VIO_RAM		0xf000	/* start of the VIO video RAM */
+#define VIO_SIZE	2048	/* size of it, including command byte */
+
+extern uint64_t vio_dirty[VIO_SIZE / 64];
+
+static inline void vio_mark(WORD addr)
+{
+	register WORD i = addr - VIO_RAM;
+
+	if (i < VIO_SIZE)
+		__atomic_fetch_or(&vio_dirty[i >> 6], (uint64_t) 1 << (i & 63),
+				  __ATOMIC_RELEASE);
+}
+
 /*
  * memory access for the CPU cores
  */
@@ -131,13 +153,15 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && hb_test(hb_wr, addr))
+		hb_hit(addr, HB_WRITE);
 #endif
 
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
-		if (p_tab[addr >> 8] == MEM_RW)
+		if (p_tab[addr >> 8] == MEM_RW) {
 			_MEMWRTTHRU(addr) = data;
+			vio_mark(addr);
+		}
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
@@ -149,15 +173,8 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
-		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
-		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
-		}
-	}
+	if (hb_flag && !(cpu_bus & CPU_M1) && hb_test(hb_rd, addr))
+		hb_hit(addr, HB_READ);
 #endif
 
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
@@ -232,8 +249,10 @@ static inline void dma_write(WORD addr, BYTE data)
 	bus_request = 0;
 
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
-		if (p_tab[addr >> 8] == MEM_RW)
+		if (p_tab[addr >> 8] == MEM_RW) {
 			_MEMDIRECT(addr) = data;
+			vio_mark(addr);
+		}
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
@@ -258,6 +277,7 @@ static inline void putmem(WORD addr, BYTE data)
 {
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
 		_MEMMAPPED(addr) = data;
+		vio_mark(addr);
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
@@ -269,8 +289,10 @@ static inline void putmem(WORD addr, BYTE data)
 static inline void fp_write(WORD addr, BYTE data)
 {
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
-		if (p_tab[addr >> 8] == MEM_RW)
+		if (p_tab[addr >> 8] == MEM_RW) {
 			_MEMDIRECT(addr) = data;
+			vio_mark(addr);
+		}
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
@@ -24,6 +24,7 @@
 #define EXCLUDE_Z80	/* Intel Intellec MDS-800 was an 8080 machine */
 /*#define ALT_I8080*/	/* use alt. 8080 sim. primarily optimized for size */
 /*#define ALT_Z80*/	/* use alt. Z80 sim. primarily optimized for size */
+/*#define THR_Z80*/	/* use threaded Z80 sim. primarily optimized for speed */
 #define UNDOC_INST	/* compile undocumented instrs. (required by ALT_*) */
 #ifndef EXCLUDE_Z80
 /*#define FAST_BLOCK*/	/* much faster but not accurate Z80 block instr. */
@@ -35,6 +36,7 @@
 /*#define HISIZE  1000*//* no history */
 /*#define SBSIZE  10*/	/* no software breakpoints */
 /*#define WANT_HB*/	/* no hardware breakpoint */
+/*#define WANT_PROF*/	/* no execution profiler */
 #endif
 
 #define HAS_DISKS	/* uses disk images */
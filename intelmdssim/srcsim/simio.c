@@ -12,6 +12,7 @@
  * 03-JUN-2024 first version
  * 07-JUN-2024 rewrite of the monitor ports and the timing thread
  * 09-JUN-2024 add hwctl and simbdos ports
+ * 18-OCT-2026 write disk sectors behind
  */
 
 #include <stdlib.h>
@@ -30,6 +31,7 @@
 #include "simport.h"
 #include "simio.h"
 
+#include "diskwb.h"
 #include "mds-monitor.h"
 #include "mds-isbc201.h"
 #include "mds-isbc202.h"
@@ -232,6 +234,9 @@ void exit_io(void)
 {
 	register int i;
 
+	/* write the disk sectors still queued */
+	dwb_exit();
+
 	/* close line printer file */
 	if (lpt_fd != 0)
 		close(lpt_fd);
@@ -23,6 +23,8 @@
  * 15-JUL-2018 use logging
  * 24-NOV-2019 configurable baud rate for second channel
  * 19-JUL-2020 avoid problems with some third party terminal emulations
+ * 18-OCT-2026 terminal input is received by the reactor thread
+ * 18-OCT-2026 terminal output is sent by the reactor thread
  */
 
 #include <unistd.h>
@@ -42,6 +44,7 @@
 
 #include "unix_terminal.h"
 #include "unix_network.h"
+#include "unix_reactor.h"
 #include "altair-88-2sio.h"
 
 #include "log.h"
@@ -81,24 +84,19 @@ void altair_2sio_reset(void)
  */
 BYTE altair_sio1_status_in(void)
 {
-	struct pollfd p[1];
+	int ch;
 
 	sio1_t2 = get_clock_us();
 	if (sio1_baud_rate > 0 &&
 	    (int) (sio1_t2 - sio1_t1) < BAUDTIME / sio1_baud_rate)
 		return sio1_stat;
 
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (p[0].revents & POLLIN)
-		sio1_stat |= 1;
-	if (p[0].revents & POLLNVAL) {
+	if ((ch = rx_stdin()) == -1) {
 		LOGE(TAG, "can't use terminal, try 'screen simulation ...'");
 		cpu_error = IOERROR;
 		cpu_state = ST_STOPPED;
-	}
+	} else if (rx_ready(ch))
+		sio1_stat |= 1;
 	sio1_stat |= 2;
 
 	sio1_t1 = get_clock_us();
@@ -122,21 +120,17 @@ void altair_sio1_status_out(BYTE data)
  */
 BYTE altair_sio1_data_in(void)
 {
-	BYTE data;
+	int ch, data;
 	static BYTE last;
-	struct pollfd p[1];
 
 again:
 	/* if no input waiting return last */
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (!(p[0].revents & POLLIN))
+	if ((ch = rx_stdin()) == -1 || (data = rx_get(ch)) == RX_NONE)
 		return last;
 
-	if (read(fileno(stdin), &data, 1) == 0) {
+	if (data == RX_EOF) {
 		/* try to reopen tty, input redirection exhausted */
+		rx_close(ch);
 		if (freopen("/dev/tty", "r", stdin) == NULL)
 			LOGE(TAG, "can't reopen /dev/tty");
 		set_unix_terminal();
@@ -161,6 +155,8 @@ again:
  */
 void altair_sio1_data_out(BYTE data)
 {
+	int ch;
+
 	if (sio1_drop_nulls)
 		if (data == 0)
 			return;
@@ -168,15 +164,10 @@ void altair_sio1_data_out(BYTE data)
 	if (sio1_strip_parity)
 		data &= 0x7f;
 
-again:
-	if (write(fileno(stdout), &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write data sio1");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if ((ch = tx_stdout()) == -1 || !tx_put(ch, data)) {
+		LOGE(TAG, "can't write data sio1");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 
 	sio1_t1 = get_clock_us();
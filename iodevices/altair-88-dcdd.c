@@ -10,22 +10,26 @@
  * History:
  * 10-AUG-2018 first version, runs CP/M 1.4 & 2.2 & disk BASIC
  * 02-DEC-2019 use disk names different from Tarbell controller
+ * 18-OCT-2026 write sectors behind
+ * 18-OCT-2026 disk timing is an event in simulated time
+ * 18-OCT-2026 keep the disk images open
  */
 
-#include <pthread.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <fcntl.h>
 
 #include "sim.h"
 #include "simdefs.h"
 #include "simglb.h"
 #include "simport.h"
+#include "simevent.h"
 
 #include "altair-88-dcdd.h"
+#include "diskimg.h"
+#include "diskwb.h"
 
 /* #define LOG_LOCAL_LEVEL LOG_DEBUG */
 #include "log.h"
@@ -61,12 +65,12 @@ static int sec;			/* current sector position */
 static int rwsec;		/* sector read/written */
 static int disk;		/* current disk # */
 static BYTE status = 0xff;	/* controller status */
-static pthread_mutex_t mustatus = PTHREAD_MUTEX_INITIALIZER;
 static int headloaded;		/* head loaded flag */
 static int writing;		/* write circuit enabled */
 static int state;		/* fdc state */
 static char fn[MAX_LFN];	/* path/filename for disk image */
 static int fd;			/* fd for disk file i/o */
+static dimg_t img[16];		/* open disk images */
 static int dcnt;		/* data counter read/write */
 static BYTE buf[SEC_SZ];	/* buffer for one sector */
 
@@ -74,7 +78,8 @@ static int cnt_sec;		/* counter for sector position */
 static int cnt_head;		/* counter for loading head */
 static int cnt_step;		/* counter for stepping track */
 
-static pthread_t thread;	/* thread for timing */
+static void timing(void);
+static event_t timing_ev = { .ev_func = timing }; /* event for timing */
 
 /* these are our disk drives */
 static const char *disks[16] = {
@@ -118,26 +123,25 @@ static void dsk_path(void)
 }
 
 /*
- * open and check disk image
+ * open and check disk image, if it isn't open already
  */
-static int dsk_open(int flags)
+static int dsk_open(bool write)
 {
-	struct stat s;
-
-	/* try to open disk image */
-	dsk_path();
-	strcat(fn, "/");
-	strcat(fn, disks[disk]);
-	if ((fd = open(fn, flags)) == -1)
-		return 0;
+	if (!dimg_valid(&img[disk])) {
+		/* try to open disk image */
+		dsk_path();
+		strcat(fn, "/");
+		strcat(fn, disks[disk]);
+		if (dimg_open(&img[disk], disk, fn) == -1)
+			return 0;
+	}
 
 	/* check for correct image size */
-	fstat(fd, &s);
-	if (s.st_size != 337568) {
-		close(fd);
+	if (img[disk].size != 337568 || (write && img[disk].rdonly))
 		return 0;
-	} else
-		return 1;
+
+	fd = img[disk].fd;
+	return 1;
 }
 
 /*
@@ -146,62 +150,44 @@ static int dsk_open(int flags)
 static void dsk_disable(void)
 {
 	state = FDC_DISABLED;
-	pthread_mutex_lock(&mustatus);
 	status = 0xff;
-	pthread_mutex_unlock(&mustatus);
 	headloaded = 0;
 	writing = 0;
 	cnt_head = 0;
 	cnt_step = 0;
-	if (thread != 0) {
-		pthread_cancel(thread);
-		pthread_join(thread, NULL);
-		thread = 0;
-	}
+	ev_cancel(&timing_ev);
 	LOGD(TAG, "disabled");
 }
 
 /*
- * thread for timing
+ * event for timing, every 1 msec
  */
-static void *timing(void *arg)
+static void timing(void)
 {
-	UNUSED(arg);
-
-	/* 1 msec per loop iteration */
-	while (true) {
-		/* advance sector position, 5ms at 360 RPM */
-		if (++cnt_sec > TIMESEC) {
-			cnt_sec = 0;
-			if (++sec >= SPT) {
-				sec = 0;
-			}
-		}
+	ev_repeat(&timing_ev, ev_us(1000));
 
-		/* count down head load timer */
-		if (cnt_head > 0) {
-			if (--cnt_head == 0) {
-				pthread_mutex_lock(&mustatus);
-				status &= ~STATHD;
-				pthread_mutex_unlock(&mustatus);
-				LOGD(TAG, "head loaded");
-			}
+	/* advance sector position, 5ms at 360 RPM */
+	if (++cnt_sec > TIMESEC) {
+		cnt_sec = 0;
+		if (++sec >= SPT) {
+			sec = 0;
 		}
+	}
 
-		/* count down stepping timer */
-		if (cnt_step > 0) {
-			if (--cnt_step == 0) {
-				pthread_mutex_lock(&mustatus);
-				status &= ~MOVEHD;
-				pthread_mutex_unlock(&mustatus);
-			}
+	/* count down head load timer */
+	if (cnt_head > 0) {
+		if (--cnt_head == 0) {
+			status &= ~STATHD;
+			LOGD(TAG, "head loaded");
 		}
-
-		/* sleep for 1 millisecond */
-		sleep_for_ms(1);
 	}
 
-	pthread_exit(NULL);
+	/* count down stepping timer */
+	if (cnt_step > 0) {
+		if (--cnt_step == 0) {
+			status &= ~MOVEHD;
+		}
+	}
 }
 
 /*
@@ -218,28 +204,20 @@ void altair_dsk_select_out(BYTE data)
 		/* get disk no. */
 		disk = data & 0x0f;
 		/* check disk in drive */
-		if (dsk_open(O_RDONLY) == 0) {
+		if (dsk_open(false) == 0) {
 			/* no (valid) disk in drive, disable */
 			dsk_disable();
 			return;
 		}
-		close(fd);
 		/* enable */
 		state = FDC_ENABLED;
-		pthread_mutex_lock(&mustatus);
 		status = 0b10100101;
-		pthread_mutex_unlock(&mustatus);
 		writing = 0;
 		headloaded = 0;
 		cnt_head = 0;
 		cnt_step = 0;
-		if (thread == 0) {
-			if (pthread_create(&thread, NULL, timing,
-					   (void *) NULL)) {
-				LOGE(TAG, "can't create timing thread");
-				exit(EXIT_FAILURE);
-			}
-		}
+		if (!ev_pending(&timing_ev))
+			ev_schedule(&timing_ev, ev_us(1000));
 		LOGD(TAG, "enabled, disk = %d", disk);
 	}
 }
@@ -262,24 +240,16 @@ BYTE altair_dsk_status_in(void)
 	if (state == FDC_ENABLED) {
 		/* set CPU INTE */
 		if (IFF & 1) {
-			pthread_mutex_lock(&mustatus);
 			status &= ~INTE;
-			pthread_mutex_unlock(&mustatus);
 		} else {
-			pthread_mutex_lock(&mustatus);
 			status |= INTE;
-			pthread_mutex_unlock(&mustatus);
 		}
 
 		/* set track 0 */
 		if (track[disk] == 0) {
-			pthread_mutex_lock(&mustatus);
 			status &= ~TRACK0;
-			pthread_mutex_unlock(&mustatus);
 		} else {
-			pthread_mutex_lock(&mustatus);
 			status |= TRACK0;
-			pthread_mutex_unlock(&mustatus);
 		}
 	}
 
@@ -306,15 +276,11 @@ void altair_dsk_control_out(BYTE data)
 			LOGD(TAG, "step in from track %d", track[disk]);
 			if (track[disk] < (TRK - 1)) {
 				track[disk]++;
-				pthread_mutex_lock(&mustatus);
 				status |= MOVEHD;
-				pthread_mutex_unlock(&mustatus);
 				cnt_step = TIMESTEP;
 				/* head needs to settle again */
 				if (headloaded) {
-					pthread_mutex_lock(&mustatus);
 					status |= STATHD;
-					pthread_mutex_unlock(&mustatus);
 					cnt_head = TIMELOAD;
 				}
 			}
@@ -325,15 +291,11 @@ void altair_dsk_control_out(BYTE data)
 			LOGD(TAG, "step out from track %d", track[disk]);
 			if (track[disk] > 0) {
 				track[disk]--;
-				pthread_mutex_lock(&mustatus);
 				status |= MOVEHD;
-				pthread_mutex_unlock(&mustatus);
 				cnt_step = TIMESTEP;
 				/* head needs to settle again */
 				if (headloaded) {
-					pthread_mutex_lock(&mustatus);
 					status |= STATHD;
-					pthread_mutex_unlock(&mustatus);
 					cnt_head = TIMELOAD;
 				}
 			}
@@ -343,9 +305,7 @@ void altair_dsk_control_out(BYTE data)
 		if (data & 4) {
 			headloaded = 1;
 			cnt_head = TIMELOAD;
-			pthread_mutex_lock(&mustatus);
 			status |= MOVEHD;
-			pthread_mutex_unlock(&mustatus);
 			cnt_step = TIMELOAD;
 			LOGD(TAG, "load head");
 		}
@@ -354,9 +314,7 @@ void altair_dsk_control_out(BYTE data)
 		if (data & 8) {
 			headloaded = 0;
 			cnt_head = 0;
-			pthread_mutex_lock(&mustatus);
 			status |= STATHD;
-			pthread_mutex_unlock(&mustatus);
 			LOGD(TAG, "unload head");
 		}
 
@@ -364,9 +322,7 @@ void altair_dsk_control_out(BYTE data)
 		if ((data & 128) && (writing == 0)) {
 			writing = 1;
 			dcnt = 0;
-			pthread_mutex_lock(&mustatus);
 			status &= ~ENWD;
-			pthread_mutex_unlock(&mustatus);
 			LOGD(TAG, "write enabled");
 		}
 	}
@@ -380,19 +336,15 @@ BYTE altair_dsk_sec_in(void)
 	BYTE sectrue;
 
 	if ((state != FDC_ENABLED) || (status & STATHD)) {
-		pthread_mutex_lock(&mustatus);
 		status |= NRDA;
 		status |= ENWD;
-		pthread_mutex_unlock(&mustatus);
 		return 0xff;
 	} else {
 		if (sec != rwsec) {
 			rwsec = sec;
 			sectrue = 0;	/* start of new sector */
-			pthread_mutex_lock(&mustatus);
 			status &= ~NRDA; /* new read data available */
 			status |= ENWD;	/* not ready for writing */
-			pthread_mutex_unlock(&mustatus);
 			dcnt = 0;
 		} else {
 			sectrue = 1;
@@ -420,20 +372,16 @@ void altair_dsk_data_out(BYTE data)
 	if (dcnt == SEC_SZ) {
 		writing = 0;
 		/* open and check disk */
-		if (dsk_open(O_RDWR) == 0) {
+		if (dsk_open(true) == 0) {
 			dsk_disable();
 			return;
 		}
 		/* write sector */
 		pos = (track[disk] * SPT + rwsec) * SEC_SZ;
-		if (lseek(fd, pos, SEEK_SET) != pos) {
-			LOGE(TAG, "can't seek to sector %d track %d",
-			     rwsec, track[disk]);
-		} else if (write(fd, buf, SEC_SZ) != SEC_SZ) {
+		if (dwb_pwrite(fd, buf, SEC_SZ, pos) != SEC_SZ) {
 			LOGE(TAG, "can't write sector %d track %d",
 			     rwsec, track[disk]);
 		}
-		close(fd);
 		LOGD(TAG, "write sector %d track %d", rwsec, track[disk]);
 	}
 }
@@ -449,20 +397,16 @@ BYTE altair_dsk_data_in(void)
 	/* first byte? */
 	if (dcnt == 0) {
 		/* open and check disk */
-		if (dsk_open(O_RDONLY) == 0) {
+		if (dsk_open(false) == 0) {
 			dsk_disable();
 			memset(buf, 0xff, SEC_SZ);
 		} else {
 			/* read sector */
 			pos = (track[disk] * SPT + rwsec) * SEC_SZ;
-			if (lseek(fd, pos, SEEK_SET) != pos) {
-				LOGE(TAG, "can't seek to sector %d track %d",
-				     rwsec, track[disk]);
-			} else if (read(fd, buf, SEC_SZ) != SEC_SZ) {
+			if (dwb_pread(fd, buf, SEC_SZ, pos) != SEC_SZ) {
 				LOGE(TAG, "can't read sector %d track %d",
 				     rwsec, track[disk]);
 			}
-			close(fd);
 			LOGD(TAG, "read sector %d track %d", rwsec, track[disk]);
 		}
 	}
@@ -474,9 +418,7 @@ BYTE altair_dsk_data_in(void)
 	/* return byte from buffer and increment counter */
 	data = buf[dcnt++];
 	if (dcnt == SEC_SZ) {
-		pthread_mutex_lock(&mustatus);
 		status |= NRDA;	/* no more data to read */
-		pthread_mutex_unlock(&mustatus);
 	}
 	return data;
 }
@@ -486,10 +428,13 @@ BYTE altair_dsk_data_in(void)
  */
 void altair_dsk_reset(void)
 {
+	int i;
+
+	/* pick up changed disk images */
+	for (i = 0; i < 16; i++)
+		dimg_close(&img[i]);
 	state = FDC_DISABLED;
-	pthread_mutex_lock(&mustatus);
 	status = 0xff;
-	pthread_mutex_unlock(&mustatus);
 	headloaded = writing = dcnt = 0;
 	cnt_head = cnt_step = 0;
 }
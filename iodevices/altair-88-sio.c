@@ -20,6 +20,8 @@
  * 15-JUL-2018 use logging
  * 24-NOV-2019 configurable baud rate for tape SIO
  * 19-JUL-2020 avoid problems with some third party terminal emulations
+ * 18-OCT-2026 terminal input is received by the reactor thread
+ * 18-OCT-2026 terminal output is sent by the reactor thread
  */
 
 #include <unistd.h>
@@ -39,6 +41,7 @@
 
 #include "unix_terminal.h"
 #include "unix_network.h"
+#include "unix_reactor.h"
 #include "altair-88-sio.h"
 
 #include "log.h"
@@ -81,7 +84,7 @@ void altair_sio_reset(void)
  */
 BYTE altair_sio0_status_in(void)
 {
-	struct pollfd p[1];
+	int ch;
 
 	if (sio0_revision == 0)
 		sio0_stat = 0;
@@ -93,21 +96,16 @@ BYTE altair_sio0_status_in(void)
 	    (int) (sio0_t2 - sio0_t1) < BAUDTIME / sio0_baud_rate)
 		return sio0_stat;
 
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (p[0].revents & POLLIN) {
+	if ((ch = rx_stdin()) == -1) {
+		LOGE(TAG, "can't use terminal, try 'screen simulation ...'");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
+	} else if (rx_ready(ch)) {
 		if (sio0_revision == 0)
 			sio0_stat |= 32;
 		else
 			sio0_stat &= ~1;
 	}
-	if (p[0].revents & POLLNVAL) {
-		LOGE(TAG, "can't use terminal, try 'screen simulation ...'");
-		cpu_error = IOERROR;
-		cpu_state = ST_STOPPED;
-	}
 	if (sio0_revision == 0)
 		sio0_stat |= 2;
 	else
@@ -134,21 +132,17 @@ void altair_sio0_status_out(BYTE data)
  */
 BYTE altair_sio0_data_in(void)
 {
-	BYTE data;
+	int ch, data;
 	static BYTE last;
-	struct pollfd p[1];
 
 again:
 	/* if no input waiting return last */
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (!(p[0].revents & POLLIN))
+	if ((ch = rx_stdin()) == -1 || (data = rx_get(ch)) == RX_NONE)
 		return last;
 
-	if (read(fileno(stdin), &data, 1) == 0) {
+	if (data == RX_EOF) {
 		/* try to reopen tty, input redirection exhausted */
+		rx_close(ch);
 		if (freopen("/dev/tty", "r", stdin) == NULL)
 			LOGE(TAG, "can't reopen /dev/tty");
 		set_unix_terminal();
@@ -176,6 +170,8 @@ again:
  */
 void altair_sio0_data_out(BYTE data)
 {
+	int ch;
+
 	if (sio0_drop_nulls)
 		if (data == 0)
 			return;
@@ -183,15 +179,10 @@ void altair_sio0_data_out(BYTE data)
 	if (sio0_strip_parity)
 		data &= 0x7f;
 
-again:
-	if (write(fileno(stdout), &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write sio0 data");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if ((ch = tx_stdout()) == -1 || !tx_put(ch, data)) {
+		LOGE(TAG, "can't write sio0 data");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 
 	sio0_t1 = get_clock_us();
@@ -25,10 +25,12 @@
  * 19-JUL-2018 integrate webfrontend
  * 04-NOV-2019 remove fake DMA bus request
  * 04-JAN-2025 add SDL2 support
+ * 18-OCT-2026 draw frames into a framebuffer, frame flag from the CPU clock
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef WANT_SDL
 #include <SDL.h>
 #else
@@ -43,6 +45,7 @@
 #include "simcfg.h"
 #include "simmem.h"
 #include "simport.h"
+#include "simevent.h"
 #ifdef WANT_SDL
 #include "simsdl.h"
 #endif
@@ -50,7 +53,6 @@
 #ifdef HAS_DAZZLER
 
 #ifdef HAS_NETSERVER
-#include <string.h>
 #include "netsrv.h"
 #endif
 
@@ -71,6 +73,7 @@ static int size = WSIZE;
 static int dazzler_win_id = -1;
 static SDL_Window *window;
 static SDL_Renderer *renderer;
+static SDL_Texture *texture;
 static uint8_t colors[16][3] = {
 	{ 0x00, 0x00, 0x00 },
 	{ 0x80, 0x00, 0x00 },
@@ -113,7 +116,7 @@ static Window window;
 static int screen;
 static GC gc;
 static XWindowAttributes wa;
-static Pixmap pixmap;
+static XImage *ximage;
 static Colormap colormap;
 static XColor colors[16];
 static XColor grays[16];
@@ -151,12 +154,35 @@ static char gray14[] =  "#EEEEEE";
 static char gray15[] =  "#FFFFFF";
 #endif /* !WANT_SDL */
 
+/*
+ * Frames are decoded into a framebuffer with the palette index of
+ * every pixel, 0-15 are the colors and 16-31 the grays. Depending on
+ * the format it holds 32x32 up to 128x128 pixels, which are scaled
+ * to the window in one go.
+ */
+#define FB_SIZE 128
+#define GRAYS 16
+static BYTE fb[FB_SIZE * FB_SIZE];
+#ifdef WANT_SDL
+static uint32_t pixels[32];
+#else
+static unsigned long pixels[32];
+#endif
+static uint32_t hires_tab[256][2];
+
 /* DAZZLER stuff */
 static bool state;
 static WORD dma_addr;
 static BYTE flags = 64;
 static BYTE format;
 
+/* frame flag timing */
+#define FRAME_US 33333	/* 30 frames per second */
+#define FLAG_US 4000	/* frame flag is low for 4ms */
+static void frame_done(void), frame_flag(void);
+static event_t frame_ev = { .ev_func = frame_done };
+static event_t flag_ev = { .ev_func = frame_flag };
+
 #if !defined(WANT_SDL) || defined(HAS_NETSERVER)
 /* UNIX stuff */
 static pthread_t thread;
@@ -167,9 +193,80 @@ static void ws_clear(void);
 static BYTE formatBuf = 0;
 #endif
 
+/*
+ * initialize the table for the hires expansion, a byte holds
+ * 4x2 pixels, for both lines the entry has a byte for every pixel,
+ * 0xff if it is lit
+ */
+static void init_tables(void)
+{
+	static const BYTE bits[2][4] = { { 1, 2, 16, 32 }, { 4, 8, 64, 128 } };
+	BYTE mask[4];
+	int i, j, k;
+
+	for (i = 0; i < 256; i++)
+		for (j = 0; j < 2; j++) {
+			for (k = 0; k < 4; k++)
+				mask[k] = (i & bits[j][k]) ? 0xff : 0;
+			memcpy(&hires_tab[i][j], mask, 4);
+		}
+}
+
+/*
+ * decode 512 bytes of DMA memory at addr into a quadrant of the
+ * framebuffer at x0, y0, 64x64 pixels in hires, 32x32 in lowres
+ */
+static void decode_quad(WORD addr, int x0, int y0)
+{
+	BYTE *p = &fb[y0 * FB_SIZE + x0];
+	BYTE pal = (format & 16) ? 0 : GRAYS;
+	uint32_t fg, v;
+	int x, y, i;
+
+	if (format & 64) {	/* hires, one color for all lit pixels */
+		fg = ((format & 0x0f) | pal) * 0x01010101U;
+		for (y = 0; y < 64; y += 2, p += 2 * FB_SIZE)
+			for (x = 0; x < 64; x += 4) {
+				i = dma_read(addr++);
+				v = hires_tab[i][0] & fg;
+				memcpy(p + x, &v, 4);
+				v = hires_tab[i][1] & fg;
+				memcpy(p + FB_SIZE + x, &v, 4);
+			}
+	} else {		/* lowres, a color for every pixel */
+		for (y = 0; y < 32; y++, p += FB_SIZE)
+			for (x = 0; x < 32; x += 2) {
+				i = dma_read(addr++);
+				p[x] = (i & 0x0f) | pal;
+				p[x + 1] = (i >> 4) | pal;
+			}
+	}
+}
+
+/*
+ * decode one frame into the framebuffer, returns the number of
+ * pixels per line
+ */
+static int decode_frame(void)
+{
+	int q = (format & 64) ? 64 : 32;	/* pixels of a quadrant */
+
+	decode_quad(dma_addr, 0, 0);
+	if (!(format & 32))	/* 512 bytes memory */
+		return q;
+	decode_quad(dma_addr + 512, q, 0);	/* 2048 bytes memory */
+	decode_quad(dma_addr + 1024, 0, q);
+	decode_quad(dma_addr + 1536, q, q);
+	return 2 * q;
+}
+
 /* create the SDL2 or X11 window for DAZZLER display */
 static void open_display(void)
 {
+	int i;
+
+	init_tables();
+
 #ifdef WANT_SDL
 	window = SDL_CreateWindow("Cromemco DAzzLER",
 				  SDL_WINDOWPOS_UNDEFINED,
@@ -177,6 +274,15 @@ static void open_display(void)
 				  size, size, 0);
 	renderer = SDL_CreateRenderer(window, -1, (SDL_RENDERER_ACCELERATED |
 						   SDL_RENDERER_PRESENTVSYNC));
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+				    SDL_TEXTUREACCESS_STREAMING,
+				    FB_SIZE, FB_SIZE);
+	for (i = 0; i < 16; i++) {
+		pixels[i] = 0xff000000 | (colors[i][0] << 16) |
+			    (colors[i][1] << 8) | colors[i][2];
+		pixels[GRAYS + i] = 0xff000000 | (grays[i][0] << 16) |
+				    (grays[i][1] << 8) | grays[i][2];
+	}
 #else /* !WANT_SDL */
 	Window rootwindow;
 	XSizeHints *size_hints = XAllocSizeHints();
@@ -204,8 +310,9 @@ static void open_display(void)
 	colormap = DefaultColormap(display, 0);
 	gc = XCreateGC(display, window, 0, NULL);
 	XSetFillStyle(display, gc, FillSolid);
-	pixmap = XCreatePixmap(display, rootwindow, size, size,
-			       wa.depth);
+	ximage = XCreateImage(display, DefaultVisual(display, screen),
+			      wa.depth, ZPixmap, 0, NULL, size, size, 32, 0);
+	ximage->data = malloc(ximage->bytes_per_line * size);
 
 	XParseColor(display, colormap, color0, &colors[0]);
 	XAllocColor(display, colormap, &colors[0]);
@@ -273,6 +380,11 @@ static void open_display(void)
 	XParseColor(display, colormap, gray15, &grays[15]);
 	XAllocColor(display, colormap, &grays[15]);
 
+	for (i = 0; i < 16; i++) {
+		pixels[i] = colors[i].pixel;
+		pixels[GRAYS + i] = grays[i].pixel;
+	}
+
 	XMapWindow(display, window);
 	XUnlockDisplay(display);
 #endif /* !WANT_SDL */
@@ -282,13 +394,16 @@ static void open_display(void)
 static void close_display(void)
 {
 #ifdef WANT_SDL
+	SDL_DestroyTexture(texture);
+	texture = NULL;
 	SDL_DestroyRenderer(renderer);
 	renderer = NULL;
 	SDL_DestroyWindow(window);
 	window = NULL;
 #else
 	XLockDisplay(display);
-	XFreePixmap(display, pixmap);
+	XDestroyImage(ximage);	/* frees the image data too */
+	ximage = NULL;
 	XFreeGC(display, gc);
 	XUnlockDisplay(display);
 	XCloseDisplay(display);
@@ -312,6 +427,9 @@ static void kill_thread(void)
 void cromemco_dazzler_off(void)
 {
 	state = false;
+	ev_cancel(&frame_ev);
+	ev_cancel(&flag_ev);
+	flags = 64;
 
 #ifdef WANT_SDL
 #ifdef HAS_NETSERVER
@@ -339,294 +457,52 @@ void cromemco_dazzler_off(void)
 }
 
 #ifdef WANT_SDL
-
 /* process SDL event */
 static void process_event(SDL_Event *event)
 {
 	UNUSED(event);
 }
+#endif
 
-static inline void set_fg_color(int i)
-{
-	SDL_SetRenderDrawColor(renderer,
-			       colors[i][0], colors[i][1], colors[i][2],
-			       SDL_ALPHA_OPAQUE);
-}
-
-static inline void set_fg_gray(int i)
-{
-	SDL_SetRenderDrawColor(renderer,
-			       grays[i][0], grays[i][1], grays[i][2],
-			       SDL_ALPHA_OPAQUE);
-}
-
-static inline void fill_rect(int x, int y, int w, int h)
-{
-	SDL_Rect r = {x, y, w, h};
-
-	SDL_RenderFillRect(renderer, &r);
-}
-
-#else /* !WANT_SDL */
-
-static inline void set_fg_color(int i)
-{
-	XSetForeground(display, gc, colors[i].pixel);
-}
-
-static inline void set_fg_gray(int i)
-{
-	XSetForeground(display, gc, grays[i].pixel);
-}
-
-static inline void fill_rect(int x, int y, int w, int h)
-{
-	XFillRectangle(display, pixmap, gc, x, y, w, h);
-}
-
-#endif /* !WANT_SDL */
-
-/* draw pixels for one frame in hires */
-static void draw_hires(void)
+/* draw one frame, scaled to the window */
+static void draw_frame(void)
 {
-	int psize, x, y, i;
-	WORD addr = dma_addr;
-
-	/* set color or grayscale from lower nibble in graphics format */
-	i = format & 0x0f;
-	if (format & 16)
-		set_fg_color(i);
-	else
-		set_fg_gray(i);
-	if (format & 32) {	/* 2048 bytes memory */
-		psize = size / 128;	/* size of one pixel for 128x128 */
-		for (y = 0; y < 64; y += 2) {
-			for (x = 0; x < 64;) {
-				i = dma_read(addr);
-				if (i & 1)
-					fill_rect(x * psize, y * psize, psize, psize);
-				if (i & 2)
-					fill_rect((x + 1) * psize, y * psize, psize, psize);
-				if (i & 4)
-					fill_rect(x * psize, (y + 1) * psize, psize, psize);
-				if (i & 8)
-					fill_rect((x + 1) * psize, (y + 1) * psize, psize, psize);
-				if (i & 16)
-					fill_rect((x + 2) * psize, y * psize, psize, psize);
-				if (i & 32)
-					fill_rect((x + 3) * psize, y * psize, psize, psize);
-				if (i & 64)
-					fill_rect((x + 2) * psize, (y + 1) * psize, psize, psize);
-				if (i & 128)
-					fill_rect((x + 3) * psize, (y + 1) * psize, psize, psize);
-				x += 4;
-				addr++;
-			}
-		}
-		for (y = 0; y < 64; y += 2) {
-			for (x = 64; x < 128;) {
-				i = dma_read(addr);
-				if (i & 1)
-					fill_rect(x * psize, y * psize, psize, psize);
-				if (i & 2)
-					fill_rect((x + 1) * psize, y * psize, psize, psize);
-				if (i & 4)
-					fill_rect(x * psize, (y + 1) * psize, psize, psize);
-				if (i & 8)
-					fill_rect((x + 1) * psize, (y + 1) * psize, psize, psize);
-				if (i & 16)
-					fill_rect((x + 2) * psize, y * psize, psize, psize);
-				if (i & 32)
-					fill_rect((x + 3) * psize, y * psize, psize, psize);
-				if (i & 64)
-					fill_rect((x + 2) * psize, (y + 1) * psize, psize, psize);
-				if (i & 128)
-					fill_rect((x + 3) * psize, (y + 1) * psize, psize, psize);
-				x += 4;
-				addr++;
-			}
-		}
-		for (y = 64; y < 128; y += 2) {
-			for (x = 0; x < 64;) {
-				i = dma_read(addr);
-				if (i & 1)
-					fill_rect(x * psize, y * psize, psize, psize);
-				if (i & 2)
-					fill_rect((x + 1) * psize, y * psize, psize, psize);
-				if (i & 4)
-					fill_rect(x * psize, (y + 1) * psize, psize, psize);
-				if (i & 8)
-					fill_rect((x + 1) * psize, (y + 1) * psize, psize, psize);
-				if (i & 16)
-					fill_rect((x + 2) * psize, y * psize, psize, psize);
-				if (i & 32)
-					fill_rect((x + 3) * psize, y * psize, psize, psize);
-				if (i & 64)
-					fill_rect((x + 2) * psize, (y + 1) * psize, psize, psize);
-				if (i & 128)
-					fill_rect((x + 3) * psize, (y + 1) * psize, psize, psize);
-				x += 4;
-				addr++;
-			}
-		}
-		for (y = 64; y < 128; y += 2) {
-			for (x = 64; x < 128;) {
-				i = dma_read(addr);
-				if (i & 1)
-					fill_rect(x * psize, y * psize, psize, psize);
-				if (i & 2)
-					fill_rect((x + 1) * psize, y * psize, psize, psize);
-				if (i & 4)
-					fill_rect(x * psize, (y + 1) * psize, psize, psize);
-				if (i & 8)
-					fill_rect((x + 1) * psize, (y + 1) * psize, psize, psize);
-				if (i & 16)
-					fill_rect((x + 2) * psize, y * psize, psize, psize);
-				if (i & 32)
-					fill_rect((x + 3) * psize, y * psize, psize, psize);
-				if (i & 64)
-					fill_rect((x + 2) * psize, (y + 1) * psize, psize, psize);
-				if (i & 128)
-					fill_rect((x + 3) * psize, (y + 1) * psize, psize, psize);
-				x += 4;
-				addr++;
-			}
-		}
-	} else {		/* 512 bytes memory */
-		psize = size / 64;	/* size of one pixel for 64x64 */
-		for (y = 0; y < 64; y += 2) {
-			for (x = 0; x < 64;) {
-				i = dma_read(addr);
-				if (i & 1)
-					fill_rect(x * psize, y * psize, psize, psize);
-				if (i & 2)
-					fill_rect((x + 1) * psize, y * psize, psize, psize);
-				if (i & 4)
-					fill_rect(x * psize, (y + 1) * psize, psize, psize);
-				if (i & 8)
-					fill_rect((x + 1) * psize, (y + 1) * psize, psize, psize);
-				if (i & 16)
-					fill_rect((x + 2) * psize, y * psize, psize, psize);
-				if (i & 32)
-					fill_rect((x + 3) * psize, y * psize, psize, psize);
-				if (i & 64)
-					fill_rect((x + 2) * psize, (y + 1) * psize, psize, psize);
-				if (i & 128)
-					fill_rect((x + 3) * psize, (y + 1) * psize, psize, psize);
-				x += 4;
-				addr++;
-			}
+	int res = decode_frame();
+#ifdef WANT_SDL
+	SDL_Rect r = {0, 0, res, res};
+	uint32_t *p;
+	void *tex;
+	int pitch, x, y;
+
+	if (SDL_LockTexture(texture, &r, &tex, &pitch) == 0) {
+		for (y = 0; y < res; y++) {
+			p = (uint32_t *) ((char *) tex + y * pitch);
+			for (x = 0; x < res; x++)
+				p[x] = pixels[fb[y * FB_SIZE + x]];
 		}
+		SDL_UnlockTexture(texture);
+		SDL_RenderCopy(renderer, texture, &r, NULL);
 	}
-}
-
-/* draw pixels for one frame in lowres */
-static void draw_lowres(void)
-{
-	int psize, x, y, i;
-	WORD addr = dma_addr;
-
-	/* get size of DMA memory and draw the pixels */
-	if (format & 32) {	/* 2048 bytes memory */
-		psize = size / 64;	/* size of one pixel for 64x64 */
-		for (y = 0; y < 32; y++) {
-			for (x = 0; x < 32;) {
-				i = dma_read(addr) & 0x0f;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				i = (dma_read(addr) & 0xf0) >> 4;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				addr++;
-			}
-		}
-		for (y = 0; y < 32; y++) {
-			for (x = 32; x < 64;) {
-				i = dma_read(addr) & 0x0f;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				i = (dma_read(addr) & 0xf0) >> 4;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				addr++;
-			}
-		}
-		for (y = 32; y < 64; y++) {
-			for (x = 0; x < 32;) {
-				i = dma_read(addr) & 0x0f;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				i = (dma_read(addr) & 0xf0) >> 4;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				addr++;
-			}
-		}
-		for (y = 32; y < 64; y++) {
-			for (x = 32; x < 64;) {
-				i = dma_read(addr) & 0x0f;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				i = (dma_read(addr) & 0xf0) >> 4;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				addr++;
-			}
-		}
-	} else {		/* 512 bytes memory */
-		psize = size / 32;	/* size of one pixel for 32x32 */
-		for (y = 0; y < 32; y++) {
-			for (x = 0; x < 32;) {
-				i = dma_read(addr) & 0x0f;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				i = (dma_read(addr) & 0xf0) >> 4;
-				if (format & 16)
-					set_fg_color(i);
-				else
-					set_fg_gray(i);
-				fill_rect(x * psize, y * psize, psize, psize);
-				x++;
-				addr++;
-			}
+#else /* !WANT_SDL */
+	int psize = size / res;
+	int bpl = ximage->bytes_per_line;
+	char *line;
+	int x, y, i;
+	unsigned long pixel;
+
+	/* scale the first line of a pixel row, copy it to the others */
+	for (y = 0; y < res; y++) {
+		line = ximage->data + y * psize * bpl;
+		for (x = 0; x < res; x++) {
+			pixel = pixels[fb[y * FB_SIZE + x]];
+			for (i = 0; i < psize; i++)
+				XPutPixel(ximage, x * psize + i, y * psize, pixel);
 		}
+		for (i = 1; i < psize; i++)
+			memcpy(line + i * bpl, line, bpl);
 	}
+	XPutImage(display, window, gc, ximage, 0, 0, 0, 0, size, size);
+#endif /* !WANT_SDL */
 }
 
 #ifdef HAS_NETSERVER
@@ -712,22 +588,11 @@ static void update_display(bool tick)
 {
 	UNUSED(tick);
 
-	/* draw one frame dependent on graphics format */
-	set_fg_color(0);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
 	SDL_RenderClear(renderer);
-	if (state) {		/* draw frame if on */
-		if (format & 64)
-			draw_hires();
-		else
-			draw_lowres();
-		SDL_RenderPresent(renderer);
-
-		/* frame done, set frame flag for 4ms */
-		flags = 0;
-		sleep_for_ms(4);
-		flags = 64;
-	} else
-		SDL_RenderPresent(renderer);
+	if (state)		/* draw frame if on */
+		draw_frame();
+	SDL_RenderPresent(renderer);
 }
 
 static win_funcs_t dazzler_funcs = {
@@ -758,14 +623,7 @@ static void *update_thread(void *arg)
 #endif
 #ifndef WANT_SDL
 				XLockDisplay(display);
-				set_fg_color(0);
-				fill_rect(0, 0, size, size);
-				if (format & 64)
-					draw_hires();
-				else
-					draw_lowres();
-				XCopyArea(display, pixmap, window, gc, 0, 0,
-					  size, size, 0, 0);
+				draw_frame();
 				XSync(display, True);
 				XUnlockDisplay(display);
 #endif
@@ -783,11 +641,6 @@ static void *update_thread(void *arg)
 #endif
 		}
 
-		/* frame done, set frame flag for 4ms */
-		flags = 0;
-		sleep_for_ms(4);
-		flags = 64;
-
 		/* sleep rest to 33333us so that we get 30 fps */
 		tleft = 33333L - (long) (get_clock_us() - t);
 		if (tleft > 0)
@@ -801,6 +654,25 @@ static void *update_thread(void *arg)
 }
 #endif /* !WANT_SDL || !HAS_NETSERVER */
 
+/*
+ *	Event for the end of a frame, the frame flag goes low
+ *	for 4ms, timed by the CPU clock
+ */
+static void frame_done(void)
+{
+	flags = 0;
+	ev_schedule(&flag_ev, ev_us(FLAG_US));
+	ev_repeat(&frame_ev, ev_us(FRAME_US));
+}
+
+/*
+ *	Event for the end of the frame flag
+ */
+static void frame_flag(void)
+{
+	flags = 64;
+}
+
 void cromemco_dazzler_ctl_out(BYTE data)
 {
 	/* get DMA address for display memory */
@@ -825,6 +697,8 @@ void cromemco_dazzler_ctl_out(BYTE data)
 		}
 #endif
 		state = true;
+		if (!ev_pending(&frame_ev))
+			ev_schedule(&frame_ev, ev_us(FRAME_US));
 #if defined(WANT_SDL) && defined(HAS_NETSERVER)
 		if (n_flag) {
 #endif
@@ -843,6 +717,9 @@ void cromemco_dazzler_ctl_out(BYTE data)
 	} else {
 		if (state) {
 			state = false;
+			ev_cancel(&frame_ev);
+			ev_cancel(&flag_ev);
+			flags = 64;
 			sleep_for_ms(50);
 #ifdef HAS_NETSERVER
 			if (!n_flag) {
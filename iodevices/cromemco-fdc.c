@@ -37,6 +37,8 @@
  * 29-JUL-2021 add boot config for machine without frontpanel
  * 02-SEP-2021 implement banked ROM
  * 15-MAY-2024 make disk manager standard
+ * 18-OCT-2026 write sectors behind
+ * 18-OCT-2026 keep disk images open and their geometry
  */
 
 #include <unistd.h>
@@ -53,6 +55,8 @@
 #include "simmem.h"
 
 #include "diskmanager.h"
+#include "diskwb.h"
+#include "diskimg.h"
 #include "cromemco-fdc.h"
 
 #include "log.h"
@@ -93,6 +97,7 @@ static int dcnt;		/* data counter read/write */
 static bool mflag;		/* multiple sectors flag */
 static char fn[MAX_LFN];	/* path/filename for disk image */
 static int fd;			/* fd for disk i/o */
+static dimg_t img[4];		/* open disk images */
 static BYTE buf[SEC_SZDD];	/* buffer for one sector */
        int index_pulse = 0;	/* disk index pulse */
 static bool autowait;		/* autowait flag */
@@ -382,6 +387,24 @@ void cromemco_fdc_diskctl_out(BYTE data)
 	}
 }
 
+/*
+ * open the disk image of the current disk, if it isn't open
+ * already, and get drive and disk geometry of a newly opened one
+ */
+static int open_disk(void)
+{
+	if (!dimg_valid(&img[disk])) {
+		dsk_path();
+		strcat(fn, "/");
+		strcat(fn, disks[disk].fn);
+		if (dimg_open(&img[disk], disk, fn) == -1)
+			return -1;
+		config_disk(img[disk].fd);
+	}
+	fd = img[disk].fd;
+	return 0;
+}
+
 /*
  *	read data from FDC
  */
@@ -403,24 +426,18 @@ BYTE cromemco_fdc_data_in(void)
 				return (BYTE) 0;
 			}
 			/* try to open disk image */
-			dsk_path();
-			strcat(fn, "/");
-			strcat(fn, disks[disk].fn);
-			if ((fd = open(fn, O_RDONLY)) == -1) {
+			if (open_disk() == -1) {
 				state = FDC_IDLE;	/* abort command */
 				fdc_flags |= 1;		/* set EOJ */
 				fdc_flags &= ~128;	/* reset DRQ */
 				fdc_stat = 0x80;	/* not ready */
 				return (BYTE) 0;
 			}
-			/* get drive and disk geometry */
-			config_disk(fd);
 			if (disks[disk].disk_t == UNKNOWN) {
 				state = FDC_IDLE;	/* abort command */
 				fdc_flags |= 1;		/* set EOJ */
 				fdc_flags &= ~128;	/* reset DRQ */
 				fdc_stat = 0x10;	/* sector not found */
-				close(fd);
 				return (BYTE) 0;
 			}
 			/* check track/sector */
@@ -435,29 +452,17 @@ BYTE cromemco_fdc_data_in(void)
 				fdc_flags |= 1;		/* set EOJ */
 				fdc_flags &= ~128;	/* reset DRQ */
 				fdc_stat = 0x10;	/* sector not found */
-				close(fd);
 				return (BYTE) 0;
 			}
-			/* seek to sector */
+			/* read the sector */
 			pos = get_pos();
-			if (lseek(fd, pos, SEEK_SET) == -1L) {
+			if (dwb_pread(fd, buf, secsz, pos) != secsz) {
 				state = FDC_IDLE;	/* abort command */
 				fdc_flags |= 1;		/* set EOJ */
 				fdc_flags &= ~128;	/* reset DRQ */
 				fdc_stat = 0x10;	/* sector not found */
-				close(fd);
 				return (BYTE) 0;
 			}
-			/* read the sector */
-			if (read(fd, buf, secsz) != secsz) {
-				state = FDC_IDLE;	/* abort command */
-				fdc_flags |= 1;		/* set EOJ */
-				fdc_flags &= ~128;	/* reset DRQ */
-				fdc_stat = 0x10;	/* sector not found */
-				close(fd);
-				return (BYTE) 0;
-			}
-			close(fd);
 		}
 		/* last byte? */
 		if (dcnt == secsz - 1) {
@@ -535,29 +540,21 @@ void cromemco_fdc_data_out(BYTE data)
 				return;
 			}
 			/* try to open disk image */
-			dsk_path();
-			strcat(fn, "/");
-			strcat(fn, disks[disk].fn);
-			if ((fd = open(fn, O_RDWR)) == -1) {
-				if ((fd = open(fn, O_RDONLY)) != -1) {
-					close(fd);
+			if (open_disk() == -1 || img[disk].rdonly) {
+				if (img[disk].open)
 					fdc_stat = 0x40; /* read only */
-				} else {
+				else
 					fdc_stat = 0x80; /* not ready */
-				}
 				state = FDC_IDLE;	/* abort command */
 				fdc_flags |= 1;		/* set EOJ */
 				fdc_flags &= ~128;	/* reset DRQ */
 				return;
 			}
-			/* get drive and disk geometry */
-			config_disk(fd);
 			if (disks[disk].disk_t == UNKNOWN) {
 				state = FDC_IDLE;	/* abort command */
 				fdc_flags |= 1;		/* set EOJ */
 				fdc_flags &= ~128;	/* reset DRQ */
 				fdc_stat = 0x10;	/* sector not found */
-				close(fd);
 				return;
 			}
 			/* check track/sector */
@@ -572,17 +569,6 @@ void cromemco_fdc_data_out(BYTE data)
 				fdc_flags |= 1;		/* set EOJ */
 				fdc_flags &= ~128;	/* reset DRQ */
 				fdc_stat = 0x10;	/* sector not found */
-				close(fd);
-				return;
-			}
-			/* seek to sector */
-			pos = get_pos();
-			if (lseek(fd, pos, SEEK_SET) == -1L) {
-				state = FDC_IDLE;	/* abort command */
-				fdc_flags |= 1;		/* set EOJ */
-				fdc_flags &= ~128;	/* reset DRQ */
-				fdc_stat = 0x10;	/* sector not found */
-				close(fd);
 				return;
 			}
 		}
@@ -593,17 +579,20 @@ void cromemco_fdc_data_out(BYTE data)
 			state = FDC_IDLE;		/* done */
 			fdc_flags |= 1;			/* set EOJ */
 			fdc_flags &= ~128;		/* reset DRQ */
-			if (write(fd, buf, secsz) == secsz)
+			if (dwb_pwrite(fd, buf, secsz, get_pos()) == secsz)
 				fdc_stat = 0;
 			else
 				fdc_stat = 0x20;	/* write fault */
-			close(fd);
 		}
 		break;
 
 	case FDC_WRTTRK:		/* write (format) track */
 		if (dcnt == 0) {
 			motortimer = 800;
+			/* queued sectors must be written before */
+			dwb_sync();
+			/* the image is written without the open one */
+			dimg_close(&img[disk]);
 			/* unlink disk image */
 			dsk_path();
 			strcat(fn, "/");
@@ -1024,6 +1013,7 @@ void cromemco_fdc_cmd_out(BYTE data)
 
 void cromemco_fdc_reset(void)
 {
+	dwb_sync();
 	state = dcnt = index_pulse = disk = side = motortimer = 0;
 	mflag = motoron = autowait = headloaded = false;
 	fdc_stat = fdc_aux = 0;
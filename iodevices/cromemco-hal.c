@@ -7,6 +7,8 @@
 *
 * History:
 * 9-JUL-2022	1.0	Initial Release
+* 18-OCT-2026	1.1	STDIO input is received by the reactor thread
+* 18-OCT-2026	1.2	STDIO output is sent by the reactor thread
 *
 */
 
@@ -26,6 +28,7 @@
 
 #include "unix_terminal.h"
 #include "unix_network.h"
+#include "unix_reactor.h"
 #ifdef HAS_NETSERVER
 #include "netsrv.h"
 #endif
@@ -128,44 +131,36 @@ static bool stdio_alive(int dev)
 
 static void stdio_status(int dev, BYTE *stat)
 {
-	struct pollfd p[1];
+	int ch;
 
 	UNUSED(dev);
 
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
 	*stat &= (BYTE) (~3);
-	if (p[0].revents & POLLIN)
-		*stat |= 2;
-	if (p[0].revents & POLLNVAL) {
+	if ((ch = rx_stdin()) == -1) {
 		LOGE(TAG, "can't use terminal, try 'screen simulation ...'");
 		exit(EXIT_FAILURE);
 		// cpu_error = IOERROR;
 		// cpu_state = STOPPED;
-	}
-	*stat |= 1;
+	} else if (rx_ready(ch))
+		*stat |= 2;
+	if ((ch = tx_stdout()) == -1 || tx_ready(ch))
+		*stat |= 1;
 }
 
 static int stdio_in(int dev)
 {
-	int data;
-	struct pollfd p[1];
+	int ch, data;
 
 	UNUSED(dev);
 
 again:
 	/* if no input waiting return last */
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (!(p[0].revents & POLLIN))
+	if ((ch = rx_stdin()) == -1 || (data = rx_get(ch)) == RX_NONE)
 		return -1;
 
-	if (read(fileno(stdin), &data, 1) == 0) {
+	if (data == RX_EOF) {
 		/* try to reopen tty, input redirection exhausted */
+		rx_close(ch);
 		if (freopen("/dev/tty", "r", stdin) == NULL)
 			LOGE(TAG, "can't reopen /dev/tty");
 		set_unix_terminal();
@@ -177,17 +172,14 @@ again:
 
 static void stdio_out(int dev, BYTE data)
 {
+	int ch;
+
 	UNUSED(dev);
 
-again:
-	if (write(fileno(stdout), (char *) &data, 1) != 1) {
-		if (errno == EINTR)
-			goto again;
-		else {
-			LOGE(TAG, "can't write data");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if ((ch = tx_stdout()) == -1 || !tx_put(ch, data)) {
+		LOGE(TAG, "can't write data");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 }
 
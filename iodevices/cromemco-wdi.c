@@ -7,6 +7,8 @@
  *
  * History:
  * 23-JUL-2022	1.0	Initial Release
+ * 18-OCT-2026	1.1	Write sectors behind
+ * 18-OCT-2026	1.2	Don't queue writes to images opened read-only
  *
  */
 
@@ -29,6 +31,7 @@
 #include "netsrv.h"
 #endif
 #include "cromemco-wdi.h"
+#include "diskwb.h"
 
 #define LOG_LOCAL_LEVEL LOG_ERROR
 #include "log.h"
@@ -177,6 +180,7 @@ static struct {
 		BYTE sector;
 
 		int fd;
+		BYTE rdonly;	/* image opened read-only */
 		BYTE online;
 		BYTE _crc_error;
 		BYTE _fault;
@@ -212,6 +216,8 @@ void wdi_exit(void)
 {
 	int unit;
 
+	dwb_sync();
+
 	for (unit = 0; unit < WDI_UNITS; unit++) {
 		if (wdi.hd[unit].fd) {
 			fsync(wdi.hd[unit].fd);
@@ -267,6 +273,7 @@ void wdi_init(void)
 		wdi.hd[unit].status.rezeroing = 0;
 		wdi.hd[unit].status.write_prot = 0;
 		wdi.hd[unit].status.illegal_address = 0;
+		wdi.hd[unit].rdonly = 0;
 
 		wdi.hd[unit].fn = images[unit];
 
@@ -283,9 +290,10 @@ again:
 					     fn, errno);
 				got_eintr++;
 				goto again;
-			} else if ((fd = open(fn, O_RDONLY)) != -1)
+			} else if ((fd = open(fn, O_RDONLY)) != -1) {
 				wdi.hd[unit].status.write_prot = 1;
-			else {
+				wdi.hd[unit].rdonly = 1;
+			} else {
 				LOGW(TAG, "INIT: HDD FILE DOES NOT EXIST - %s : %s [%d]",
 				     fn, strerror(errno), errno);
 				wdi.hd[unit]._fault = 0; /* SET FAULT */
@@ -413,13 +421,9 @@ static Tstates_t wdi_dma_write(BYTE bus_ack)
 
 	off_t pos = wdi_pos(&buffer[1]);
 
-	if (lseek(wdi.hd[wdi.unit].fd, pos, SEEK_SET) == -1L) {
-		wdi.hd[wdi.unit]._fault = 0; /* write fault */
-		return 0;
-	}
-
 	/* write the sector */
-	if (write(wdi.hd[wdi.unit].fd, &buffer[5], WDI_BLOCK_SIZE) == WDI_BLOCK_SIZE)
+	if (!wdi.hd[wdi.unit].rdonly &&
+	    dwb_pwrite(wdi.hd[wdi.unit].fd, &buffer[5], WDI_BLOCK_SIZE, pos) == WDI_BLOCK_SIZE)
 		wdi.hd[wdi.unit]._fault = 1;
 	else
 		wdi.hd[wdi.unit]._fault = 0; /* write fault */
@@ -464,13 +468,8 @@ static Tstates_t wdi_dma_read(BYTE bus_ack)
 
 	off_t pos = wdi_pos(buffer);
 
-	if (lseek(wdi.hd[wdi.unit].fd, pos, SEEK_SET) == -1L) {
-		wdi.hd[wdi.unit]._fault = 0; /* read fault */
-		return 0;
-	}
-
 	/* read the sector */
-	if (read(wdi.hd[wdi.unit].fd, &buffer[4], WDI_BLOCK_SIZE) == WDI_BLOCK_SIZE)
+	if (dwb_pread(wdi.hd[wdi.unit].fd, &buffer[4], WDI_BLOCK_SIZE, pos) == WDI_BLOCK_SIZE)
 		wdi.hd[wdi.unit]._fault = 1;
 	else {
 		wdi.hd[wdi.unit]._fault = 0; /* read fault */
@@ -0,0 +1,103 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by agent
+ *
+ * Open disk images of the disk controllers
+ *
+ * History:
+ * 18-OCT-2026 first version
+ * 18-OCT-2026 write queued sectors before closing an image
+ */
+
+/*
+ *	The disk controllers keep the images of their drives open
+ *	with a dimg_t, instead of opening and closing them for every
+ *	sector. An image is opened read/write if possible, otherwise
+ *	read-only, and its size is kept, so that the controllers only
+ *	have to find the geometry of a disk after dimg_open().
+ *
+ *	The disk manager calls dimg_invalidate() when a disk is inserted
+ *	into or ejected from a drive, possibly from the thread of the
+ *	web server. This only advances the generation of the drive, the
+ *	controller notices it with dimg_valid() and opens the image
+ *	again in the CPU thread. Controllers must close the image with
+ *	dimg_close() before writing to it in any other way, e.g. when
+ *	formatting. Sectors queued by the write behind are written
+ *	through the fd of the image, so it is synced before closing.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "sim.h"
+#include "simdefs.h"
+
+#include "diskimg.h"
+#include "diskwb.h"
+
+unsigned dimg_gen[DIMG_MAX];	/* generations of the drives */
+
+/*
+ *	Open image file fn inserted in drive, returns -1 if it
+ *	can't be opened, otherwise 0
+ */
+int dimg_open(dimg_t *d, int drive, const char *fn)
+{
+	struct stat s;
+
+	dimg_close(d);
+
+	d->drive = drive;
+	d->gen = __atomic_load_n(&dimg_gen[drive], __ATOMIC_ACQUIRE);
+	d->rdonly = false;
+	if ((d->fd = open(fn, O_RDWR)) == -1) {
+		if ((d->fd = open(fn, O_RDONLY)) == -1)
+			return -1;
+		d->rdonly = true;
+	}
+	if (fstat(d->fd, &s) == -1) {
+		close(d->fd);
+		return -1;
+	}
+	d->size = s.st_size;
+	d->open = true;
+
+	return 0;
+}
+
+/*
+ *	Close the image, if it is open
+ */
+void dimg_close(dimg_t *d)
+{
+	if (d->open) {
+		dwb_sync();
+		close(d->fd);
+		d->open = false;
+	}
+}
+
+/*
+ *	Disk in drive was changed, the controller has to open it again
+ */
+void dimg_invalidate(int drive)
+{
+	if (drive >= 0 && drive < DIMG_MAX)
+		__atomic_add_fetch(&dimg_gen[drive], 1, __ATOMIC_RELEASE);
+}
+
+/*
+ *	Disks in all drives might have been changed
+ */
+void dimg_invalidate_all(void)
+{
+	register int i;
+
+	for (i = 0; i < DIMG_MAX; i++)
+		dimg_invalidate(i);
+}
@@ -0,0 +1,50 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by agent
+ *
+ * Open disk images of the disk controllers
+ *
+ * History:
+ * 18-OCT-2026 first version
+ */
+
+#ifndef DISKIMG_INC
+#define DISKIMG_INC
+
+#include <sys/types.h>
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define DIMG_MAX	16	/* max. number of drives */
+
+typedef struct dimg {		/* structure of an open disk image */
+	bool open;		/* image is open */
+	int fd;			/* fd of the image */
+	bool rdonly;		/* image can only be read */
+	off_t size;		/* size of the image */
+	int drive;		/* drive the image is inserted in */
+	unsigned gen;		/* generation of the drive when opened */
+} dimg_t;
+
+extern unsigned dimg_gen[DIMG_MAX];
+
+extern int dimg_open(dimg_t *d, int drive, const char *fn);
+extern void dimg_close(dimg_t *d);
+extern void dimg_invalidate(int drive);
+extern void dimg_invalidate_all(void);
+
+/*
+ *	Check if the image is still open and the drive wasn't
+ *	changed since, otherwise dimg_open() must be called
+ */
+static inline bool dimg_valid(dimg_t *d)
+{
+	return d->open && d->gen == __atomic_load_n(&dimg_gen[d->drive],
+						     __ATOMIC_ACQUIRE);
+}
+
+#endif /* !DISKIMG_INC */
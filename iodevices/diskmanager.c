@@ -5,6 +5,7 @@
  *
  * History:
  * 12-JUL-2018	1.0	Initial Release
+ * 18-OCT-2026	1.1	Tell the controllers about changed disks
  */
 
 /**
@@ -55,6 +56,7 @@
 #include "netsrv.h"
 #endif
 #include "diskmanager.h"
+#include "diskimg.h"
 
 #define LOCAL_LOG_LEVEL LOG_DEBUG
 #include "log.h"
@@ -103,6 +105,7 @@ static disk_err_t insertDisk(int disk, const char *image)
 					} else {
 						/* Everything is OK, we can insert the disk */
 						DISKNAME(disk) = name;
+						dimg_invalidate(disk);
 						return SUCCESS;
 					}
 				} else
@@ -155,6 +158,7 @@ void readDiskmap(char *path_name)
 
 	for (i = 0; i < _MAX_DISK; i++)
 		DISKNAME(i) = NULL;
+	dimg_invalidate_all();
 
 	strncpy(path, path_name, MAX_LFN);
 	strncat(path, "/", MAX_LFN - strlen(path));
@@ -259,6 +263,7 @@ static disk_err_t ejectDisk(int disk)
 		name = DISKNAME(disk);
 		DISKNAME(disk) = NULL;
 		free(name);
+		dimg_invalidate(disk);
 
 		return SUCCESS;
 	}
@@ -289,6 +294,7 @@ int LibraryHandler(HttpdConnection_t *conn, void *unused)
 		break;
 	case HTTP_PUT:
 		UploadHandler(conn, path);
+		dimg_invalidate_all();
 		LOGI(TAG, "PUT image: image uploaded.");
 		break;
 	case HTTP_DELETE:
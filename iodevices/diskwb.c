@@ -0,0 +1,215 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by agent
+ *
+ * Write behind for the disk images of the disk controllers
+ *
+ * History:
+ * 18-OCT-2026 first version
+ * 18-OCT-2026 pre-allocated ring, write through the open images
+ */
+
+/*
+ *	The disk controllers write sectors with dwb_pwrite(), which
+ *	copies the data into a free entry of a ring and returns at
+ *	once. A background thread writes the entries to the images in
+ *	the order they were made, so the CPU thread doesn't wait for
+ *	the host disk. Sectors are read with dwb_pread(), which
+ *	overlays the entries still in the ring for the image on the
+ *	data read from it.
+ *
+ *	The entries are written through the fd the controller passed,
+ *	the image must stay open until dwb_sync() was called, the
+ *	images opened with dimg_open() are synced when closed. The
+ *	controllers only pass images opened for writing and positions
+ *	inside of the image. Writes larger than an entry are done
+ *	right away, after the ring is drained. Controllers must call
+ *	dwb_sync() before writing to an image in any other way, e.g.
+ *	when formatting, on reset, and the machines call dwb_exit() on
+ *	exit. dwb_pread() and dwb_pwrite() must be called from the CPU
+ *	thread only.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "sim.h"
+#include "simdefs.h"
+
+#include "diskwb.h"
+
+#include "log.h"
+static const char *TAG = "DWB";
+
+#define DWB_NREQ	1024	/* number of entries in the ring */
+#define DWB_SECSZ	512	/* max. number of bytes of an entry */
+
+typedef struct dwb_req {	/* structure of a queued write */
+	int fd;			/* fd of the image */
+	off_t pos;		/* position in the image */
+	size_t count;		/* number of bytes */
+	BYTE data[DWB_SECSZ];	/* the data */
+} dwb_req_t;
+
+static dwb_req_t ring[DWB_NREQ];	/* ring of the write requests */
+static unsigned rd;			/* next entry written, write thread */
+static unsigned wr;			/* next free entry, CPU thread */
+static bool running;			/* write thread is running */
+static bool stopping;			/* write thread should stop */
+static pthread_t thread;		/* the write thread */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+
+/*
+ *	Thread writing the queued requests in order, an entry is
+ *	only released after it is written, so that reads can overlay
+ *	it in the meantime
+ */
+static void *dwb_thread(void *arg)
+{
+	dwb_req_t *r;
+	unsigned i;
+
+	UNUSED(arg);
+
+	pthread_mutex_lock(&mutex);
+	while (true) {
+		while (rd == __atomic_load_n(&wr, __ATOMIC_ACQUIRE)
+		       && !stopping)
+			pthread_cond_wait(&work, &mutex);
+		i = rd;
+		if (i == __atomic_load_n(&wr, __ATOMIC_ACQUIRE))
+			break;
+		pthread_mutex_unlock(&mutex);
+
+		r = &ring[i % DWB_NREQ];
+		if (pwrite(r->fd, r->data, r->count, r->pos)
+		    != (ssize_t) r->count)
+			LOGE(TAG, "can't write %zu bytes at %lld to disk image",
+			     r->count, (long long) r->pos);
+
+		pthread_mutex_lock(&mutex);
+		__atomic_store_n(&rd, i + 1, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&done);
+	}
+	pthread_mutex_unlock(&mutex);
+
+	return NULL;
+}
+
+/*
+ *	Read count bytes at pos from the image open on fd,
+ *	returns the number of bytes read like pread()
+ */
+ssize_t dwb_pread(int fd, void *buf, size_t count, off_t pos)
+{
+	ssize_t n;
+	dwb_req_t *r;
+	unsigned i, w;
+	off_t start, end;
+
+	/* entries before i were written before reading the image,
+	   the entries from i on can't be reused while overlaying,
+	   because only this thread queues new ones */
+	i = __atomic_load_n(&rd, __ATOMIC_ACQUIRE);
+	w = wr;
+	n = pread(fd, buf, count, pos);
+	for (; n > 0 && i != w; i++) {
+		r = &ring[i % DWB_NREQ];
+		if (r->fd != fd)
+			continue;
+		start = (r->pos > pos) ? r->pos : pos;
+		end = r->pos + (off_t) r->count;
+		if (end > pos + n)
+			end = pos + n;
+		if (start < end)
+			memcpy((BYTE *) buf + (start - pos),
+			       r->data + (start - r->pos),
+			       (size_t) (end - start));
+	}
+
+	return n;
+}
+
+/*
+ *	Queue count bytes to be written at pos to the image open on
+ *	fd, returns count like pwrite(), or the result of pwrite() if
+ *	the bytes were written right away
+ */
+ssize_t dwb_pwrite(int fd, const void *buf, size_t count, off_t pos)
+{
+	dwb_req_t *r;
+
+	if (count > DWB_SECSZ)
+		goto sync;
+
+	if (!running) {
+		if (pthread_create(&thread, NULL, dwb_thread, NULL)) {
+			LOGW(TAG, "can't create write thread");
+			goto sync;
+		}
+		running = true;
+	}
+
+	/* wait for a free entry, if the ring is full */
+	if (wr - __atomic_load_n(&rd, __ATOMIC_ACQUIRE) == DWB_NREQ) {
+		pthread_mutex_lock(&mutex);
+		while (wr - rd == DWB_NREQ)
+			pthread_cond_wait(&done, &mutex);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	r = &ring[wr % DWB_NREQ];
+	r->fd = fd;
+	r->pos = pos;
+	r->count = count;
+	memcpy(r->data, buf, count);
+
+	pthread_mutex_lock(&mutex);
+	__atomic_store_n(&wr, wr + 1, __ATOMIC_RELEASE);
+	pthread_cond_signal(&work);
+	pthread_mutex_unlock(&mutex);
+
+	return (ssize_t) count;
+
+sync:
+	dwb_sync();
+	return pwrite(fd, buf, count, pos);
+}
+
+/*
+ *	Wait until all queued requests are written
+ */
+void dwb_sync(void)
+{
+	if (__atomic_load_n(&rd, __ATOMIC_ACQUIRE) == wr)
+		return;
+
+	pthread_mutex_lock(&mutex);
+	while (rd != wr)
+		pthread_cond_wait(&done, &mutex);
+	pthread_mutex_unlock(&mutex);
+}
+
+/*
+ *	Write all queued requests and stop the write thread
+ */
+void dwb_exit(void)
+{
+	if (!running)
+		return;
+
+	pthread_mutex_lock(&mutex);
+	stopping = true;
+	pthread_cond_signal(&work);
+	pthread_mutex_unlock(&mutex);
+
+	pthread_join(thread, NULL);
+	running = stopping = false;
+}
@@ -0,0 +1,27 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by agent
+ *
+ * Write behind for the disk images of the disk controllers
+ *
+ * History:
+ * 18-OCT-2026 first version
+ */
+
+#ifndef DISKWB_INC
+#define DISKWB_INC
+
+#include <sys/types.h>
+
+#include "sim.h"
+#include "simdefs.h"
+
+extern ssize_t dwb_pread(int fd, void *buf, size_t count, off_t pos);
+extern ssize_t dwb_pwrite(int fd, const void *buf, size_t count, off_t pos);
+extern void dwb_sync(void);
+extern void dwb_exit(void);
+
+#endif /* !DISKWB_INC */
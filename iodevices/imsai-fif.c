@@ -29,6 +29,7 @@
  * 18-NOV-2019 initialize command string address array
  * 14-May-2024 remove large disk from disks[] for disk manager, show it as HDD
  * 15-MAY-2024 make disk manager standard
+ * 18-OCT-2026 keep disk images open
  */
 
 #include <unistd.h>
@@ -44,6 +45,7 @@
 #include "simmem.h"
 
 #include "diskmanager.h"
+#include "diskimg.h"
 #ifdef HAS_NETSERVER
 #include "netsrv.h"
 #endif
@@ -82,6 +84,7 @@ static const char *TAG = "FIF";
 
 char *disks[4];
 static const char *hddisk = "drivei.dsk";
+static dimg_t img[9];		/* open disk images, 8 = harddisk */
 
 static int fdaddr[16];		/* address of disk descriptors */
 static char fn[MAX_LFN];	/* path/filename for disk image */
@@ -235,7 +238,6 @@ static void disk_io(int addr)
 	static int spt;			/* sectors per track */
 	static int maxtrk;		/* max tracks of disk */
 	static int disk;		/* internal disk no */
-	static struct stat s;
 	static char blksec[SEC_SZ];
 
 	LOGD(TAG, "disk descriptor at %04x", addr);
@@ -312,63 +314,56 @@ static void disk_io(int addr)
 
 	/* handle case when disk is ejected */
 	if ((disk <= 3) && (disks[disk] == NULL)) {
+		dimg_close(&img[disk]);
 		dma_write(addr + DD_RESULT, 0xa1);
 		return;
 	}
 
-	/* try to open disk image */
-	dsk_path();
-	strcat(fn, "/");
-	strcat(fn, (disk <= 3) ? disks[disk] : hddisk);
 	if (cmd == FMT_TRACK) {
 		/* can only format floppy disks */
-		if (disk <= 3) {
-			if (track == 0)
-				unlink(fn);
-			fd = open(fn, O_RDWR | O_CREAT, 0644);
-		} else {
+		if (disk > 3) {
 			dma_write(addr + DD_RESULT, 0xa1);
 			return;
 		}
+		/* the image is written without the open one */
+		dimg_close(&img[disk]);
+		dsk_path();
+		strcat(fn, "/");
+		strcat(fn, disks[disk]);
+		if (track == 0)
+			unlink(fn);
+		fd = open(fn, O_RDWR | O_CREAT, 0644);
 		if (fd == -1) {
 			dma_write(addr + DD_RESULT, 0xa1);
 			return;
 		}
 		goto do_format;
-	} else if ((cmd == READ_SEC) || (cmd == VERIFY_DATA)) {
-		fd = open(fn, O_RDONLY);
-		if (fd == -1) {
-			dma_write(addr + DD_RESULT, 0xa1);
-			return;
-		}
-	} else if (cmd == WRITE_SEC) {
-		fd = open(fn, O_RDWR);
-		/* if the disk can't be opened R/W */
-		if (fd == -1) {
-			/* see if it opens R/O */
-			fd = open(fn, O_RDONLY);
-			/* if that works it is write protected */
-			if (fd != -1) {
-				close(fd);
-				dma_write(addr + DD_RESULT, 0xa2);
-			} else {
-				/* else no disk */
-				dma_write(addr + DD_RESULT, 0xa1);
-			}
-			return;
-		}
 	}
 
-	/* check for correct disk size if not formatting a new disk */
-	if (fd != -1) {
-		fstat(fd, &s);
-		if (((disk <= 3) && (s.st_size != 256256)) ||
-		    ((disk == 8) && (s.st_size != 4177920))) {
+	/* try to open disk image, if not open already */
+	if (!dimg_valid(&img[disk])) {
+		dsk_path();
+		strcat(fn, "/");
+		strcat(fn, (disk <= 3) ? disks[disk] : hddisk);
+		if (dimg_open(&img[disk], disk, fn) == -1) {
 			dma_write(addr + DD_RESULT, 0xa1);
-			close(fd);
 			return;
 		}
 	}
+	fd = img[disk].fd;
+
+	/* if the disk was opened R/O it is write protected */
+	if ((cmd == WRITE_SEC) && img[disk].rdonly) {
+		dma_write(addr + DD_RESULT, 0xa2);
+		return;
+	}
+
+	/* check for correct disk size */
+	if (((disk <= 3) && (img[disk].size != 256256)) ||
+	    ((disk == 8) && (img[disk].size != 4177920))) {
+		dma_write(addr + DD_RESULT, 0xa1);
+		return;
+	}
 
 do_format:
 
@@ -384,13 +379,9 @@ do_format:
 			goto done;
 		}
 		pos = (track * spt + sector - 1) * SEC_SZ;
-		if (lseek(fd, pos, SEEK_SET) == -1L) {
-			dma_write(addr + DD_RESULT, 0x92);
-			goto done;
-		}
 		for (i = 0; i < SEC_SZ; i++)
 			blksec[i] = dma_read(dma_addr + i);
-		if (write(fd, blksec, SEC_SZ) != SEC_SZ) {
+		if (pwrite(fd, blksec, SEC_SZ, pos) != SEC_SZ) {
 			dma_write(addr + DD_RESULT, 0x93);
 			goto done;
 		}
@@ -407,11 +398,7 @@ do_format:
 			goto done;
 		}
 		pos = (track * spt + sector - 1) * SEC_SZ;
-		if (lseek(fd, pos, SEEK_SET) == -1L) {
-			dma_write(addr + DD_RESULT, 0x92);
-			goto done;
-		}
-		if (read(fd, blksec, SEC_SZ) != SEC_SZ) {
+		if (pread(fd, blksec, SEC_SZ, pos) != SEC_SZ) {
 			dma_write(addr + DD_RESULT, 0x93);
 			goto done;
 		}
@@ -450,7 +437,8 @@ do_format:
 	}
 
 done:
-	close(fd);
+	if (cmd == FMT_TRACK)
+		close(fd);
 }
 
 /*
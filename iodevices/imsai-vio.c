@@ -21,6 +21,7 @@
  * 14-JUL-2018 integrate webfrontend
  * 05-NOV-2019 use correct memory access function
  * 04-JAN-2025 add SDL2 support
+ * 18-OCT-2026 only render the cells written since the last refresh
  */
 
 #include <stdlib.h>
@@ -109,6 +110,8 @@ static int kbd_data;			/* keyboard data */
 static pthread_t thread;
 #endif
 
+static void blank(void);
+
 /* create the SDL2 or X11 window for VIO display */
 static void open_display(void)
 {
@@ -124,6 +127,12 @@ static void open_display(void)
 						   SDL_RENDERER_PRESENTVSYNC));
 	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
 				    SDL_TEXTUREACCESS_STREAMING, xsize, ysize);
+	/* the cells are rendered into this copy of the texture,
+	   a locked texture doesn't keep the old contents */
+	pitch = xsize * 4;
+	pixels = malloc(ysize * pitch);
+	blank();		/* opaque black border and scanlines */
+	modebuf = -1;		/* render all cells */
 
 	keybuf_mutex = SDL_CreateMutex();
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
@@ -179,6 +188,7 @@ static void close_display(void)
 {
 #ifdef WANT_SDL
 	SDL_DestroyMutex(keybuf_mutex);
+	free(pixels);
 	SDL_DestroyTexture(texture);
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
@@ -478,15 +488,51 @@ static inline void event_handler(void)
 
 #endif /* !WANT_SDL */
 
-/* refresh the display buffer dependent on video mode */
-static void refresh(void)
+/* mark all cells of the video RAM as written */
+static void mark_all(void)
 {
-	static int cols, rows;
-	static BYTE c;
-	register int x, y;
+	register int i;
+
+	for (i = 0; i < VIO_SIZE / 64; i++)
+		__atomic_store_n(&vio_dirty[i], ~(uint64_t) 0, __ATOMIC_RELAXED);
+}
+
+/* get and clear the written cells in 64 cells at index i */
+static inline uint64_t get_dirty(int i)
+{
+	if (__atomic_load_n(&vio_dirty[i >> 6], __ATOMIC_RELAXED) == 0)
+		return 0;
+	return __atomic_exchange_n(&vio_dirty[i >> 6], 0, __ATOMIC_ACQUIRE);
+}
+
+/* blank the display buffer */
+static void blank(void)
+{
+#ifdef WANT_SDL
+	register int i;
+
+	for (i = 0; i < ysize * pitch; i += 4) {
+		pixels[i + 3] = pixels[i + 2] = pixels[i + 1] = 0;
+		pixels[i] = SDL_ALPHA_OPAQUE;
+	}
+#else
+	XSetForeground(display, gc, black.pixel);
+	XFillRectangle(display, pixmap, gc, 0, 0, xsize, ysize);
+#endif
+}
 
-	sx = XOFF;
-	sy = YOFF;
+/*
+ * refresh the cells of the display buffer, which were written since
+ * the last refresh, dependent on video mode
+ * returns true if the display buffer was changed
+ */
+static bool refresh(void)
+{
+	static int cols, rows;
+	register int i, w;
+	register uint64_t bits;
+	bool changed = false;
+	BYTE c;
 
 	mode = getmem(0xf7ff);
 	if (mode != modebuf) {
@@ -511,67 +557,46 @@ static void refresh(void)
 			rows = 24;
 			yscale = 1;
 		}
+
+		/* Video mode 0: video off, screen blanked */
+		if (vmode == 0)
+			blank();
+		mark_all();
+		changed = true;
 	}
 
-	switch (vmode) {
-	case 0:	/* Video mode 0: video off, screen blanked */
+	for (w = 0; w < VIO_SIZE; w += 64) {
 #if !defined(WANT_SDL) || defined(HAS_NETSERVER)
 		event_handler();
 #endif
-#ifdef WANT_SDL
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-		SDL_RenderClear(renderer);
-#else
-		XSetForeground(display, gc, black.pixel);
-		XFillRectangle(display, pixmap, gc, 0, 0, xsize, ysize);
-#endif
-		break;
+		if (vmode == 0 || (bits = get_dirty(w)) == 0)
+			continue;
 
-	case 1: /* Video mode 1: display character codes 80-FF */
-		for (y = 0; y < rows; y++) {
-			sx = XOFF;
-#if !defined(WANT_SDL) || defined(HAS_NETSERVER)
-			event_handler();
-#endif
-			for (x = 0; x < cols; x++) {
-				c = getmem(0xf000 + (y * cols) + x);
-				dc1(c);
-				sx += (res & 1) ? 14 : 7;
-			}
-			sy += (res & 2) ? 20 * slf : 10 * slf;
-		}
-		break;
+		do {
+			i = w + __builtin_ctzll(bits);
+			bits &= bits - 1;
+			if (i >= rows * cols)
+				break;
 
-	case 2:	/* Video mode 2: display character codes 00-7F */
-		for (y = 0; y < rows; y++) {
-			sx = XOFF;
-#if !defined(WANT_SDL) || defined(HAS_NETSERVER)
-			event_handler();
-#endif
-			for (x = 0; x < cols; x++) {
-				c = getmem(0xf000 + (y * cols) + x);
+			sx = XOFF + (i % cols) * ((res & 1) ? 14 : 7);
+			sy = YOFF + (i / cols) * ((res & 2) ? 20 * slf : 10 * slf);
+			c = getmem(VIO_RAM + i);
+			switch (vmode) {
+			case 1:	/* Video mode 1: display character codes 80-FF */
+				dc1(c);
+				break;
+			case 2:	/* Video mode 2: display character codes 00-7F */
 				dc2(c);
-				sx += (res & 1) ? 14 : 7;
-			}
-			sy += (res & 2) ? 20 * slf : 10 * slf;
-		}
-		break;
-
-	case 3:	/* Video mode 3: display character codes 00-FF */
-		for (y = 0; y < rows; y++) {
-			sx = XOFF;
-#if !defined(WANT_SDL) || defined(HAS_NETSERVER)
-			event_handler();
-#endif
-			for (x = 0; x < cols; x++) {
-				c = getmem(0xf000 + (y * cols) + x);
+				break;
+			case 3:	/* Video mode 3: display character codes 00-FF */
 				dc3(c);
-				sx += (res & 1) ? 14 : 7;
+				break;
 			}
-			sy += (res & 2) ? 20 * slf : 10 * slf;
-		}
-		break;
+			changed = true;
+		} while (bits);
 	}
+
+	return changed;
 }
 
 #ifdef HAS_NETSERVER
@@ -586,6 +611,16 @@ static struct {
 	uint8_t buf[2048];
 } msg;
 
+/* send a run of n changed bytes of the video RAM starting at addr */
+static void ws_send(int addr, int n)
+{
+	msg.addr = VIO_RAM + addr;
+	msg.len = n;
+	net_device_send(DEV_VIO, (char *) &msg, msg.len + 4);
+	LOGD(__func__, "BUF update FROM %04X TO %04X",
+	     msg.addr, msg.addr + msg.len);
+}
+
 static void ws_refresh(void)
 {
 	static int cols, rows;
@@ -594,6 +629,7 @@ static void ws_refresh(void)
 	if (mode != modebuf) {
 		modebuf = mode;
 		memset(dblbuf, 0, 2048);
+		mark_all();
 
 		res = mode & 3;
 
@@ -618,49 +654,40 @@ static void ws_refresh(void)
 	event_handler();
 
 	int len = rows * cols;
-	int addr;
-	int i, n, x;
-	bool cont;
+	int addr = -1, last = 0;
+	int i, n = 0, w;
+	uint64_t bits;
 	uint8_t val;
 
-	for (i = 0; i < len; i++) {
-		addr = i;
-		n = 0;
-		cont = true;
-		while (cont && (i < len)) {
-			val = getmem(0xf000 + i);
-			while ((val != dblbuf[i]) && (i < len)) {
-				dblbuf[i++] = val;
-				msg.buf[n++] = val;
-				cont = false;
-				val = getmem(0xf000 + i);
-			}
-			if (cont)
-				break;
-			x = 0;
+	/* send runs of the written cells, which differ from the double
+	   buffer, runs with gaps of up to 4 unchanged bytes are joined */
 #define LOOKAHEAD 4
-			/* look-ahead up to 4 bytes for next change */
-			while ((x < LOOKAHEAD) && !cont && (i < len)) {
-				val = getmem(0xf000 + i++);
-				msg.buf[n++] = val;
-				val = getmem(0xf000 + i);
-				if ((i < len) && (val != dblbuf[i])) {
-					cont = true;
-				}
-				x++;
+	for (w = 0; w < len; w += 64) {
+		for (bits = get_dirty(w); bits; bits &= bits - 1) {
+			i = w + __builtin_ctzll(bits);
+			if (i >= len)
+				break;
+			val = getmem(VIO_RAM + i);
+			if (val == dblbuf[i])
+				continue;
+			dblbuf[i] = val;
+			if (addr >= 0 && i - last > LOOKAHEAD + 1) {
+				ws_send(addr, n);
+				addr = -1;
 			}
-			if (!cont) {
-				n -= x;
+			if (addr < 0) {
+				addr = i;
+				n = 0;
+			} else {
+				while (++last < i)
+					msg.buf[n++] = getmem(VIO_RAM + last);
 			}
-		}
-		if (n) {
-			msg.addr = 0xf000 + addr;
-			msg.len = n;
-			net_device_send(DEV_VIO, (char *) &msg, msg.len + 4);
-			LOGD(__func__, "BUF update FROM %04X TO %04X",
-			     msg.addr, msg.addr + msg.len);
+			msg.buf[n++] = val;
+			last = i;
 		}
 	}
+	if (addr >= 0)
+		ws_send(addr, n);
 }
 #endif /* HAS_NETSERVER */
 
@@ -671,9 +698,8 @@ static void update_display(bool tick)
 	UNUSED(tick);
 
 	/* update display window */
-	SDL_LockTexture(texture, NULL, (void **) &pixels, &pitch);
-	refresh();
-	SDL_UnlockTexture(texture);
+	if (refresh())
+		SDL_UpdateTexture(texture, NULL, pixels, pitch);
 	SDL_RenderCopy(renderer, texture, NULL, NULL);
 	SDL_RenderPresent(renderer);
 }
@@ -10,6 +10,8 @@
  *
  * History:
  * 09-JUN-2024 first version
+ * 18-OCT-2026 write sectors behind
+ * 18-OCT-2026 keep the disk images open
  */
 
 #include <stdio.h>
@@ -29,6 +31,8 @@
 #ifdef HAS_ISBC201
 
 #include "mds-isbc201.h"
+#include "diskimg.h"
+#include "diskwb.h"
 
 #include "log.h"
 static const char *TAG = "ISBC201";
@@ -94,6 +98,7 @@ static const char *TAG = "ISBC201";
 #define SPT		26
 #define TRK		77
 #define DISK_SIZE	(TRK * SPT * SEC_SZ)
+#define DRIVE0		4	/* drive # of unit 0, disk E */
 
 #define ISBC201_IRQ	2
 
@@ -104,6 +109,8 @@ static BYTE ioerr;		/* I/O complete error bits */
 static char fndir[MAX_LFN];	/* directory path for disk image */
 static char fn[MAX_LFN];	/* path/filename for disk image */
 static int fd;			/* fd for disk file i/o */
+static dimg_t img[2];		/* open disk images */
+static ino_t inode[2];		/* inodes of the disk images */
 static BYTE buf[SEC_SZ];	/* buffer for one sector */
 static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -138,6 +145,19 @@ static void dsk_path(void)
 	strcat(fndir, "/");
 }
 
+/*
+ * open the disk image of drive, if it isn't open already
+ */
+static int open_disk(int drive)
+{
+	if (!dimg_valid(&img[drive])) {
+		if (dimg_open(&img[drive], DRIVE0 + drive, fn) == -1)
+			return -1;
+	}
+	fd = img[drive].fd;
+	return 0;
+}
+
 BYTE isbc201_status_in(void)
 {
 	return status;
@@ -184,7 +204,6 @@ void isbc201_iopbh_out(BYTE data)
 #endif
 	int i, drive, op;
 	off_t pos;
-	struct stat s;
 
 	iopb_addr |= data << 8;
 
@@ -246,6 +265,9 @@ void isbc201_iopbh_out(BYTE data)
 			break;
 		}
 
+		/* the image is written without the open one */
+		dimg_close(&img[drive]);
+
 		/* unlink disk image */
 		if (taddr == 0)
 			unlink(fn);
@@ -340,40 +362,24 @@ void isbc201_iopbh_out(BYTE data)
 			break;
 		}
 
-		/* try to open disk image */
-		if ((fd = open(fn, O_RDONLY)) == -1) {
+		/* try to open disk image and check for correct size */
+		if (open_disk(drive) == -1 || img[drive].size != DISK_SIZE) {
 			ioerr = IO_NRDY;
 			break;
 		}
 
-		/* check for correct image size */
-		if (fstat(fd, &s) == -1 || !S_ISREG(s.st_mode)
-					|| s.st_size != DISK_SIZE) {
-			ioerr = IO_NRDY;
-			goto rdone;
-		}
-
-		/* seek to sector */
-		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
-		if (lseek(fd, pos, SEEK_SET) == (off_t) -1) {
-			ioerr = IO_SEEK;
-			goto rdone;
-		}
-
 		/* read the sectors */
-		for (; nsec > 0; nsec--) {
-			if (read(fd, buf, SEC_SZ) != SEC_SZ) {
+		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
+		for (; nsec > 0; nsec--, pos += SEC_SZ) {
+			if (dwb_pread(fd, buf, SEC_SZ, pos) != SEC_SZ) {
 				ioerr = IO_OURUN;
-				goto rdone;
+				break;
 			}
 			if (op == OP_READ) {
 				for (i = 0; i < SEC_SZ; i++)
 					dma_write(addr++, buf[i]);
 			}
 		}
-
-	rdone:
-		close(fd);
 		break;
 
 	case OP_WT:	/* write data */
@@ -387,42 +393,31 @@ void isbc201_iopbh_out(BYTE data)
 		}
 
 		/* try to open disk image */
-		if ((fd = open(fn, O_RDWR)) == -1) {
-			if ((fd = open(fn, O_RDONLY)) != -1) {
-				ioerr = IO_WPROT;
-				goto wdone;
-			} else {
-				ioerr = IO_NRDY;
-				break;
-			}
+		if (open_disk(drive) == -1) {
+			ioerr = IO_NRDY;
+			break;
+		}
+		if (img[drive].rdonly) {
+			ioerr = IO_WPROT;
+			break;
 		}
 
 		/* check for correct image size */
-		if (fstat(fd, &s) == -1 || !S_ISREG(s.st_mode)
-					|| s.st_size != DISK_SIZE) {
+		if (img[drive].size != DISK_SIZE) {
 			ioerr = IO_NRDY;
-			goto wdone;
-		}
-
-		/* seek to sector */
-		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
-		if (lseek(fd, pos, SEEK_SET) == (off_t) -1) {
-			ioerr = IO_SEEK;
-			goto wdone;
+			break;
 		}
 
 		/* write sectors */
-		for (; nsec > 0; nsec--) {
+		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
+		for (; nsec > 0; nsec--, pos += SEC_SZ) {
 			for (i = 0; i < SEC_SZ; i++)
 				buf[i] = dma_read(addr++);
-			if (write(fd, buf, SEC_SZ) != SEC_SZ) {
+			if (dwb_pwrite(fd, buf, SEC_SZ, pos) != SEC_SZ) {
 				ioerr = IO_OURUN;
-				goto wdone;
+				break;
 			}
 		}
-
-	wdone:
-		close(fd);
 		break;
 
 	default:
@@ -464,8 +459,15 @@ void isbc201_disk_check(void)
 	pfn = fn_ + strlen(fn_);
 	for (i = 0; i <= 1; i++) {
 		strcpy(pfn, disks[i]);
-		if (stat(fn_, &s) == -1 || !S_ISREG(s.st_mode))
+		if (stat(fn_, &s) == -1 || !S_ISREG(s.st_mode)) {
 			nstatus &= ~uready[i];
+			s.st_ino = 0;
+		}
+		/* the image was replaced, open it again */
+		if (s.st_ino != inode[i]) {
+			inode[i] = s.st_ino;
+			dimg_invalidate(DRIVE0 + i);
+		}
 	}
 
 	if ((status & ST_UNITS) != nstatus) {
@@ -484,6 +486,10 @@ void isbc201_reset(void)
 	BYTE nstatus;
 	struct stat s;
 
+	/* pick up changed disk images */
+	for (i = 0; i < 2; i++)
+		dimg_close(&img[i]);
+
 	/* set disk directory path */
 	dsk_path();
 
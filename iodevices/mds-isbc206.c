@@ -18,6 +18,8 @@
  *
  * History:
  * 08-JUN-2024 first version
+ * 18-OCT-2026 write sectors behind
+ * 18-OCT-2026 keep the disk images open
  */
 
 #include <stdio.h>
@@ -37,6 +39,8 @@
 #ifdef HAS_ISBC206
 
 #include "mds-isbc206.h"
+#include "diskimg.h"
+#include "diskwb.h"
 
 #include "log.h"
 static const char *TAG = "ISBC206";
@@ -99,6 +103,7 @@ static const char *TAG = "ISBC206";
 #define SPT		144
 #define TRK		200
 #define DISK_SIZE	(TRK * SPT * SEC_SZ)
+#define DRIVE0		8	/* drive # of unit 0, disk I */
 
 #define ISBC206_IRQ	2
 
@@ -109,6 +114,8 @@ static BYTE ioerr;		/* I/O complete error bits */
 static char fndir[MAX_LFN];	/* directory path for disk image */
 static char fn[MAX_LFN];	/* path/filename for disk image */
 static int fd;			/* fd for disk file i/o */
+static dimg_t img[4];		/* open disk images */
+static ino_t inode[4];		/* inodes of the disk images */
 static BYTE buf[SEC_SZ];	/* buffer for one sector */
 static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -148,6 +155,19 @@ static void dsk_path(void)
 	strcat(fndir, "/");
 }
 
+/*
+ * open the disk image of drive, if it isn't open already
+ */
+static int open_disk(int drive)
+{
+	if (!dimg_valid(&img[drive])) {
+		if (dimg_open(&img[drive], DRIVE0 + drive, fn) == -1)
+			return -1;
+	}
+	fd = img[drive].fd;
+	return 0;
+}
+
 BYTE isbc206_status_in(void)
 {
 	return status;
@@ -190,7 +210,6 @@ void isbc206_iopbh_out(BYTE data)
 	WORD addr, track;
 	int i, drive, op;
 	off_t pos;
-	struct stat s;
 
 	iopb_addr |= data << 8;
 
@@ -258,6 +277,9 @@ void isbc206_iopbh_out(BYTE data)
 			break;
 		}
 
+		/* the image is written without the open one */
+		dimg_close(&img[drive]);
+
 		/* unlink disk image */
 		if (taddr == 0)
 			unlink(fn);
@@ -352,40 +374,24 @@ void isbc206_iopbh_out(BYTE data)
 			break;
 		}
 
-		/* try to open disk image */
-		if ((fd = open(fn, O_RDONLY)) == -1) {
+		/* try to open disk image and check for correct size */
+		if (open_disk(drive) == -1 || img[drive].size != DISK_SIZE) {
 			ioerr = IO_NRDY;
 			break;
 		}
 
-		/* check for correct image size */
-		if (fstat(fd, &s) == -1 || !S_ISREG(s.st_mode)
-					|| s.st_size != DISK_SIZE) {
-			ioerr = IO_NRDY;
-			goto rdone;
-		}
-
-		/* seek to sector */
-		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
-		if (lseek(fd, pos, SEEK_SET) == (off_t) -1) {
-			ioerr = IO_SEEK;
-			goto rdone;
-		}
-
 		/* read the sectors */
-		for (; nsec > 0; nsec--) {
-			if (read(fd, buf, SEC_SZ) != SEC_SZ) {
+		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
+		for (; nsec > 0; nsec--, pos += SEC_SZ) {
+			if (dwb_pread(fd, buf, SEC_SZ, pos) != SEC_SZ) {
 				ioerr = IO_OURUN;
-				goto rdone;
+				break;
 			}
 			if (op == OP_READ) {
 				for (i = 0; i < SEC_SZ; i++)
 					dma_write(addr++, buf[i]);
 			}
 		}
-
-	rdone:
-		close(fd);
 		break;
 
 	case OP_WT:	/* write data */
@@ -399,42 +405,31 @@ void isbc206_iopbh_out(BYTE data)
 		}
 
 		/* try to open disk image */
-		if ((fd = open(fn, O_RDWR)) == -1) {
-			if ((fd = open(fn, O_RDONLY)) != -1) {
-				ioerr = IO_WPROT;
-				goto wdone;
-			} else {
-				ioerr = IO_NRDY;
-				break;
-			}
+		if (open_disk(drive) == -1) {
+			ioerr = IO_NRDY;
+			break;
+		}
+		if (img[drive].rdonly) {
+			ioerr = IO_WPROT;
+			break;
 		}
 
 		/* check for correct image size */
-		if (fstat(fd, &s) == -1 || !S_ISREG(s.st_mode)
-					|| s.st_size != DISK_SIZE) {
+		if (img[drive].size != DISK_SIZE) {
 			ioerr = IO_NRDY;
-			goto wdone;
-		}
-
-		/* seek to sector */
-		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
-		if (lseek(fd, pos, SEEK_SET) == (off_t) -1) {
-			ioerr = IO_SEEK;
-			goto wdone;
+			break;
 		}
 
 		/* write sectors */
-		for (; nsec > 0; nsec--) {
+		pos = (taddr * SPT + saddr - 1) * SEC_SZ;
+		for (; nsec > 0; nsec--, pos += SEC_SZ) {
 			for (i = 0; i < SEC_SZ; i++)
 				buf[i] = dma_read(addr++);
-			if (write(fd, buf, SEC_SZ) != SEC_SZ) {
+			if (dwb_pwrite(fd, buf, SEC_SZ, pos) != SEC_SZ) {
 				ioerr = IO_OURUN;
-				goto wdone;
+				break;
 			}
 		}
-
-	wdone:
-		close(fd);
 		break;
 
 	default:
@@ -476,8 +471,15 @@ void isbc206_disk_check(void)
 	pfn = fn_ + strlen(fn_);
 	for (i = 0; i <= 3; i++) {
 		strcpy(pfn, disks[i]);
-		if (stat(fn_, &s) == -1 || !S_ISREG(s.st_mode))
+		if (stat(fn_, &s) == -1 || !S_ISREG(s.st_mode)) {
 			nstatus &= ~uready[i];
+			s.st_ino = 0;
+		}
+		/* the image was replaced, open it again */
+		if (s.st_ino != inode[i]) {
+			inode[i] = s.st_ino;
+			dimg_invalidate(DRIVE0 + i);
+		}
 	}
 
 	if ((status & ST_UNITS) != nstatus) {
@@ -496,6 +498,10 @@ void isbc206_reset(void)
 	BYTE nstatus;
 	struct stat s;
 
+	/* pick up changed disk images */
+	for (i = 0; i < 4; i++)
+		dimg_close(&img[i]);
+
 	/* set disk directory path */
 	dsk_path();
 
@@ -13,6 +13,8 @@
  * History:
  * 03-JUN-2024 first version
  * 07-JUN-2024 rewrite of the monitor ports and the timing thread
+ * 18-OCT-2026 CRT input is received by the reactor thread
+ * 18-OCT-2026 CRT output is sent by the reactor thread
  */
 
 #include <stdio.h>
@@ -33,6 +35,7 @@
 #include "mds-monitor.h"
 #include "unix_network.h"
 #include "unix_terminal.h"
+#include "unix_reactor.h"
 
 #include "log.h"
 static const char *TAG = "MONITOR";
@@ -356,24 +359,19 @@ void mon_tty_ctl_out(BYTE data)
  */
 void mon_crt_periodic(void)
 {
-	struct pollfd p[1];
+	int ch;
 	BYTE iset;
 
 	iset = 0;
 	if ((tty_cmd & RXEN) && !crt_rbr) {
-		p[0].fd = fileno(stdin);
-		p[0].events = POLLIN;
-		p[0].revents = 0;
-		poll(p, 1, 0);
-		if (p[0].revents & POLLIN) {
-			crt_rbr = true;
-			iset |= ICRTI;
-		}
-		if (p[0].revents & POLLNVAL) {
+		if ((ch = rx_stdin()) == -1) {
 			LOGE(TAG, "can't use terminal, "
 			     "try 'screen simulation ...'");
 			cpu_error = IOERROR;
 			cpu_state = ST_STOPPED;
+		} else if (rx_ready(ch)) {
+			crt_rbr = true;
+			iset |= ICRTI;
 		}
 	}
 	if ((tty_cmd & TXEN) && !crt_trdy) {
@@ -389,15 +387,19 @@ void mon_crt_periodic(void)
  */
 BYTE mon_crt_data_in(void)
 {
-	BYTE data;
+	int ch, data;
 	static BYTE last;
 
 	if (!(crt_cmd & RXEN) || !crt_rbr)
 		return last;
 
 again:
-	if (read(fileno(stdin), &data, 1) == 0) {
+	if ((ch = rx_stdin()) == -1 || (data = rx_get(ch)) == RX_NONE)
+		return last;
+
+	if (data == RX_EOF) {
 		/* try to reopen tty, input redirection exhausted */
+		rx_close(ch);
 		if (freopen("/dev/tty", "r", stdin) == NULL)
 			LOGE(TAG, "can't reopen /dev/tty");
 		set_unix_terminal();
@@ -435,6 +437,8 @@ BYTE mon_crt_status_in(void)
  */
 void mon_crt_data_out(BYTE data)
 {
+	int ch;
+
 	if (!(crt_cmd & TXEN) || !crt_trdy)
 		return;
 
@@ -444,15 +448,10 @@ void mon_crt_data_out(BYTE data)
 	if (crt_strip_parity)
 		data &= 0x7f;
 
-again:
-	if (write(fileno(stdout), &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write stdout data");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if ((ch = tx_stdout()) == -1 || !tx_put(ch, data)) {
+		LOGE(TAG, "can't write stdout data");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 
 done:
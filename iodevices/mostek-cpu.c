@@ -9,6 +9,8 @@
  *
  * History:
  * 15-SEP-2019 (Mike Douglas) created from altair-88-2sio.c
+ * 18-OCT-2026 terminal input is received by the reactor thread
+ * 18-OCT-2026 terminal output is sent by the reactor thread
  */
 
 #include <unistd.h>
@@ -25,6 +27,7 @@
 #include "simglb.h"
 
 #include "unix_terminal.h"
+#include "unix_reactor.h"
 #include "mostek-cpu.h"
 
 #include "log.h"
@@ -39,15 +42,11 @@ static const char *TAG = "console";
 BYTE sio_status_in(void)
 {
 	BYTE status = 0;
-	struct pollfd p[1];
+	int ch;
 
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN | POLLOUT;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (p[0].revents & POLLIN)
+	if ((ch = rx_stdin()) != -1 && rx_ready(ch))
 		status |= 0x40;
-	if (p[0].revents & POLLOUT)
+	if ((ch = tx_stdout()) == -1 || tx_ready(ch))
 		status |= 0x80;
 
 	return status;
@@ -66,21 +65,17 @@ void sio_control_out(BYTE data)
  */
 BYTE sio_data_in(void)
 {
-	BYTE data;
+	int ch, data;
 	static BYTE last;
-	struct pollfd p[1];
 
 again:
 	/* if no input waiting return last */
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (!(p[0].revents & POLLIN))
+	if ((ch = rx_stdin()) == -1 || (data = rx_get(ch)) == RX_NONE)
 		return last;
 
-	if (read(fileno(stdin), &data, 1) == 0) {
+	if (data == RX_EOF) {
 		/* try to reopen tty, input redirection exhausted */
+		rx_close(ch);
 		if (freopen("/dev/tty", "r", stdin) == NULL)
 			LOGE(TAG, "can't reopen /dev/tty");
 		set_unix_terminal();
@@ -97,16 +92,12 @@ again:
  */
 void sio_data_out(BYTE data)
 {
+	int ch;
 
-again:
-	if (write(fileno(stdout), &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			perror("write data sio1");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
+	if ((ch = tx_stdout()) == -1 || !tx_put(ch, data)) {
+		LOGE(TAG, "can't write data sio1");
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
 	}
 }
 
@@ -0,0 +1,172 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by agent
+ *
+ * Lock-free byte ring for one producer and one consumer thread
+ *
+ * History:
+ * 18-OCT-2026 first version
+ * 18-OCT-2026 free space for producers which must not drop bytes
+ * 18-OCT-2026 consumers can write the waiting bytes out in place
+ */
+
+/*
+ *	The ring passes bytes from a thread receiving them, e.g. the
+ *	web server, to the CPU thread without locks and system calls.
+ *	Only the producer advances head and only the consumer advances
+ *	tail, both are free running and published with release stores,
+ *	so that the bytes are visible before the index which covers
+ *	them. Bytes which don't fit are dropped and counted.
+ */
+
+#ifndef SPSCRING_INC
+#define SPSCRING_INC
+
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define RING_SIZE	1024	/* size of a ring, power of 2 */
+
+typedef struct spsc_ring {
+	unsigned head;		/* next byte to put, producer only */
+	unsigned tail;		/* next byte to get, consumer only */
+	unsigned long overflow;	/* number of bytes dropped */
+	BYTE buf[RING_SIZE];	/* the bytes */
+} spsc_ring_t;
+
+/*
+ *	Empty the ring, neither producer nor consumer may use it
+ */
+static inline void ring_reset(spsc_ring_t *r)
+{
+	__atomic_store_n(&r->head, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&r->tail, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&r->overflow, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ *	Producer: put len bytes into the ring, returns the number
+ *	of bytes put, the rest is dropped
+ */
+static inline int ring_put(spsc_ring_t *r, const BYTE *data, int len)
+{
+	unsigned head = r->head;
+	unsigned tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	unsigned n, i, k;
+
+	n = RING_SIZE - (head - tail);
+	if ((unsigned) len < n)
+		n = (unsigned) len;
+	i = head & (RING_SIZE - 1);
+	k = RING_SIZE - i;
+	if (k > n)
+		k = n;
+	memcpy(&r->buf[i], data, k);
+	memcpy(&r->buf[0], data + k, n - k);
+	__atomic_store_n(&r->head, head + n, __ATOMIC_RELEASE);
+
+	if (n < (unsigned) len)
+		__atomic_fetch_add(&r->overflow, (unsigned long) len - n,
+				   __ATOMIC_RELAXED);
+	return (int) n;
+}
+
+/*
+ *	Producer: number of bytes which can be put into the ring
+ */
+static inline int ring_space(spsc_ring_t *r)
+{
+	return (int) (RING_SIZE - (r->head -
+				   __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)));
+}
+
+/*
+ *	Consumer: number of bytes waiting in the ring
+ */
+static inline int ring_count(spsc_ring_t *r)
+{
+	return (int) (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - r->tail);
+}
+
+/*
+ *	Consumer: the next byte in the ring without removing it,
+ *	or -1 if the ring is empty
+ */
+static inline int ring_peek(spsc_ring_t *r)
+{
+	if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == r->tail)
+		return -1;
+	return r->buf[r->tail & (RING_SIZE - 1)];
+}
+
+/*
+ *	Consumer: remove up to len bytes from the ring into dst,
+ *	returns the number of bytes removed
+ */
+static inline int ring_get(spsc_ring_t *r, BYTE *dst, int len)
+{
+	unsigned tail = r->tail;
+	unsigned n = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - tail;
+	unsigned i, k;
+
+	if ((unsigned) len < n)
+		n = (unsigned) len;
+	i = tail & (RING_SIZE - 1);
+	k = RING_SIZE - i;
+	if (k > n)
+		k = n;
+	memcpy(dst, &r->buf[i], k);
+	memcpy(dst + k, &r->buf[0], n - k);
+	__atomic_store_n(&r->tail, tail + n, __ATOMIC_RELEASE);
+
+	return (int) n;
+}
+
+/*
+ *	Consumer: the waiting bytes in up to two contiguous parts,
+ *	in place, returns the number of parts, which are removed
+ *	with ring_skip() after they were used
+ */
+static inline int ring_parts(spsc_ring_t *r, BYTE *part[2], int len[2])
+{
+	unsigned tail = r->tail;
+	unsigned n = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - tail;
+	unsigned i, k;
+
+	if (n == 0)
+		return 0;
+	i = tail & (RING_SIZE - 1);
+	k = RING_SIZE - i;
+	if (k > n)
+		k = n;
+	part[0] = &r->buf[i];
+	len[0] = (int) k;
+	if (k == n)
+		return 1;
+	part[1] = &r->buf[0];
+	len[1] = (int) (n - k);
+	return 2;
+}
+
+/*
+ *	Consumer: remove len waiting bytes from the ring
+ */
+static inline void ring_skip(spsc_ring_t *r, int len)
+{
+	__atomic_store_n(&r->tail, r->tail + (unsigned) len, __ATOMIC_RELEASE);
+}
+
+/*
+ *	Number of bytes dropped since the ring was reset
+ */
+static inline unsigned long ring_overflow(spsc_ring_t *r)
+{
+	return __atomic_load_n(&r->overflow, __ATOMIC_RELAXED);
+}
+
+#endif /* !SPSCRING_INC */
@@ -23,6 +23,8 @@
  * 15-JUL-2018 use logging
  * 23-SEP-2019 bug fixes and improvements by Mike Douglas
  * 24-SEP-2019 restore and seek also affect step direction
+ * 18-OCT-2026 write sectors behind
+ * 18-OCT-2026 keep disk images open
  */
 
 #include <unistd.h>
@@ -36,6 +38,8 @@
 #include "simglb.h"
 
 #include "tarbell_fdc.h"
+#include "diskwb.h"
+#include "diskimg.h"
 
 #include "log.h"
 static const char *TAG = "Tarbell";
@@ -59,6 +63,7 @@ static int disk;		/* current disk # */
 static int state;		/* fdc state */
 static char fn[MAX_LFN];	/* path/filename for disk image */
 static int fd;			/* fd for disk file i/o */
+static dimg_t img[4];		/* open disk images */
 static int dcnt;		/* data counter read/write */
 static BYTE buf[SEC_SZ];	/* buffer for one sector */
 static int stepdir = -1;	/* stepping direction */
@@ -103,6 +108,22 @@ void dsk_path(void)
 	}
 }
 
+/*
+ * open the disk image of the current disk, if it isn't open already
+ */
+static int open_disk(void)
+{
+	if (!dimg_valid(&img[disk])) {
+		dsk_path();
+		strcat(fn, "/");
+		strcat(fn, disks[disk]);
+		if (dimg_open(&img[disk], disk, fn) == -1)
+			return -1;
+	}
+	fd = img[disk].fd;
+	return 0;
+}
+
 /*
  * FDC status port
  */
@@ -241,7 +262,6 @@ void tarbell_sec_out(BYTE data)
 BYTE tarbell_data_in(void)
 {
 	off_t pos;		/* seek position */
-	struct stat s;
 
 	switch (state) {
 	case FDC_READ:		/* read data from disk sector */
@@ -264,41 +284,26 @@ BYTE tarbell_data_in(void)
 			}
 
 			/* try to open disk image */
-			dsk_path();
-			strcat(fn, "/");
-			strcat(fn, disks[disk]);
-			if ((fd = open(fn, O_RDONLY)) == -1) {
+			if (open_disk() == -1) {
 				state = FDC_IDLE;	/* abort command */
 				fdc_stat = 0x80;	/* not ready */
 				return (BYTE) 0;
 			}
 
 			/* check for correct image size */
-			fstat(fd, &s);
-			if (s.st_size != 256256) {
+			if (img[disk].size != 256256) {
 				state = FDC_IDLE;	/* abort command */
 				fdc_stat = 0x80;	/* not ready */
-				close(fd);
-				return (BYTE) 0;
-			}
-
-			/* seek to sector */
-			pos = (fdc_track * SPT + fdc_sec - 1) * SEC_SZ;
-			if (lseek(fd, pos, SEEK_SET) == -1L) {
-				state = FDC_IDLE;	/* abort command */
-				fdc_stat = 0x10;	/* record not found */
-				close(fd);
 				return (BYTE) 0;
 			}
 
 			/* read the sector */
-			if (read(fd, buf, SEC_SZ) != SEC_SZ) {
+			pos = (fdc_track * SPT + fdc_sec - 1) * SEC_SZ;
+			if (dwb_pread(fd, buf, SEC_SZ, pos) != SEC_SZ) {
 				state = FDC_IDLE;	/* abort read command */
 				fdc_stat = 0x10;	/* record not found */
-				close(fd);
 				return (BYTE) 0;
 			}
-			close(fd);
 		}
 
 		/* last byte? */
@@ -345,7 +350,6 @@ void tarbell_data_out(BYTE data)
 	static int wrtstat;		/* state while formatting track */
 	static int bcnt;		/* byte counter for sector data */
 	static int secs;		/* # of sectors written so far */
-	struct stat s;
 
 	switch (state) {
 	case FDC_WRITE:			/* write data to disk sector */
@@ -366,35 +370,19 @@ void tarbell_data_out(BYTE data)
 			}
 
 			/* try to open disk image */
-			dsk_path();
-			strcat(fn, "/");
-			strcat(fn, disks[disk]);
-			if ((fd = open(fn, O_RDWR)) == -1) {
-				if ((fd = open(fn, O_RDONLY)) != -1) {
-					close(fd);
+			if (open_disk() == -1 || img[disk].rdonly) {
+				if (img[disk].open)
 					fdc_stat = 0x40; /* read only */
-				} else {
+				else
 					fdc_stat = 0x80; /* not ready */
-				}
 				state = FDC_IDLE;	/* abort command */
 				return;
 			}
 
 			/* check for correct image size */
-			fstat(fd, &s);
-			if (s.st_size != 256256) {
+			if (img[disk].size != 256256) {
 				state = FDC_IDLE;	/* abort command */
 				fdc_stat = 0x80;	/* not ready */
-				close(fd);
-				return;
-			}
-
-			/* seek to sector */
-			pos = (fdc_track * SPT + fdc_sec - 1) * SEC_SZ;
-			if (lseek(fd, pos, SEEK_SET) == -1L) {
-				state = FDC_IDLE;	/* abort command */
-				fdc_stat = 0x10;	/* record not found */
-				close(fd);
 				return;
 			}
 		}
@@ -405,16 +393,20 @@ void tarbell_data_out(BYTE data)
 		/* last byte? */
 		if (dcnt == SEC_SZ) {
 			state = FDC_IDLE;		/* reset DRQ */
-			if (write(fd, buf, SEC_SZ) == SEC_SZ)
+			pos = (fdc_track * SPT + fdc_sec - 1) * SEC_SZ;
+			if (dwb_pwrite(fd, buf, SEC_SZ, pos) == SEC_SZ)
 				fdc_stat = 0;
 			else
 				fdc_stat = 0x20;	/* write fault */
-			close(fd);
 		}
 		break;
 
 	case FDC_WRTTRK:		/* write (format) TRACK */
 		if (dcnt == 0) {
+			/* queued sectors must be written before */
+			dwb_sync();
+			/* the image is written without the open one */
+			dimg_close(&img[disk]);
 			/* unlink disk image */
 			dsk_path();
 			strcat(fn, "/");
@@ -501,6 +493,12 @@ void tarbell_ext_out(BYTE data)
  */
 void tarbell_reset(void)
 {
+	int i;
+
+	dwb_sync();
+	/* pick up changed disk images */
+	for (i = 0; i < 4; i++)
+		dimg_close(&img[i]);
 	fdc_stat = fdc_track = fdc_sec = disk = state = dcnt = 0;
 	tarbell_rom_active = true;
 }
@@ -0,0 +1,778 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by agent
+ *
+ * This module contains a reactor thread, which receives the input
+ * for the serial devices into rings and sends their output from rings.
+ *
+ * History:
+ * 18-OCT-2026 first version
+ * 18-OCT-2026 output is sent from transmit channels
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simport.h"
+#ifdef HAS_FORKSRV
+#include "simfork.h"
+#endif
+
+#include "spscring.h"
+#include "unix_reactor.h"
+
+#include "log.h"
+static const char *TAG = "reactor";
+
+#define RX_SLICE	100	/* max. ms the CPU waits at once */
+#define RX_WAKE		RX_MAX	/* epoll data of the wake up pipe */
+
+#define TX_FLUSH	(RING_SIZE / 2)	/* output written at once */
+
+typedef struct rx_chan {
+	bool used;		/* channel is open */
+	int fd;			/* file descriptor received from */
+	bool direct;		/* can't be watched, read directly */
+	bool armed;		/* watched by the thread */
+	bool eof;		/* end of input or error seen */
+	spsc_ring_t ring;	/* received bytes */
+} rx_chan_t;
+
+typedef struct tx_chan {
+	bool used;		/* channel is open */
+	int fd;			/* file descriptor sent to */
+	bool sock;		/* is a socket, sent without blocking */
+	bool err;		/* write failed, output is discarded */
+	bool kicked;		/* thread was woken up for the channel */
+	bool urgent;		/* write the output now */
+	uint64_t due;		/* host time in us to write the output */
+	spsc_ring_t ring;	/* bytes to send */
+} tx_chan_t;
+
+static rx_chan_t rx_chans[RX_MAX];
+static int rx_stdin_ch = -1;	/* channel of stdin */
+
+static tx_chan_t tx_chans[TX_MAX];
+static int tx_stdout_ch = -1;	/* channel of stdout */
+
+static bool rx_started;		/* reactor thread is running */
+static pthread_t rx_tid;	/* its thread id */
+static pthread_mutex_t rx_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rx_cond = PTHREAD_COND_INITIALIZER;
+#ifdef __linux__
+static int rx_epfd = -1;	/* epoll instance watching the channels */
+#endif
+static int rx_pipe[2] = { -1, -1 }; /* wakes up the thread */
+
+/*
+ *	Wake up the reactor thread
+ */
+static void rx_kick(void)
+{
+	if (write(rx_pipe[1], "", 1) == -1) {
+		/* pipe is full, the thread wakes up anyway */
+	}
+}
+
+/*
+ *	Watch the file descriptor of channel c for input once
+ */
+static void rx_watch(rx_chan_t *c)
+{
+#ifdef __linux__
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN | EPOLLONESHOT;
+	ev.data.u32 = (uint32_t) (c - rx_chans);
+	if (epoll_ctl(rx_epfd, EPOLL_CTL_MOD, c->fd, &ev) == -1)
+		LOGE(TAG, "can't watch file descriptor %d", c->fd);
+#else
+	UNUSED(c);
+
+	rx_kick();
+#endif
+}
+
+/*
+ *	Add the file descriptor of channel c to the watched ones,
+ *	called with the lock held
+ */
+static bool rx_add(rx_chan_t *c)
+{
+#ifdef __linux__
+	struct epoll_event ev;
+#else
+	struct stat s;
+#endif
+
+	ring_reset(&c->ring);
+	c->eof = false;
+	c->direct = false;
+	c->armed = true;
+
+#ifdef __linux__
+	ev.events = EPOLLIN | EPOLLONESHOT;
+	ev.data.u32 = (uint32_t) (c - rx_chans);
+	if (epoll_ctl(rx_epfd, EPOLL_CTL_ADD, c->fd, &ev) == -1) {
+		if (errno != EPERM)
+			return false;
+		/* regular files and /dev/null can't be watched */
+		c->direct = true;
+		c->armed = false;
+	}
+#else
+	if (fstat(c->fd, &s) == -1)
+		return false;
+	if (S_ISREG(s.st_mode)) {
+		c->direct = true;
+		c->armed = false;
+	} else
+		rx_watch(c);
+#endif
+
+	return true;
+}
+
+/*
+ *	Read the input, which arrived for channel c, into its ring,
+ *	called with the lock held
+ */
+static void rx_recv(rx_chan_t *c)
+{
+	BYTE buf[RING_SIZE];
+	ssize_t n;
+
+	if (!c->used || !c->armed)
+		return;
+
+	/* the machine was stopped, leave the input to the ICE */
+	if (cpu_state == ST_STOPPED) {
+		__atomic_store_n(&c->armed, false, __ATOMIC_RELEASE);
+		return;
+	}
+
+	n = read(c->fd, buf, (size_t) ring_space(&c->ring));
+	if (n > 0)
+		ring_put(&c->ring, buf, (int) n);
+	else if (n == 0 || (errno != EAGAIN && errno != EINTR))
+		__atomic_store_n(&c->eof, true, __ATOMIC_RELEASE);
+	else {
+		rx_watch(c);
+		return;
+	}
+	__atomic_store_n(&c->armed, false, __ATOMIC_RELEASE);
+}
+
+/*
+ *	Prepare channel c for sending to its file descriptor,
+ *	called with the lock held
+ */
+static bool tx_add(tx_chan_t *c)
+{
+	struct stat s;
+
+	if (fstat(c->fd, &s) == -1)
+		return false;
+
+	ring_reset(&c->ring);
+	c->sock = S_ISSOCK(s.st_mode);
+	c->err = false;
+	c->kicked = false;
+	c->urgent = false;
+
+	return true;
+}
+
+/*
+ *	Write the output waiting in the ring of channel c, sockets
+ *	without blocking unless wait is true, called with the lock
+ *	held, returns false if not all output could be written yet
+ */
+static bool tx_send(tx_chan_t *c, bool wait)
+{
+	struct iovec iov[2];
+	struct msghdr msg;
+	struct pollfd p[1];
+	BYTE *part[2];
+	int len[2];
+	int i, k;
+	ssize_t n;
+
+	while ((k = ring_parts(&c->ring, part, len)) > 0) {
+		for (i = 0; i < k; i++) {
+			iov[i].iov_base = part[i];
+			iov[i].iov_len = (size_t) len[i];
+		}
+		if (c->sock) {
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = iov;
+			msg.msg_iovlen = k;
+			n = sendmsg(c->fd, &msg, wait ? 0 : MSG_DONTWAIT);
+		} else
+			n = writev(c->fd, iov, k);
+
+		if (n > 0)
+			ring_skip(&c->ring, (int) n);
+		else if (n == -1 && errno == EINTR)
+			continue;
+		else if (n == -1 && (errno == EAGAIN ||
+				     errno == EWOULDBLOCK)) {
+			if (!wait)
+				return false;
+			/* non-blocking descriptor, wait a while for it */
+			p[0].fd = c->fd;
+			p[0].events = POLLOUT;
+			p[0].revents = 0;
+			if (poll(p, 1, RX_SLICE) <= 0)
+				return false;
+		} else {
+			__atomic_store_n(&c->err, true, __ATOMIC_RELEASE);
+			ring_skip(&c->ring, ring_count(&c->ring));
+		}
+	}
+
+	return true;
+}
+
+/*
+ *	Write the output of the transmit channels, which is due,
+ *	called with the lock held
+ */
+static void tx_run(void)
+{
+	tx_chan_t *c;
+	uint64_t t;
+	int i;
+
+	t = get_clock_us();
+	for (i = 0; i < TX_MAX; i++) {
+		c = &tx_chans[i];
+		if (!c->used)
+			continue;
+		__atomic_store_n(&c->kicked, false, __ATOMIC_SEQ_CST);
+		if (ring_count(&c->ring) == 0)
+			continue;
+		if (__atomic_exchange_n(&c->urgent, false, __ATOMIC_SEQ_CST) ||
+		    t >= __atomic_load_n(&c->due, __ATOMIC_ACQUIRE)) {
+			/* the receiver is busy, try again later */
+			if (!tx_send(c, false))
+				__atomic_store_n(&c->due,
+						 t + TX_DELAY * 1000,
+						 __ATOMIC_RELEASE);
+		}
+	}
+}
+
+/*
+ *	Time in ms until output of a transmit channel is due,
+ *	-1 if there is none, called with the lock held
+ */
+static int tx_timeout(void)
+{
+	tx_chan_t *c;
+	uint64_t t, due, next = UINT64_MAX;
+	int i;
+
+	for (i = 0; i < TX_MAX; i++) {
+		c = &tx_chans[i];
+		if (!c->used || ring_count(&c->ring) == 0)
+			continue;
+		due = __atomic_load_n(&c->due, __ATOMIC_ACQUIRE);
+		if (due < next)
+			next = due;
+	}
+
+	if (next == UINT64_MAX)
+		return -1;
+	t = get_clock_us();
+	return (next > t) ? (int) ((next - t + 999) / 1000) : 0;
+}
+
+/*
+ *	Thread waiting for input on the watched channels
+ *	and writing the output of the transmit channels
+ */
+static void *rx_thread(void *arg)
+{
+#ifdef __linux__
+	struct epoll_event ev[RX_MAX + 1];
+#else
+	struct pollfd p[RX_MAX + 1];
+	int ch[RX_MAX + 1];
+	rx_chan_t *c;
+	int k;
+#endif
+	char buf[64];
+	bool input;
+	int i, n, ms;
+
+	UNUSED(arg);
+
+	for (;;) {
+		pthread_mutex_lock(&rx_lock);
+		ms = tx_timeout();
+#ifdef __linux__
+		pthread_mutex_unlock(&rx_lock);
+		n = epoll_wait(rx_epfd, ev, RX_MAX + 1, ms);
+#else
+		p[0].fd = rx_pipe[0];
+		p[0].events = POLLIN;
+		p[0].revents = 0;
+		k = 1;
+		for (i = 0; i < RX_MAX; i++) {
+			c = &rx_chans[i];
+			if (c->used && !c->direct &&
+			    __atomic_load_n(&c->armed, __ATOMIC_ACQUIRE)) {
+				p[k].fd = c->fd;
+				p[k].events = POLLIN;
+				p[k].revents = 0;
+				ch[k++] = i;
+			}
+		}
+		pthread_mutex_unlock(&rx_lock);
+		n = poll(p, (nfds_t) k, ms);
+#endif
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			LOGE(TAG, "can't wait for input");
+			break;
+		}
+
+		input = false;
+		pthread_mutex_lock(&rx_lock);
+#ifdef __linux__
+		for (i = 0; i < n; i++) {
+			if (ev[i].data.u32 == RX_WAKE) {
+				while (read(rx_pipe[0], buf, sizeof(buf)) > 0)
+					;
+			} else {
+				rx_recv(&rx_chans[ev[i].data.u32]);
+				input = true;
+			}
+		}
+#else
+		if (p[0].revents)
+			while (read(rx_pipe[0], buf, sizeof(buf)) > 0)
+				;
+		for (i = 1; i < k; i++)
+			if (p[i].revents && rx_chans[ch[i]].fd == p[i].fd) {
+				rx_recv(&rx_chans[ch[i]]);
+				input = true;
+			}
+#endif
+		tx_run();
+		pthread_cond_broadcast(&rx_cond);
+		pthread_mutex_unlock(&rx_lock);
+
+		if (input)
+			wakeup_for_input();
+	}
+
+	return NULL;
+}
+
+#ifdef HAS_FORKSRV
+static void rx_fork(void);
+#endif
+
+/*
+ *	Start the reactor thread
+ */
+static bool rx_start(void)
+{
+	sigset_t set, old;
+	int err;
+#ifdef __linux__
+	struct epoll_event ev;
+#endif
+#ifdef HAS_FORKSRV
+	static bool registered;
+
+	if (!registered) {
+		fork_register(rx_fork);
+		registered = true;
+	}
+#endif
+
+	if (pipe(rx_pipe) == -1) {
+		LOGE(TAG, "can't create pipe");
+		return false;
+	}
+	fcntl(rx_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(rx_pipe[1], F_SETFL, O_NONBLOCK);
+
+#ifdef __linux__
+	if ((rx_epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		LOGE(TAG, "can't create epoll instance");
+		return false;
+	}
+	ev.events = EPOLLIN;
+	ev.data.u32 = RX_WAKE;
+	if (epoll_ctl(rx_epfd, EPOLL_CTL_ADD, rx_pipe[0], &ev) == -1) {
+		LOGE(TAG, "can't watch pipe");
+		return false;
+	}
+#endif
+
+	/* signals are handled by the CPU thread */
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &old);
+	err = pthread_create(&rx_tid, NULL, rx_thread, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (err != 0) {
+		LOGE(TAG, "can't create thread");
+		return false;
+	}
+	pthread_detach(rx_tid);
+
+	rx_started = true;
+	return true;
+}
+
+#ifdef HAS_FORKSRV
+/*
+ *	Called in the copy of the machine forked by the fork server,
+ *	which has no reactor thread, start a new one and watch the
+ *	channels again, stdin and stdout now are the connection of
+ *	the job, output left over from the parent is discarded
+ */
+static void rx_fork(void)
+{
+	int i;
+
+	pthread_mutex_init(&rx_lock, NULL);
+	pthread_cond_init(&rx_cond, NULL);
+#ifdef __linux__
+	close(rx_epfd);
+#endif
+	close(rx_pipe[0]);
+	close(rx_pipe[1]);
+	rx_started = false;
+	if (!rx_start())
+		return;
+
+	for (i = 0; i < RX_MAX; i++)
+		if (rx_chans[i].used && !rx_add(&rx_chans[i])) {
+			LOGE(TAG, "can't watch file descriptor %d",
+			     rx_chans[i].fd);
+			rx_chans[i].used = false;
+		}
+	for (i = 0; i < TX_MAX; i++)
+		if (tx_chans[i].used && !tx_add(&tx_chans[i]))
+			tx_chans[i].err = true;
+}
+#endif
+
+/*
+ *	Open a receive channel for file descriptor fd,
+ *	returns the channel or -1 on error
+ */
+int rx_open(int fd)
+{
+	rx_chan_t *c;
+	int ch;
+
+	if (!rx_started && !rx_start())
+		return -1;
+
+	pthread_mutex_lock(&rx_lock);
+	for (ch = 0; ch < RX_MAX && rx_chans[ch].used; ch++)
+		;
+	if (ch == RX_MAX) {
+		pthread_mutex_unlock(&rx_lock);
+		LOGE(TAG, "too many receive channels");
+		return -1;
+	}
+	c = &rx_chans[ch];
+	c->fd = fd;
+	if (!rx_add(c)) {
+		pthread_mutex_unlock(&rx_lock);
+		LOGE(TAG, "can't watch file descriptor %d", fd);
+		return -1;
+	}
+	c->used = true;
+	pthread_mutex_unlock(&rx_lock);
+
+	return ch;
+}
+
+/*
+ *	Close receive channel ch, must be called before its
+ *	file descriptor is closed
+ */
+void rx_close(int ch)
+{
+	rx_chan_t *c = &rx_chans[ch];
+
+	pthread_mutex_lock(&rx_lock);
+#ifdef __linux__
+	if (!c->direct)
+		epoll_ctl(rx_epfd, EPOLL_CTL_DEL, c->fd, NULL);
+#endif
+	c->used = false;
+	if (ch == rx_stdin_ch)
+		rx_stdin_ch = -1;
+	pthread_mutex_unlock(&rx_lock);
+}
+
+/*
+ *	Receive channel for stdin, opened when used the first time,
+ *	returns -1 if stdin can't be used
+ */
+int rx_stdin(void)
+{
+	if (rx_stdin_ch == -1)
+		rx_stdin_ch = rx_open(fileno(stdin));
+
+	return rx_stdin_ch;
+}
+
+/*
+ *	Check if input or the end of input is waiting on channel ch,
+ *	if not, watch it for input
+ */
+bool rx_ready(int ch)
+{
+	rx_chan_t *c = &rx_chans[ch];
+
+	if (c->direct || ring_count(&c->ring) > 0 ||
+	    __atomic_load_n(&c->eof, __ATOMIC_ACQUIRE))
+		return true;
+
+	if (!__atomic_load_n(&c->armed, __ATOMIC_ACQUIRE)) {
+		__atomic_store_n(&c->armed, true, __ATOMIC_RELEASE);
+		rx_watch(c);
+	}
+
+	return false;
+}
+
+/*
+ *	Get the next byte received on channel ch, returns RX_NONE
+ *	if no input is waiting, or RX_EOF at the end of input
+ */
+int rx_get(int ch)
+{
+	rx_chan_t *c = &rx_chans[ch];
+	BYTE data;
+	ssize_t n;
+
+	if (c->direct) {
+		n = read(c->fd, &data, 1);
+		if (n == 1)
+			return data;
+		if (n == 0 || (errno != EAGAIN && errno != EINTR))
+			return RX_EOF;
+		return RX_NONE;
+	}
+
+	if (ring_get(&c->ring, &data, 1) == 1)
+		return data;
+	if (__atomic_load_n(&c->eof, __ATOMIC_ACQUIRE))
+		return RX_EOF;
+
+	rx_ready(ch);
+	return RX_NONE;
+}
+
+/*
+ *	Wait until input is waiting on channel ch, for at most ms
+ *	milliseconds or forever if ms < 0, or until the CPU is stopped
+ *	with an error, returns true if input is waiting
+ */
+bool rx_wait(int ch, int ms)
+{
+	struct timespec ts;
+	uint64_t t, end;
+	bool ready;
+
+	end = get_clock_us() + (uint64_t) (ms < 0 ? 0 : ms) * 1000;
+
+	pthread_mutex_lock(&rx_lock);
+	while (!(ready = rx_ready(ch)) && cpu_error == NONE) {
+		t = get_clock_us();
+		if (ms >= 0 && t >= end)
+			break;
+		t += RX_SLICE * 1000;
+		if (ms >= 0 && t > end)
+			t = end;
+		ts.tv_sec = (time_t) (t / 1000000);
+		ts.tv_nsec = (long) (t % 1000000) * 1000;
+		pthread_cond_timedwait(&rx_cond, &rx_lock, &ts);
+	}
+	pthread_mutex_unlock(&rx_lock);
+
+	return ready;
+}
+
+/*
+ *	Open a transmit channel for file descriptor fd,
+ *	returns the channel or -1 on error
+ */
+int tx_open(int fd)
+{
+	tx_chan_t *c;
+	int ch;
+
+	if (!rx_started && !rx_start())
+		return -1;
+
+	pthread_mutex_lock(&rx_lock);
+	for (ch = 0; ch < TX_MAX && tx_chans[ch].used; ch++)
+		;
+	if (ch == TX_MAX) {
+		pthread_mutex_unlock(&rx_lock);
+		LOGE(TAG, "too many transmit channels");
+		return -1;
+	}
+	c = &tx_chans[ch];
+	c->fd = fd;
+	if (!tx_add(c)) {
+		pthread_mutex_unlock(&rx_lock);
+		LOGE(TAG, "can't send to file descriptor %d", fd);
+		return -1;
+	}
+	c->used = true;
+	pthread_mutex_unlock(&rx_lock);
+
+	return ch;
+}
+
+/*
+ *	Close transmit channel ch after writing the waiting output,
+ *	must be called before its file descriptor is closed
+ */
+void tx_close(int ch)
+{
+	tx_chan_t *c = &tx_chans[ch];
+
+	pthread_mutex_lock(&rx_lock);
+	if (!c->err)
+		tx_send(c, true);
+	c->used = false;
+	if (ch == tx_stdout_ch)
+		tx_stdout_ch = -1;
+	pthread_mutex_unlock(&rx_lock);
+}
+
+/*
+ *	Transmit channel for stdout, opened when used the first time,
+ *	returns -1 if stdout can't be used
+ */
+int tx_stdout(void)
+{
+	if (tx_stdout_ch == -1)
+		tx_stdout_ch = tx_open(fileno(stdout));
+
+	return tx_stdout_ch;
+}
+
+/*
+ *	Check if there is room for output in the ring of channel ch
+ */
+bool tx_ready(int ch)
+{
+	tx_chan_t *c = &tx_chans[ch];
+
+	return ring_space(&c->ring) > 0 ||
+	       __atomic_load_n(&c->err, __ATOMIC_ACQUIRE);
+}
+
+/*
+ *	Wake up the reactor thread for channel c, unless it
+ *	was woken up for it already
+ */
+static void tx_kick(tx_chan_t *c, bool urgent)
+{
+	if (urgent)
+		__atomic_store_n(&c->urgent, true, __ATOMIC_SEQ_CST);
+	if (!__atomic_exchange_n(&c->kicked, true, __ATOMIC_SEQ_CST))
+		rx_kick();
+}
+
+/*
+ *	Put a byte for output into the ring of channel ch, if the ring
+ *	is full wait until the thread wrote some output, or until the
+ *	CPU is stopped with an error, returns false if writing failed
+ */
+bool tx_put(int ch, BYTE data)
+{
+	tx_chan_t *c = &tx_chans[ch];
+	struct timespec ts;
+	uint64_t t;
+	int n;
+
+	if ((n = ring_space(&c->ring)) == 0) {
+		pthread_mutex_lock(&rx_lock);
+		while ((n = ring_space(&c->ring)) == 0 && !c->err &&
+		       cpu_error == NONE) {
+			tx_kick(c, true);
+			t = get_clock_us() + RX_SLICE * 1000;
+			ts.tv_sec = (time_t) (t / 1000000);
+			ts.tv_nsec = (long) (t % 1000000) * 1000;
+			pthread_cond_timedwait(&rx_cond, &rx_lock, &ts);
+		}
+		pthread_mutex_unlock(&rx_lock);
+		if (n == 0)	/* stopped, the byte is dropped */
+			return !__atomic_load_n(&c->err, __ATOMIC_ACQUIRE);
+	} else if (n == RING_SIZE)
+		__atomic_store_n(&c->due, get_clock_us() + TX_DELAY * 1000,
+				 __ATOMIC_RELEASE);
+
+	ring_put(&c->ring, &data, 1);
+	if (RING_SIZE - n + 1 >= TX_FLUSH)
+		tx_kick(c, true);
+	else if (n == RING_SIZE)
+		tx_kick(c, false);
+
+	return !__atomic_load_n(&c->err, __ATOMIC_ACQUIRE);
+}
+
+/*
+ *	Write the output waiting on channel ch now
+ */
+void tx_flush(int ch)
+{
+	pthread_mutex_lock(&rx_lock);
+	tx_send(&tx_chans[ch], true);
+	pthread_mutex_unlock(&rx_lock);
+}
+
+/*
+ *	Write the output waiting on all transmit channels now,
+ *	before something else writes to the same terminal
+ */
+void tx_flush_all(void)
+{
+	int i;
+
+	if (!rx_started)
+		return;
+
+	pthread_mutex_lock(&rx_lock);
+	for (i = 0; i < TX_MAX; i++)
+		if (tx_chans[i].used && !tx_chans[i].err)
+			tx_send(&tx_chans[i], true);
+	pthread_mutex_unlock(&rx_lock);
+}
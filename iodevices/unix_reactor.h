@@ -0,0 +1,68 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by agent
+ *
+ * This module contains a reactor thread, which receives the input
+ * for the serial devices into rings and sends their output from rings.
+ *
+ * History:
+ * 18-OCT-2026 first version
+ * 18-OCT-2026 output is sent from transmit channels
+ */
+
+/*
+ *	A device opens a receive channel for the file descriptor it
+ *	reads from. The reactor thread waits for input on all channels
+ *	with epoll (poll on systems without it) and reads what arrived
+ *	into the ring of the channel, so checking the receive status
+ *	only loads from memory and reading data takes it from the ring.
+ *	A channel is watched only after the CPU found its ring empty,
+ *	until input arrives. So a guest polling the status costs one
+ *	system call for every burst of input instead of one for every
+ *	poll, and nothing is taken away from stdin, while the machine
+ *	is stopped and the ICE reads from it. Descriptors which can't
+ *	be watched, like regular files, are always ready and are read
+ *	directly.
+ *
+ *	Output is put into the ring of a transmit channel and written
+ *	by the reactor thread with one writev() for all waiting bytes,
+ *	TX_DELAY ms after the first one, or when half of the ring is
+ *	filled. Sockets are written without blocking, so a slow client
+ *	fills the ring and the transmitter of the device reports busy,
+ *	instead of the CPU hanging in write(). Only if the guest writes
+ *	into a full ring the CPU waits for the thread.
+ */
+
+#ifndef UNIX_REACTOR_INC
+#define UNIX_REACTOR_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define RX_MAX		8	/* max. number of receive channels */
+
+#define RX_NONE		-1	/* rx_get(): no input available */
+#define RX_EOF		-2	/* rx_get(): end of input or error */
+
+#define TX_MAX		8	/* max. number of transmit channels */
+#define TX_DELAY	10	/* max. ms output waits in a ring */
+
+extern int rx_open(int fd);
+extern void rx_close(int ch);
+extern int rx_stdin(void);
+extern bool rx_ready(int ch);
+extern int rx_get(int ch);
+extern bool rx_wait(int ch, int ms);
+
+extern int tx_open(int fd);
+extern void tx_close(int ch);
+extern int tx_stdout(void);
+extern bool tx_ready(int ch);
+extern bool tx_put(int ch, BYTE data);
+extern void tx_flush(int ch);
+extern void tx_flush_all(void);
+
+#endif /* !UNIX_REACTOR_INC */
@@ -14,12 +14,15 @@
  * 16-JAN-2014 discard input at reset
  * 15-APR-2014 added some more c_cc's used on BSD systems
  * 24-FEB-2017 set line discipline only if fd 0 is a tty
+ * 18-OCT-2026 write buffered output at reset
  */
 
 #include <stdio.h>
 #include <unistd.h>
 #include <termios.h>
 
+#include "unix_reactor.h"
+
 struct termios old_term, new_term;
 
 static int init_flag;
@@ -60,6 +63,9 @@ void set_unix_terminal(void)
 
 void reset_unix_terminal(void)
 {
+	/* output of the machine comes before output of the ICE */
+	tx_flush_all();
+
 	if (!init_flag || !isatty(fileno(stdin)))
 		return;
 
@@ -26,6 +26,7 @@
 #define EXCLUDE_I8080	/* this was a Z80 machine */
 /*#define ALT_I8080*/	/* use alt. 8080 sim. primarily optimized for size */
 /*#define ALT_Z80*/	/* use alt. Z80 sim. primarily optimized for size */
+/*#define THR_Z80*/	/* use threaded Z80 sim. primarily optimized for speed */
 #define UNDOC_INST	/* compile undocumented instrs. (required by ALT_*) */
 #ifndef EXCLUDE_Z80
 /*#define FAST_BLOCK*/	/* much faster but not accurate Z80 block instr. */
@@ -37,6 +38,7 @@
 #define HISIZE	100	/* number of entries in history */
 #define SBSIZE	4	/* number of software breakpoints */
 #define WANT_HB		/* hardware breakpoint */
+#define WANT_PROF	/* execution profiler */
 #endif
 
 #define HAS_DISKS	/* uses disk images */
@@ -12,6 +12,7 @@
  *	       computers by treating 0xe000-0xefff as ROM.
  * 04-NOV-2019 (Udo Munk) add functions for direct memory access
  * 14-DEC-2024 (Thomas Eberhardt) added hardware breakpoint support
+ * 18-OCT-2026 (Udo Munk) breakpoints are checked in bitmaps
  */
 
 #ifndef SIMMEM_INC
@@ -43,8 +44,8 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && hb_test(hb_wr, addr))
+		hb_hit(addr, HB_WRITE);
 #endif
 
 	if ((addr & 0xf000) != 0xe000)
@@ -56,15 +57,8 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
-		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
-		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
-		}
-	}
+	if (hb_flag && !(cpu_bus & CPU_M1) && hb_test(hb_rd, addr))
+		hb_hit(addr, HB_READ);
 #endif
 
 	data = memory[addr];
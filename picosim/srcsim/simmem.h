@@ -11,6 +11,7 @@
  * 29-JUN-2024 implemented banked memory
  * 14-DEC-2024 added hardware breakpoint support
  * 12-MAR-2025 added more memory banks for RP2350
+ * 18-OCT-2026 breakpoints are checked in bitmaps
  */
 
 #ifndef SIMMEM_INC
@@ -36,6 +37,8 @@
 extern BYTE bnk0[65536], bnks[NUMSEG][SEGSIZ];
 extern BYTE selbnk, *curbnk;
 
+#define BP_BANK selbnk		/* bank of the breakpoints */
+
 extern void init_memory(void), reset_memory(void);
 
 /* Last page in memory is ROM and write protected. Some software */
@@ -52,8 +55,8 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && hb_test(hb_wr, addr))
+		hb_hit(addr, HB_WRITE);
 #endif
 
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
@@ -69,15 +72,8 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
-		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
-		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
-		}
-	}
+	if (hb_flag && !(cpu_bus & CPU_M1) && hb_test(hb_rd, addr))
+		hb_hit(addr, HB_READ);
 #endif
 
 	if ((selbnk == 0) || (addr >= SEGSIZ))
@@ -20,6 +20,8 @@ static inline uint64_t get_clock_us(void)
 	return to_us_since_boot(get_absolute_time());
 }
 
+static inline void sleep_for_input(unsigned long time) { sleep_us(time); }
+
 extern bool get_cmdline(char *buf, int len);
 
 #endif /* !SIMPORT_INC */
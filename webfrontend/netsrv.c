@@ -5,6 +5,10 @@
  *
  * History:
  * 12-JUL-2018	1.0	Initial Release
+ * 18-OCT-2026	1.1	Lock-free rings instead of SysV message queues
+ * 18-OCT-2026	1.2	Wake up an idle CPU on input
+ * 18-OCT-2026	1.3	Buffered output of the stream devices sent by a thread
+ * 18-OCT-2026	1.4	Framed messages of the 88ACC, waiting without polling
  */
 
 /**
@@ -13,13 +17,11 @@
 
 #include <unistd.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <string.h>
 #include <time.h>
 #include <fcntl.h>
-#include <errno.h>
 #include <dirent.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
 
@@ -45,6 +47,7 @@
 #include "cromemco-tu-art.h"
 #endif
 #include "diskmanager.h"
+#include "spscring.h"
 
 #ifdef HAS_NETSERVER
 
@@ -53,12 +56,8 @@ static const char *TAG = "netsrv";
 
 #define MAX_WS_CLIENTS (_DEV_MAX)
 
-typedef struct msgbuf_s {
-	long mtype;
-	unsigned char mtext[128];
-} msgbuf_t;
-
-static msgbuf_t msg;
+#define FLUSH_MS	10		/* max. delay of buffered output */
+#define FLUSH_SIZE	(RING_SIZE / 2)	/* buffered output sent at once */
 
 typedef struct ws_client {
 	struct mg_connection *conn;
@@ -66,7 +65,11 @@ typedef struct ws_client {
 } ws_client_t;
 
 static struct {
-	int queue;
+	bool queue;		/* queue provisioned */
+	spsc_ring_t ring;	/* queue from the websocket to the CPU */
+	spsc_ring_t out;	/* output from the CPU to the websocket */
+	pthread_mutex_t mutex;	/* for waiting on a message in the queue */
+	pthread_cond_t cond;
 	ws_client_t ws_client;
 	void (*cbfunc)(BYTE *);
 } dev[MAX_WS_CLIENTS];
@@ -92,6 +95,12 @@ static const char *dev_name[] = {
 
 static int last_error = 0; //TODO: replace
 
+static pthread_t sender;	/* thread sending the buffered output */
+static pthread_mutex_t sender_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sender_cond = PTHREAD_COND_INITIALIZER;
+static bool sender_run;		/* sender thread keeps running */
+static bool sender_kick;	/* buffered output to send now */
+
 /*
 extern int reset;
 extern int power;
@@ -103,7 +112,7 @@ extern void quit_callback(void);
  */
 bool net_device_alive(net_device_t device)
 {
-	return dev[device].queue >= 0;
+	return __atomic_load_n(&dev[device].queue, __ATOMIC_ACQUIRE);
 }
 
 void net_device_service(net_device_t device, void (*cbfunc)(BYTE *data))
@@ -112,32 +121,97 @@ void net_device_service(net_device_t device, void (*cbfunc)(BYTE *data))
 }
 
 /**
- * Assumes the data is:
- *	TEXT	if only a single byte
- *	BINARY	if there are multiple bytes
- *	TTY & LPT are always BINARY now
+ * Check if the device is a byte stream, its output is buffered
  */
-void net_device_send(net_device_t device, char *msg, int len)
+static bool net_device_stream(net_device_t device)
 {
-	int op_code;
-
 	switch (device) {
 	case DEV_TTY:
 	case DEV_TTY2:
 	case DEV_TTY3:
 	case DEV_PTR:
 	case DEV_LPT:
-		op_code = MG_WEBSOCKET_OPCODE_BINARY;
-		break;
+		return true;
 	default:
-		op_code = (len == 1) ? MG_WEBSOCKET_OPCODE_TEXT : MG_WEBSOCKET_OPCODE_BINARY;
-		break;
+		return false;
+	}
+}
+
+/**
+ * Check if the device receives messages, every message is put
+ * into the queue with its length in front
+ */
+static bool net_device_framed(net_device_t device)
+{
+	return device == DEV_88ACC;
+}
+
+/**
+ * Wake up a thread waiting for a message of the device
+ */
+static void net_device_wakeup(net_device_t device)
+{
+	pthread_mutex_lock(&dev[device].mutex);
+	pthread_cond_broadcast(&dev[device].cond);
+	pthread_mutex_unlock(&dev[device].mutex);
+}
+
+/**
+ * Wake up the sender thread to send the buffered output now
+ */
+static void net_sender_kick(void)
+{
+	pthread_mutex_lock(&sender_mutex);
+	sender_kick = true;
+	pthread_cond_signal(&sender_cond);
+	pthread_mutex_unlock(&sender_mutex);
+}
+
+/**
+ * Assumes the data is:
+ *	TEXT	if only a single byte
+ *	BINARY	if there are multiple bytes
+ *	TTY & LPT are always BINARY now
+ *
+ * The output of TTY & LPT is put into a buffer and sent by the
+ * sender thread, after FLUSH_MS, when FLUSH_SIZE bytes are waiting
+ * or a line is complete, so that the CPU doesn't wait for the socket.
+ * Only if the buffer is full the CPU waits for the sender thread.
+ */
+void net_device_send(net_device_t device, char *msg, int len)
+{
+	int op_code, n;
+	bool kick = false;
+
+	if (!net_device_alive(device))
+		return;
+
+	if (net_device_stream(device)) {
+		while (len > 0 && net_device_alive(device)) {
+			if ((n = ring_space(&dev[device].out)) == 0) {
+				net_sender_kick();
+				sleep_for_ms(1);
+				continue;
+			}
+			if (n > len)
+				n = len;
+			ring_put(&dev[device].out, (const BYTE *) msg, n);
+			if (memchr(msg, '\n', n) != NULL)
+				kick = true;
+			msg += n;
+			len -= n;
+		}
+		if (kick || RING_SIZE - ring_space(&dev[device].out)
+			    >= FLUSH_SIZE)
+			net_sender_kick();
+		return;
 	}
 
-	if (dev[device].queue >= 0)
-		mg_websocket_write(dev[device].ws_client.conn,
-				   op_code,
-				   msg, len);
+	op_code = (len == 1) ? MG_WEBSOCKET_OPCODE_TEXT : MG_WEBSOCKET_OPCODE_BINARY;
+
+	mg_websocket_write(dev[device].ws_client.conn,
+			   op_code,
+			   msg, len);
 }
 
 /**
@@ -148,32 +222,42 @@ void net_device_send(net_device_t device, char *msg, int len)
  */
 int net_device_get(net_device_t device)
 {
-	ssize_t res;
-	msgbuf_t msg;
-
-	if (dev[device].queue >= 0) {
-		res = msgrcv(dev[device].queue, &msg, 2, 1L, IPC_NOWAIT);
-		LOGD(TAG, "GET: device[%d] res[%ld] msg[%ld, %s]",
-		     device, res, msg.mtype, msg.mtext);
-		if (res == 2)
-			return msg.mtext[0];
+	BYTE c;
+
+	if (net_device_alive(device) && ring_get(&dev[device].ring, &c, 1)) {
+		LOGD(TAG, "GET: device[%d] char[%02x]", device, c);
+		return c;
 	}
 
 	return -1;
 }
 
+/**
+ * Waits for the next message in the queue, or until it is closed,
+ * copies up to len bytes of the message and removes all of it
+ * returns:
+ *	n	length of the message
+ *	-1	if the queue is not open
+ */
 int net_device_get_data(net_device_t device, char *dst, int len)
 {
-	ssize_t res;
-	msgbuf_t msg;
+	WORD n;
+	int k;
 
-	if (dev[device].queue >= 0) {
-		res = msgrcv(dev[device].queue, &msg, len, 1L, MSG_NOERROR);
-		memcpy((void *)dst, (void *)msg.mtext, res);
-		return res;
-	}
+	pthread_mutex_lock(&dev[device].mutex);
+	while (ring_count(&dev[device].ring) == 0 && net_device_alive(device))
+		pthread_cond_wait(&dev[device].cond, &dev[device].mutex);
+	pthread_mutex_unlock(&dev[device].mutex);
 
-	return -1;
+	if (!net_device_alive(device))
+		return -1;
+
+	ring_get(&dev[device].ring, (BYTE *) &n, sizeof(n));
+	k = (n < len) ? n : len;
+	ring_get(&dev[device].ring, (BYTE *) dst, k);
+	ring_skip(&dev[device].ring, n - k);
+
+	return n;
 }
 
 /**
@@ -184,20 +268,48 @@ int net_device_get_data(net_device_t device, char *dst, int len)
  */
 int net_device_poll(net_device_t device)
 {
-	ssize_t res;
-	msgbuf_t msg;
-
-	if (dev[device].queue >= 0) {
-		res = msgrcv(dev[device].queue, &msg, 1, 1L, IPC_NOWAIT);
-		LOGV(TAG, "POLL: device[%d] res[%ld] errno[%d]", device, res, errno);
-		if (res == -1 && errno == E2BIG) {
-			LOGD(TAG, "CHARACTERS WAITING");
-			return 1;
-		}
+	if (net_device_alive(device) && ring_peek(&dev[device].ring) != -1) {
+		LOGV(TAG, "POLL: device[%d] CHARACTERS WAITING", device);
+		return 1;
 	}
 	return 0;
 }
 
+/**
+ * Put the data received by the websocket into the queue, the
+ * messages of a framed device are put as a whole or dropped
+ */
+static int net_device_put(net_device_t d, const char *data, int len)
+{
+	BYTE buf[RING_SIZE];
+	WORD k;
+	int n;
+
+	if (net_device_framed(d)) {
+		if (len + (int) sizeof(k) > ring_space(&dev[d].ring)) {
+			LOGW(TAG, "%s Overflow, message of %d bytes dropped",
+			     dev_name[d], len);
+			return 0;
+		}
+		k = (WORD) len;
+		memcpy(buf, &k, sizeof(k));
+		memcpy(buf + sizeof(k), data, len);
+		ring_put(&dev[d].ring, buf, len + sizeof(k));
+		net_device_wakeup(d);
+		return 1;
+	}
+
+	n = ring_put(&dev[d].ring, (const BYTE *) data, len);
+
+	if (n > 0)
+		wakeup_for_input();
+	if (n != len) {
+		LOGW(TAG, "%s Overflow", dev_name[d]);
+		return 0;
+	}
+	return 1;
+}
+
 request_t *get_request(const HttpdConnection_t *conn)
 {
 	static request_t req;
@@ -577,7 +689,6 @@ static int WebSocketConnectHandler(const HttpdConnection_t *conn, void *device)
 {
 	struct mg_context *ctx = mg_get_context(conn);
 	int reject = 1;
-	int res;
 	net_device_t d = *(net_device_t *) device;
 
 	mg_lock_context(ctx);
@@ -596,11 +707,9 @@ static int WebSocketConnectHandler(const HttpdConnection_t *conn, void *device)
 		case DEV_DZLR:
 		case DEV_88ACC:
 		case DEV_D7AIO:
-			res = msgget(IPC_PRIVATE, 0644 | IPC_CREAT); //TODO: check flags
-			if (res < 0)
-				perror("msgget()");
-			else
-				dev[d].queue = res;
+			ring_reset(&dev[d].ring);
+			ring_reset(&dev[d].out);
+			__atomic_store_n(&dev[d].queue, true, __ATOMIC_RELEASE);
 			break;
 		default:
 			break;
@@ -686,28 +795,13 @@ static int WebsocketDataHandler(HttpdConnection_t *conn,
 				     (int) len);
 				return 0;
 			}
-			msg.mtype = 1L;
-			msg.mtext[0] = data[0];
-			msg.mtext[1] = '\0';
-			if (msgsnd(dev[d].queue, &msg, 2, IPC_NOWAIT)) {
-				if (errno == EAGAIN) {
-					LOGW(TAG, "%s Overflow", dev_name[d]);
-				} else
-					perror("msgsnd()");
+			if (!net_device_put(d, data, 1))
 				return 0;
-			};
 			break;
 		case DEV_88ACC:
 			// LOGI(TAG, "rec: %d, %d", (int)len, (BYTE)*data);
-			msg.mtype = 1L;
-			memcpy(msg.mtext, data, len);
-			if (msgsnd(dev[d].queue, &msg, len, IPC_NOWAIT)) {
-				if (errno == EAGAIN) {
-					LOGW(TAG, "%s Overflow", dev_name[d]);
-				} else
-					perror("msgsnd()");
+			if (!net_device_put(d, data, (int) len))
 				return 0;
-			};
 			break;
 		default:
 			break;
@@ -728,16 +822,8 @@ static int WebsocketDataHandler(HttpdConnection_t *conn,
 				     (int) len);
 				return 0;
 			}
-			msg.mtype = 1L;
-			msg.mtext[0] = data[0];
-			msg.mtext[1] = '\0';
-			if (msgsnd(dev[d].queue, &msg, 2, IPC_NOWAIT)) {
-				if (errno == EAGAIN) {
-					LOGW(TAG, "%s Overflow", dev_name[d]);
-				} else
-					perror("msgsnd()");
+			if (!net_device_put(d, data, 1))
 				return 0;
-			};
 			break;
 		default:
 			break;
@@ -760,19 +846,79 @@ static void WebSocketCloseHandler(const HttpdConnection_t *conn, void *device)
 
 	LOGI(TAG, "WS CLIENT CLOSED %s", dev_name[d]);
 
-	if (dev[d].queue >= 0 && msgctl(dev[d].queue, IPC_RMID, NULL) == -1)
-		perror("msgctl()");
+	if (net_device_alive(d) && ring_overflow(&dev[d].ring))
+		LOGW(TAG, "%s lost %lu characters", dev_name[d],
+		     ring_overflow(&dev[d].ring));
 
-	LOGD(TAG, "Message queue closed (%d) [%08X]", d, dev[d].queue);
+	__atomic_store_n(&dev[d].queue, false, __ATOMIC_RELEASE);
+	net_device_wakeup(d);
 
-	dev[d].queue = -1;
+	LOGD(TAG, "Message queue closed (%d)", d);
 }
 
 static struct mg_context *ctx = NULL;
 
+/**
+ * Send the buffered output of a stream device in one frame
+ */
+static void net_device_flush(net_device_t d)
+{
+	static BYTE buf[RING_SIZE];
+	int n;
+
+	if (!net_device_alive(d) || (n = ring_get(&dev[d].out, buf, RING_SIZE)) == 0)
+		return;
+
+	mg_lock_context(ctx);
+	if (dev[d].ws_client.conn != NULL)
+		mg_websocket_write(dev[d].ws_client.conn,
+				   MG_WEBSOCKET_OPCODE_BINARY,
+				   (char *) buf, n);
+	mg_unlock_context(ctx);
+}
+
+/**
+ * Thread sending the buffered output of the stream devices,
+ * every FLUSH_MS or when kicked by net_device_send()
+ */
+static void *net_sender(void *arg)
+{
+	struct timespec ts;
+	int i;
+
+	UNUSED(arg);
+
+	while (__atomic_load_n(&sender_run, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&sender_mutex);
+		if (!sender_kick) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += FLUSH_MS * 1000000L;
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&sender_cond, &sender_mutex, &ts);
+		}
+		sender_kick = false;
+		pthread_mutex_unlock(&sender_mutex);
+
+		for (i = 0; i < MAX_WS_CLIENTS; i++)
+			if (net_device_stream((net_device_t) i))
+				net_device_flush((net_device_t) i);
+	}
+
+	return NULL;
+}
+
 void stop_net_services(void)
 {
 	if (ctx != NULL) {
+		if (__atomic_load_n(&sender_run, __ATOMIC_ACQUIRE)) {
+			__atomic_store_n(&sender_run, false, __ATOMIC_RELEASE);
+			net_sender_kick();
+			pthread_join(sender, NULL);
+		}
+
 		InformWebsockets(ctx);
 
 		/* Stop the server */
@@ -822,8 +968,11 @@ int start_net_services(int port)
 	const struct mg_option *opts;
 #endif
 
-	for (i = 0; i < MAX_WS_CLIENTS; i++)
-		dev[i].queue = -1;
+	for (i = 0; i < MAX_WS_CLIENTS; i++) {
+		dev[i].queue = false;
+		pthread_mutex_init(&dev[i].mutex, NULL);
+		pthread_cond_init(&dev[i].cond, NULL);
+	}
 
 	atexit(stop_net_services);
 
@@ -846,6 +995,16 @@ int start_net_services(int port)
 		return EXIT_FAILURE;
 	}
 
+	/* Start the thread sending the buffered output */
+	__atomic_store_n(&sender_run, true, __ATOMIC_RELEASE);
+	if (pthread_create(&sender, NULL, net_sender, NULL)) {
+		LOGW(TAG, "Cannot create the sender thread.");
+		__atomic_store_n(&sender_run, false, __ATOMIC_RELEASE);
+		mg_stop(ctx);
+		ctx = NULL;
+		return EXIT_FAILURE;
+	}
+
 	//TODO: sort out all the paths for the handlers
 	mg_set_request_handler(ctx, "/system", 	SystemHandler, 	0);
 	mg_set_request_handler(ctx, "/conf", 	ConfigHandler,	(void *) "conf");
@@ -5,9 +5,6 @@
  * Copyright (C) 2024 by Thomas Eberhardt
  */
 
-#ifndef ALT8080_INC
-#define ALT8080_INC
-
 /*
  *	This module builds the 8080 central processing unit.
  *	The opcode where PC points to is fetched from the memory
@@ -756,7 +753,7 @@
 				/* else wait for INT or user interrupt */
 				while (!int_int &&
 				       (cpu_state == ST_CONTIN_RUN)) {
-					sleep_for_ms(1);
+					idle_wait();
 				}
 			}
 #ifdef BUS_8080
@@ -776,7 +773,7 @@
 				while (!(cpu_state & ST_RESET)) {
 					fp_clock++;
 					fp_sampleData();
-					sleep_for_ms(1);
+					idle_wait();
 					if (cpu_error != NONE)
 						break;
 				}
@@ -786,7 +783,7 @@
 				while (!int_int && !(cpu_state & ST_RESET)) {
 					fp_clock++;
 					fp_sampleData();
-					sleep_for_ms(1);
+					idle_wait();
 					if (cpu_error != NONE)
 						break;
 				}
@@ -1565,5 +1562,3 @@
 #undef C_SHIFT
 
 }
-
-#endif /* !ALT8080_INC */
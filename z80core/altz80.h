@@ -5,9 +5,6 @@
  * Copyright (C) 2024 by Thomas Eberhardt
  */
 
-#ifndef ALTZ80_INC
-#define ALTZ80_INC
-
 /*
  *	This module builds the Z80 central processing unit.
  *	The opcode where PC points to is fetched from the memory
@@ -818,7 +815,7 @@ next_opcode:
 				/* else wait for INT, NMI or user interrupt */
 				while (!int_int && !int_nmi &&
 				       (cpu_state == ST_CONTIN_RUN)) {
-					sleep_for_ms(1);
+					idle_wait();
 					R += 99;
 				}
 			}
@@ -839,7 +836,7 @@ next_opcode:
 				while (!int_nmi && !(cpu_state & ST_RESET)) {
 					fp_clock++;
 					fp_sampleData();
-					sleep_for_ms(1);
+					idle_wait();
 					R += 99;
 					if (cpu_error != NONE)
 						break;
@@ -851,7 +848,7 @@ next_opcode:
 				       !(cpu_state & ST_RESET)) {
 					fp_clock++;
 					fp_sampleData();
-					sleep_for_ms(1);
+					idle_wait();
 					R += 99;
 					if (cpu_error != NONE)
 						break;
@@ -2448,5 +2445,3 @@ next_opcode:
 #undef N_SHIFT
 #undef C_SHIFT
 }
-
-#endif /* !ALTZ80_INC */
@@ -0,0 +1,311 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 1987-2024 by Udo Munk
+ * Copyright (C) 2024 by Thomas Eberhardt
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This is the CPU loop of the 8080 simulation, moved from
+ *	sim8080.c into this file so that it can be compiled twice.
+ *	It is included by sim8080.c as the body of cpu_8080_fast()
+ *	and, if the ICE is compiled in, of cpu_8080_debug() with
+ *	CPU_HOOKS defined. Only the latter records the history,
+ *	counts t-states, profiles and checks for breakpoints, the
+ *	ICE runs it only if one of these is used.
+ */
+
+{
+	Tstates_t T_max, T_dma;
+	uint64_t t1, t2;
+	unsigned long tdiff;
+
+#ifdef FRONTPANEL
+	if (F_flag) {
+		fp_clock++;
+		fp_sampleData();
+	}
+#endif
+
+	T_max = T + tmax;
+	t1 = get_clock_us();
+
+	do {
+
+#ifdef CPU_HOOKS
+
+#ifdef HISIZE
+		/* write history */
+		his[h_next].h_cpu = I8080;
+		his[h_next].h_addr = PC;
+		his[h_next].h_af = (A << 8) + F;
+		his[h_next].h_bc = (B << 8) + C;
+		his[h_next].h_de = (D << 8) + E;
+		his[h_next].h_hl = (H << 8) + L;
+		his[h_next].h_sp = SP;
+		h_next++;
+		if (h_next == HISIZE) {
+			h_flag = true;
+			h_next = 0;
+		}
+#endif
+
+#ifdef WANT_TIM
+		/* check for start address of runtime measurement */
+		if (PC == t_start && !t_flag) {
+			t_flag = true;		     /* turn measurement on */
+			t_states_s = t_states_e = T; /* initialize markers */
+		}
+#endif
+
+#endif /* CPU_HOOKS */
+
+		/* CPU DMA bus request handling */
+		if (bus_mode) {
+
+			if (!bus_request && (bus_mode != BUS_DMA_CONTINUOUS)) {
+				if (dma_bus_master) {
+					/* hand control to the DMA bus master
+					   without BUS_ACK */
+					T_dma = (*dma_bus_master)(0);
+					T += T_dma;
+					if (cpu_freq)
+						cpu_time += (1000000 * T_dma) /
+							    cpu_freq;
+				}
+			}
+
+			if (bus_request) {		/* DMA bus request */
+#ifdef FRONTPANEL
+				if (F_flag) {
+					fp_clock += 1000;
+					fp_sampleData();
+				}
+#endif
+				if (dma_bus_master) {
+					/* hand control to the DMA bus master
+					   with BUS_ACK */
+					T_dma = (*dma_bus_master)(1);
+					T += T_dma;
+					if (cpu_freq)
+						cpu_time += (1000000 * T_dma) /
+							    cpu_freq;
+				}
+				/* FOR NOW -
+				   MAY BE NEED A PRIORITY SYSTEM LATER */
+				bus_request = 0;
+				if (bus_mode == BUS_DMA_CONTINUOUS) {
+					end_bus_request();
+				}
+#ifdef FRONTPANEL
+				if (F_flag) {
+					fp_clock += 1000;
+					fp_sampleData();
+				}
+#endif
+			}
+		}
+
+		/* CPU interrupt handling */
+		if (int_int) {
+			if (IFF != 3)
+				goto leave;
+			if (int_protection)	/* protect first instruction */
+				goto leave;	/* after EI */
+
+			IFF = 0;
+
+#ifdef BUS_8080
+			if (!(cpu_bus & CPU_HLTA)) {
+				cpu_bus = CPU_WO | CPU_M1 | CPU_INTA;
+#endif
+#ifdef FRONTPANEL
+				if (F_flag) {
+					fp_clock += 1000;
+					fp_led_data = (int_data != -1) ?
+						      (BYTE) int_data : 0xff;
+					fp_sampleData();
+					wait_int_step();
+					if (cpu_state & ST_RESET)
+						goto leave;
+				}
+#endif
+#ifdef SIMPLEPANEL
+				fp_led_data = (int_data != -1) ?
+					      (BYTE) int_data : 0xff;
+#endif
+#ifdef BUS_8080
+			}
+			cpu_bus = CPU_STACK;
+#endif
+#ifdef FRONTPANEL
+			if (F_flag) {
+				fp_clock++;
+				fp_sampleLightGroup(0, 0);
+			}
+#endif
+
+			memwrt(--SP, PC >> 8);
+			memwrt(--SP, PC);
+
+#ifdef FRONTPANEL
+			if (F_flag && (cpu_state & ST_RESET))
+				goto leave;
+#endif
+
+			switch (int_data) {
+			case 0xc7: /* RST 00H */
+				PC = 0;
+				break;
+			case 0xcf: /* RST 08H */
+				PC = 8;
+				break;
+			case 0xd7: /* RST 10H */
+				PC = 0x10;
+				break;
+			case 0xdf: /* RST 18H */
+				PC = 0x18;
+				break;
+			case 0xe7: /* RST 20H */
+				PC = 0x20;
+				break;
+			case 0xef: /* RST 28H */
+				PC = 0x28;
+				break;
+			case 0xf7: /* RST 30H */
+				PC = 0x30;
+				break;
+			case 0xff: /* RST 38H */
+				PC = 0x38;
+				break;
+			case -1: /* no data = 0xff on S100 bus */
+				PC = 0x38;
+				break;
+			default: /* unsupported bus data */
+				cpu_error = INTERROR;
+				cpu_state = ST_STOPPED;
+				continue;
+			}
+			T += 11;
+			int_int = false;
+			int_data = -1;
+#ifdef FRONTPANEL
+			if (F_flag)
+				m1_step = true;
+#endif
+		}
+	leave:
+
+#ifdef BUS_8080
+		/* M1 opcode fetch */
+		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
+#endif
+
+#if defined(CPU_HOOKS) && defined(WANT_BP)
+		/* check for execute breakpoint, stop before the
+		   instruction, unless the ICE continues from it */
+		if (hb_test(hb_ex, PC) && PC != hb_skip) {
+			hb_hit(PC, HB_EXEC);
+			cpu_error = OPHALT;
+			cpu_state = ST_STOPPED;
+			continue;
+		}
+		hb_skip = -1;
+#endif
+#if defined(CPU_HOOKS) && defined(WANT_PROF)
+		if (p_flag)		/* profile the instruction */
+			prof_pre();
+#endif
+
+		int_protection = false;
+#ifndef ALT_I8080
+		T += (*op_sim[memrdr(PC++)])();	/* execute next opcode */
+#else
+#include "alt8080.h"
+#endif
+
+#ifdef CPU_HOOKS
+
+#ifdef WANT_TIM
+					/* do runtime measurement */
+		if (t_flag) {
+			t_states_e = T; /* set end marker for this opcode */
+			if (PC == t_end)	/* check for end address */
+				t_flag = false;	/* if reached, switch off */
+		}
+#endif
+
+#ifdef WANT_PROF
+		if (p_flag)
+			prof_post();
+#endif
+
+#ifdef WANT_BP
+		if (hb_trig) {	/* read or write breakpoint hit */
+			cpu_error = OPHALT;
+			cpu_state = ST_STOPPED;
+		}
+#endif
+
+#endif /* CPU_HOOKS */
+
+#ifdef WANT_GUI
+		check_gui_break();
+#endif
+
+					/* run the device events,
+					   which are due */
+		if (T >= ev_next)
+			ev_run();
+
+					/* adjust CPU speed and
+					   update CPU accounting */
+		if (T >= T_max) {
+			T_max = T + tmax;
+			t2 = get_clock_us();
+			tdiff = t2 - t1;
+			if (f_value && !cpu_needed && tdiff < 10000L) {
+				sleep_for_us(10000L - tdiff);
+				t2 = get_clock_us();
+				tdiff = t2 - t1;
+			}
+			cpu_time += tdiff - (io_time + wait_time);
+			total_io_time += io_time;
+			total_wait_time += wait_time;
+			io_time = wait_time = 0;
+			if (cpu_time)
+				cpu_freq = (T * 1000000) / cpu_time;
+			t1 = t2;
+		}
+
+	} while (cpu_state == ST_CONTIN_RUN);
+
+					/* update CPU accounting
+					   if necessary */
+	if (T > T_max - tmax) {
+		cpu_time += (get_clock_us() - t1) - (io_time + wait_time);
+		total_io_time += io_time;
+		total_wait_time += wait_time;
+		io_time = wait_time = 0;
+		if (cpu_time)
+			cpu_freq = (T * 1000000) / cpu_time;
+	}
+
+#ifdef BUS_8080
+	if (!(cpu_bus & CPU_INTA))
+		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
+#endif
+#ifdef FRONTPANEL
+	if (F_flag) {
+		fp_led_address = PC;
+		fp_led_data = getmem(PC);
+		fp_clock++;
+		fp_sampleData();
+	}
+#endif
+#ifdef SIMPLEPANEL
+	fp_led_address = PC;
+	fp_led_data = getmem(PC);
+#endif
+}
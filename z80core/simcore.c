@@ -18,6 +18,7 @@
 #include "simport.h"
 #include "simmem.h"
 #include "simio.h"
+#include "simidle.h"
 #ifndef EXCLUDE_I8080
 #include "sim8080.h"
 #endif
@@ -215,6 +216,15 @@ void report_cpu_error(void)
 	case INTERROR:
 		LOGW(TAG, "Unsupported bus data during INT: 0x%02x", int_data);
 		break;
+	case BUDGET:
+		LOG(TAG, "T-state budget used up at 0x%04x\r\n", PC);
+		break;
+	case IDLETIME:
+		LOG(TAG, "CPU idle for %d ms at 0x%04x\r\n", I_value, PC);
+		break;
+	case INPUTEOF:
+		LOG(TAG, "End of input at 0x%04x\r\n", PC);
+		break;
 	case POWEROFF:
 		LOG(TAG, "System powered off\r\n");
 		break;
@@ -225,21 +235,25 @@ void report_cpu_error(void)
 }
 
 /*
- * print some execution statistics
+ * print some execution statistics, in batch mode to stderr,
+ * so that they don't get mixed with the console output
  */
 void report_cpu_stats(void)
 {
 	unsigned freq;
+	FILE *fp = B_flag ? stderr : stdout;
 
 	if (cpu_time)
 	{
 		freq = (unsigned) (cpu_freq / 10000);
-		printf("I/O ran for %" PRIu64 " ms, ", total_io_time / 1000);
-		printf("waited for %" PRIu64 " ms\n", total_wait_time / 1000);
-		printf("CPU executed %" PRIu64 " t-states ", T);
-		printf("in %" PRIu64 " ms\n", cpu_time / 1000);
-		printf("Clock frequency %u.%02u MHz\n",
-		       freq / 100, freq % 100);
+		fprintf(fp, "I/O ran for %" PRIu64 " ms, ",
+			total_io_time / 1000);
+		fprintf(fp, "waited for %" PRIu64 " ms\n",
+			total_wait_time / 1000);
+		fprintf(fp, "CPU executed %" PRIu64 " t-states ", T);
+		fprintf(fp, "in %" PRIu64 " ms\n", cpu_time / 1000);
+		fprintf(fp, "Clock frequency %u.%02u MHz\n",
+			freq / 100, freq % 100);
 	}
 }
 
@@ -273,6 +287,9 @@ BYTE io_in(BYTE addrl, BYTE addrh)
 		io_data = IO_DATA_UNUSED;
 	}
 
+	/* check for a polling loop */
+	idle_poll(addrl, io_data);
+
 #ifdef BUS_8080
 	cpu_bus = CPU_WO | CPU_INP;
 #endif
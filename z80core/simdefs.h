@@ -36,6 +36,14 @@
 #if defined(EXCLUDE_Z80) && DEF_CPU != I8080
 #error "DEF_CPU=Z80 and no Z80 simulation included"
 #endif
+#ifdef THR_Z80
+#ifndef __GNUC__
+#error "THR_Z80 requires a compiler supporting GNU C extensions"
+#endif
+#ifndef ALT_Z80
+#define ALT_Z80		/* threaded Z80 sim. uses the alt. register file */
+#endif
+#endif
 #if (defined(ALT_I8080) || defined(ALT_Z80)) && !defined(UNDOC_INST)
 #error "UNDOC_INST required for alternate simulators"
 #endif
@@ -83,6 +91,9 @@
 #define OPTRAP4		8	/* illegal 4 byte op-code trap */
 #define USERINT		9	/* user interrupt */
 #define INTERROR	10	/* unsupported bus data on interrupt */
+#define BUDGET		11	/* t-state budget used up */
+#define IDLETIME	12	/* CPU idle for too long */
+#define INPUTEOF	13	/* end of the input in batch mode */
 #define POWEROFF	255	/* CPU off, no error */
 
 typedef uint16_t WORD;		/* 16 bit unsigned */
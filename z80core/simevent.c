@@ -0,0 +1,148 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This module implements the event scheduler for the devices
+ *	of the simulated machines, see simevent.h
+ */
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simevent.h"
+
+#include "log.h"
+static const char *TAG = "event";
+
+Tstates_t ev_next = EV_NEVER;	/* t-state of the next event */
+
+static event_t *ev_heap[EV_MAX + 1]; /* heap of the events, from 1 */
+static int ev_cnt;		/* number of scheduled events */
+static unsigned long ev_seq;	/* sequence number of the next event */
+
+/*
+ *	Check if event a is due before event b
+ */
+static inline bool ev_before(event_t *a, event_t *b)
+{
+	return a->ev_time < b->ev_time ||
+	       (a->ev_time == b->ev_time && a->ev_seq < b->ev_seq);
+}
+
+/*
+ *	Put event e at index i of the heap
+ */
+static inline void ev_put(int i, event_t *e)
+{
+	ev_heap[i] = e;
+	e->ev_idx = i;
+}
+
+/*
+ *	Move the event at index i to its place in the heap
+ */
+static void ev_sift(int i)
+{
+	register event_t *e = ev_heap[i];
+	register int j;
+
+	/* up, while it is due before its parent */
+	while (i > 1 && ev_before(e, ev_heap[i / 2])) {
+		ev_put(i, ev_heap[i / 2]);
+		i /= 2;
+	}
+
+	/* down, while a child is due before it */
+	while ((j = 2 * i) <= ev_cnt) {
+		if (j < ev_cnt && ev_before(ev_heap[j + 1], ev_heap[j]))
+			j++;
+		if (!ev_before(ev_heap[j], e))
+			break;
+		ev_put(i, ev_heap[j]);
+		i = j;
+	}
+	ev_put(i, e);
+
+	ev_next = ev_heap[1]->ev_time;
+}
+
+/*
+ *	Schedule event e at t-state time, an event already
+ *	scheduled is moved
+ */
+static void ev_at(event_t *e, Tstates_t time)
+{
+	e->ev_time = time;
+	e->ev_seq = ev_seq++;
+	if (e->ev_idx == 0) {
+		if (ev_cnt == EV_MAX) {
+			LOGE(TAG, "too many events scheduled");
+			return;
+		}
+		ev_put(++ev_cnt, e);
+	}
+	ev_sift(e->ev_idx);
+}
+
+/*
+ *	Schedule event e delay t-states from now
+ */
+void ev_schedule(event_t *e, Tstates_t delay)
+{
+	ev_at(e, T + delay);
+}
+
+/*
+ *	Schedule event e period t-states after it was due the
+ *	last time, for periodic events which shouldn't drift
+ */
+void ev_repeat(event_t *e, Tstates_t period)
+{
+	ev_at(e, e->ev_time + period);
+}
+
+/*
+ *	Remove event e from the schedule, if it is scheduled
+ */
+void ev_cancel(event_t *e)
+{
+	register int i = e->ev_idx;
+	register event_t *last;
+
+	if (i == 0)
+		return;
+	e->ev_idx = 0;
+
+	last = ev_heap[ev_cnt--];
+	if (last != e) {
+		ev_put(i, last);
+		ev_sift(i);
+	} else if (ev_cnt == 0)
+		ev_next = EV_NEVER;
+	else
+		ev_next = ev_heap[1]->ev_time;
+}
+
+/*
+ *	Run the functions of all events, which are due
+ */
+void ev_run(void)
+{
+	register event_t *e;
+
+	while (ev_cnt > 0 && (e = ev_heap[1])->ev_time <= T) {
+		ev_cancel(e);
+		(*e->ev_func)();
+	}
+}
+
+/*
+ *	Number of t-states for us microseconds of simulated time
+ */
+Tstates_t ev_us(unsigned long us)
+{
+	return (Tstates_t) us * (f_value ? f_value : EV_MHZ);
+}
@@ -0,0 +1,55 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	Event scheduler for the devices of the simulated machines.
+ *
+ *	Instead of running threads or host timers, devices schedule
+ *	events at a t-state of the CPU, and the CPU loop calls the
+ *	function of an event, when the t-state counter T reaches it.
+ *	So the device timing follows the simulated time, runs can be
+ *	reproduced, and with an unlimited CPU speed the devices are
+ *	as fast as the CPU. Events are kept in a heap sorted by their
+ *	t-state, events due at the same t-state run in the order they
+ *	were scheduled. Events must be scheduled in the CPU thread.
+ */
+
+#ifndef SIMEVENT_INC
+#define SIMEVENT_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define EV_MAX		32	/* max. number of scheduled events */
+#define EV_MHZ		4	/* CPU clock for unlimited CPU speed */
+#define EV_NEVER	(~(Tstates_t) 0) /* ev_next without events */
+
+typedef void (ev_func_t)(void);
+
+typedef struct event {		/* structure of an event */
+	ev_func_t *ev_func;	/* function called when due */
+	Tstates_t ev_time;	/* t-state the event is due */
+	unsigned long ev_seq;	/* sequence number when scheduled */
+	int ev_idx;		/* index in the heap, 0 = not scheduled */
+} event_t;
+
+extern Tstates_t ev_next;
+
+extern void ev_schedule(event_t *e, Tstates_t delay);
+extern void ev_repeat(event_t *e, Tstates_t period);
+extern void ev_cancel(event_t *e);
+extern void ev_run(void);
+extern Tstates_t ev_us(unsigned long us);
+
+/*
+ *	Check if an event is scheduled
+ */
+static inline bool ev_pending(event_t *e)
+{
+	return e->ev_idx != 0;
+}
+
+#endif /* !SIMEVENT_INC */
@@ -0,0 +1,132 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This module implements the fork server for batch jobs,
+ *	see simfork.h
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simfork.h"
+
+#ifdef HAS_FORKSRV
+
+#include "log.h"
+static const char *TAG = "fork";
+
+static fork_func_t *funcs[FORK_MAXFUNCS]; /* called in a new job */
+static int nfuncs;
+
+/*
+ *	Register function func, which is called in every job after
+ *	the fork, to make the state of a device private to the job
+ */
+void fork_register(fork_func_t *func)
+{
+	if (nfuncs == FORK_MAXFUNCS) {
+		LOGE(TAG, "too many functions registered");
+		return;
+	}
+	funcs[nfuncs++] = func;
+}
+
+/*
+ *	Create the UNIX domain socket jfn, jobs connect to
+ */
+static int open_socket(void)
+{
+	struct sockaddr_un sun;
+	int s;
+
+	if (strlen(jfn) >= sizeof(sun.sun_path)) {
+		LOGE(TAG, "socket path %s too long", jfn);
+		return -1;
+	}
+	if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+		LOGE(TAG, "can't create socket");
+		return -1;
+	}
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	strcpy(sun.sun_path, jfn);
+	unlink(jfn);
+	if (bind(s, (struct sockaddr *) &sun, sizeof(sun)) == -1 ||
+	    listen(s, 16) == -1) {
+		LOGE(TAG, "can't listen on socket %s", jfn);
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+/*
+ *	Called when the CPU becomes idle, forks a job for every
+ *	connection to the socket, until the server is interrupted.
+ *	Returns in the jobs with the connection as stdin and stdout,
+ *	and in the server after it was stopped.
+ */
+void fork_server(void)
+{
+	int s, fd, i;
+
+	j_flag = false;		/* only once, not again in the jobs */
+
+	if ((s = open_socket()) == -1) {
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
+		return;
+	}
+	signal(SIGCHLD, SIG_IGN); /* no zombies from finished jobs */
+	LOG(TAG, "machine booted, waiting for jobs on %s\r\n", jfn);
+	fflush(stdout);
+
+	while (cpu_error == NONE) {
+		if ((fd = accept(s, NULL, NULL)) == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			LOGE(TAG, "can't accept job");
+			cpu_error = IOERROR;
+			cpu_state = ST_STOPPED;
+			break;
+		}
+
+		switch (fork()) {
+		case -1:
+			LOGE(TAG, "can't fork job");
+			close(fd);
+			break;
+
+		case 0:		/* job */
+			close(s);
+			signal(SIGCHLD, SIG_DFL);
+			dup2(fd, fileno(stdin));
+			dup2(fd, fileno(stdout));
+			close(fd);
+			for (i = 0; i < nfuncs; i++)
+				(*funcs[i])();
+			return;
+
+		default:	/* server */
+			close(fd);
+			break;
+		}
+	}
+
+	close(s);
+	unlink(jfn);
+}
+
+#endif /* HAS_FORKSRV */
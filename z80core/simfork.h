@@ -0,0 +1,40 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	Fork server for batch jobs.
+ *
+ *	With option -j the machine boots as usual, until the CPU
+ *	becomes idle for the first time, that is when the operating
+ *	system waits at its prompt for input. Then the simulator
+ *	listens on the UNIX domain socket given with the option and
+ *	forks a copy of the booted machine for every connection.
+ *	The copy uses the connection as console for input and output,
+ *	so a job starts without booting and only has to send its
+ *	commands. Memory is shared with the server copy-on-write by
+ *	fork(), the machine registers a function, which is called in
+ *	the copy after the fork, to make the disk images private.
+ *	The server runs until it is interrupted.
+ */
+
+#ifndef SIMFORK_INC
+#define SIMFORK_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#ifdef HAS_FORKSRV
+
+#define FORK_MAXFUNCS	4	/* max. number of registered functions */
+
+typedef void (fork_func_t)(void);
+
+extern void fork_register(fork_func_t *func);
+extern void fork_server(void);
+
+#endif /* HAS_FORKSRV */
+
+#endif /* !SIMFORK_INC */
@@ -15,6 +15,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
@@ -113,6 +114,51 @@ uint64_t get_clock_us(void)
 	return t;
 }
 
+static int wakeup_fd = -1;	/* write end of the wakeup pipe */
+
+/*
+ *	Sleep for time microseconds, or until input on a terminal
+ *	connected to stdin is available or wakeup_for_input() is called
+ */
+void sleep_for_input(unsigned long time)
+{
+	static int pfd[2] = { -1, -1 };
+	static int tty = -1;
+	struct pollfd p[2];
+	char buf[64];
+
+	if (pfd[0] == -1 && pipe(pfd) == 0) {
+		fcntl(pfd[0], F_SETFL, O_NONBLOCK);
+		fcntl(pfd[1], F_SETFL, O_NONBLOCK);
+		__atomic_store_n(&wakeup_fd, pfd[1], __ATOMIC_RELEASE);
+		/* files and /dev/null are always readable */
+		tty = isatty(fileno(stdin)) ? fileno(stdin) : -1;
+	}
+
+	p[0].fd = pfd[0];
+	p[0].events = POLLIN;
+	p[0].revents = 0;
+	p[1].fd = tty;
+	p[1].events = POLLIN;
+	p[1].revents = 0;
+	if (poll(p, 2, (int) ((time + 999) / 1000)) > 0 && p[0].revents)
+		while (read(pfd[0], buf, sizeof(buf)) > 0)
+			;
+}
+
+/*
+ *	End sleep_for_input() in the CPU thread, called by other
+ *	threads when they have input for the simulation
+ */
+void wakeup_for_input(void)
+{
+	int fd = __atomic_load_n(&wakeup_fd, __ATOMIC_ACQUIRE);
+
+	if (fd != -1 && write(fd, "", 1) == -1) {
+		/* pipe is full, the CPU thread wakes up anyway */
+	}
+}
+
 #ifdef WANT_ICE
 /*
  *	Read an ICE command line from stdin.
@@ -22,6 +22,8 @@
  *	extern void sleep_for_us(unsigned long time);
  *	extern void sleep_for_ms(unsigned time);
  *	extern uint64_t get_clock_us(void);
+ *	extern void sleep_for_input(unsigned long time);
+ *	extern void wakeup_for_input(void);
  *	#ifdef WANT_ICE
  *	extern bool get_cmdline(char *buf, int len);
  *	#endif
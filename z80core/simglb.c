@@ -107,6 +107,9 @@ int f_value;			/* value of -f option */
 bool u_flag;			/* flag for -u option */
 bool r_flag;			/* flag for -r option */
 bool c_flag;			/* flag for -c option */
+bool B_flag;			/* flag for -B option */
+Tstates_t T_value;		/* value of -T option */
+int I_value;			/* value of -I option */
 #ifdef HAS_CONFIG
 int M_value = 0;		/* value of -M option */
 #endif
@@ -126,6 +129,9 @@ bool p_flag = true;		/* flag for -p option */
 bool p_flag = false;		/* flag for -p option */
 #endif
 #endif
+#ifdef HAS_FORKSRV
+bool j_flag;			/* flag for -j option */
+#endif
 
 /*
  *	Variables for configuration and disk images
@@ -135,6 +141,9 @@ char xfn[MAX_LFN];		/* buffer for filename (option -x) */
 char *diskdir = NULL;		/* path for disk images (option -d) */
 char diskd[MAX_LFN];		/* disk image directory in use */
 #endif
+#ifdef HAS_FORKSRV
+char jfn[MAX_LFN];		/* socket of the fork server (option -j) */
+#endif
 #ifdef CONFDIR
 char confdir[MAX_LFN];		/* path for configuration files */
 #endif
@@ -77,6 +77,9 @@ extern port_flags_t port_flags[256];
 
 extern bool	s_flag, l_flag, x_flag, i_flag, u_flag, r_flag, c_flag;
 extern int	m_value, f_value;
+extern bool	B_flag;
+extern Tstates_t T_value;
+extern int	I_value;
 #ifdef HAS_CONFIG
 extern int	M_value;
 #endif
@@ -92,11 +95,17 @@ extern bool	n_flag;
 #ifdef INFOPANEL
 extern bool	p_flag;
 #endif
+#ifdef HAS_FORKSRV
+extern bool	j_flag;
+#endif
 
 extern char	xfn[MAX_LFN];
 #ifdef HAS_DISKS
 extern char	*diskdir, diskd[MAX_LFN];
 #endif
+#ifdef HAS_FORKSRV
+extern char	jfn[MAX_LFN];
+#endif
 #ifdef CONFDIR
 extern char	confdir[MAX_LFN];
 #endif
@@ -24,6 +24,7 @@
 #include "simdis.h"
 #include "simport.h"
 #include "simice.h"
+#include "simprof.h"
 
 #ifndef BAREMETAL
 #include <signal.h>
@@ -34,6 +35,12 @@
 
 #ifdef WANT_ICE
 
+/*
+ *	Select the CPU loop with the hooks for history,
+ *	t-state count and hardware breakpoint
+ */
+bool ice_hooks;
+
 /*
  *	Variables for history memory
  */
@@ -41,13 +48,7 @@
 history_t his[HISIZE];		/* memory to hold trace information */
 int h_next;			/* index into trace memory */
 bool h_flag;			/* flag for trace memory overrun */
-#endif
-
-/*
- *	Variables for breakpoint memory
- */
-#ifdef SBSIZE
-softbreak_t soft[SBSIZE];	/* memory to hold breakpoint information */
+bool h_rec;			/* record history while running */
 #endif
 
 /*
@@ -62,20 +63,35 @@ WORD t_end = 65535;		/* end address for measurement */
 #endif
 
 /*
- *	Variables for hardware breakpoint
+ *	Variables for breakpoints
  */
-#ifdef WANT_HB
-bool hb_flag;			/* hardware breakpoint enabled flag */
-WORD hb_addr;			/* address of hardware breakpoint */
-int hb_mode;			/* access mode of hardware breakpoint */
-int hb_trig;			/* hardware breakpoint triggered flag */
+#ifdef WANT_BP
+BYTE hb_rd[65536 / 8];		/* bitmap of read breakpoints */
+BYTE hb_wr[65536 / 8];		/* bitmap of write breakpoints */
+BYTE hb_ex[65536 / 8];		/* bitmap of execute breakpoints */
+bool hb_flag;			/* read/write breakpoints set flag */
+int hb_trig;			/* access mode of breakpoint hit */
+WORD hb_addr;			/* address of breakpoint hit */
+int hb_skip = -1;		/* execute breakpoint to pass once */
+
+typedef struct breakpoint {	/* structure of a breakpoint */
+	WORD	bp_addr;	/* address of breakpoint */
+	int	bp_mode;	/* access modes of breakpoint */
+	bool	bp_soft;	/* software breakpoint flag */
+	int	bp_bank;	/* bank of breakpoint, -1 = all banks */
+	int	bp_pass;	/* no. of pass to break */
+	int	bp_passcount;	/* pass counter of breakpoint */
+	char	*bp_cond;	/* condition to break or NULL */
+} breakpoint_t;
+
+static breakpoint_t *bps;	/* table of breakpoints */
+static int nbps;		/* no. of breakpoints in table */
 #endif
 
 static void do_step(void);
 static void do_trace(char *s);
 static void do_go(char *s);
-static void install_softbp(void);
-static void uninstall_softbp(void);
+static bool want_hooks(void);
 static bool handle_break(void);
 static void do_dump(char *s);
 static void do_list(char *s);
@@ -87,8 +103,18 @@ static void do_reg(char *s);
 static void print_head(void);
 static void print_reg(void);
 static void do_break(char *s);
+#ifdef WANT_BP
+static void bp_update(void);
+static bool bp_addr(char **s, int *bank, WORD *a);
+static void bp_set(char *s, bool soft);
+static void bp_clear(char *s, bool soft);
+static void bp_show(bool soft);
+static const char *cond_term(const char *s, WORD *w);
+static int cond_eval(const char *s);
+#endif
 static void do_hist(char *s);
 static void do_count(char *s);
+static void do_prof(char *s);
 #if !defined (EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
 static void do_switch(char *s);
 #endif
@@ -196,6 +222,9 @@ void ice_cmd_loop(int go_mode)
 		case 'z':
 			do_count(cmd + 1);
 			break;
+		case 'y':
+			do_prof(cmd + 1);
+			break;
 #if !defined (EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
 		case '8':
 			do_switch(cmd + 1);
@@ -242,11 +271,10 @@ void ice_cmd_loop(int go_mode)
  */
 static void do_step(void)
 {
-	install_softbp();
+	ice_hooks = true;
 	step_cpu();
 	if (cpu_error == OPHALT)
 		(void) handle_break();
-	uninstall_softbp();
 	report_cpu_error();
 	print_head();
 	print_reg();
@@ -269,14 +297,13 @@ static void do_trace(char *s)
 		count = atoi(s);
 	print_head();
 	print_reg();
-	install_softbp();
+	ice_hooks = true;
 	for (i = 0; i < count; i++) {
 		step_cpu();
 		print_reg();
 		if (cpu_error && (cpu_error != OPHALT || handle_break()))
 			break;
 	}
-	uninstall_softbp();
 	report_cpu_error();
 	wrk_addr = PC;
 }
@@ -303,7 +330,7 @@ static void do_go(char *s)
 		PC = strtol(s, NULL, 16);
 	if (ice_before_go)
 		(*ice_before_go)();
-	install_softbp();
+	ice_hooks = want_hooks();
 	T0 = T;
 	start_cpu_time = cpu_time;
 	start_io_time = total_io_time;
@@ -316,7 +343,6 @@ static void do_go(char *s)
 	stop_cpu_time = cpu_time;
 	stop_io_time = total_io_time;
 	stop_wait_time = total_wait_time;
-	uninstall_softbp();
 	if (ice_after_go)
 		(*ice_after_go)();
 	report_cpu_error();
@@ -338,87 +364,84 @@ static void do_go(char *s)
 }
 
 /*
- *	Install software breakpoints (HALT opcode)
+ *	Check if the CPU loop with the hooks has to run the program,
+ *	because the history or profile is recorded, t-states are
+ *	counted or breakpoints are set
  */
-static void install_softbp(void)
+static bool want_hooks(void)
 {
-#ifdef SBSIZE
-	register int i;
-
-	for (i = 0; i < SBSIZE; i++)
-		if (soft[i].sb_pass) {
-			soft[i].sb_oldopc = getmem(soft[i].sb_addr);
-			putmem(soft[i].sb_addr, 0x76); /* HALT */
-		}
+#ifdef HISIZE
+	if (h_rec)
+		return true;
 #endif
-}
-
-/*
- *	Uninstall software breakpoints (HALT opcode)
- */
-static void uninstall_softbp(void)
-{
-#ifdef SBSIZE
-	register int i;
-
-	for (i = 0; i < SBSIZE; i++)
-		if (soft[i].sb_pass)
-			putmem(soft[i].sb_addr, soft[i].sb_oldopc);
+#ifdef WANT_TIM
+	if (t_start != 65535 || t_end != 65535)
+		return true;
+#endif
+#ifdef WANT_PROF
+	if (p_flag)
+		return true;
+#endif
+#ifdef WANT_BP
+	if (nbps)
+		return true;
 #endif
+	return false;
 }
 
 /*
- *	Handling of software (HALT opcode) / hardware breakpoints:
+ *	Handling of breakpoints, the CPU stopped with OPHALT before
+ *	the instruction at an execute breakpoint, after the instruction
+ *	which hit a read or write breakpoint or after HALT:
  *
- *	Output:	false breakpoint hit, pass counter not reached (continue)
- *		true breakpoint or other HALT opcode reached (stop)
+ *	Output:	false breakpoint hit, but bank, condition or pass counter
+ *		don't match (continue)
+ *		true breakpoint or HALT opcode reached (stop)
  */
 static bool handle_break(void)
 {
-#ifdef SBSIZE
+#ifdef WANT_BP
 	register int i;
-#endif
+	register breakpoint_t *p;
+	int mode;
+	bool stop = false;
 
-#ifdef WANT_HB
-	if (hb_flag && hb_trig) {
-		printf("Hardware breakpoint hit by ");
-		if (hb_trig == HB_READ)
-			printf("read");
-		else if (hb_trig == HB_WRITE)
-			printf("write");
-		else
-			printf("execute");
-		printf(" access to %04x\n", hb_addr);
-		hb_trig = 0;
-		cpu_error = NONE;
+	if ((mode = hb_trig) == 0)	/* HALT opcode */
 		return true;
-	}
-#endif
-#ifdef SBSIZE
-	for (i = 0; i < SBSIZE; i++)	/* search for breakpoint */
-		if (soft[i].sb_pass && soft[i].sb_addr == PC - 1)
-			break;
-	if (i == SBSIZE)		/* no breakpoint found */
-		return true;
-#ifdef HISIZE
-	if (h_next)			/* correct history */
-		h_next--;
-	else
-		h_next = HISIZE - 1;
+	hb_trig = 0;
+	cpu_error = NONE;
+	if (mode == HB_EXEC)		/* continue with the instruction */
+		hb_skip = hb_addr;
+	for (i = 0, p = bps; i < nbps; i++, p++) {
+		if (p->bp_addr != hb_addr || !(p->bp_mode & mode))
+			continue;
+#ifdef BP_BANK
+		if (p->bp_bank != -1 && p->bp_bank != BP_BANK)
+			continue;
 #endif
-	PC--;				/* substitute HALT opcode by */
-	putmem(PC, soft[i].sb_oldopc);	/* original opcode */
-	step_cpu();			/* and execute it */
-	putmem(soft[i].sb_addr, 0x76);	/* restore HALT opcode again */
-	soft[i].sb_passcount++;		/* increment pass counter */
-	if (soft[i].sb_passcount != soft[i].sb_pass)
-		return false;		/* pass not reached, continue */
-	printf("Software breakpoint hit at %04x\n", soft[i].sb_addr);
-	soft[i].sb_passcount = 0;	/* reset pass counter */
-	return true;			/* pass reached, stop */
-#else /* !SBSIZE */
+		if (p->bp_cond && cond_eval(p->bp_cond) != 1)
+			continue;
+		if (++p->bp_passcount < p->bp_pass)
+			continue;
+		p->bp_passcount = 0;	/* reset pass counter */
+		if (p->bp_soft)
+			printf("Software breakpoint hit at %04x\n", hb_addr);
+		else {
+			printf("Hardware breakpoint hit by ");
+			if (mode == HB_READ)
+				printf("read");
+			else if (mode == HB_WRITE)
+				printf("write");
+			else
+				printf("execute");
+			printf(" access to %04x\n", hb_addr);
+		}
+		stop = true;
+	}
+	return stop;
+#else /* !WANT_BP */
 	return true;
-#endif /* !SBSIZE */
+#endif /* !WANT_BP */
 }
 
 /*
@@ -878,191 +901,396 @@ static void print_reg(void)
 }
 
 /*
- *	Software breakpoints
+ *	Software and hardware breakpoints
  */
 static void do_break(char *s)
 {
-#if defined(SBSIZE) || defined(WANT_HB)
-	WORD a;
-	int n;
-#ifdef SBSIZE
-	register int i;
-	int hdr_flag;
-#endif
+#ifdef WANT_BP
+	bool soft = true;
 #endif
 
 	if (*s == 'h') {
-#ifndef WANT_HB
-		puts("Sorry, no hardware breakpoint available");
-		puts("Please recompile with WANT_HB defined in sim.h");
-#else /* WANT_HB */
+#ifdef WANT_HB
+		soft = false;
 		s++;
-		if (*s == '\n' || *s == '\0') {
-			if (hb_flag) {
-				printf("Hardware breakpoint set with ");
-				n = 0;
-				if (hb_mode & HB_READ) {
-					printf("read");
-					n = 1;
-				}
-				if (hb_mode & HB_WRITE) {
-					if (n)
-						putchar('/');
-					printf("write");
-					n = 1;
-				}
-				if (hb_mode & HB_EXEC) {
-					if (n)
-						putchar('/');
-					printf("execute");
-				}
-				printf(" access trigger to %04x\n", hb_addr);
-			} else
-				puts("No hardware breakpoint set");
-			return;
-		}
-		if (tolower((unsigned char) *s) == 'c') {
-			hb_flag = false;
-			return;
-		}
-		while (isspace((unsigned char) *s))
-			s++;
-		if (!isxdigit((unsigned char) *s)) {
+#else
+		puts("Sorry, no hardware breakpoints available");
+		puts("Please recompile with WANT_HB defined in sim.h");
+		return;
+#endif
+	}
+#ifndef SBSIZE
+	else {
+		puts("Sorry, no software breakpoints available");
+		puts("Please recompile with SBSIZE defined in sim.h");
+		return;
+	}
+#endif
+#ifdef WANT_BP
+	if (*s == '\n' || *s == '\0')
+		bp_show(soft);
+	else if (tolower((unsigned char) *s) == 'c')
+		bp_clear(s + 1, soft);
+	else
+		bp_set(s, soft);
+#endif
+}
+
+#ifdef WANT_BP
+
+/*
+ *	Get the [bank:]address of a breakpoint
+ *
+ *	Output:	false address missing or no banks available
+ */
+static bool bp_addr(char **s, int *bank, WORD *a)
+{
+	while (isspace((unsigned char) **s))
+		(*s)++;
+	if (!isxdigit((unsigned char) **s)) {
+		puts("address missing");
+		return false;
+	}
+	*a = strtol(*s, s, 16);
+	*bank = -1;
+	if (**s == ':') {
+#ifdef BP_BANK
+		*bank = *a;
+		(*s)++;
+		while (isspace((unsigned char) **s))
+			(*s)++;
+		if (!isxdigit((unsigned char) **s)) {
 			puts("address missing");
-			return;
-		}
-		a = strtol(s, &s, 16);
-		while (isspace((unsigned char) *s))
-			s++;
-		if (*s == ',') {
-			s++;
-			while (isspace((unsigned char) *s))
-				s++;
-			n = 0;
-			if (tolower((unsigned char) *s) == 'r') {
-				n |= HB_READ;
-				s++;
-			}
-			if (tolower((unsigned char) *s) == 'w') {
-				n |= HB_WRITE;
-				s++;
-			}
-			if (tolower((unsigned char) *s) == 'x')
-				n |= HB_EXEC;
-		} else
-			n = HB_READ | HB_WRITE | HB_EXEC;
-#ifdef SBSIZE
-		if (n & HB_EXEC) {
-			for (i = 0; i < SBSIZE; i++)
-				if (soft[i].sb_pass && soft[i].sb_addr == a) {
-					puts("Software breakpoint set "
-					     "at same execute access address");
-					return;
-				}
+			return false;
 		}
+		*a = strtol(*s, s, 16);
+#else
+		puts("No memory banks available");
+		return false;
 #endif
-		hb_addr = a;
-		hb_mode = n;
-		hb_flag = true;
-#endif /* WANT_HB */
+	}
+	while (isspace((unsigned char) **s))
+		(*s)++;
+	return true;
+}
+
+/*
+ *	Set breakpoint: [bank:]address[,accmode][,pass][,condition],
+ *	the access mode only for hardware breakpoints
+ */
+static void bp_set(char *s, bool soft)
+{
+	register int i;
+	register breakpoint_t *p;
+	int bank, mode, pass;
+	WORD a;
+	char *t, *cond;
+
+	if (!bp_addr(&s, &bank, &a))
 		return;
+	mode = soft ? HB_EXEC : HB_READ | HB_WRITE | HB_EXEC;
+	if (!soft && *s == ',') {
+		i = 0;
+		for (t = s + 1; *t != ',' && *t != '\0'; t++) {
+			if (tolower((unsigned char) *t) == 'r')
+				i |= HB_READ;
+			else if (tolower((unsigned char) *t) == 'w')
+				i |= HB_WRITE;
+			else if (tolower((unsigned char) *t) == 'x')
+				i |= HB_EXEC;
+			else if (!isspace((unsigned char) *t))
+				break;
+		}
+		if (i && (*t == ',' || *t == '\0')) {
+			mode = i;
+			s = t;
+		}
 	}
-#ifndef SBSIZE
-	puts("Sorry, no software breakpoints available");
-	puts("Please recompile with SBSIZE defined in sim.h");
-#else /* SBSIZE */
-	if (*s == '\n' || *s == '\0') {
-		hdr_flag = 0;
-		for (i = 0; i < SBSIZE; i++)
-			if (soft[i].sb_pass) {
-				if (!hdr_flag) {
-					puts("Addr Pass  Counter");
-					hdr_flag = 1;
-				}
-				printf("%04x %05d %05d\n",
-				       soft[i].sb_addr, soft[i].sb_pass,
-				       soft[i].sb_passcount);
+	pass = 1;
+	if (*s == ',') {
+		for (t = s + 1; isspace((unsigned char) *t); t++)
+			;
+		if (*t == ',')		/* empty pass field */
+			s = t;
+		else if (isdigit((unsigned char) *t)) {
+			i = strtol(t, &t, 10);
+			while (isspace((unsigned char) *t))
+				t++;
+			if (*t == ',' || *t == '\0') {
+				if (i > 0)
+					pass = i;
+				s = t;
 			}
-		if (!hdr_flag)
-			puts("No software breakpoints set");
-		return;
+		}
 	}
-	if (tolower((unsigned char) *s) == 'c') {
-		s++;
-		while (isspace((unsigned char) *s))
-			s++;
-		if (*s == '\0') {
-			memset((char *) soft, 0, sizeof(softbreak_t) * SBSIZE);
-			return;
+	cond = NULL;
+	if (*s == ',') {
+		for (s++; isspace((unsigned char) *s); s++)
+			;
+		for (t = s + strlen(s); t > s && isspace((unsigned char) t[-1]);)
+			*--t = '\0';
+		for (t = s; *t != '\0'; t++)
+			*t = tolower((unsigned char) *t);
+		if (*s != '\0') {
+			if (cond_eval(s) < 0) {
+				puts("invalid condition");
+				return;
+			}
+			cond = s;
 		}
-		if (!isxdigit((unsigned char) *s)) {
-			puts("address missing");
+	}
+	/* look for existing breakpoint, if not found add a new one */
+	for (i = 0, p = bps; i < nbps; i++, p++)
+		if (p->bp_addr == a && p->bp_bank == bank &&
+		    p->bp_soft == soft)
+			break;
+	if (i == nbps) {
+		p = realloc(bps, (nbps + 1) * sizeof(breakpoint_t));
+		if (p == NULL) {
+			puts("out of memory");
 			return;
 		}
-		a = strtol(s, NULL, 16);
-		for (i = 0; i < SBSIZE; i++) {
-			if (soft[i].sb_pass && soft[i].sb_addr == a)
-				break;
+		bps = p;
+		p += nbps++;
+		p->bp_addr = a;
+		p->bp_bank = bank;
+		p->bp_soft = soft;
+		p->bp_cond = NULL;
+	}
+	p->bp_mode = mode;
+	p->bp_pass = pass;
+	p->bp_passcount = 0;
+	free(p->bp_cond);
+	p->bp_cond = cond ? strdup(cond) : NULL;
+	bp_update();
+}
+
+/*
+ *	Clear all breakpoints or the ones at [bank:]address
+ */
+static void bp_clear(char *s, bool soft)
+{
+	register int i, j;
+	register breakpoint_t *p;
+	int bank;
+	WORD a;
+	bool all;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	if ((all = (*s == '\0')) == false && !bp_addr(&s, &bank, &a))
+		return;
+	for (i = j = 0, p = bps; i < nbps; i++, p++) {
+		if (p->bp_soft == soft &&
+		    (all || (p->bp_addr == a &&
+			     (bank == -1 || p->bp_bank == bank))))
+			free(p->bp_cond);
+		else
+			bps[j++] = *p;
+	}
+	if (!all && j == nbps)
+		printf("No %s breakpoint at address %04x\n",
+		       soft ? "software" : "hardware", a);
+	nbps = j;
+	bp_update();
+}
+
+/*
+ *	Show the breakpoints
+ */
+static void bp_show(bool soft)
+{
+	register int i;
+	register breakpoint_t *p;
+	bool hdr_flag = false;
+
+	for (i = 0, p = bps; i < nbps; i++, p++) {
+		if (p->bp_soft != soft)
+			continue;
+		if (!hdr_flag) {
+#ifdef BP_BANK
+			printf("Bank ");
+#endif
+			puts(soft ? "Addr Pass  Counter Condition"
+				  : "Addr Mode Pass  Counter Condition");
+			hdr_flag = true;
 		}
-		if (i == SBSIZE)
-			printf("No software breakpoint at address %04x\n", a);
+#ifdef BP_BANK
+		if (p->bp_bank == -1)
+			printf("all  ");
 		else
-			memset((char *) &soft[i], 0, sizeof(softbreak_t));
-		return;
+			printf("%02x   ", p->bp_bank);
+#endif
+		printf("%04x ", p->bp_addr);
+		if (!soft)
+			printf("%c%c%c  ", p->bp_mode & HB_READ ? 'r' : '-',
+			       p->bp_mode & HB_WRITE ? 'w' : '-',
+			       p->bp_mode & HB_EXEC ? 'x' : '-');
+		printf("%05d %05d %s\n", p->bp_pass, p->bp_passcount,
+		       p->bp_cond ? p->bp_cond : "");
+	}
+	if (!hdr_flag)
+		printf("No %s breakpoints set\n",
+		       soft ? "software" : "hardware");
+}
+
+/*
+ *	Rebuild the bitmaps of the breakpoints from the table
+ */
+static void bp_update(void)
+{
+	register int i;
+	register breakpoint_t *p;
+	register BYTE bit;
+
+	memset(hb_rd, 0, sizeof(hb_rd));
+	memset(hb_wr, 0, sizeof(hb_wr));
+	memset(hb_ex, 0, sizeof(hb_ex));
+	hb_flag = false;
+	for (i = 0, p = bps; i < nbps; i++, p++) {
+		bit = 1 << (p->bp_addr & 7);
+		if (p->bp_mode & HB_READ)
+			hb_rd[p->bp_addr >> 3] |= bit;
+		if (p->bp_mode & HB_WRITE)
+			hb_wr[p->bp_addr >> 3] |= bit;
+		if (p->bp_mode & HB_EXEC)
+			hb_ex[p->bp_addr >> 3] |= bit;
+		if (p->bp_mode & (HB_READ | HB_WRITE))
+			hb_flag = true;
 	}
+}
+
+/*
+ *	Get the value of a term of a breakpoint condition: a register,
+ *	a hex number starting with a digit, or (term) for the memory
+ *	byte at the address
+ *
+ *	Output:	pointer behind the term or NULL on syntax error
+ */
+static const char *cond_term(const char *s, WORD *w)
+{
+	register int i, n;
+	register const reg_def_t *p;
+	char *t;
+
 	while (isspace((unsigned char) *s))
 		s++;
-	if (!isxdigit((unsigned char) *s)) {
-		puts("address missing");
-		return;
+	if (*s == '(') {
+		if ((s = cond_term(s + 1, w)) == NULL)
+			return NULL;
+		while (isspace((unsigned char) *s))
+			s++;
+		if (*s != ')')
+			return NULL;
+		*w = getmem(*w);
+		return s + 1;
 	}
-	a = strtol(s, &s, 16);
-	/* look for existing breakpoint */
-	for (i = 0; i < SBSIZE; i++) {
-		if (soft[i].sb_pass && soft[i].sb_addr == a)
+	if (isdigit((unsigned char) *s)) {
+		*w = strtol(s, &t, 16);
+		return t;
+	}
+	for (i = 0, p = regs; i < nregs; i++, p++) {
+#ifndef EXCLUDE_Z80
+		if (p->z80 && cpu != Z80)
+			continue;
+#endif
+		n = p->len;
+		if (strncmp(s, p->name, n) == 0 &&
+		    !isalnum((unsigned char) s[n]) && s[n] != '\'')
 			break;
 	}
-	/* if not found, look for free one */
-	if (i == SBSIZE) {
-		for (i = 0; i < SBSIZE; i++)
-			if (!soft[i].sb_pass)
-				break;
+	if (i == nregs)
+		return NULL;
+	switch (p->type) {
+	case R_8:
+		*w = *(p->r8);
+		break;
+	case R_88:
+		*w = (*(p->r8h) << 8) + *(p->r8l);
+		break;
+	case R_16:
+		*w = *(p->r16);
+		break;
+	case R_R:
+		*w = (*(p->r8h) & 0x80) | (*(p->r8l) & 0x7f);
+		break;
+	case R_F:
+		*w = *(p->rf);
+		break;
+	case R_M:
+		*w = (F & p->rm) ? 1 : 0;
+		break;
+	default:
+		break;
 	}
-	if (i == SBSIZE)
-		puts("All software breakpoints in use");
-	else {
-		if (!soft[i].sb_pass) {
-			/* new breakpoint */
-#ifdef WANT_HB
-			if (hb_flag && (hb_mode & HB_EXEC) && hb_addr == a) {
-				puts("Hardware execute access breakpoint set "
-				     "at same address");
-				return;
-			}
-#endif
-			soft[i].sb_addr = a;
-		}
+	return s + n;
+}
+
+/*
+ *	Evaluate a breakpoint condition: comparisons of two terms
+ *	with ==, !=, <, <=, > or >=, or single terms which must not
+ *	be zero, all joined with &&
+ *
+ *	Output:	1 condition true, 0 condition false, -1 syntax error
+ */
+static int cond_eval(const char *s)
+{
+	static const char *const ops[] = { "==", "!=", "<=", ">=", "<", ">" };
+	register int i;
+	WORD w1, w2;
+	int res = 1;
+	bool r;
+
+	while (true) {
+		if ((s = cond_term(s, &w1)) == NULL)
+			return -1;
 		while (isspace((unsigned char) *s))
 			s++;
-		if (*s == ',') {
-			s++;
+		for (i = 0; i < 6; i++)
+			if (strncmp(s, ops[i], strlen(ops[i])) == 0)
+				break;
+		if (i < 6) {
+			s += strlen(ops[i]);
+			if ((s = cond_term(s, &w2)) == NULL)
+				return -1;
 			while (isspace((unsigned char) *s))
 				s++;
-			if (!isdigit((unsigned char) *s))
-				n = 1;
-			else {
-				n = atoi(s);
-				if (n == 0)
-					n = 1;
-			}
-		} else
-			n = 1;
-		soft[i].sb_pass = n;
-		soft[i].sb_passcount = 0;
+		}
+		switch (i) {
+		case 0:
+			r = (w1 == w2);
+			break;
+		case 1:
+			r = (w1 != w2);
+			break;
+		case 2:
+			r = (w1 <= w2);
+			break;
+		case 3:
+			r = (w1 >= w2);
+			break;
+		case 4:
+			r = (w1 < w2);
+			break;
+		case 5:
+			r = (w1 > w2);
+			break;
+		default:
+			r = (w1 != 0);
+			break;
+		}
+		if (!r)
+			res = 0;
+		if (*s == '\0')
+			return res;
+		if (s[0] != '&' || s[1] != '&')
+			return -1;
+		s += 2;
 	}
-#endif /* SBSIZE */
 }
 
+#endif /* WANT_BP */
+
 /*
  *	History
  */
@@ -1082,6 +1310,12 @@ static void do_hist(char *s)
 		h_flag = false;
 		return;
 	}
+	if (tolower((unsigned char) *s) == 'r') {
+		h_rec = !h_rec;
+		printf("History is %s recorded while running\n",
+		       h_rec ? "now" : "no longer");
+		return;
+	}
 	if (h_next == 0 && !h_flag) {
 		puts("History memory is empty");
 		return;
@@ -1181,6 +1415,21 @@ static void do_count(char *s)
 #endif
 }
 
+/*
+ *	Execution profiler
+ */
+static void do_prof(char *s)
+{
+#ifndef WANT_PROF
+	UNUSED(s);
+
+	puts("Sorry, no profiler available");
+	puts("Please recompile with WANT_PROF defined in sim.h");
+#else
+	prof_cmd(s);
+#endif
+}
+
 #if !defined (EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
 /*
  *	Switch between CPU modes
@@ -1264,20 +1513,25 @@ static void do_show(void)
 	printf("sim Release: %s\n", RELEASE);
 #ifdef HISIZE
 	printf("No. of entries in history memory: %d\n", HISIZE);
+	printf("History is %srecorded while running\n", h_rec ? "" : "not ");
 #else
 	puts("History not available");
 #endif
 #ifdef SBSIZE
-	printf("No. of software breakpoints: %d\n", SBSIZE);
+	i = 1;
 #else
-	puts("Software breakpoints not available");
+	i = 0;
 #endif
+	printf("Software breakpoints %savailable\n", i ? "" : "not ");
 #ifdef WANT_HB
 	i = 1;
 #else
 	i = 0;
 #endif
-	printf("Hardware breakpoint %savailable\n", i ? "" : "not ");
+	printf("Hardware breakpoints %savailable\n", i ? "" : "not ");
+#ifdef BP_BANK
+	puts("Breakpoints can be set for a memory bank");
+#endif
 #ifdef UNDOC_INST
 	printf("Undocumented op-codes are %s\n",
 	       u_flag ? "trapped" : "executed");
@@ -1291,6 +1545,12 @@ static void do_show(void)
 	i = 0;
 #endif
 	printf("T-State counting %spossible\n", i ? "" : "not ");
+#ifdef WANT_PROF
+	i = 1;
+#else
+	i = 0;
+#endif
+	printf("Profiler %savailable\n", i ? "" : "not ");
 }
 
 /*
@@ -1309,16 +1569,29 @@ static void do_help(void)
 	puts("return                    single step program");
 	puts("x [register]              show/modify register");
 	puts("x f<flag>                 modify flag");
-	puts("b address[,pass]          set software breakpoint");
+	puts("b address[,pass][,cond]   set software breakpoint");
 	puts("b                         show software breakpoints");
 	puts("bc [address]              clear software breakpoint(s)");
-	puts("bh address[,accmode]      set hardware breakpoint");
-	puts("bh                        show hardware breakpoint");
-	puts("bhc                       clear hardware breakpoint");
+	puts("bh address[,accmode][,pass][,cond]");
+	puts("                          set hardware breakpoint");
+	puts("bh                        show hardware breakpoints");
+	puts("bhc [address]             clear hardware breakpoint(s)");
+#ifdef BP_BANK
+	puts("  address = [bank:]address");
+#endif
+	puts("  cond = term [op term] [&& ...], op = == != < <= > >=");
+	puts("  term = register, 0hex, (term) = memory at address");
 	puts("h [address]               show history");
 	puts("hc                        clear history");
+	puts("hr                        toggle history recording on run");
 	puts("z start,stop              set trigger addr for t-state count");
 	puts("z                         show t-state count");
+	puts("y                         show profile");
+	puts("yc                        clear profile");
+	puts("yr [rate]                 toggle profile recording on run,");
+	puts("                          sampled every rate t-states");
+	puts("yl filename               load symbols of z80asm listing");
+	puts("yf filename               write call stacks for flamegraph");
 	puts("u                         toggle trap on undocumented op-codes");
 	puts("i                         toggle trap on undefined ports I/O");
 	puts("s                         show settings");
@@ -1383,6 +1656,7 @@ static void do_clock(void)
 	tim.it_interval.tv_sec = 0;
 	tim.it_interval.tv_usec = 0;
 	setitimer(ITIMER_REAL, &tim, NULL);
+	ice_hooks = false;		/* measure without the hooks */
 	run_cpu();			/* start CPU */
 	newact.sa_handler = SIG_DFL;	/* reset timer interrupt handler */
 	sigaction(SIGALRM, &newact, NULL);
@@ -13,6 +13,8 @@
 
 #ifdef WANT_ICE
 
+extern bool	ice_hooks;
+
 #ifdef HISIZE
 typedef struct history {	/* structure of a history entry */
 	int	h_cpu;		/* CPU type */
@@ -31,17 +33,7 @@ typedef struct history {	/* structure of a history entry */
 extern history_t his[HISIZE];
 extern int	h_next;
 extern bool	h_flag;
-#endif
-
-#ifdef SBSIZE
-typedef struct softbreak {	/* structure of a breakpoint */
-	WORD	sb_addr;	/* address of breakpoint */
-	BYTE	sb_oldopc;	/* op-code at address of breakpoint */
-	int	sb_passcount;	/* pass counter of breakpoint */
-	int	sb_pass;	/* no. of pass to break */
-} softbreak_t;
-
-extern softbreak_t soft[SBSIZE];
+extern bool	h_rec;
 #endif
 
 #ifdef WANT_TIM
@@ -50,15 +42,50 @@ extern bool	t_flag;
 extern WORD	t_start, t_end;
 #endif
 
-#ifdef WANT_HB
-				/* hardware breakpoint access modes */
+#if defined(SBSIZE) || defined(WANT_HB)
+/*
+ *	Software breakpoints (SBSIZE) and hardware breakpoints (WANT_HB)
+ *	are not limited in number. For every address there is one bit in
+ *	the bitmaps of the access modes, so checking an access is a
+ *	single bit test. Execute bits are tested for the PC by the CPU
+ *	loop with the hooks and stop the CPU before the instruction,
+ *	read and write bits are tested by memrdr()/memwrt() only while
+ *	hb_flag is set and stop the CPU after the instruction. Then the
+ *	ICE checks the bank, condition and pass count of the breakpoints
+ *	at the address. When the CPU continues at an execute breakpoint,
+ *	hb_skip lets the first instruction pass it.
+ */
+#define WANT_BP
+
+				/* breakpoint access modes */
 #define HB_READ		1	/* read memory */
 #define HB_WRITE	2	/* write memory */
 #define HB_EXEC		4	/* execute (op-code fetch) */
 
+extern BYTE	hb_rd[65536 / 8], hb_wr[65536 / 8], hb_ex[65536 / 8];
 extern bool	hb_flag;
-extern int	hb_mode, hb_trig;
+extern int	hb_trig;
 extern WORD	hb_addr;
+extern int	hb_skip;
+
+/*
+ *	Test the bit of an address in a breakpoint bitmap
+ */
+static inline bool hb_test(const BYTE *map, WORD addr)
+{
+	return map[addr >> 3] & (1 << (addr & 7));
+}
+
+/*
+ *	Record a breakpoint hit, the first one of an instruction counts
+ */
+static inline void hb_hit(WORD addr, int mode)
+{
+	if (!hb_trig) {
+		hb_trig = mode;
+		hb_addr = addr;
+	}
+}
 #endif
 
 extern void (*ice_before_go)(void);
@@ -0,0 +1,115 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This module implements the detection of an idle CPU,
+ *	see simidle.h
+ */
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simport.h"
+#include "simevent.h"
+#include "simidle.h"
+#include "simfork.h"
+
+static Tstates_t idle_start;	/* t-state the CPU became idle */
+static Tstates_t idle_last;	/* t-state the last wait ended */
+static uint64_t idle_host;	/* host time the CPU became idle */
+
+/*
+ *	Called for every input from a port, counts the polls of
+ *	the same port at the same address with the same result.
+ *	The Z80 block input instructions repeat at the same address
+ *	too, but they transfer data and are never counted.
+ */
+void idle_poll(BYTE port, BYTE data)
+{
+	static WORD last_pc;
+	static BYTE last_port, last_data;
+	static Tstates_t last_T;
+	uint64_t t;
+
+#ifndef EXCLUDE_Z80
+	/* INI, IND, INIR or INDR */
+	if (cpu == Z80 && getmem((WORD) (PC - 2)) == 0xed &&
+	    (getmem((WORD) (PC - 1)) & 0xe7) == 0xa2) {
+		busy_loop_cnt = 0;
+		return;
+	}
+#endif
+
+	if (PC == last_pc && port == last_port && data == last_data &&
+	    T - last_T <= IDLE_LOOP) {
+		if (++busy_loop_cnt >= IDLE_POLLS) {
+			busy_loop_cnt = 0;
+			t = get_clock_us();
+			idle_wait();
+			wait_time += get_clock_us() - t;
+		}
+	} else {
+		last_pc = PC;
+		last_port = port;
+		last_data = data;
+		busy_loop_cnt = 0;
+	}
+	last_T = T;
+}
+
+/*
+ *	The CPU is idle, let the simulated time until the next
+ *	event pass
+ */
+void idle_wait(void)
+{
+	Tstates_t t;
+	uint64_t t1, us;
+
+#ifdef HAS_FORKSRV
+	/* booted and waiting for input, start the fork server */
+	if (j_flag) {
+		fork_server();
+		return;
+	}
+#endif
+
+	/* instructions executed since the last wait start a new period */
+	if (T - idle_last > IDLE_LOOP * IDLE_POLLS) {
+		idle_start = T;
+		if (I_value)
+			idle_host = get_clock_us();
+	}
+
+	/* stop, if idle longer than allowed with option -I */
+	if (I_value && get_clock_us() - idle_host >
+	    (uint64_t) I_value * 1000) {
+		cpu_error = IDLETIME;
+		cpu_state = ST_STOPPED;
+		return;
+	}
+
+	if (ev_next == EV_NEVER) {
+		/* only input from the host can end it */
+		sleep_for_input(IDLE_SLEEP);
+	} else {
+		t = (ev_next > T) ? ev_next - T : 0;
+		if (f_value || T + t - idle_start > ev_us(IDLE_SKIP)) {
+			if (t > ev_us(IDLE_SLEEP))
+				t = ev_us(IDLE_SLEEP);
+			t1 = get_clock_us();
+			sleep_for_input((unsigned long) (t / ev_us(1)));
+			us = get_clock_us() - t1;
+			if (ev_us(us) < t)	/* woken up by input */
+				t = ev_us(us);
+		}
+		T += t;
+		ev_run();
+	}
+
+	idle_last = T;
+}
@@ -0,0 +1,39 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	Detection of an idle CPU.
+ *
+ *	The CPU is idle, if it waits in HALT for an interrupt, or if it
+ *	polls a port in a tight loop and always reads the same value.
+ *	Then the simulated time until the next event passes without
+ *	executing instructions. With an unlimited CPU speed this time
+ *	is skipped, until the CPU is idle for IDLE_SKIP us of simulated
+ *	time, so that waiting for a simulated device stays fast. After
+ *	that, and with a limited CPU speed, the host sleeps until the
+ *	next event is due, at most IDLE_SLEEP us, or until input for
+ *	the simulation arrives.
+ *
+ *	If the CPU stays idle longer than the host time given with
+ *	option -I, the machine is stopped, so that batch jobs waiting
+ *	for input which never arrives end.
+ */
+
+#ifndef SIMIDLE_INC
+#define SIMIDLE_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define IDLE_POLLS	32	/* polls reading the same, until idle */
+#define IDLE_LOOP	1000	/* max. t-states between these polls */
+#define IDLE_SKIP	10000	/* max. us of simulated time skipped */
+#define IDLE_SLEEP	10000	/* max. us the host sleeps at once */
+
+extern void idle_poll(BYTE port, BYTE data);
+extern void idle_wait(void);
+
+#endif /* !SIMIDLE_INC */
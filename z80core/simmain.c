@@ -36,13 +36,20 @@
 #include "simport.h"
 #include "simfun.h"
 #include "simint.h"
+#include "simsnap.h"
+#include "simevent.h"
 
 #ifdef INFOPANEL
 #include "simpanel.h"
 #endif
 
+static void banner(void);
 static void save_core(void);
 static bool load_core(void);
+static int batch_status(void);
+static void budget_used(void);
+
+static event_t budget_ev = { .ev_func = budget_used }; /* -T budget event */
 
 #ifdef WANT_SDL
 int sim_main(int argc, char *argv[])
@@ -254,6 +261,54 @@ int main(int argc, char *argv[])
 				p_flag = !p_flag;
 				break;
 #endif
+			case 'B':	/* batch mode */
+				B_flag = true;
+				break;
+
+			case 'T':	/* set t-state budget */
+				if (*(s + 1) != '\0') {
+					T_value = strtoull(s + 1, NULL, 10);
+					s += strlen(s + 1);
+				} else {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					T_value = strtoull(argv[0], NULL, 10);
+				}
+				break;
+
+			case 'I':	/* set idle time budget */
+				if (*(s + 1) != '\0') {
+					I_value = atoi(s + 1);
+					s += strlen(s + 1);
+				} else {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					I_value = atoi(argv[0]);
+				}
+				break;
+
+#ifdef HAS_FORKSRV
+			case 'j':	/* get socket for fork server */
+				j_flag = true;
+				s++;
+				if (*s == '\0') {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					s = argv[0];
+				}
+				p = jfn;
+				while (*s)
+					*p++ = *s++;
+				*p = '\0';
+				s--;
+				break;
+#endif
 
 			case '?':
 			case 'h':
@@ -265,7 +320,8 @@ int main(int argc, char *argv[])
 usage:
 
 				printf("usage:\t%s%s%s -s -l -i -u %s-m val "
-				       "-f freq\n\t\t-x filename", pn,
+				       "-f freq\n\t\t-x filename -B -T tstates "
+				       "-I ms", pn,
 #ifndef EXCLUDE_Z80
 				       " -z",
 #else
@@ -294,6 +350,9 @@ usage:
 #endif
 #ifdef HAS_NETSERVER
 				fputs(" -n", stdout);
+#endif
+#ifdef HAS_FORKSRV
+				fputs(" -j socket", stdout);
 #endif
 				fputs("\n\n", stdout);
 #ifndef EXCLUDE_Z80
@@ -321,6 +380,15 @@ usage:
 				puts("\t-m = init memory with val (00-FF)");
 				puts("\t-f = CPU clock frequency freq in MHz");
 				puts("\t-x = load and execute filename");
+				puts("\t-B = batch mode, no banner, exit status "
+				     "tells how the run ended:");
+				puts("\t     0 = halted, 1 = error, "
+				     "2 = t-states used up (-T),");
+				puts("\t     3 = idle too long (-I), "
+				     "4 = end of input");
+				puts("\t-T = stop after tstates t-states");
+				puts("\t-I = stop when the CPU is idle for ms "
+				     "milliseconds");
 #ifdef HAS_DISKS
 				puts("\t-d = use disk images at diskpath");
 				puts("\t     default path for disk images:");
@@ -348,57 +416,19 @@ usage:
 #endif
 #ifdef INFOPANEL
 				puts("\t-p = toggle introspection panel");
+#endif
+#ifdef HAS_FORKSRV
+				puts("\t-j = boot and fork a job for every "
+				     "connection to socket");
 #endif
 				return EXIT_FAILURE;
 			}
 
-	putchar('\n');
-
-#ifndef EXCLUDE_Z80
-	if (cpu == Z80) {
-puts("#######  #####    ###            #####    ###   #     #");
-puts("     #  #     #  #   #          #     #    #    ##   ##");
-puts("    #   #     # #     #         #          #    # # # #");
-puts("   #     #####  #     #  #####   #####     #    #  #  #");
-puts("  #     #     # #     #               #    #    #     #");
-puts(" #      #     #  #   #          #     #    #    #     #");
-puts("#######  #####    ###            #####    ###   #     #");
-	}
-#endif
-#ifndef EXCLUDE_I8080
-	if (cpu == I8080) {
-puts(" #####    ###     #####    ###            #####    ###   #     #");
-puts("#     #  #   #   #     #  #   #          #     #    #    ##   ##");
-puts("#     # #     #  #     # #     #         #          #    # # # #");
-puts(" #####  #     #   #####  #     #  #####   #####     #    #  #  #");
-puts("#     # #     #  #     # #     #               #    #    #     #");
-puts("#     #  #   #   #     #  #   #          #     #    #    #     #");
-puts(" #####    ###     #####    ###            #####    ###   #     #");
-	}
-#endif
-
-	printf("\nRelease %s, %s\n", RELEASE, COPYR);
-
-#ifdef USR_COM
-	printf("%s Release %s\n%s\n\n", USR_COM, USR_REL, USR_CPR);
-#else
-	putchar('\n');
-#endif
-
-	if (f_value > 0)
-		printf("CPU speed is %d MHz", f_value);
-	else
-		fputs("CPU speed is unlimited", stdout);
-
-#ifndef UNDOC_INST
-	puts(", CPU doesn't execute undocumented instructions");
-#else
-	if (u_flag)
-		puts(", CPU doesn't execute undocumented instructions");
-	else
-		puts(", CPU executes undocumented instructions");
-#endif
-	fflush(stdout);
+	if (B_flag) {		/* batch mode runs with unlimited speed */
+		f_value = 0;
+		tmax = 100000;
+	} else
+		banner();
 
 	/* if the machine has configuration files try to find them */
 #ifdef CONFDIR
@@ -431,21 +461,28 @@ puts(" #####    ###     #####    ###            #####    ###   #     #");
 	init_cpu();		/* initialize CPU */
 	init_memory();		/* initialize memory configuration */
 
-	if (l_flag) {		/* load core */
-		if (!load_core())
-			return EXIT_FAILURE;
-	} else if (x_flag) { 	/* OR load memory from file */
+	if (!l_flag && x_flag) { /* load memory from file */
 		if (!load_file(xfn, 0, 0)) /* don't care where it loads */
 			return EXIT_FAILURE;
 	}
 
 	int_on();		/* initialize UNIX interrupts */
 	init_io();		/* initialize I/O devices */
+
+	/* load core after the devices registered their snapshot chunks */
+	if (l_flag && !load_core()) {
+		exit_io();
+		int_off();
+		return EXIT_FAILURE;
+	}
 #ifdef INFOPANEL
 	if (p_flag)
 		init_panel();	/* initialize introspection panel */
 #endif
 
+	if (T_value)		/* stop when the t-state budget is used up */
+		ev_schedule(&budget_ev, T_value);
+
 	mon();			/* run system */
 
 	if (s_flag)		/* save core */
@@ -458,19 +495,110 @@ puts(" #####    ###     #####    ###            #####    ###   #     #");
 	exit_io();		/* stop I/O devices */
 	int_off();		/* stop UNIX interrupts */
 
-	return EXIT_SUCCESS;
+	return B_flag ? batch_status() : EXIT_SUCCESS;
 }
 
 /*
- *	This function saves the CPU and the memory into the
- *	file core.z80 or core.8080
+ *	Print the banner with release and CPU
+ */
+static void banner(void)
+{
+	putchar('\n');
+
+#ifndef EXCLUDE_Z80
+	if (cpu == Z80) {
+puts("#######  #####    ###            #####    ###   #     #");
+puts("     #  #     #  #   #          #     #    #    ##   ##");
+puts("    #   #     # #     #         #          #    # # # #");
+puts("   #     #####  #     #  #####   #####     #    #  #  #");
+puts("  #     #     # #     #               #    #    #     #");
+puts(" #      #     #  #   #          #     #    #    #     #");
+puts("#######  #####    ###            #####    ###   #     #");
+	}
+#endif
+#ifndef EXCLUDE_I8080
+	if (cpu == I8080) {
+puts(" #####    ###     #####    ###            #####    ###   #     #");
+puts("#     #  #   #   #     #  #   #          #     #    #    ##   ##");
+puts("#     # #     #  #     # #     #         #          #    # # # #");
+puts(" #####  #     #   #####  #     #  #####   #####     #    #  #  #");
+puts("#     # #     #  #     # #     #               #    #    #     #");
+puts("#     #  #   #   #     #  #   #          #     #    #    #     #");
+puts(" #####    ###     #####    ###            #####    ###   #     #");
+	}
+#endif
+
+	printf("\nRelease %s, %s\n", RELEASE, COPYR);
+
+#ifdef USR_COM
+	printf("%s Release %s\n%s\n\n", USR_COM, USR_REL, USR_CPR);
+#else
+	putchar('\n');
+#endif
+
+	if (f_value > 0)
+		printf("CPU speed is %d MHz", f_value);
+	else
+		fputs("CPU speed is unlimited", stdout);
+
+#ifndef UNDOC_INST
+	puts(", CPU doesn't execute undocumented instructions");
+#else
+	if (u_flag)
+		puts(", CPU doesn't execute undocumented instructions");
+	else
+		puts(", CPU executes undocumented instructions");
+#endif
+	fflush(stdout);
+}
+
+/*
+ *	Event for the t-state budget of option -T
+ */
+static void budget_used(void)
+{
+	cpu_error = BUDGET;
+	cpu_state = ST_STOPPED;
+}
+
+/*
+ *	Exit status of a run in batch mode:
+ *	0 = the machine halted, 1 = error,
+ *	2 = t-state budget used up, 3 = CPU idle too long,
+ *	4 = end of the input
+ */
+static int batch_status(void)
+{
+	switch (cpu_error) {
+	case NONE:
+	case OPHALT:
+	case IOHALT:
+	case POWEROFF:
+		return EXIT_SUCCESS;
+	case BUDGET:
+		return 2;
+	case IDLETIME:
+		return 3;
+	case INPUTEOF:
+		return 4;
+	default:
+		return EXIT_FAILURE;
+	}
+}
+
+/*
+ *	This function saves a snapshot of the machine into the
+ *	file core.z80 or core.8080, machines without snapshots
+ *	save the CPU and the 64 KB memory seen by the CPU
  */
 static void save_core(void)
 {
+#ifndef HAS_SNAPSHOT
 	register FILE *fp;
 	register int i;
 	int fd;
 	bool err;
+#endif
 	const char *fname;
 
 #ifndef EXCLUDE_Z80
@@ -481,6 +609,9 @@ static void save_core(void)
 	if (cpu == I8080)
 		fname = "core.8080";
 #endif
+#ifdef HAS_SNAPSHOT
+	snap_save(fname);	/* tells itself what went wrong */
+#else
 	if ((fd = open(fname, O_WRONLY | O_CREAT, 0600)) == -1
 	    || (fp = fdopen(fd, "w")) == NULL) {
 		if (fd != -1)
@@ -543,11 +674,15 @@ static void save_core(void)
 
 	if (err)
 		printf("error writing %s\n", fname);
+#endif
 }
 
 /*
- *	This function loads the CPU and memory from the
- *	file core.z80 or core.8080
+ *	This function loads a snapshot of the machine from the
+ *	file core.z80 or core.8080, files without the header of
+ *	a snapshot and all files on machines without snapshots
+ *	are loaded in the old format with the CPU registers and
+ *	64 KB memory
  */
 static bool load_core(void)
 {
@@ -564,6 +699,18 @@ static bool load_core(void)
 	if (cpu == I8080)
 		fname = "core.8080";
 #endif
+#ifdef HAS_SNAPSHOT
+	switch (snap_load(fname)) {
+	case SNAP_OK:
+		return true;
+	case SNAP_ERROR:
+		/* snap_load() already told what went wrong */
+		return false;
+	default:
+		break;
+	}
+#endif
+
 	if ((fp = fopen(fname, "r")) == NULL) {
 		printf("can't open file %s\n", fname);
 		return false;
@@ -0,0 +1,88 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This module implements the page table for the memory
+ *	of the simulated machines, see simpage.h
+ */
+
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simpage.h"
+
+pg_desc_t pg_map[PG_PAGES];	/* the page table */
+
+/*
+ *	Set up an empty page table, no memory mapped and no traps
+ */
+void pg_init(void)
+{
+	memset(pg_map, 0, sizeof(pg_map));
+}
+
+/*
+ *	Map size bytes of RAM at host memory mem to addr, the
+ *	flags are kept, addr and size must be multiples of the page size
+ */
+void pg_ram(int addr, int size, BYTE *mem)
+{
+	register pg_desc_t *p = &pg_map[addr >> PG_SHIFT];
+	register int n = size >> PG_SHIFT;
+
+	for (; n > 0; n--, p++, mem += PG_SIZE)
+		p->pg_mem = mem;
+}
+
+/*
+ *	Set trap flags of the pages from addr to addr + size,
+ *	the mapping of the pages is not changed
+ */
+void pg_set_flags(int addr, int size, unsigned flags)
+{
+	register pg_desc_t *p = &pg_map[addr >> PG_SHIFT];
+	register int n = size >> PG_SHIFT;
+
+	for (; n > 0; n--, p++)
+		p->pg_flags |= flags;
+}
+
+/*
+ *	Clear trap flags of the pages from addr to addr + size
+ */
+void pg_clr_flags(int addr, int size, unsigned flags)
+{
+	register pg_desc_t *p = &pg_map[addr >> PG_SHIFT];
+	register int n = size >> PG_SHIFT;
+
+	for (; n > 0; n--, p++)
+		p->pg_flags &= ~flags;
+}
+
+/*
+ *	Host memory for a block transfer of len bytes at addr,
+ *	or NULL if the block isn't contiguous in host memory or
+ *	a page of it has to be accessed byte by byte
+ */
+BYTE *pg_host(WORD addr, int len, bool wr)
+{
+	register pg_desc_t *p = &pg_map[addr >> PG_SHIFT];
+	register int n;
+	register BYTE *mem, *base;
+	unsigned mask = wr ? PG_WPROT : 0;
+
+	if (len <= 0 || addr + len > 65536)
+		return NULL;
+
+	n = ((addr & PG_MASK) + len + PG_MASK) >> PG_SHIFT;
+	base = mem = p->pg_mem;
+	for (; n > 0; n--, p++, mem += PG_SIZE)
+		if ((p->pg_flags & mask) || p->pg_mem != mem)
+			return NULL;
+
+	return base + (addr & PG_MASK);
+}
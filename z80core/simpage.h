@@ -0,0 +1,70 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	Page table for the memory of the simulated machines.
+ *
+ *	The 64 KB address space of the CPU is divided into pages of
+ *	256 bytes. The descriptor of a page holds a pointer to the host
+ *	memory of the page and its flags, so that a normal access is
+ *	one indexed load of the descriptor and the flags only have to
+ *	be checked for writes, which may trap into the machine (write
+ *	protect). A machine describes its memory map with the pg_*()
+ *	functions, and re-points the affected pages once on a bank
+ *	switch or a change of the configuration.
+ */
+
+#ifndef SIMPAGE_INC
+#define SIMPAGE_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define PG_SHIFT	8		/* 256 bytes per page */
+#define PG_SIZE		(1 << PG_SHIFT)
+#define PG_MASK		(PG_SIZE - 1)
+#define PG_PAGES	(65536 >> PG_SHIFT)
+
+#define PG_WPROT	0x01		/* writes trap into the machine */
+
+typedef struct pg_desc {	/* structure of a page descriptor */
+	BYTE	*pg_mem;	/* host memory of the page */
+	unsigned pg_flags;	/* flags of the page */
+} pg_desc_t;
+
+extern pg_desc_t pg_map[PG_PAGES];
+
+extern void pg_init(void);
+extern void pg_ram(int addr, int size, BYTE *mem);
+extern void pg_set_flags(int addr, int size, unsigned flags);
+extern void pg_clr_flags(int addr, int size, unsigned flags);
+extern BYTE *pg_host(WORD addr, int len, bool wr);
+
+/*
+ *	Flags of the page holding addr
+ */
+static inline unsigned pg_flags(WORD addr)
+{
+	return pg_map[addr >> PG_SHIFT].pg_flags;
+}
+
+/*
+ *	Read the byte at addr, traps must have been checked
+ */
+static inline BYTE pg_read(WORD addr)
+{
+	return pg_map[addr >> PG_SHIFT].pg_mem[addr & PG_MASK];
+}
+
+/*
+ *	Write the byte at addr, traps must have been checked
+ */
+static inline void pg_write(WORD addr, BYTE data)
+{
+	pg_map[addr >> PG_SHIFT].pg_mem[addr & PG_MASK] = data;
+}
+
+#endif /* !SIMPAGE_INC */
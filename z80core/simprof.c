@@ -0,0 +1,486 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This module implements the execution profiler of the ICE,
+ *	see simprof.h
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simprof.h"
+
+#ifdef WANT_PROF
+
+typedef struct prof_node {	/* node of the call graph */
+	WORD	pn_addr;	/* address of the routine */
+	int	pn_parent;	/* node of the caller, -1 for the root */
+	int	pn_child;	/* first node called, -1 = none */
+	int	pn_sibling;	/* next node of the caller, -1 = none */
+	uint64_t pn_cnt;	/* t-states/samples in the routine itself */
+} prof_node_t;
+
+typedef struct prof_frame {	/* routine on the call stack */
+	WORD	pf_sp;		/* SP pointing to the return address */
+	int	pf_node;	/* node of the caller */
+} prof_frame_t;
+
+typedef struct prof_sym {	/* symbol loaded from a listing */
+	WORD	ps_addr;	/* value of the symbol */
+	char	*ps_name;	/* name of the symbol */
+} prof_sym_t;
+
+bool p_flag;			/* record profile while running */
+
+static int p_rate;		/* sample every p_rate t-states, 0 = exact */
+static uint64_t *p_cnt;		/* t-states/samples of every address */
+static uint64_t p_total;	/* total t-states/samples */
+static Tstates_t p_T;		/* T at start of the instruction */
+static Tstates_t p_next;	/* T of the next sample */
+static WORD p_pc, p_sp;		/* PC and SP before the instruction */
+static WORD p_npc, p_nsp;	/* PC and SP after the instruction */
+static BYTE p_op;		/* op-code of the instruction */
+
+static prof_node_t *p_node;	/* call graph, node 0 is the root */
+static int p_nodes;		/* no. of nodes used */
+static int p_cur;		/* node of the current routine */
+static prof_frame_t p_stack[PROF_DEPTH];
+static int p_depth;		/* depth of the call stack */
+static bool p_root;		/* address of the root node not yet known */
+
+static prof_sym_t *p_sym;	/* symbols sorted by value */
+static int p_nsym;		/* no. of symbols */
+
+static void prof_call(WORD addr);
+static void prof_clear(void);
+static void prof_show(void);
+static void prof_top(uint64_t *cnt, bool routines);
+static const char *prof_name(WORD addr);
+static void prof_load(char *s);
+static bool prof_ident(const char *s);
+static bool prof_hex(const char *s, WORD *w);
+static int prof_sym_cmp(const void *p1, const void *p2);
+static void prof_folded(char *s);
+static char *prof_fname(char *s);
+
+/*
+ *	Called before the instruction, remember its state and check
+ *	if an interrupt pushed the PC and entered a handler
+ */
+void prof_pre(void)
+{
+	if (p_root) {			/* the root is where the run starts */
+		p_node[0].pn_addr = PC;
+		p_root = false;
+	}
+	if (SP == (WORD) (p_nsp - 2) && PC != p_npc &&
+	    getmem(SP) + (getmem(SP + 1) << 8) == p_npc)
+		prof_call(PC);
+	p_pc = PC;
+	p_sp = SP;
+	p_op = getmem(PC);
+	p_T = T;
+}
+
+/*
+ *	Called after the instruction, count it and follow
+ *	the call stack
+ */
+void prof_post(void)
+{
+	register uint64_t n;
+	register WORD d;
+
+	if (p_rate == 0)
+		n = T - p_T;
+	else if (T >= p_next) {
+		n = 1;
+		p_next += p_rate;
+		if (p_next <= T)
+			p_next = T + p_rate;
+	} else
+		n = 0;
+	if (n) {
+		p_cnt[p_pc] += n;
+		p_node[p_cur].pn_cnt += n;
+		p_total += n;
+	}
+
+	/* leave the routines, whose return address was popped */
+	while (p_depth) {
+		d = SP - p_stack[p_depth - 1].pf_sp;
+		if (d == 0 || d >= 0x8000)
+			break;
+		p_cur = p_stack[--p_depth].pf_node;
+	}
+
+	/* CALL, Ccc or RST pushed the return address */
+	if ((p_op == 0xcd || (p_op & 0xc7) == 0xc4 ||
+	     (p_op & 0xc7) == 0xc7) && SP == (WORD) (p_sp - 2))
+		prof_call(PC);
+
+	p_npc = PC;
+	p_nsp = SP;
+}
+
+/*
+ *	Enter the routine at addr, its node is a child of the node
+ *	of the current routine. If the call stack or the call graph
+ *	is full, the time is counted for the caller.
+ */
+static void prof_call(WORD addr)
+{
+	register int n;
+
+	if (p_depth == PROF_DEPTH)
+		return;
+	for (n = p_node[p_cur].pn_child; n != -1; n = p_node[n].pn_sibling)
+		if (p_node[n].pn_addr == addr)
+			break;
+	if (n == -1 && p_nodes < PROF_NODES) {
+		n = p_nodes++;
+		p_node[n].pn_addr = addr;
+		p_node[n].pn_parent = p_cur;
+		p_node[n].pn_child = -1;
+		p_node[n].pn_sibling = p_node[p_cur].pn_child;
+		p_node[n].pn_cnt = 0;
+		p_node[p_cur].pn_child = n;
+	}
+	p_stack[p_depth].pf_sp = SP;
+	p_stack[p_depth].pf_node = p_cur;
+	p_depth++;
+	if (n != -1)
+		p_cur = n;
+}
+
+/*
+ *	Profiler commands of the ICE
+ */
+void prof_cmd(char *s)
+{
+	switch (tolower((unsigned char) *s)) {
+	case '\n':
+	case '\0':
+		prof_show();
+		break;
+	case 'c':
+		if (p_cnt != NULL)
+			prof_clear();
+		break;
+	case 'r':
+		if (p_flag) {
+			p_flag = false;
+			puts("Profile is no longer recorded while running");
+			break;
+		}
+		if (p_cnt == NULL) {
+			p_cnt = (uint64_t *) malloc(65536 * sizeof(uint64_t));
+			p_node = (prof_node_t *) malloc(PROF_NODES *
+							sizeof(prof_node_t));
+			if (p_cnt == NULL || p_node == NULL) {
+				free(p_cnt);
+				free(p_node);
+				p_cnt = NULL;
+				p_node = NULL;
+				puts("out of memory");
+				break;
+			}
+			prof_clear();
+		}
+		p_rate = atoi(s + 1);
+		if (p_rate < 0)
+			p_rate = 0;
+		p_next = T + p_rate;
+		p_npc = PC;
+		p_nsp = SP;
+		p_flag = true;
+		if (p_rate)
+			printf("Profile is now sampled every %d t-states "
+			       "while running\n", p_rate);
+		else
+			puts("Profile is now recorded while running");
+		break;
+	case 'l':
+		prof_load(s + 1);
+		break;
+	case 'f':
+		prof_folded(s + 1);
+		break;
+	default:
+		puts("what??");
+		break;
+	}
+}
+
+/*
+ *	Clear the profile, the call graph starts with the PC of the
+ *	next run
+ */
+static void prof_clear(void)
+{
+	memset(p_cnt, 0, 65536 * sizeof(uint64_t));
+	p_total = 0;
+	p_node[0].pn_addr = PC;
+	p_root = true;
+	p_node[0].pn_parent = -1;
+	p_node[0].pn_child = -1;
+	p_node[0].pn_sibling = -1;
+	p_node[0].pn_cnt = 0;
+	p_nodes = 1;
+	p_cur = 0;
+	p_depth = 0;
+}
+
+/*
+ *	Show the routines with the most time spent in themselves,
+ *	summed up over all their nodes in the call graph, and the
+ *	instructions with the most time spent
+ */
+static void prof_show(void)
+{
+	register int i;
+	uint64_t *cnt;
+
+	if (p_total == 0) {
+		puts("Profile is empty");
+		return;
+	}
+	if ((cnt = (uint64_t *) calloc(65536, sizeof(uint64_t))) == NULL) {
+		puts("out of memory");
+		return;
+	}
+	printf("%" PRIu64 " %s profiled, %d routines in the call graph\n",
+	       p_total, p_rate ? "samples" : "t-states", p_nodes);
+	for (i = 0; i < p_nodes; i++)
+		cnt[p_node[i].pn_addr] += p_node[i].pn_cnt;
+	prof_top(cnt, true);
+	memcpy(cnt, p_cnt, 65536 * sizeof(uint64_t));
+	prof_top(cnt, false);
+	free(cnt);
+}
+
+/*
+ *	Output the PROF_TOP addresses with the highest counts,
+ *	the counts are cleared while doing so
+ */
+static void prof_top(uint64_t *cnt, bool routines)
+{
+	register int i, j, m;
+	unsigned pct;
+
+	printf("\n%s         Count      %% Symbol\n",
+	       routines ? "Routine" : "Address");
+	for (i = 0; i < PROF_TOP; i++) {
+		m = 0;
+		for (j = 1; j < 65536; j++)
+			if (cnt[j] > cnt[m])
+				m = j;
+		if (cnt[m] == 0)
+			break;
+		pct = (unsigned) ((cnt[m] * 10000) / p_total);
+		printf("%04x    %13" PRIu64 " %3u.%02u %s\n", m, cnt[m],
+		       pct / 100, pct % 100, prof_name(m));
+		cnt[m] = 0;
+	}
+}
+
+/*
+ *	Get the name of an address from the symbols,
+ *	name+offset if it isn't the value of a symbol
+ */
+static const char *prof_name(WORD addr)
+{
+	static char buf[64];
+	register int l, h, m;
+
+	if (p_nsym == 0 || addr < p_sym[0].ps_addr) {
+		snprintf(buf, sizeof(buf), "%04x", addr);
+		return buf;
+	}
+	l = 0;
+	h = p_nsym - 1;
+	while (l < h) {			/* last symbol <= addr */
+		m = (l + h + 1) / 2;
+		if (p_sym[m].ps_addr <= addr)
+			l = m;
+		else
+			h = m - 1;
+	}
+	if (p_sym[l].ps_addr == addr)
+		return p_sym[l].ps_name;
+	snprintf(buf, sizeof(buf), "%s+%x", p_sym[l].ps_name,
+		 addr - p_sym[l].ps_addr);
+	return buf;
+}
+
+/*
+ *	Load the symbols from the symbol table of a z80asm listing,
+ *	or from a file with lines "symbol address" or "address symbol"
+ */
+static void prof_load(char *s)
+{
+	FILE *fp;
+	char line[256], *tok[32], *p;
+	bool skip;
+	prof_sym_t *sp;
+	register int i, n;
+	WORD w;
+
+	s = prof_fname(s);
+	if ((fp = fopen(s, "r")) == NULL) {
+		printf("can't open file %s\n", s);
+		return;
+	}
+	for (i = 0; i < p_nsym; i++)
+		free(p_sym[i].ps_name);
+	free(p_sym);
+	p_sym = NULL;
+	p_nsym = 0;
+
+	/* in a listing only the symbol table is read */
+	skip = false;
+	while (fgets(line, sizeof(line), fp) != NULL)
+		if (strstr(line, "Symbol table") != NULL)
+			skip = true;
+	rewind(fp);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (skip) {
+			skip = (strstr(line, "Symbol table") == NULL);
+			continue;
+		}
+		n = 0;
+		for (p = strtok(line, " \t\r\n"); p != NULL && n < 32;
+		     p = strtok(NULL, " \t\r\n"))
+			tok[n++] = p;
+		for (i = 0; i < n - 1; i++) {
+			if (prof_ident(tok[i]) && prof_hex(tok[i + 1], &w))
+				p = tok[i];
+			else if (prof_hex(tok[i], &w) &&
+				 prof_ident(tok[i + 1]))
+				p = tok[i + 1];
+			else
+				continue;
+			sp = (prof_sym_t *) realloc(p_sym, (p_nsym + 1) *
+						    sizeof(prof_sym_t));
+			if (sp == NULL || (p = strdup(p)) == NULL) {
+				if (sp != NULL)
+					p_sym = sp;
+				puts("out of memory");
+				goto done;
+			}
+			p_sym = sp;
+			p_sym[p_nsym].ps_addr = w;
+			p_sym[p_nsym].ps_name = p;
+			p_nsym++;
+			i++;
+		}
+	}
+done:
+	fclose(fp);
+	if (p_nsym)
+		qsort(p_sym, p_nsym, sizeof(prof_sym_t), prof_sym_cmp);
+	printf("%d symbols loaded\n", p_nsym);
+}
+
+/*
+ *	Check if a token of a listing is a symbol name
+ */
+static bool prof_ident(const char *s)
+{
+	if (!isalpha((unsigned char) *s) && *s != '_' && *s != '.' &&
+	    *s != '$' && *s != '?' && *s != '@')
+		return false;
+	for (s++; *s != '\0'; s++)
+		if (!isalnum((unsigned char) *s) && *s != '_' && *s != '.' &&
+		    *s != '$' && *s != '?' && *s != '@')
+			return false;
+	return true;
+}
+
+/*
+ *	Check if a token of a listing is a four digit hex address,
+ *	optionally followed by a flag like * for an unused symbol
+ */
+static bool prof_hex(const char *s, WORD *w)
+{
+	register int i;
+
+	for (i = 0; i < 4; i++)
+		if (!isxdigit((unsigned char) s[i]))
+			return false;
+	if (isalnum((unsigned char) s[4]))
+		return false;
+	*w = strtol(s, NULL, 16);
+	return true;
+}
+
+/*
+ *	Compare two symbols for qsort()
+ */
+static int prof_sym_cmp(const void *p1, const void *p2)
+{
+	return ((const prof_sym_t *) p1)->ps_addr -
+	       ((const prof_sym_t *) p2)->ps_addr;
+}
+
+/*
+ *	Write the call stacks with their counts in the folded format,
+ *	one line "root;caller;routine count" for every node of the
+ *	call graph with a count
+ */
+static void prof_folded(char *s)
+{
+	FILE *fp;
+	int path[PROF_DEPTH + 1];
+	register int i, j, n;
+
+	s = prof_fname(s);
+	if (p_total == 0) {
+		puts("Profile is empty");
+		return;
+	}
+	if ((fp = fopen(s, "w")) == NULL) {
+		printf("can't create file %s\n", s);
+		return;
+	}
+	for (i = 0; i < p_nodes; i++) {
+		if (p_node[i].pn_cnt == 0)
+			continue;
+		n = 0;
+		for (j = i; j != -1 && n <= PROF_DEPTH; j = p_node[j].pn_parent)
+			path[n++] = j;
+		while (n--)
+			fprintf(fp, "%s%c", prof_name(p_node[path[n]].pn_addr),
+				n ? ';' : ' ');
+		fprintf(fp, "%" PRIu64 "\n", p_node[i].pn_cnt);
+	}
+	fclose(fp);
+	printf("Call stacks written to %s\n", s);
+}
+
+/*
+ *	Strip the white space around a filename
+ */
+static char *prof_fname(char *s)
+{
+	register char *t;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	for (t = s + strlen(s); t > s && isspace((unsigned char) t[-1]);)
+		*--t = '\0';
+	return s;
+}
+
+#endif /* WANT_PROF */
@@ -0,0 +1,46 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	Execution profiler of the ICE.
+ *
+ *	While recording, the CPU loop with the hooks calls prof_pre()
+ *	before and prof_post() after every instruction. The t-states of
+ *	the instruction, or with a sample rate one sample for every rate
+ *	t-states, are added to the address of the instruction and to the
+ *	node of the call graph for the current call stack. The call stack
+ *	is followed with the stack pointer: a CALL or RST, which pushed
+ *	the return address, or an interrupt enters a routine, and every
+ *	instruction which moves SP above the return address of a routine
+ *	leaves it. So RET, RETI and RETN, but also the stack cleanup of
+ *	code which doesn't return, are followed.
+ *
+ *	The ICE shows the self time of the routines and the hottest
+ *	instructions, with the symbols of a z80asm listing if loaded, and
+ *	writes the call stacks in the folded format of flamegraph.pl.
+ */
+
+#ifndef SIMPROF_INC
+#define SIMPROF_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#ifdef WANT_PROF
+
+#define PROF_DEPTH	256	/* max. depth of the call stack */
+#define PROF_NODES	65536	/* max. number of call graph nodes */
+#define PROF_TOP	20	/* max. number of lines in the reports */
+
+extern bool	p_flag;
+
+extern void prof_pre(void);
+extern void prof_post(void);
+extern void prof_cmd(char *s);
+
+#endif /* WANT_PROF */
+
+#endif /* !SIMPROF_INC */
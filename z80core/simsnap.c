@@ -0,0 +1,471 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This module implements snapshots of the simulated machine,
+ *	see simsnap.h
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simsnap.h"
+
+#ifdef HAS_SNAPSHOT
+
+#include "log.h"
+static const char *TAG = "snapshot";
+
+#define SNAP_MAGIC	"z80pack\032"
+#define SNAP_BOM	0x1234	/* byte order mark */
+#define SNAP_PAGE	256	/* size of a memory page */
+
+#define PAGE_ZERO	0	/* page filled with 0, no data */
+#define PAGE_RAW	1	/* page data follows */
+#define PAGE_RLE	2	/* length and compressed page data follow */
+
+typedef struct snap_header {	/* header of a snapshot file */
+	char magic[8];
+	WORD version;
+	WORD bom;
+} snap_header_t;
+
+typedef struct snap_reg {	/* a registered chunk */
+	char tag[4];
+	snap_save_func_t *save;
+	snap_load_func_t *load;
+} snap_reg_t;
+
+static snap_reg_t chunks[SNAP_MAXCHUNKS];
+static int nchunks;
+
+static BYTE *buf;		/* data of the chunk being saved */
+static size_t buf_len, buf_size;
+static bool buf_err;
+
+/*
+ *	Register the functions to save and load the chunk with tag
+ */
+void snap_register(const char *tag, snap_save_func_t *save,
+		   snap_load_func_t *load)
+{
+	if (nchunks == SNAP_MAXCHUNKS) {
+		LOGE(TAG, "too many chunks registered");
+		return;
+	}
+	memcpy(chunks[nchunks].tag, tag, 4);
+	chunks[nchunks].save = save;
+	chunks[nchunks].load = load;
+	nchunks++;
+}
+
+/*
+ *	Find the registered chunk with tag
+ */
+static snap_reg_t *snap_find(const char *tag)
+{
+	register int i;
+
+	for (i = 0; i < nchunks; i++)
+		if (memcmp(chunks[i].tag, tag, 4) == 0)
+			return &chunks[i];
+	return NULL;
+}
+
+/*
+ *	Put len bytes of data into the chunk being saved
+ */
+void snap_put(const void *data, size_t len)
+{
+	BYTE *p;
+	size_t n;
+
+	if (buf_len + len > buf_size) {
+		n = buf_size ? buf_size : 65536;
+		while (buf_len + len > n)
+			n *= 2;
+		if ((p = (BYTE *) realloc(buf, n)) == NULL) {
+			buf_err = true;
+			return;
+		}
+		buf = p;
+		buf_size = n;
+	}
+	memcpy(buf + buf_len, data, len);
+	buf_len += len;
+}
+
+/*
+ *	Run-length compress len bytes at src into dst, a byte n < 128
+ *	is followed by n + 1 bytes to copy, a byte n >= 128 by one
+ *	byte to repeat n - 125 times, returns the compressed length
+ */
+static size_t rle_compress(const BYTE *src, size_t len, BYTE *dst)
+{
+	size_t i = 0, j, n = 0, lit;
+
+	while (i < len) {
+		/* repeat at least three bytes */
+		for (j = i + 1; j < len && j - i < 130 && src[j] == src[i];
+		     j++)
+			;
+		if (j - i >= 3) {
+			dst[n++] = (BYTE) (j - i + 125);
+			dst[n++] = src[i];
+			i = j;
+			continue;
+		}
+
+		/* else copy bytes up to the next repeat */
+		for (lit = i; lit < len && lit - i < 128; lit++)
+			if (lit + 2 < len && src[lit] == src[lit + 1] &&
+			    src[lit] == src[lit + 2])
+				break;
+		dst[n++] = (BYTE) (lit - i - 1);
+		while (i < lit)
+			dst[n++] = src[i++];
+	}
+
+	return n;
+}
+
+/*
+ *	Put size bytes of memory into the chunk being saved, pages
+ *	filled with 0 are left out, the others are compressed
+ */
+void snap_put_mem(const BYTE *mem, size_t size)
+{
+	static const BYTE zero[SNAP_PAGE];
+	BYTE rle[SNAP_PAGE * 2], type;
+	size_t i, n, len;
+	WORD w;
+
+	for (i = 0; i < size; i += SNAP_PAGE) {
+		n = (size - i < SNAP_PAGE) ? size - i : SNAP_PAGE;
+		if (memcmp(mem + i, zero, n) == 0) {
+			type = PAGE_ZERO;
+			snap_put(&type, 1);
+		} else if ((len = rle_compress(mem + i, n, rle)) < n) {
+			type = PAGE_RLE;
+			w = (WORD) len;
+			snap_put(&type, 1);
+			snap_put(&w, sizeof(w));
+			snap_put(rle, len);
+		} else {
+			type = PAGE_RAW;
+			snap_put(&type, 1);
+			snap_put(mem + i, n);
+		}
+	}
+}
+
+/*
+ *	Get len bytes of data from the chunk being loaded
+ */
+bool snap_get(snap_chunk_t *c, void *data, size_t len)
+{
+	if (len > c->len)
+		return false;
+	memcpy(data, c->data, len);
+	c->data += len;
+	c->len -= len;
+	return true;
+}
+
+/*
+ *	Decompress run-length compressed data at src of length len
+ *	into size bytes at dst
+ */
+static bool rle_expand(const BYTE *src, size_t len, BYTE *dst, size_t size)
+{
+	size_t i = 0, n = 0, cnt;
+
+	while (i < len) {
+		if (src[i] < 128) {
+			cnt = src[i++] + 1;
+			if (i + cnt > len || n + cnt > size)
+				return false;
+			memcpy(dst + n, src + i, cnt);
+			i += cnt;
+		} else {
+			cnt = src[i++] - 125;
+			if (i >= len || n + cnt > size)
+				return false;
+			memset(dst + n, src[i++], cnt);
+		}
+		n += cnt;
+	}
+
+	return n == size;
+}
+
+/*
+ *	Get size bytes of memory from the chunk being loaded
+ */
+bool snap_get_mem(snap_chunk_t *c, BYTE *mem, size_t size)
+{
+	BYTE type;
+	size_t i, n;
+	WORD w;
+
+	for (i = 0; i < size; i += SNAP_PAGE) {
+		n = (size - i < SNAP_PAGE) ? size - i : SNAP_PAGE;
+		if (!snap_get(c, &type, 1))
+			return false;
+		switch (type) {
+		case PAGE_ZERO:
+			memset(mem + i, 0, n);
+			break;
+		case PAGE_RAW:
+			if (!snap_get(c, mem + i, n))
+				return false;
+			break;
+		case PAGE_RLE:
+			if (!snap_get(c, &w, sizeof(w)) || w > c->len ||
+			    !rle_expand(c->data, w, mem + i, n))
+				return false;
+			c->data += w;
+			c->len -= w;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ *	The chunk with the CPU registers
+ */
+static void save_cpu(void)
+{
+	BYTE regs[] = {
+		cpu, A, F, B, C, D, E, H, L, IFF, int_protection,
+#ifndef EXCLUDE_Z80
+		A_, F_, B_, C_, D_, E_, H_, L_, I, R, R_, int_mode
+#endif
+	};
+	WORD wregs[] = {
+		PC, SP,
+#ifndef EXCLUDE_Z80
+		IX, IY
+#endif
+	};
+
+	snap_put(regs, sizeof(regs));
+	snap_put(wregs, sizeof(wregs));
+}
+
+static bool load_cpu(snap_chunk_t *c)
+{
+#ifndef EXCLUDE_Z80
+	BYTE regs[23];
+	WORD wregs[4];
+#else
+	BYTE regs[11];
+	WORD wregs[2];
+#endif
+
+	if (!snap_get(c, regs, sizeof(regs)) ||
+	    !snap_get(c, wregs, sizeof(wregs)))
+		return false;
+
+	if (regs[0] != cpu) {
+		LOGE(TAG, "snapshot was saved for another CPU");
+		return false;
+	}
+	A = regs[1];
+	F = regs[2];
+	B = regs[3];
+	C = regs[4];
+	D = regs[5];
+	E = regs[6];
+	H = regs[7];
+	L = regs[8];
+	IFF = regs[9];
+	int_protection = regs[10];
+	PC = wregs[0];
+	SP = wregs[1];
+#ifndef EXCLUDE_Z80
+	A_ = regs[11];
+	F_ = regs[12];
+	B_ = regs[13];
+	C_ = regs[14];
+	D_ = regs[15];
+	E_ = regs[16];
+	H_ = regs[17];
+	L_ = regs[18];
+	I = regs[19];
+	R = regs[20];
+	R_ = regs[21];
+	int_mode = regs[22];
+	IX = wregs[2];
+	IY = wregs[3];
+#endif
+
+	return true;
+}
+
+/*
+ *	Write the chunk with tag, the data is put by function save
+ */
+static bool write_chunk(FILE *fp, const char *tag, snap_save_func_t *save)
+{
+	uint32_t len;
+
+	buf_len = 0;
+	buf_err = false;
+	(*save)();
+	if (buf_err) {
+		LOGE(TAG, "no memory for chunk %.4s", tag);
+		return false;
+	}
+
+	len = buf_len;
+	return fwrite(tag, 4, 1, fp) == 1 &&
+	       fwrite(&len, sizeof(len), 1, fp) == 1 &&
+	       (len == 0 || fwrite(buf, len, 1, fp) == 1);
+}
+
+static void save_end(void)
+{
+}
+
+/*
+ *	Save a snapshot of the machine into file fname
+ */
+bool snap_save(const char *fname)
+{
+	snap_header_t hdr;
+	FILE *fp;
+	int fd, i;
+	bool ok;
+
+	if (snap_find("MEM ") == NULL) {
+		LOGE(TAG, "machine doesn't save its memory, no snapshot");
+		return false;
+	}
+
+	if ((fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1 ||
+	    (fp = fdopen(fd, "w")) == NULL) {
+		if (fd != -1)
+			close(fd);
+		LOGE(TAG, "can't open file %s", fname);
+		return false;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+	hdr.version = SNAP_VERSION;
+	hdr.bom = SNAP_BOM;
+
+	ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+	     write_chunk(fp, "CPU ", save_cpu);
+	for (i = 0; ok && i < nchunks; i++)
+		ok = write_chunk(fp, chunks[i].tag, chunks[i].save);
+	if (ok)
+		ok = write_chunk(fp, "END ", save_end);
+
+	if (fclose(fp) != 0)
+		ok = false;
+	free(buf);
+	buf = NULL;
+	buf_size = 0;
+
+	if (!ok)
+		LOGE(TAG, "error writing %s", fname);
+	return ok;
+}
+
+/*
+ *	Load a snapshot of the machine from file fname, returns
+ *	SNAP_NOSNAP if the file has another format
+ */
+int snap_load(const char *fname)
+{
+	snap_header_t hdr;
+	snap_chunk_t c;
+	snap_reg_t *r;
+	struct stat sbuf;
+	const BYTE *p, *end;
+	void *map;
+	uint32_t len;
+	int fd, ret;
+	bool mem;
+
+	if ((fd = open(fname, O_RDONLY)) == -1) {
+		LOGE(TAG, "can't open file %s", fname);
+		return SNAP_ERROR;
+	}
+	if (fstat(fd, &sbuf) == -1 || sbuf.st_size < (off_t) sizeof(hdr) ||
+	    (map = mmap(NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+	    == MAP_FAILED) {
+		close(fd);
+		return SNAP_NOSNAP;
+	}
+	close(fd);
+
+	p = (const BYTE *) map;
+	end = p + sbuf.st_size;
+	memcpy(&hdr, p, sizeof(hdr));
+	p += sizeof(hdr);
+
+	if (memcmp(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic)) != 0) {
+		munmap(map, sbuf.st_size);
+		return SNAP_NOSNAP;
+	}
+	if (hdr.bom != SNAP_BOM || hdr.version > SNAP_VERSION) {
+		LOGE(TAG, "%s has an unsupported format", fname);
+		munmap(map, sbuf.st_size);
+		return SNAP_ERROR;
+	}
+
+	ret = SNAP_ERROR;
+	mem = false;
+	while (end - p >= 8) {
+		memcpy(&len, p + 4, sizeof(len));
+		if (len > (size_t) (end - p - 8))
+			break;
+		c.data = p + 8;
+		c.len = len;
+
+		if (memcmp(p, "END ", 4) == 0) {
+			/* without the memory the machine can't continue */
+			if (mem)
+				ret = SNAP_OK;
+			break;
+		} else if (memcmp(p, "CPU ", 4) == 0) {
+			if (!load_cpu(&c))
+				break;
+		} else if ((r = snap_find((const char *) p)) != NULL) {
+			if (!(*r->load)(&c))
+				break;
+			if (memcmp(p, "MEM ", 4) == 0)
+				mem = true;
+		} else
+			LOGW(TAG, "skipping unknown chunk %.4s", (const char *) p);
+
+		p += 8 + len;
+	}
+
+	munmap(map, sbuf.st_size);
+
+	if (ret != SNAP_OK)
+		LOGE(TAG, "error reading %s", fname);
+	return ret;
+}
+
+#endif /* HAS_SNAPSHOT */
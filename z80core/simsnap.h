@@ -0,0 +1,71 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	Snapshots of the simulated machine.
+ *
+ *	A snapshot file starts with a header holding a magic, the
+ *	format version and a byte order mark, followed by chunks.
+ *	Every chunk has a tag of four characters and the length of
+ *	its data. The CPU chunk is written by the core, the machine
+ *	and its devices register functions, which put their state into
+ *	a chunk on save and get it back on load. Chunks with an unknown
+ *	tag are skipped, so that snapshots stay loadable, when devices
+ *	are added. Memory is put as pages of 256 bytes, pages filled
+ *	with 0 are left out and the others are run-length compressed.
+ *	Values are stored in the byte order of the host, snapshots are
+ *	meant for restarting a machine on the same host quickly.
+ *
+ *	Only machines defining HAS_SNAPSHOT take snapshots, they must
+ *	register chunks for all of their memory and every device with
+ *	state, so that the machine continues from a snapshot exactly
+ *	as it was saved. The other machines save the CPU registers
+ *	and the 64 KB memory seen by the CPU in the old core format.
+ *
+ *	A snapshot is loaded from a memory mapping of the file, the
+ *	load functions get a pointer to the data of their chunk and
+ *	take the values from it with snap_get() and snap_get_mem().
+ */
+
+#ifndef SIMSNAP_INC
+#define SIMSNAP_INC
+
+#include <stddef.h>
+
+#include "sim.h"
+#include "simdefs.h"
+
+#ifdef HAS_SNAPSHOT
+
+#define SNAP_VERSION	1	/* version of the snapshot format */
+#define SNAP_MAXCHUNKS	16	/* max. number of registered chunks */
+
+#define SNAP_OK		0	/* snapshot loaded */
+#define SNAP_NOSNAP	1	/* file isn't a snapshot */
+#define SNAP_ERROR	2	/* error loading the snapshot */
+
+typedef struct snap_chunk {	/* data of a chunk being loaded */
+	const BYTE *data;	/* next byte to get */
+	size_t len;		/* number of bytes left */
+} snap_chunk_t;
+
+typedef void (snap_save_func_t)(void);
+typedef bool (snap_load_func_t)(snap_chunk_t *c);
+
+extern void snap_register(const char *tag, snap_save_func_t *save,
+			  snap_load_func_t *load);
+
+extern void snap_put(const void *data, size_t len);
+extern void snap_put_mem(const BYTE *mem, size_t size);
+extern bool snap_get(snap_chunk_t *c, void *data, size_t len);
+extern bool snap_get_mem(snap_chunk_t *c, BYTE *mem, size_t size);
+
+extern bool snap_save(const char *fname);
+extern int snap_load(const char *fname);
+
+#endif /* HAS_SNAPSHOT */
+
+#endif /* !SIMSNAP_INC */
@@ -11,6 +11,8 @@
 #include "simmem.h"
 #include "simcore.h"
 #include "simport.h"
+#include "simevent.h"
+#include "simidle.h"
 #include "simz80.h"
 #include "simz80-cb.h"
 #include "simz80-dd.h"
@@ -19,6 +21,7 @@
 
 #ifdef WANT_ICE
 #include "simice.h"
+#include "simprof.h"
 #endif
 
 #ifdef FRONTPANEL
@@ -116,6 +119,282 @@ static int op_rst00(void), op_rst08(void), op_rst10(void), op_rst18(void);
 static int op_rst20(void), op_rst28(void), op_rst30(void), op_rst38(void);
 #endif /* !ALT_Z80 */
 
+#ifndef ALT_Z80
+static int (*op_sim[256])(void) = {
+	op_nop,				/* 0x00 */
+	op_ldbcnn,			/* 0x01 */
+	op_ldbca,			/* 0x02 */
+	op_incbc,			/* 0x03 */
+	op_incb,			/* 0x04 */
+	op_decb,			/* 0x05 */
+	op_ldbn,			/* 0x06 */
+	op_rlca,			/* 0x07 */
+	op_exafaf,			/* 0x08 */
+	op_adhlbc,			/* 0x09 */
+	op_ldabc,			/* 0x0a */
+	op_decbc,			/* 0x0b */
+	op_incc,			/* 0x0c */
+	op_decc,			/* 0x0d */
+	op_ldcn,			/* 0x0e */
+	op_rrca,			/* 0x0f */
+	op_djnz,			/* 0x10 */
+	op_lddenn,			/* 0x11 */
+	op_lddea,			/* 0x12 */
+	op_incde,			/* 0x13 */
+	op_incd,			/* 0x14 */
+	op_decd,			/* 0x15 */
+	op_lddn,			/* 0x16 */
+	op_rla,				/* 0x17 */
+	op_jr,				/* 0x18 */
+	op_adhlde,			/* 0x19 */
+	op_ldade,			/* 0x1a */
+	op_decde,			/* 0x1b */
+	op_ince,			/* 0x1c */
+	op_dece,			/* 0x1d */
+	op_lden,			/* 0x1e */
+	op_rra,				/* 0x1f */
+	op_jrnz,			/* 0x20 */
+	op_ldhlnn,			/* 0x21 */
+	op_ldinhl,			/* 0x22 */
+	op_inchl,			/* 0x23 */
+	op_inch,			/* 0x24 */
+	op_dech,			/* 0x25 */
+	op_ldhn,			/* 0x26 */
+	op_daa,				/* 0x27 */
+	op_jrz,				/* 0x28 */
+	op_adhlhl,			/* 0x29 */
+	op_ldhlin,			/* 0x2a */
+	op_dechl,			/* 0x2b */
+	op_incl,			/* 0x2c */
+	op_decl,			/* 0x2d */
+	op_ldln,			/* 0x2e */
+	op_cpl,				/* 0x2f */
+	op_jrnc,			/* 0x30 */
+	op_ldspnn,			/* 0x31 */
+	op_ldnna,			/* 0x32 */
+	op_incsp,			/* 0x33 */
+	op_incihl,			/* 0x34 */
+	op_decihl,			/* 0x35 */
+	op_ldhl1,			/* 0x36 */
+	op_scf,				/* 0x37 */
+	op_jrc,				/* 0x38 */
+	op_adhlsp,			/* 0x39 */
+	op_ldann,			/* 0x3a */
+	op_decsp,			/* 0x3b */
+	op_inca,			/* 0x3c */
+	op_deca,			/* 0x3d */
+	op_ldan,			/* 0x3e */
+	op_ccf,				/* 0x3f */
+	op_ldbb,			/* 0x40 */
+	op_ldbc,			/* 0x41 */
+	op_ldbd,			/* 0x42 */
+	op_ldbe,			/* 0x43 */
+	op_ldbh,			/* 0x44 */
+	op_ldbl,			/* 0x45 */
+	op_ldbhl,			/* 0x46 */
+	op_ldba,			/* 0x47 */
+	op_ldcb,			/* 0x48 */
+	op_ldcc,			/* 0x49 */
+	op_ldcd,			/* 0x4a */
+	op_ldce,			/* 0x4b */
+	op_ldch,			/* 0x4c */
+	op_ldcl,			/* 0x4d */
+	op_ldchl,			/* 0x4e */
+	op_ldca,			/* 0x4f */
+	op_lddb,			/* 0x50 */
+	op_lddc,			/* 0x51 */
+	op_lddd,			/* 0x52 */
+	op_ldde,			/* 0x53 */
+	op_lddh,			/* 0x54 */
+	op_lddl,			/* 0x55 */
+	op_lddhl,			/* 0x56 */
+	op_ldda,			/* 0x57 */
+	op_ldeb,			/* 0x58 */
+	op_ldec,			/* 0x59 */
+	op_lded,			/* 0x5a */
+	op_ldee,			/* 0x5b */
+	op_ldeh,			/* 0x5c */
+	op_ldel,			/* 0x5d */
+	op_ldehl,			/* 0x5e */
+	op_ldea,			/* 0x5f */
+	op_ldhb,			/* 0x60 */
+	op_ldhc,			/* 0x61 */
+	op_ldhd,			/* 0x62 */
+	op_ldhe,			/* 0x63 */
+	op_ldhh,			/* 0x64 */
+	op_ldhl,			/* 0x65 */
+	op_ldhhl,			/* 0x66 */
+	op_ldha,			/* 0x67 */
+	op_ldlb,			/* 0x68 */
+	op_ldlc,			/* 0x69 */
+	op_ldld,			/* 0x6a */
+	op_ldle,			/* 0x6b */
+	op_ldlh,			/* 0x6c */
+	op_ldll,			/* 0x6d */
+	op_ldlhl,			/* 0x6e */
+	op_ldla,			/* 0x6f */
+	op_ldhlb,			/* 0x70 */
+	op_ldhlc,			/* 0x71 */
+	op_ldhld,			/* 0x72 */
+	op_ldhle,			/* 0x73 */
+	op_ldhlh,			/* 0x74 */
+	op_ldhll,			/* 0x75 */
+	op_halt,			/* 0x76 */
+	op_ldhla,			/* 0x77 */
+	op_ldab,			/* 0x78 */
+	op_ldac,			/* 0x79 */
+	op_ldad,			/* 0x7a */
+	op_ldae,			/* 0x7b */
+	op_ldah,			/* 0x7c */
+	op_ldal,			/* 0x7d */
+	op_ldahl,			/* 0x7e */
+	op_ldaa,			/* 0x7f */
+	op_addb,			/* 0x80 */
+	op_addc,			/* 0x81 */
+	op_addd,			/* 0x82 */
+	op_adde,			/* 0x83 */
+	op_addh,			/* 0x84 */
+	op_addl,			/* 0x85 */
+	op_addhl,			/* 0x86 */
+	op_adda,			/* 0x87 */
+	op_adcb,			/* 0x88 */
+	op_adcc,			/* 0x89 */
+	op_adcd,			/* 0x8a */
+	op_adce,			/* 0x8b */
+	op_adch,			/* 0x8c */
+	op_adcl,			/* 0x8d */
+	op_adchl,			/* 0x8e */
+	op_adca,			/* 0x8f */
+	op_subb,			/* 0x90 */
+	op_subc,			/* 0x91 */
+	op_subd,			/* 0x92 */
+	op_sube,			/* 0x93 */
+	op_subh,			/* 0x94 */
+	op_subl,			/* 0x95 */
+	op_subhl,			/* 0x96 */
+	op_suba,			/* 0x97 */
+	op_sbcb,			/* 0x98 */
+	op_sbcc,			/* 0x99 */
+	op_sbcd,			/* 0x9a */
+	op_sbce,			/* 0x9b */
+	op_sbch,			/* 0x9c */
+	op_sbcl,			/* 0x9d */
+	op_sbchl,			/* 0x9e */
+	op_sbca,			/* 0x9f */
+	op_andb,			/* 0xa0 */
+	op_andc,			/* 0xa1 */
+	op_andd,			/* 0xa2 */
+	op_ande,			/* 0xa3 */
+	op_andh,			/* 0xa4 */
+	op_andl,			/* 0xa5 */
+	op_andhl,			/* 0xa6 */
+	op_anda,			/* 0xa7 */
+	op_xorb,			/* 0xa8 */
+	op_xorc,			/* 0xa9 */
+	op_xord,			/* 0xaa */
+	op_xore,			/* 0xab */
+	op_xorh,			/* 0xac */
+	op_xorl,			/* 0xad */
+	op_xorhl,			/* 0xae */
+	op_xora,			/* 0xaf */
+	op_orb,				/* 0xb0 */
+	op_orc,				/* 0xb1 */
+	op_ord,				/* 0xb2 */
+	op_ore,				/* 0xb3 */
+	op_orh,				/* 0xb4 */
+	op_orl,				/* 0xb5 */
+	op_orhl,			/* 0xb6 */
+	op_ora,				/* 0xb7 */
+	op_cpb,				/* 0xb8 */
+	op_cpc,				/* 0xb9 */
+	op_cpd,				/* 0xba */
+	op_cpe,				/* 0xbb */
+	op_cph,				/* 0xbc */
+	op_cplr,			/* 0xbd */
+	op_cphl,			/* 0xbe */
+	op_cpa,				/* 0xbf */
+	op_retnz,			/* 0xc0 */
+	op_popbc,			/* 0xc1 */
+	op_jpnz,			/* 0xc2 */
+	op_jp,				/* 0xc3 */
+	op_calnz,			/* 0xc4 */
+	op_pushbc,			/* 0xc5 */
+	op_addn,			/* 0xc6 */
+	op_rst00,			/* 0xc7 */
+	op_retz,			/* 0xc8 */
+	op_ret,				/* 0xc9 */
+	op_jpz,				/* 0xca */
+	op_cb_handle,			/* 0xcb */
+	op_calz,			/* 0xcc */
+	op_call,			/* 0xcd */
+	op_adcn,			/* 0xce */
+	op_rst08,			/* 0xcf */
+	op_retnc,			/* 0xd0 */
+	op_popde,			/* 0xd1 */
+	op_jpnc,			/* 0xd2 */
+	op_out,				/* 0xd3 */
+	op_calnc,			/* 0xd4 */
+	op_pushde,			/* 0xd5 */
+	op_subn,			/* 0xd6 */
+	op_rst10,			/* 0xd7 */
+	op_retc,			/* 0xd8 */
+	op_exx,				/* 0xd9 */
+	op_jpc,				/* 0xda */
+	op_in,				/* 0xdb */
+	op_calc,			/* 0xdc */
+	op_dd_handle,			/* 0xdd */
+	op_sbcn,			/* 0xde */
+	op_rst18,			/* 0xdf */
+	op_retpo,			/* 0xe0 */
+	op_pophl,			/* 0xe1 */
+	op_jppo,			/* 0xe2 */
+	op_exsphl,			/* 0xe3 */
+	op_calpo,			/* 0xe4 */
+	op_pushhl,			/* 0xe5 */
+	op_andn,			/* 0xe6 */
+	op_rst20,			/* 0xe7 */
+	op_retpe,			/* 0xe8 */
+	op_jphl,			/* 0xe9 */
+	op_jppe,			/* 0xea */
+	op_exdehl,			/* 0xeb */
+	op_calpe,			/* 0xec */
+	op_ed_handle,			/* 0xed */
+	op_xorn,			/* 0xee */
+	op_rst28,			/* 0xef */
+	op_retp,			/* 0xf0 */
+	op_popaf,			/* 0xf1 */
+	op_jpp,				/* 0xf2 */
+	op_di,				/* 0xf3 */
+	op_calp,			/* 0xf4 */
+	op_pushaf,			/* 0xf5 */
+	op_orn,				/* 0xf6 */
+	op_rst30,			/* 0xf7 */
+	op_retm,			/* 0xf8 */
+	op_ldsphl,			/* 0xf9 */
+	op_jpm,				/* 0xfa */
+	op_ei,				/* 0xfb */
+	op_calm,			/* 0xfc */
+	op_fd_handle,			/* 0xfd */
+	op_cpn,				/* 0xfe */
+	op_rst38			/* 0xff */
+};
+#endif /* !ALT_Z80 */
+
+/*
+ *	The CPU loop is compiled twice from simz80-loop.h, without and
+ *	with the hooks for history, t-state count and hardware
+ *	breakpoint, the ICE selects the one to run with ice_hooks
+ */
+static void cpu_z80_fast(void)
+#include "simz80-loop.h"
+
+#ifdef WANT_ICE
+#define CPU_HOOKS
+static void cpu_z80_debug(void)
+#include "simz80-loop.h"
+#undef CPU_HOOKS
+#endif
+
 /*
  *	This function builds the Z80 central processing unit.
  *	The opcode where PC points to is fetched from the memory
@@ -125,567 +404,13 @@ static int op_rst20(void), op_rst28(void), op_rst30(void), op_rst38(void);
  */
 void cpu_z80(void)
 {
-#ifndef ALT_Z80
-	static int (*op_sim[256])(void) = {
-		op_nop,				/* 0x00 */
-		op_ldbcnn,			/* 0x01 */
-		op_ldbca,			/* 0x02 */
-		op_incbc,			/* 0x03 */
-		op_incb,			/* 0x04 */
-		op_decb,			/* 0x05 */
-		op_ldbn,			/* 0x06 */
-		op_rlca,			/* 0x07 */
-		op_exafaf,			/* 0x08 */
-		op_adhlbc,			/* 0x09 */
-		op_ldabc,			/* 0x0a */
-		op_decbc,			/* 0x0b */
-		op_incc,			/* 0x0c */
-		op_decc,			/* 0x0d */
-		op_ldcn,			/* 0x0e */
-		op_rrca,			/* 0x0f */
-		op_djnz,			/* 0x10 */
-		op_lddenn,			/* 0x11 */
-		op_lddea,			/* 0x12 */
-		op_incde,			/* 0x13 */
-		op_incd,			/* 0x14 */
-		op_decd,			/* 0x15 */
-		op_lddn,			/* 0x16 */
-		op_rla,				/* 0x17 */
-		op_jr,				/* 0x18 */
-		op_adhlde,			/* 0x19 */
-		op_ldade,			/* 0x1a */
-		op_decde,			/* 0x1b */
-		op_ince,			/* 0x1c */
-		op_dece,			/* 0x1d */
-		op_lden,			/* 0x1e */
-		op_rra,				/* 0x1f */
-		op_jrnz,			/* 0x20 */
-		op_ldhlnn,			/* 0x21 */
-		op_ldinhl,			/* 0x22 */
-		op_inchl,			/* 0x23 */
-		op_inch,			/* 0x24 */
-		op_dech,			/* 0x25 */
-		op_ldhn,			/* 0x26 */
-		op_daa,				/* 0x27 */
-		op_jrz,				/* 0x28 */
-		op_adhlhl,			/* 0x29 */
-		op_ldhlin,			/* 0x2a */
-		op_dechl,			/* 0x2b */
-		op_incl,			/* 0x2c */
-		op_decl,			/* 0x2d */
-		op_ldln,			/* 0x2e */
-		op_cpl,				/* 0x2f */
-		op_jrnc,			/* 0x30 */
-		op_ldspnn,			/* 0x31 */
-		op_ldnna,			/* 0x32 */
-		op_incsp,			/* 0x33 */
-		op_incihl,			/* 0x34 */
-		op_decihl,			/* 0x35 */
-		op_ldhl1,			/* 0x36 */
-		op_scf,				/* 0x37 */
-		op_jrc,				/* 0x38 */
-		op_adhlsp,			/* 0x39 */
-		op_ldann,			/* 0x3a */
-		op_decsp,			/* 0x3b */
-		op_inca,			/* 0x3c */
-		op_deca,			/* 0x3d */
-		op_ldan,			/* 0x3e */
-		op_ccf,				/* 0x3f */
-		op_ldbb,			/* 0x40 */
-		op_ldbc,			/* 0x41 */
-		op_ldbd,			/* 0x42 */
-		op_ldbe,			/* 0x43 */
-		op_ldbh,			/* 0x44 */
-		op_ldbl,			/* 0x45 */
-		op_ldbhl,			/* 0x46 */
-		op_ldba,			/* 0x47 */
-		op_ldcb,			/* 0x48 */
-		op_ldcc,			/* 0x49 */
-		op_ldcd,			/* 0x4a */
-		op_ldce,			/* 0x4b */
-		op_ldch,			/* 0x4c */
-		op_ldcl,			/* 0x4d */
-		op_ldchl,			/* 0x4e */
-		op_ldca,			/* 0x4f */
-		op_lddb,			/* 0x50 */
-		op_lddc,			/* 0x51 */
-		op_lddd,			/* 0x52 */
-		op_ldde,			/* 0x53 */
-		op_lddh,			/* 0x54 */
-		op_lddl,			/* 0x55 */
-		op_lddhl,			/* 0x56 */
-		op_ldda,			/* 0x57 */
-		op_ldeb,			/* 0x58 */
-		op_ldec,			/* 0x59 */
-		op_lded,			/* 0x5a */
-		op_ldee,			/* 0x5b */
-		op_ldeh,			/* 0x5c */
-		op_ldel,			/* 0x5d */
-		op_ldehl,			/* 0x5e */
-		op_ldea,			/* 0x5f */
-		op_ldhb,			/* 0x60 */
-		op_ldhc,			/* 0x61 */
-		op_ldhd,			/* 0x62 */
-		op_ldhe,			/* 0x63 */
-		op_ldhh,			/* 0x64 */
-		op_ldhl,			/* 0x65 */
-		op_ldhhl,			/* 0x66 */
-		op_ldha,			/* 0x67 */
-		op_ldlb,			/* 0x68 */
-		op_ldlc,			/* 0x69 */
-		op_ldld,			/* 0x6a */
-		op_ldle,			/* 0x6b */
-		op_ldlh,			/* 0x6c */
-		op_ldll,			/* 0x6d */
-		op_ldlhl,			/* 0x6e */
-		op_ldla,			/* 0x6f */
-		op_ldhlb,			/* 0x70 */
-		op_ldhlc,			/* 0x71 */
-		op_ldhld,			/* 0x72 */
-		op_ldhle,			/* 0x73 */
-		op_ldhlh,			/* 0x74 */
-		op_ldhll,			/* 0x75 */
-		op_halt,			/* 0x76 */
-		op_ldhla,			/* 0x77 */
-		op_ldab,			/* 0x78 */
-		op_ldac,			/* 0x79 */
-		op_ldad,			/* 0x7a */
-		op_ldae,			/* 0x7b */
-		op_ldah,			/* 0x7c */
-		op_ldal,			/* 0x7d */
-		op_ldahl,			/* 0x7e */
-		op_ldaa,			/* 0x7f */
-		op_addb,			/* 0x80 */
-		op_addc,			/* 0x81 */
-		op_addd,			/* 0x82 */
-		op_adde,			/* 0x83 */
-		op_addh,			/* 0x84 */
-		op_addl,			/* 0x85 */
-		op_addhl,			/* 0x86 */
-		op_adda,			/* 0x87 */
-		op_adcb,			/* 0x88 */
-		op_adcc,			/* 0x89 */
-		op_adcd,			/* 0x8a */
-		op_adce,			/* 0x8b */
-		op_adch,			/* 0x8c */
-		op_adcl,			/* 0x8d */
-		op_adchl,			/* 0x8e */
-		op_adca,			/* 0x8f */
-		op_subb,			/* 0x90 */
-		op_subc,			/* 0x91 */
-		op_subd,			/* 0x92 */
-		op_sube,			/* 0x93 */
-		op_subh,			/* 0x94 */
-		op_subl,			/* 0x95 */
-		op_subhl,			/* 0x96 */
-		op_suba,			/* 0x97 */
-		op_sbcb,			/* 0x98 */
-		op_sbcc,			/* 0x99 */
-		op_sbcd,			/* 0x9a */
-		op_sbce,			/* 0x9b */
-		op_sbch,			/* 0x9c */
-		op_sbcl,			/* 0x9d */
-		op_sbchl,			/* 0x9e */
-		op_sbca,			/* 0x9f */
-		op_andb,			/* 0xa0 */
-		op_andc,			/* 0xa1 */
-		op_andd,			/* 0xa2 */
-		op_ande,			/* 0xa3 */
-		op_andh,			/* 0xa4 */
-		op_andl,			/* 0xa5 */
-		op_andhl,			/* 0xa6 */
-		op_anda,			/* 0xa7 */
-		op_xorb,			/* 0xa8 */
-		op_xorc,			/* 0xa9 */
-		op_xord,			/* 0xaa */
-		op_xore,			/* 0xab */
-		op_xorh,			/* 0xac */
-		op_xorl,			/* 0xad */
-		op_xorhl,			/* 0xae */
-		op_xora,			/* 0xaf */
-		op_orb,				/* 0xb0 */
-		op_orc,				/* 0xb1 */
-		op_ord,				/* 0xb2 */
-		op_ore,				/* 0xb3 */
-		op_orh,				/* 0xb4 */
-		op_orl,				/* 0xb5 */
-		op_orhl,			/* 0xb6 */
-		op_ora,				/* 0xb7 */
-		op_cpb,				/* 0xb8 */
-		op_cpc,				/* 0xb9 */
-		op_cpd,				/* 0xba */
-		op_cpe,				/* 0xbb */
-		op_cph,				/* 0xbc */
-		op_cplr,			/* 0xbd */
-		op_cphl,			/* 0xbe */
-		op_cpa,				/* 0xbf */
-		op_retnz,			/* 0xc0 */
-		op_popbc,			/* 0xc1 */
-		op_jpnz,			/* 0xc2 */
-		op_jp,				/* 0xc3 */
-		op_calnz,			/* 0xc4 */
-		op_pushbc,			/* 0xc5 */
-		op_addn,			/* 0xc6 */
-		op_rst00,			/* 0xc7 */
-		op_retz,			/* 0xc8 */
-		op_ret,				/* 0xc9 */
-		op_jpz,				/* 0xca */
-		op_cb_handle,			/* 0xcb */
-		op_calz,			/* 0xcc */
-		op_call,			/* 0xcd */
-		op_adcn,			/* 0xce */
-		op_rst08,			/* 0xcf */
-		op_retnc,			/* 0xd0 */
-		op_popde,			/* 0xd1 */
-		op_jpnc,			/* 0xd2 */
-		op_out,				/* 0xd3 */
-		op_calnc,			/* 0xd4 */
-		op_pushde,			/* 0xd5 */
-		op_subn,			/* 0xd6 */
-		op_rst10,			/* 0xd7 */
-		op_retc,			/* 0xd8 */
-		op_exx,				/* 0xd9 */
-		op_jpc,				/* 0xda */
-		op_in,				/* 0xdb */
-		op_calc,			/* 0xdc */
-		op_dd_handle,			/* 0xdd */
-		op_sbcn,			/* 0xde */
-		op_rst18,			/* 0xdf */
-		op_retpo,			/* 0xe0 */
-		op_pophl,			/* 0xe1 */
-		op_jppo,			/* 0xe2 */
-		op_exsphl,			/* 0xe3 */
-		op_calpo,			/* 0xe4 */
-		op_pushhl,			/* 0xe5 */
-		op_andn,			/* 0xe6 */
-		op_rst20,			/* 0xe7 */
-		op_retpe,			/* 0xe8 */
-		op_jphl,			/* 0xe9 */
-		op_jppe,			/* 0xea */
-		op_exdehl,			/* 0xeb */
-		op_calpe,			/* 0xec */
-		op_ed_handle,			/* 0xed */
-		op_xorn,			/* 0xee */
-		op_rst28,			/* 0xef */
-		op_retp,			/* 0xf0 */
-		op_popaf,			/* 0xf1 */
-		op_jpp,				/* 0xf2 */
-		op_di,				/* 0xf3 */
-		op_calp,			/* 0xf4 */
-		op_pushaf,			/* 0xf5 */
-		op_orn,				/* 0xf6 */
-		op_rst30,			/* 0xf7 */
-		op_retm,			/* 0xf8 */
-		op_ldsphl,			/* 0xf9 */
-		op_jpm,				/* 0xfa */
-		op_ei,				/* 0xfb */
-		op_calm,			/* 0xfc */
-		op_fd_handle,			/* 0xfd */
-		op_cpn,				/* 0xfe */
-		op_rst38			/* 0xff */
-	};
-#endif /* !ALT_Z80 */
-
-	Tstates_t T_max, T_dma;
-	uint64_t t1, t2;
-	unsigned long tdiff;
-	WORD p;
-
-#ifdef FRONTPANEL
-	if (F_flag) {
-		fp_clock++;
-		fp_sampleData();
-	}
-#endif
-
-	T_max = T + tmax;
-	t1 = get_clock_us();
-
-	do {
-
 #ifdef WANT_ICE
-
-#ifdef HISIZE
-		/* write history */
-		his[h_next].h_cpu = Z80;
-		his[h_next].h_addr = PC;
-		his[h_next].h_af = (A << 8) + F;
-		his[h_next].h_bc = (B << 8) + C;
-		his[h_next].h_de = (D << 8) + E;
-		his[h_next].h_hl = (H << 8) + L;
-		his[h_next].h_ix = IX;
-		his[h_next].h_iy = IY;
-		his[h_next].h_sp = SP;
-		h_next++;
-		if (h_next == HISIZE) {
-			h_flag = true;
-			h_next = 0;
-		}
-#endif
-
-#ifdef WANT_TIM
-		/* check for start address of runtime measurement */
-		if (PC == t_start && !t_flag) {
-			t_flag = true;		     /* turn measurement on */
-			t_states_s = t_states_e = T; /* initialize markers */
-		}
-#endif
-
-#endif /* WANT_ICE */
-
-		/* CPU DMA bus request handling */
-		if (bus_mode) {
-
-			if (!bus_request && (bus_mode != BUS_DMA_CONTINUOUS)) {
-				if (dma_bus_master) {
-					/* hand control to the DMA bus master
-					   without BUS_ACK */
-					T_dma = (*dma_bus_master)(0);
-					T += T_dma;
-					if (cpu_freq)
-						cpu_time += (1000000 * T_dma) /
-							    cpu_freq;
-				}
-			}
-
-			if (bus_request) {		/* DMA bus request */
-#ifdef FRONTPANEL
-				if (F_flag) {
-					fp_clock += 1000;
-					fp_sampleData();
-				}
-#endif
-				if (dma_bus_master) {
-					/* hand control to the DMA bus master
-					   with BUS_ACK */
-					T_dma = (*dma_bus_master)(1);
-					T += T_dma;
-					if (cpu_freq)
-						cpu_time += (1000000 * T_dma) /
-							    cpu_freq;
-				}
-				/* FOR NOW -
-				   MAY BE NEED A PRIORITY SYSTEM LATER */
-				bus_request = 0;
-				if (bus_mode == BUS_DMA_CONTINUOUS) {
-					end_bus_request();
-				}
-#ifdef FRONTPANEL
-				if (F_flag) {
-					fp_clock += 1000;
-					fp_sampleData();
-				}
-#endif
-			}
-		}
-
-		/* CPU interrupt handling */
-		if (int_nmi) {		/* non-maskable interrupt */
-			IFF = (IFF << 1) & 3;
-			memwrt(--SP, PC >> 8);
-			memwrt(--SP, PC);
-			PC = 0x66;
-			int_nmi = false;
-			T += 11;
-			R++;		/* increment refresh register */
-		}
-
-		if (int_int) {		/* maskable interrupt */
-			if (IFF != 3)
-				goto leave;
-			if (int_protection)	/* protect first instruction */
-				goto leave;	/* after EI */
-
-			IFF = 0;
-
-#ifdef BUS_8080
-			if (!(cpu_bus & CPU_HLTA)) {
-				cpu_bus = CPU_WO | CPU_M1 | CPU_INTA;
-#endif
-#ifdef FRONTPANEL
-				if (F_flag) {
-					fp_clock += 1000;
-					fp_led_data = (int_data != -1) ?
-						      (BYTE) int_data : 0xff;
-					fp_sampleData();
-					wait_int_step();
-					if (cpu_state & ST_RESET)
-						goto leave;
-				}
-#endif
-#ifdef SIMPLEPANEL
-				fp_led_data = (int_data != -1) ?
-					      (BYTE) int_data : 0xff;
-#endif
-#ifdef BUS_8080
-			}
-			cpu_bus = 0;
-#endif
-
-			switch (int_mode) {
-			case 0:		/* IM 0 */
-				memwrt(--SP, PC >> 8);
-				memwrt(--SP, PC);
-#ifdef FRONTPANEL
-				if (F_flag && (cpu_state & ST_RESET))
-					goto leave;
-#endif
-				switch (int_data) {
-				case 0xc7: /* RST 00H */
-					PC = 0;
-					break;
-				case 0xcf: /* RST 08H */
-					PC = 8;
-					break;
-				case 0xd7: /* RST 10H */
-					PC = 0x10;
-					break;
-				case 0xdf: /* RST 18H */
-					PC = 0x18;
-					break;
-				case 0xe7: /* RST 20H */
-					PC = 0x20;
-					break;
-				case 0xef: /* RST 28H */
-					PC = 0x28;
-					break;
-				case 0xf7: /* RST 30H */
-					PC = 0x30;
-					break;
-				case 0xff: /* RST 38H */
-					PC = 0x38;
-					break;
-				case -1: /* no data = 0xff on S100 bus */
-					PC = 0x38;
-					break;
-				default: /* unsupported bus data */
-					cpu_error = INTERROR;
-					cpu_state = ST_STOPPED;
-					continue;
-				}
-				T += 13;
-				break;
-			case 1:		/* IM 1 */
-				memwrt(--SP, PC >> 8);
-				memwrt(--SP, PC);
-#ifdef FRONTPANEL
-				if (F_flag && (cpu_state & ST_RESET))
-					goto leave;
-#endif
-				PC = 0x38;
-				T += 13;
-				break;
-			case 2:		/* IM 2 */
-				memwrt(--SP, PC >> 8);
-				memwrt(--SP, PC);
-#ifdef FRONTPANEL
-				if (F_flag && (cpu_state & ST_RESET))
-					goto leave;
-#endif
-				p = (I << 8) + (int_data & 0xff);
-				PC = memrdr(p++);
-				PC += memrdr(p) << 8;
-				T += 19;
-				break;
-			}
-			int_int = false;
-			int_data = -1;
-#ifdef FRONTPANEL
-			if (F_flag)
-				m1_step = true;
-#endif
-			R++;		/* increment refresh register */
-		}
-	leave:
-
-#ifdef BUS_8080
-		/* M1 opcode fetch */
-		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
-#endif
-
-		R++;			/* increment refresh register */
-
-		int_protection = false;
-#ifndef ALT_Z80
-		T += (*op_sim[memrdr(PC++)])();	/* execute next opcode */
-#else
-#include "altz80.h"
-#endif
-
-#ifdef WANT_ICE
-
-#ifdef WANT_TIM
-					/* do runtime measurement */
-		if (t_flag) {
-			t_states_e = T; /* set end marker for this opcode */
-			if (PC == t_end)	/* check for end address */
-				t_flag = false;	/* if reached, switch off */
-		}
-#endif
-
-#ifdef WANT_HB
-		if (hb_trig) {
-			cpu_error = OPHALT;
-			cpu_state = ST_STOPPED;
-		}
-#endif
-
-#endif /* WANT_ICE */
-
-#ifdef WANT_GUI
-		check_gui_break();
-#endif
-
-					/* adjust CPU speed and
-					   update CPU accounting */
-		if (T >= T_max) {
-			T_max = T + tmax;
-			t2 = get_clock_us();
-			tdiff = t2 - t1;
-			if (f_value && !cpu_needed && tdiff < 10000L) {
-				sleep_for_us(10000L - tdiff);
-				t2 = get_clock_us();
-				tdiff = t2 - t1;
-			}
-			cpu_time += tdiff - (io_time + wait_time);
-			total_io_time += io_time;
-			total_wait_time += wait_time;
-			io_time = wait_time = 0;
-			if (cpu_time)
-				cpu_freq = (T * 1000000) / cpu_time;
-			t1 = t2;
-		}
-
-	} while (cpu_state == ST_CONTIN_RUN);
-
-					/* update CPU accounting
-					   if necessary */
-	if (T > T_max - tmax) {
-		cpu_time += (get_clock_us() - t1) - (io_time + wait_time);
-		total_io_time += io_time;
-		total_wait_time += wait_time;
-		io_time = wait_time = 0;
-		if (cpu_time)
-			cpu_freq = (T * 1000000) / cpu_time;
-	}
-
-#ifdef BUS_8080
-	if (!(cpu_bus & CPU_INTA))
-		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
-#endif
-
-#ifdef FRONTPANEL
-	if (F_flag) {
-		fp_led_address = PC;
-		fp_led_data = getmem(PC);
-		fp_clock++;
-		fp_sampleData();
+	if (ice_hooks) {
+		cpu_z80_debug();
+		return;
 	}
 #endif
-#ifdef SIMPLEPANEL
-	fp_led_address = PC;
-	fp_led_data = getmem(PC);
-#endif
+	cpu_z80_fast();
 }
 
 #ifndef ALT_Z80
@@ -715,7 +440,7 @@ static int op_halt(void)		/* HALT */
 			/* else wait for INT, NMI or user interrupt */
 			while (!int_int && !int_nmi &&
 			       (cpu_state == ST_CONTIN_RUN)) {
-				sleep_for_ms(1);
+				idle_wait();
 				R += 99;
 			}
 		}
@@ -735,7 +460,7 @@ static int op_halt(void)		/* HALT */
 			while (!int_nmi && !(cpu_state & ST_RESET)) {
 				fp_clock++;
 				fp_sampleData();
-				sleep_for_ms(1);
+				idle_wait();
 				R += 99;
 				if (cpu_error != NONE)
 					break;
@@ -747,7 +472,7 @@ static int op_halt(void)		/* HALT */
 			       !(cpu_state & ST_RESET)) {
 				fp_clock++;
 				fp_sampleData();
-				sleep_for_ms(1);
+				idle_wait();
 				R += 99;
 				if (cpu_error != NONE)
 					break;
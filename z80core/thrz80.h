@@ -0,0 +1,2606 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 1987-2024 by Udo Munk
+ * Copyright (C) 2024 by Thomas Eberhardt
+ * Copyright (C) 2026 by agent
+ */
+
+/*
+ *	This module builds the Z80 central processing unit.
+ *	It executes the same instruction code as the alternative
+ *	Z80 simulation in altz80.h, but is primarily optimized for
+ *	speed and requires a compiler supporting the GNU C extensions
+ *	"labels as values" and "statement expressions".
+ *
+ *	Opcodes are dispatched with a computed goto through a table of
+ *	label addresses, and every opcode jumps directly to the code of
+ *	the next one (direct threading). This avoids the function call
+ *	per opcode and prefix of the table driven simulation, and gives
+ *	the host branch predictor one indirect jump per opcode instead
+ *	of a single shared one.
+ *
+ *	The CPU registers are held in a local copy for as long as no
+ *	event requires the attention of the CPU loop in cpu_z80(), that
+ *	is a DMA bus request, an interrupt which can be accepted, the end
+ *	of the current time slice or a change of the CPU state. The copy
+ *	is written back before every I/O port access, so that the port
+ *	handlers see and can modify the current register contents.
+ *	If the CPU loop is compiled with the hooks for the ICE, or the
+ *	GUI is compiled in, only one instruction is executed before
+ *	returning to the CPU loop, like the other simulations do.
+ */
+
+{
+#define S_SHIFT		7	/* S_FLAG shift */
+#define Z_SHIFT		6	/* Z_FLAG shift */
+#define H_SHIFT		4	/* H_FLAG shift */
+#define P_SHIFT		2	/* P_FLAG shift */
+#define N_SHIFT		1	/* N_FLAG shift */
+#define C_SHIFT		0	/* C_FLAG shift */
+
+	/* Precomputed table for fast sign, zero and parity flag calculation */
+#define _ 0
+#define S S_FLAG
+#define Z Z_FLAG
+#define P P_FLAG
+	static const BYTE szp_flags[256] = {
+		/*00*/ Z|P,   _,   _,   P,   _,   P,   P,   _,
+		/*08*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*10*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*18*/   P,   _,   _,   P,   _,   P,   P,   _,
+		/*20*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*28*/   P,   _,   _,   P,   _,   P,   P,   _,
+		/*30*/   P,   _,   _,   P,   _,   P,   P,   _,
+		/*38*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*40*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*48*/   P,   _,   _,   P,   _,   P,   P,   _,
+		/*50*/   P,   _,   _,   P,   _,   P,   P,   _,
+		/*58*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*60*/   P,   _,   _,   P,   _,   P,   P,   _,
+		/*68*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*70*/   _,   P,   P,   _,   P,   _,   _,   P,
+		/*78*/   P,   _,   _,   P,   _,   P,   P,   _,
+		/*80*/   S, S|P, S|P,   S, S|P,   S,   S, S|P,
+		/*88*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*90*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*98*/   S, S|P, S|P,   S, S|P,   S,   S, S|P,
+		/*a0*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*a8*/   S, S|P, S|P,   S, S|P,   S,   S, S|P,
+		/*b0*/   S, S|P, S|P,   S, S|P,   S,   S, S|P,
+		/*b8*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*c0*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*c8*/   S, S|P, S|P,   S, S|P,   S,   S, S|P,
+		/*d0*/   S, S|P, S|P,   S, S|P,   S,   S, S|P,
+		/*d8*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*e0*/   S, S|P, S|P,   S, S|P,   S,   S, S|P,
+		/*e8*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*f0*/ S|P,   S,   S, S|P,   S, S|P, S|P,   S,
+		/*f8*/   S, S|P, S|P,   S, S|P,   S,   S, S|P
+	};
+#undef _
+#undef S
+#undef Z
+#undef P
+
+	/* Dispatch table with the addresses of the opcode labels */
+	static void *const op_tab[256] = {
+		/*00*/ &&op_00, &&op_01, &&op_02, &&op_03,
+		/*04*/ &&op_04, &&op_05, &&op_06, &&op_07,
+		/*08*/ &&op_08, &&op_09, &&op_0a, &&op_0b,
+		/*0c*/ &&op_0c, &&op_0d, &&op_0e, &&op_0f,
+		/*10*/ &&op_10, &&op_11, &&op_12, &&op_13,
+		/*14*/ &&op_14, &&op_15, &&op_16, &&op_17,
+		/*18*/ &&op_18, &&op_19, &&op_1a, &&op_1b,
+		/*1c*/ &&op_1c, &&op_1d, &&op_1e, &&op_1f,
+		/*20*/ &&op_20, &&op_21, &&op_22, &&op_23,
+		/*24*/ &&op_24, &&op_25, &&op_26, &&op_27,
+		/*28*/ &&op_28, &&op_29, &&op_2a, &&op_2b,
+		/*2c*/ &&op_2c, &&op_2d, &&op_2e, &&op_2f,
+		/*30*/ &&op_30, &&op_31, &&op_32, &&op_33,
+		/*34*/ &&op_34, &&op_35, &&op_36, &&op_37,
+		/*38*/ &&op_38, &&op_39, &&op_3a, &&op_3b,
+		/*3c*/ &&op_3c, &&op_3d, &&op_3e, &&op_3f,
+		/*40*/ &&op_40, &&op_41, &&op_42, &&op_43,
+		/*44*/ &&op_44, &&op_45, &&op_46, &&op_47,
+		/*48*/ &&op_48, &&op_49, &&op_4a, &&op_4b,
+		/*4c*/ &&op_4c, &&op_4d, &&op_4e, &&op_4f,
+		/*50*/ &&op_50, &&op_51, &&op_52, &&op_53,
+		/*54*/ &&op_54, &&op_55, &&op_56, &&op_57,
+		/*58*/ &&op_58, &&op_59, &&op_5a, &&op_5b,
+		/*5c*/ &&op_5c, &&op_5d, &&op_5e, &&op_5f,
+		/*60*/ &&op_60, &&op_61, &&op_62, &&op_63,
+		/*64*/ &&op_64, &&op_65, &&op_66, &&op_67,
+		/*68*/ &&op_68, &&op_69, &&op_6a, &&op_6b,
+		/*6c*/ &&op_6c, &&op_6d, &&op_6e, &&op_6f,
+		/*70*/ &&op_70, &&op_71, &&op_72, &&op_73,
+		/*74*/ &&op_74, &&op_75, &&op_76, &&op_77,
+		/*78*/ &&op_78, &&op_79, &&op_7a, &&op_7b,
+		/*7c*/ &&op_7c, &&op_7d, &&op_7e, &&op_7f,
+		/*80*/ &&op_80, &&op_81, &&op_82, &&op_83,
+		/*84*/ &&op_84, &&op_85, &&op_86, &&op_87,
+		/*88*/ &&op_88, &&op_89, &&op_8a, &&op_8b,
+		/*8c*/ &&op_8c, &&op_8d, &&op_8e, &&op_8f,
+		/*90*/ &&op_90, &&op_91, &&op_92, &&op_93,
+		/*94*/ &&op_94, &&op_95, &&op_96, &&op_97,
+		/*98*/ &&op_98, &&op_99, &&op_9a, &&op_9b,
+		/*9c*/ &&op_9c, &&op_9d, &&op_9e, &&op_9f,
+		/*a0*/ &&op_a0, &&op_a1, &&op_a2, &&op_a3,
+		/*a4*/ &&op_a4, &&op_a5, &&op_a6, &&op_a7,
+		/*a8*/ &&op_a8, &&op_a9, &&op_aa, &&op_ab,
+		/*ac*/ &&op_ac, &&op_ad, &&op_ae, &&op_af,
+		/*b0*/ &&op_b0, &&op_b1, &&op_b2, &&op_b3,
+		/*b4*/ &&op_b4, &&op_b5, &&op_b6, &&op_b7,
+		/*b8*/ &&op_b8, &&op_b9, &&op_ba, &&op_bb,
+		/*bc*/ &&op_bc, &&op_bd, &&op_be, &&op_bf,
+		/*c0*/ &&op_c0, &&op_c1, &&op_c2, &&op_c3,
+		/*c4*/ &&op_c4, &&op_c5, &&op_c6, &&op_c7,
+		/*c8*/ &&op_c8, &&op_c9, &&op_ca, &&op_cb,
+		/*cc*/ &&op_cc, &&op_cd, &&op_ce, &&op_cf,
+		/*d0*/ &&op_d0, &&op_d1, &&op_d2, &&op_d3,
+		/*d4*/ &&op_d4, &&op_d5, &&op_d6, &&op_d7,
+		/*d8*/ &&op_d8, &&op_d9, &&op_da, &&op_db,
+		/*dc*/ &&op_dc, &&op_dd, &&op_de, &&op_df,
+		/*e0*/ &&op_e0, &&op_e1, &&op_e2, &&op_e3,
+		/*e4*/ &&op_e4, &&op_e5, &&op_e6, &&op_e7,
+		/*e8*/ &&op_e8, &&op_e9, &&op_ea, &&op_eb,
+		/*ec*/ &&op_ec, &&op_ed, &&op_ee, &&op_ef,
+		/*f0*/ &&op_f0, &&op_f1, &&op_f2, &&op_f3,
+		/*f4*/ &&op_f4, &&op_f5, &&op_f6, &&op_f7,
+		/*f8*/ &&op_f8, &&op_f9, &&op_fa, &&op_fb,
+		/*fc*/ &&op_fc, &&op_fd, &&op_fe, &&op_ff
+	};
+
+	BYTE t, res, cout, P, op, n, curr_ir;
+#ifdef FAST_BLOCK
+	WORD s, d;
+	int32_t tl;		/* loops can run for 65535 * 21 + 16 cycles */
+#endif
+	cpu_reg_t w;		/* working register */
+	cpu_reg_t ir;		/* current index register (HL, IX, IY) */
+	cpu_regs_t *const gregs = &cpu_regs; /* global CPU registers */
+	cpu_regs_t lregs = cpu_regs;	/* local copy of the CPU registers */
+
+	/* from here on the register macros refer to the local copy */
+#define cpu_regs lregs
+
+#define W	w.w
+#define WH	w.h
+#define WL	w.l
+
+#define IR	ir.w
+#define IRH	ir.h
+#define IRL	ir.l
+
+#define IR_HL	0		/* values for curr_ir */
+#define IR_IX	1
+#define IR_IY	2
+
+	/* read variables which are modified by other threads */
+#define VOLATILE(v)	(*(volatile __typeof__(v) *) &(v))
+
+	/*
+	 *	Port I/O with the register copy written back before and
+	 *	reloaded after the call of the port handler. The arguments
+	 *	are evaluated first, because they may modify registers.
+	 */
+#define IO_IN(addrl, addrh)						\
+	({								\
+		BYTE _l = (addrl), _h = (addrh), _d;			\
+									\
+		*gregs = lregs;						\
+		_d = io_in(_l, _h);					\
+		lregs = *gregs;						\
+		if (curr_ir == IR_HL)					\
+			IR = HL;					\
+		_d;							\
+	})
+
+#define IO_OUT(addrl, addrh, data)					\
+	do {								\
+		BYTE _l = (addrl), _h = (addrh), _d = (data);		\
+									\
+		*gregs = lregs;						\
+		io_out(_l, _h, _d);					\
+		lregs = *gregs;						\
+		if (curr_ir == IR_HL)					\
+			IR = HL;					\
+	} while (0)
+
+	/*
+	 *	An event requires the attention of the CPU loop. ev_next
+	 *	is a global, so it is read again after ev_run() in the CPU
+	 *	loop scheduled the next device event.
+	 */
+#if defined(CPU_HOOKS) || defined(WANT_GUI)
+#define EVENT	true
+#else
+#define EVENT	(VOLATILE(cpu_state) != ST_CONTIN_RUN || T >= T_max ||	\
+		 T >= ev_next ||					\
+		 VOLATILE(bus_mode) != BUS_DMA_NONE ||			\
+		 VOLATILE(int_nmi) || (VOLATILE(int_int) && IFF == 3))
+#endif
+
+#ifdef BUS_8080
+#define M1_FETCH	cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR
+#else
+#define M1_FETCH
+#endif
+
+	/*
+	 *	Finish the current opcode and, if no event is pending,
+	 *	directly dispatch the next one.
+	 */
+#define NEXT								\
+	do {								\
+		if (curr_ir == IR_HL)					\
+			HL = IR;					\
+		else if (curr_ir == IR_IX)				\
+			IX = IR;					\
+		else							\
+			IY = IR;					\
+		T += t;							\
+		if (EVENT)						\
+			goto thr_leave;					\
+		M1_FETCH;	/* M1 opcode fetch */			\
+		R++;		/* increment refresh register */	\
+		int_protection = false;					\
+		t = 4;							\
+		curr_ir = IR_HL;					\
+		IR = HL;						\
+		goto *op_tab[memrdr(PC++)]; /* execute next opcode */	\
+	} while (0)
+
+	t = 0;
+	curr_ir = IR_HL;
+	IR = HL;
+
+next_opcode:
+
+	t += 4;
+
+	goto *op_tab[memrdr(PC++)];	/* execute next opcode */
+
+
+	op_00:				/* NOP */
+	op_40:				/* LD B,B */
+	op_49:				/* LD C,C */
+	op_52:				/* LD D,D */
+	op_5b:				/* LD E,E */
+	op_64:				/* LD irh,irh */
+	op_6d:				/* LD irl,irl */
+	op_7f:				/* LD A,A */
+		NEXT;
+
+	op_01:				/* LD BC,nn */
+		C = memrdr(PC++);
+		B = memrdr(PC++);
+		t += 6;
+		NEXT;
+
+	op_02:				/* LD (BC),A */
+		memwrt(BC, A);
+		t += 3;
+		NEXT;
+
+	op_03:				/* INC BC */
+		BC++;
+		t += 2;
+		NEXT;
+
+	op_04:				/* INC B */
+		P = B;
+		res = ++B;
+	finish_inc:
+		cout = (P & 1) | ((P | 1) & ~res);
+		F = ((F & C_FLAG) |
+		     ((((cout + 64) >> 7) & 1) << P_SHIFT) |
+		     (((cout >> 3) & 1) << H_SHIFT) |
+		     (szp_flags[res] & ~P_FLAG));
+		/* N_FLAG cleared, C_FLAG unchanged */
+		NEXT;
+
+	op_05:				/* DEC B */
+		P = B;
+		res = --B;
+	finish_dec:
+		cout = (~P & 1) | ((~P | 1) & res);
+		F = ((F & C_FLAG) |
+		     ((((cout + 64) >> 7) & 1) << P_SHIFT) |
+		     (((cout >> 3) & 1) << H_SHIFT) |
+		     N_FLAG |
+		     (szp_flags[res] & ~P_FLAG));
+		/* C_FLAG unchanged */
+		NEXT;
+
+	op_06:				/* LD B,n */
+		B = memrdr(PC++);
+		t += 3;
+		NEXT;
+
+	op_07:				/* RLCA */
+		res = ((A & 0x80) >> 7) & 1;
+		F = (F & ~(H_FLAG | N_FLAG | C_FLAG)) | (res << C_SHIFT);
+		/* S_FLAG, Z_FLAG, and P_FLAG unchanged */
+		A = (A << 1) | res;
+		NEXT;
+
+	op_08:				/* EX AF,AF' */
+		W = AF;
+		AF = AF_;
+		AF_ = W;
+		NEXT;
+
+	op_09:				/* ADD ir,BC */
+		W = IR + BC;
+		cout = (IRH & B) | ((IRH | B) & ~WH);
+	finish_addir:
+		F = ((F & ~(H_FLAG | N_FLAG | C_FLAG)) |
+		     (((cout >> 3) & 1) << H_SHIFT) |
+		     (((cout >> 7) & 1) << C_SHIFT));
+		/* S_FLAG, Z_FLAG, and P_FLAG unchanged */
+		IR = W;
+		t += 7;
+		NEXT;
+
+	op_0a:				/* LD A,(BC) */
+		A = memrdr(BC);
+		t += 3;
+		NEXT;
+
+	op_0b:				/* DEC BC */
+		BC--;
+		t += 2;
+		NEXT;
+
+	op_0c:				/* INC C */
+		P = C;
+		res = ++C;
+		goto finish_inc;
+
+	op_0d:				/* DEC C */
+		P = C;
+		res = --C;
+		goto finish_dec;
+
+	op_0e:				/* LD C,n */
+		C = memrdr(PC++);
+		t += 3;
+		NEXT;
+
+	op_0f:				/* RRCA */
+		res = A & 1;
+		F = (F & ~(H_FLAG | N_FLAG | C_FLAG)) | (res << C_SHIFT);
+		/* S_FLAG, Z_FLAG, and P_FLAG unchanged */
+		A = (A >> 1) | (res << 7);
+		NEXT;
+
+	op_10:				/* DJNZ n */
+		P = memrdr(PC++);
+		t++;
+		if (--B) {
+			PC += (SBYTE) P;
+			t += 8;
+		}
+		NEXT;
+
+	op_11:				/* LD DE,nn */
+		E = memrdr(PC++);
+		D = memrdr(PC++);
+		t += 6;
+		NEXT;
+
+	op_12:				/* LD (DE),A */
+		memwrt(DE, A);
+		t += 3;
+		NEXT;
+
+	op_13:				/* INC DE */
+		DE++;
+		t += 2;
+		NEXT;
+
+	op_14:				/* INC D */
+		P = D;
+		res = ++D;
+		goto finish_inc;
+
+	op_15:				/* DEC D */
+		P = D;
+		res = --D;
+		goto finish_dec;
+
+	op_16:				/* LD D,n */
+		D = memrdr(PC++);
+		t += 3;
+		NEXT;
+
+	op_17:				/* RLA */
+		res = (F >> C_SHIFT) & 1;
+		F = ((F & ~(H_FLAG | N_FLAG | C_FLAG)) |
+		     ((((A & 0x80) >> 7) & 1) << C_SHIFT));
+		/* S_FLAG, Z_FLAG, and P_FLAG unchanged */
+		A = (A << 1) | res;
+		NEXT;
+
+	op_18:				/* JR n */
+		P = memrdr(PC++);
+		PC += (SBYTE) P;
+		t += 8;
+		NEXT;
+
+	op_19:				/* ADD ir,DE */
+		W = IR + DE;
+		cout = (IRH & D) | ((IRH | D) & ~WH);
+		goto finish_addir;
+
+	op_1a:				/* LD A,(DE) */
+		A = memrdr(DE);
+		t += 3;
+		NEXT;
+
+	op_1b:				/* DEC DE */
+		DE--;
+		t += 2;
+		NEXT;
+
+	op_1c:				/* INC E */
+		P = E;
+		res = ++E;
+		goto finish_inc;
+
+	op_1d:				/* DEC E */
+		P = E;
+		res = --E;
+		goto finish_dec;
+
+	op_1e:				/* LD E,n */
+		E = memrdr(PC++);
+		t += 3;
+		NEXT;
+
+	op_1f:				/* RRA */
+		res = (F >> C_SHIFT) & 1;
+		F = (F & ~(H_FLAG | N_FLAG | C_FLAG)) | ((A & 1) << C_SHIFT);
+		/* S_FLAG, Z_FLAG, and P_FLAG unchanged */
+		A = (A >> 1) | (res << 7);
+		NEXT;
+
+	op_20:				/* JR NZ,n */
+		res = !(F & Z_FLAG);
+	finish_jrc:
+		P = memrdr(PC++);
+		t += 3;
+		if (res) {
+			PC += (SBYTE) P;
+			t += 5;
+		}
+		NEXT;
+
+	op_21:				/* LD ir,nn */
+		IRL = memrdr(PC++);
+		IRH = memrdr(PC++);
+		t += 6;
+		NEXT;
+
+	op_22:				/* LD (nn),ir */
+		WL = memrdr(PC++);
+		WH = memrdr(PC++);
+		memwrt(W, IRL);
+		memwrt(W + 1, IRH);
+		t += 12;
+		NEXT;
+
+	op_23:				/* INC ir */
+		IR++;
+		t += 2;
+		NEXT;
+
+	op_24:				/* INC irh */
+		P = IRH;
+		res = ++IRH;
+		goto finish_inc;
+
+	op_25:				/* DEC irh */
+		P = IRH;
+		res = --IRH;
+		goto finish_dec;
+
+	op_26:				/* LD irh,n */
+		IRH = memrdr(PC++);
+		t += 3;
+		NEXT;
+
+	op_27:				/* DAA */
+		P = 0;
+		if (((A & 0xf) > 9) || (F & H_FLAG))
+			P |= 0x06;
+		if ((A > 0x99) || (F & C_FLAG)) {
+			F |= C_FLAG;
+			P |= 0x60;
+		}
+		if (F & N_FLAG) {
+			res = A - P;
+			cout = (~A & P) | ((~A | P) & res);
+		} else  {
+			res = A + P;
+			cout = (A & P) | ((A | P) & ~res);
+		}
+		F = ((F & (N_FLAG | C_FLAG)) |
+		     (((cout >> 3) & 1) << H_SHIFT) |
+		     szp_flags[res]);
+		/* N_FLAG unchanged */
+		A = res;
+		NEXT;
+
+	op_28:				/* JR Z,n */
+		res = F & Z_FLAG;
+		goto finish_jrc;
+
+	op_29:				/* ADD ir,ir */
+		W = IR << 1;
+		cout = IRH | (IRH & ~WH);
+		goto finish_addir;
+
+	op_2a:				/* LD ir,(nn) */
+		WL = memrdr(PC++);
+		WH = memrdr(PC++);
+		IRL = memrdr(W);
+		IRH = memrdr(W + 1);
+		t += 12;
+		NEXT;
+
+	op_2b:				/* DEC ir */
+		IR--;
+		t += 2;
+		NEXT;
+
+	op_2c:				/* INC irl */
+		P = IRL;
+		res = ++IRL;
+		goto finish_inc;
+
+	op_2d:				/* DEC irl */
+		P = IRL;
+		res = --IRL;
+		goto finish_dec;
+
+	op_2e:				/* LD irl,n */
+		IRL = memrdr(PC++);
+		t += 3;
+		NEXT;
+
+	op_2f:				/* CPL */
+		A = ~A;
+		F |= H_FLAG | N_FLAG;
+		/* S_FLAG, Z_FLAG, P_FLAG, and C_FLAG unchanged */
+		NEXT;
+
+	op_30:				/* JR NC,n */
+		res = !(F & C_FLAG);
+		goto finish_jrc;
+
+	op_31:				/* LD SP,nn */
+		SPL = memrdr(PC++);
+		SPH = memrdr(PC++);
+		t += 6;
+		NEXT;
+
+	op_32:				/* LD (nn),A */
+		WL = memrdr(PC++);
+		WH = memrdr(PC++);
+		memwrt(W, A);
+		t += 9;
+		NEXT;
+
+	op_33:				/* INC SP */
+		SP++;
+		t += 2;
+		NEXT;
+
+	op_34:				/* INC (ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		res = P + 1;
+		memwrt(W, res);
+		t += 7;
+		goto finish_inc;
+
+	op_35:				/* DEC (ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		res = P - 1;
+		memwrt(W, res);
+		t += 7;
+		goto finish_dec;
+
+	op_36:				/* LD (ir),n */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 5;
+		}
+		memwrt(W, memrdr(PC++));
+		t += 6;
+		NEXT;
+
+	op_37:				/* SCF */
+		F |= C_FLAG;
+		F &= ~(N_FLAG | H_FLAG);
+		/* S_FLAG, Z_FLAG, and P_FLAG unchanged */
+		NEXT;
+
+	op_38:				/* JR C,n */
+		res = F & C_FLAG;
+		goto finish_jrc;
+
+	op_39:				/* ADD ir,SP */
+		W = IR + SP;
+		cout = (IRH & SPH) | ((IRH | SPH) & ~WH);
+		goto finish_addir;
+
+	op_3a:				/* LD A,(nn) */
+		WL = memrdr(PC++);
+		WH = memrdr(PC++);
+		A = memrdr(W);
+		t += 9;
+		NEXT;
+
+	op_3b:				/* DEC SP */
+		SP--;
+		t += 2;
+		NEXT;
+
+	op_3c:				/* INC A */
+		P = A;
+		res = ++A;
+		goto finish_inc;
+
+	op_3d:				/* DEC A */
+		P = A;
+		res = --A;
+		goto finish_dec;
+
+	op_3e:				/* LD A,n */
+		A = memrdr(PC++);
+		t += 3;
+		NEXT;
+
+	op_3f:				/* CCF */
+		if (F & C_FLAG) {
+			F |= H_FLAG;
+			F &= ~C_FLAG;
+		} else {
+			F &= ~H_FLAG;
+			F |= C_FLAG;
+		}
+		F &= ~N_FLAG;
+		/* S_FLAG, Z_FLAG, and P_FLAG unchanged */
+		NEXT;
+
+	op_41:				/* LD B,C */
+		B = C;
+		NEXT;
+
+	op_42:				/* LD B,D */
+		B = D;
+		NEXT;
+
+	op_43:				/* LD B,E */
+		B = E;
+		NEXT;
+
+	op_44:				/* LD B,irh */
+		B = IRH;
+		NEXT;
+
+	op_45:				/* LD B,irl */
+		B = IRL;
+		NEXT;
+
+	op_46:				/* LD B,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		B = memrdr(W);
+		t += 3;
+		NEXT;
+
+	op_47:				/* LD B,A */
+		B = A;
+		NEXT;
+
+	op_48:				/* LD C,B */
+		C = B;
+		NEXT;
+
+	op_4a:				/* LD C,D */
+		C = D;
+		NEXT;
+
+	op_4b:				/* LD C,E */
+		C = E;
+		NEXT;
+
+	op_4c:				/* LD C,irh */
+		C = IRH;
+		NEXT;
+
+	op_4d:				/* LD C,irl */
+		C = IRL;
+		NEXT;
+
+	op_4e:				/* LD C,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		C = memrdr(W);
+		t += 3;
+		NEXT;
+
+	op_4f:				/* LD C,A */
+		C = A;
+		NEXT;
+
+	op_50:				/* LD D,B */
+		D = B;
+		NEXT;
+
+	op_51:				/* LD D,C */
+		D = C;
+		NEXT;
+
+	op_53:				/* LD D,E */
+		D = E;
+		NEXT;
+
+	op_54:				/* LD D,irh */
+		D = IRH;
+		NEXT;
+
+	op_55:				/* LD D,irl */
+		D = IRL;
+		NEXT;
+
+	op_56:				/* LD D,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		D = memrdr(W);
+		t += 3;
+		NEXT;
+
+	op_57:				/* LD D,A */
+		D = A;
+		NEXT;
+
+	op_58:				/* LD E,B */
+		E = B;
+		NEXT;
+
+	op_59:				/* LD E,C */
+		E = C;
+		NEXT;
+
+	op_5a:				/* LD E,D */
+		E = D;
+		NEXT;
+
+	op_5c:				/* LD E,irh */
+		E = IRH;
+		NEXT;
+
+	op_5d:				/* LD E,irl */
+		E = IRL;
+		NEXT;
+
+	op_5e:				/* LD E,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		E = memrdr(W);
+		t += 3;
+		NEXT;
+
+	op_5f:				/* LD E,A */
+		E = A;
+		NEXT;
+
+	op_60:				/* LD irh,B */
+		IRH = B;
+		NEXT;
+
+	op_61:				/* LD irh,C */
+		IRH = C;
+		NEXT;
+
+	op_62:				/* LD irh,D */
+		IRH = D;
+		NEXT;
+
+	op_63:				/* LD irh,E */
+		IRH = E;
+		NEXT;
+
+	op_65:				/* LD irh,irl */
+		IRH = IRL;
+		NEXT;
+
+	op_66:				/* LD H,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+			H = memrdr(W);
+		} else
+			IRH = memrdr(W);
+		t += 3;
+		NEXT;
+
+	op_67:				/* LD irh,A */
+		IRH = A;
+		NEXT;
+
+	op_68:				/* LD irl,B */
+		IRL = B;
+		NEXT;
+
+	op_69:				/* LD irl,C */
+		IRL = C;
+		NEXT;
+
+	op_6a:				/* LD irl,D */
+		IRL = D;
+		NEXT;
+
+	op_6b:				/* LD irl,E */
+		IRL = E;
+		NEXT;
+
+	op_6c:				/* LD irl,irh */
+		IRL = IRH;
+		NEXT;
+
+	op_6e:				/* LD L,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+			L = memrdr(W);
+		} else
+			IRL = memrdr(W);
+		t += 3;
+		NEXT;
+
+	op_6f:				/* LD irl,A */
+		IRL = A;
+		NEXT;
+
+	op_70:				/* LD (ir),B */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		memwrt(W, B);
+		t += 3;
+		NEXT;
+
+	op_71:				/* LD (ir),C */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		memwrt(W, C);
+		t += 3;
+		NEXT;
+
+	op_72:				/* LD (ir),D */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		memwrt(W, D);
+		t += 3;
+		NEXT;
+
+	op_73:				/* LD (ir),E */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		memwrt(W, E);
+		t += 3;
+		NEXT;
+
+	op_74:				/* LD (ir),H */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+			memwrt(W, H);
+		} else
+			memwrt(W, IRH);
+		t += 3;
+		NEXT;
+
+	op_75:				/* LD (ir),L */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+			memwrt(W, L);
+		} else
+			memwrt(W, IRL);
+		t += 3;
+		NEXT;
+
+	op_76:				/* HALT */
+		t2 = get_clock_us();
+
+#ifdef BUS_8080
+		cpu_bus = CPU_WO | CPU_HLTA | CPU_MEMR;
+#endif
+#ifdef FRONTPANEL
+		if (!F_flag) {
+#endif
+			if (IFF == 0) {
+				/* without a frontpanel DI + HALT
+				   stops the machine */
+				cpu_error = OPHALT;
+				cpu_state = ST_STOPPED;
+			} else {
+				/* else wait for INT, NMI or user interrupt */
+				while (!int_int && !int_nmi &&
+				       (cpu_state == ST_CONTIN_RUN)) {
+					idle_wait();
+					R += 99;
+				}
+			}
+#ifdef BUS_8080
+			if (int_int)
+				cpu_bus = CPU_INTA | CPU_WO |
+					  CPU_HLTA | CPU_M1;
+#endif
+			busy_loop_cnt = 0;
+#ifdef FRONTPANEL
+		} else {
+			fp_led_address = 0xffff;
+			fp_led_data = 0xff;
+
+			if (IFF == 0) {
+				/* INT disabled, wait for NMI,
+				   frontpanel reset or user interrupt */
+				while (!int_nmi && !(cpu_state & ST_RESET)) {
+					fp_clock++;
+					fp_sampleData();
+					idle_wait();
+					R += 99;
+					if (cpu_error != NONE)
+						break;
+				}
+			} else {
+				/* else wait for INT, NMI,
+				   frontpanel reset or user interrupt */
+				while (!int_int && !int_nmi &&
+				       !(cpu_state & ST_RESET)) {
+					fp_clock++;
+					fp_sampleData();
+					idle_wait();
+					R += 99;
+					if (cpu_error != NONE)
+						break;
+				}
+				if (int_int) {
+					cpu_bus = CPU_INTA | CPU_WO |
+						  CPU_HLTA | CPU_M1;
+					fp_clock++;
+					fp_sampleLightGroup(0, 0);
+				}
+			}
+		}
+#endif /* FRONTPANEL */
+
+		wait_time += get_clock_us() - t2;
+
+		NEXT;
+
+	op_77:				/* LD (ir),A */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		memwrt(W, A);
+		t += 3;
+		NEXT;
+
+	op_78:				/* LD A,B */
+		A = B;
+		NEXT;
+
+	op_79:				/* LD A,C */
+		A = C;
+		NEXT;
+
+	op_7a:				/* LD A,D */
+		A = D;
+		NEXT;
+
+	op_7b:				/* LD A,E */
+		A = E;
+		NEXT;
+
+	op_7c:				/* LD A,irh */
+		A = IRH;
+		NEXT;
+
+	op_7d:				/* LD A,irl */
+		A = IRL;
+		NEXT;
+
+	op_7e:				/* LD A,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		A = memrdr(W);
+		t += 3;
+		NEXT;
+
+	op_80:				/* ADD A,B */
+		P = B;
+		res = 0;
+	finish_add:
+		res = A + P + res;
+		cout = (A & P) | ((A | P) & ~res);
+		F = ((((cout >> 7) & 1) << C_SHIFT) |
+		     ((((cout + 64) >> 7) & 1) << P_SHIFT) |
+		     (((cout >> 3) & 1) << H_SHIFT) |
+		     (szp_flags[res] & ~P_FLAG));
+		/* N_FLAG cleared */
+		A = res;
+		NEXT;
+
+	op_81:				/* ADD A,C */
+		P = C;
+		res = 0;
+		goto finish_add;
+
+	op_82:				/* ADD A,D */
+		P = D;
+		res = 0;
+		goto finish_add;
+
+	op_83:				/* ADD A,E */
+		P = E;
+		res = 0;
+		goto finish_add;
+
+	op_84:				/* ADD A,irh */
+		P = IRH;
+		res = 0;
+		goto finish_add;
+
+	op_85:				/* ADD A,irl */
+		P = IRL;
+		res = 0;
+		goto finish_add;
+
+	op_86:				/* ADD A,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		res = 0;
+		t += 3;
+		goto finish_add;
+
+	op_87:				/* ADD A,A */
+		P = A;
+		res = 0;
+		goto finish_add;
+
+	op_88:				/* ADC A,B */
+		P = B;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_add;
+
+	op_89:				/* ADC A,C */
+		P = C;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_add;
+
+	op_8a:				/* ADC A,D */
+		P = D;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_add;
+
+	op_8b:				/* ADC A,E */
+		P = E;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_add;
+
+	op_8c:				/* ADC A,irh */
+		P = IRH;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_add;
+
+	op_8d:				/* ADC A,irl */
+		P = IRL;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_add;
+
+	op_8e:				/* ADC A,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		res = (F >> C_SHIFT) & 1;
+		t += 3;
+		goto finish_add;
+
+	op_8f:				/* ADC A,A */
+		P = A;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_add;
+
+	op_90:				/* SUB A,B */
+		P = B;
+		res = 0;
+	finish_sub:
+		res = A - P - res;
+		cout = (~A & P) | ((~A | P) & res);
+		F = ((((cout >> 7) & 1) << C_SHIFT) |
+		     ((((cout + 64) >> 7) & 1) << P_SHIFT) |
+		     (((cout >> 3) & 1) << H_SHIFT) |
+		     N_FLAG |
+		     (szp_flags[res] & ~P_FLAG));
+		A = res;
+		NEXT;
+
+	op_91:				/* SUB A,C */
+		P = C;
+		res = 0;
+		goto finish_sub;
+
+	op_92:				/* SUB A,D */
+		P = D;
+		res = 0;
+		goto finish_sub;
+
+	op_93:				/* SUB A,E */
+		P = E;
+		res = 0;
+		goto finish_sub;
+
+	op_94:				/* SUB A,irh */
+		P = IRH;
+		res = 0;
+		goto finish_sub;
+
+	op_95:				/* SUB A,irl */
+		P = IRL;
+		res = 0;
+		goto finish_sub;
+
+	op_96:				/* SUB A,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		res = 0;
+		t += 3;
+		goto finish_sub;
+
+	op_97:				/* SUB A,A */
+		F = Z_FLAG | N_FLAG;
+		/* S_FLAG, H_FLAG, P_FLAG, and C_FLAG cleared */
+		A = 0;
+		NEXT;
+
+	op_98:				/* SBC A,B */
+		P = B;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_sub;
+
+	op_99:				/* SBC A,C */
+		P = C;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_sub;
+
+	op_9a:				/* SBC A,D */
+		P = D;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_sub;
+
+	op_9b:				/* SBC A,E */
+		P = E;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_sub;
+
+	op_9c:				/* SBC A,irh */
+		P = IRH;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_sub;
+
+	op_9d:				/* SBC A,irl */
+		P = IRL;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_sub;
+
+	op_9e:				/* SBC A,(ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		res = (F >> C_SHIFT) & 1;
+		t += 3;
+		goto finish_sub;
+
+	op_9f:				/* SBC A,A */
+		P = A;
+		res = (F >> C_SHIFT) & 1;
+		goto finish_sub;
+
+	op_a0:				/* AND B */
+		P = B;
+	finish_and:
+		res = A & P;
+		F = H_FLAG | szp_flags[res];
+		/* N_FLAG and C_FLAG cleared */
+		A = res;
+		NEXT;
+
+	op_a1:				/* AND C */
+		P = C;
+		goto finish_and;
+
+	op_a2:				/* AND D */
+		P = D;
+		goto finish_and;
+
+	op_a3:				/* AND E */
+		P = E;
+		goto finish_and;
+
+	op_a4:				/* AND irh */
+		P = IRH;
+		goto finish_and;
+
+	op_a5:				/* AND irl */
+		P = IRL;
+		goto finish_and;
+
+	op_a6:				/* AND (ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		t += 3;
+		goto finish_and;
+
+	op_a7:				/* AND A */
+		P = A;
+		goto finish_and;
+
+	op_a8:				/* XOR B */
+		P = B;
+	finish_xor:
+		res = A ^ P;
+		F = szp_flags[res];
+		/* H_FLAG, N_FLAG, and C_FLAG cleared */
+		A = res;
+		NEXT;
+
+	op_a9:				/* XOR C */
+		P = C;
+		goto finish_xor;
+
+	op_aa:				/* XOR D */
+		P = D;
+		goto finish_xor;
+
+	op_ab:				/* XOR E */
+		P = E;
+		goto finish_xor;
+
+	op_ac:				/* XOR irh */
+		P = IRH;
+		goto finish_xor;
+
+	op_ad:				/* XOR irl */
+		P = IRL;
+		goto finish_xor;
+
+	op_ae:				/* XOR (ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		t += 3;
+		goto finish_xor;
+
+	op_af:				/* XOR A */
+		F = Z_FLAG | P_FLAG;
+		/* S_FLAG, H_FLAG, N_FLAG, and C_FLAG cleared */
+		A = 0;
+		NEXT;
+
+	op_b0:				/* OR B */
+		P = B;
+	finish_or:
+		res = A | P;
+		F = szp_flags[res];
+		/* H_FLAG, N_FLAG, and C_FLAG cleared */
+		A = res;
+		NEXT;
+
+	op_b1:				/* OR C */
+		P = C;
+		goto finish_or;
+
+	op_b2:				/* OR D */
+		P = D;
+		goto finish_or;
+
+	op_b3:				/* OR E */
+		P = E;
+		goto finish_or;
+
+	op_b4:				/* OR irh */
+		P = IRH;
+		goto finish_or;
+
+	op_b5:				/* OR irl */
+		P = IRL;
+		goto finish_or;
+
+	op_b6:				/* OR (ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		t += 3;
+		goto finish_or;
+
+	op_b7:				/* OR A */
+		F = szp_flags[A];
+		/* H_FLAG, N_FLAG, and C_FLAG cleared */
+		NEXT;
+
+	op_b8:				/* CP B */
+		P = B;
+	finish_cp:
+		res = A - P;
+		cout = (~A & P) | ((~A | P) & res);
+		F = ((((cout >> 7) & 1) << C_SHIFT) |
+		     ((((cout + 64) >> 7) & 1) << P_SHIFT) |
+		     (((cout >> 3) & 1) << H_SHIFT) |
+		     N_FLAG |
+		     (szp_flags[res] & ~P_FLAG));
+		NEXT;
+
+	op_b9:				/* CP C */
+		P = C;
+		goto finish_cp;
+
+	op_ba:				/* CP D */
+		P = D;
+		goto finish_cp;
+
+	op_bb:				/* CP E */
+		P = E;
+		goto finish_cp;
+
+	op_bc:				/* CP irh */
+		P = IRH;
+		goto finish_cp;
+
+	op_bd:				/* CP irl */
+		P = IRL;
+		goto finish_cp;
+
+	op_be:				/* CP (ir) */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		}
+		P = memrdr(W);
+		t += 3;
+		goto finish_cp;
+
+	op_bf:				/* CP A */
+		F = Z_FLAG | N_FLAG;
+		/* S_FLAG, H_FLAG, P_FLAG, and C_FLAG cleared */
+		NEXT;
+
+	op_c0:				/* RET NZ */
+		res = !(F & Z_FLAG);
+	finish_retc:
+		t++;
+		if (res)
+			goto finish_ret;
+		NEXT;
+
+	op_c1:				/* POP BC */
+		C = memrdr(SP++);
+		B = memrdr(SP++);
+		t += 6;
+		NEXT;
+
+	op_c2:				/* JP NZ,nn */
+		res = !(F & Z_FLAG);
+	finish_jpc:
+		WL = memrdr(PC++);
+		WH = memrdr(PC++);
+		t += 6;
+		if (res)
+			PC = W;
+		NEXT;
+
+	op_c3:				/* JP nn */
+		WL = memrdr(PC++);
+		WH = memrdr(PC);
+		t += 6;
+		PC = W;
+		NEXT;
+
+	op_c4:				/* CALL NZ,nn */
+		res = !(F & Z_FLAG);
+	finish_callc:
+		WL = memrdr(PC++);
+		WH = memrdr(PC++);
+		t += 6;
+		if (res)
+			goto finish_call;
+		NEXT;
+
+	op_c5:				/* PUSH BC */
+		memwrt(--SP, B);
+		memwrt(--SP, C);
+		t += 7;
+		NEXT;
+
+	op_c6:				/* ADD A,n */
+		P = memrdr(PC++);
+		res = 0;
+		t += 3;
+		goto finish_add;
+
+	op_c7:				/* RST 00 */
+		W = 0;
+		goto finish_call;
+
+	op_c8:				/* RET Z */
+		res = F & Z_FLAG;
+		goto finish_retc;
+
+	op_c9:				/* RET */
+	finish_ret:
+		WL = memrdr(SP++);
+		WH = memrdr(SP++);
+		t += 6;
+		PC = W;
+		NEXT;
+
+	op_ca:				/* JP Z,nn */
+		res = F & Z_FLAG;
+		goto finish_jpc;
+
+	op_cb:				/* 0xcb prefix */
+		W = IR;
+		if (curr_ir != IR_HL) {
+			W += (SBYTE) memrdr(PC++);
+			t += 8;
+		} else {
+#ifdef BUS_8080
+			/* M1 opcode fetch */
+			cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
+			m1_step = true;
+#endif
+#ifdef FRONTPANEL
+			if (F_flag) {
+				/* update frontpanel */
+				fp_clock++;
+				fp_sampleLightGroup(0, 0);
+			}
+#endif
+
+			R++;		/* increment refresh register */
+		}
+
+		t += 4;
+
+		res = 0;		/* silence compiler */
+
+		op = memrdr(PC++);
+		n = (op >> 3) & 7;
+		if (curr_ir != IR_HL)
+			P = memrdr(W);
+		else {
+			switch (op & 7) {
+			case 0:
+				P = B;
+				break;
+			case 1:
+				P = C;
+				break;
+			case 2:
+				P = D;
+				break;
+			case 3:
+				P = E;
+				break;
+			case 4:
+				P = IRH;
+				break;
+			case 5:
+				P = IRL;
+				break;
+			case 6:
+				P = memrdr(W);
+				t += 4;
+				break;
+			case 7:
+				P = A;
+				break;
+			}
+		}
+		switch (op & 0xc0) {
+		case 0x00:
+			switch (n) {
+			case 0:		/* RLC */
+				res = (P << 1) | (P >> 7);
+				F = (res & 1) << C_SHIFT;
+				break;
+			case 1:		/* RRC */
+				res = (P >> 1) | (P << 7);
+				F = ((res & 0x80) >> 7) << C_SHIFT;
+				break;
+			case 2:		/* RL */
+				res = (P << 1) | ((F & C_FLAG) >> C_SHIFT);
+				F = ((P & 0x80) >> 7) << C_SHIFT;
+				break;
+			case 3:		/* RR */
+				res = ((P >> 1) |
+				       (((F & C_FLAG) >> C_SHIFT) << 7));
+				F = (P & 1) << C_SHIFT;
+				break;
+			case 4:		/* SLA */
+				res = P << 1;
+				F = ((P & 0x80) >> 7) << C_SHIFT;
+				break;
+			case 5:		/* SRA */
+				res = (P >> 1) | (P & 0x80);
+				F = (P & 1) << C_SHIFT;
+				break;
+			case 6:		/* SLL */
+				res = (P << 1) | 1;
+				F = ((P & 0x80) >> 7) << C_SHIFT;
+				break;
+			case 7:		/* SRL */
+				res = P >> 1;
+				F = (P & 1) << C_SHIFT;
+				break;
+			}
+			F = (F & C_FLAG) | szp_flags[res];
+			/* H_FLAG and N_FLAG cleared */
+			break;
+		case 0x40:		/* BIT n */
+			res = P & (1 << n);
+			F = (F & C_FLAG) | H_FLAG | szp_flags[res];
+			/* N_FLAG cleared, C_FLAG unchanged */
+			goto end_cb;
+		case 0x80:		/* RES n */
+			res = P & ~(1 << n);
+			break;
+		case 0xc0:		/* SET n */
+			res = P | (1 << n);
+			break;
+		}
+		if (curr_ir != IR_HL)
+			memwrt(W, res);
+		switch (op & 7) {
+		case 0:
+			B = res;
+			break;
+		case 1:
+			C = res;
+			break;
+		case 2:
+			D = res;
+			break;
+		case 3:
+			E = res;
+			break;
+		case 4:
+			if (curr_ir != IR_HL)
+				H = res;
+			else
+				IRH = res;
+			break;
+		case 5:
+			if (curr_ir != IR_HL)
+				L = res;
+			else
+				IRL = res;
+			break;
+		case 6:
+			if (curr_ir == IR_HL)
+				memwrt(W, res);
+			t += 3;
+			break;
+		case 7:
+			A = res;
+			break;
+		}
+	end_cb:
+		NEXT;
+
+	op_cc:				/* CALL Z,nn */
+		res = F & Z_FLAG;
+		goto finish_callc;
+
+	op_cd:				/* CALL nn */
+		WL = memrdr(PC++);
+		WH = memrdr(PC++);
+		t += 6;
+	finish_call:
+		memwrt(--SP, PCH);
+		memwrt(--SP, PCL);
+		t += 7;
+		PC = W;
+		NEXT;
+
+	op_ce:				/* ADC A,n */
+		P = memrdr(PC++);
+		res = (F >> C_SHIFT) & 1;
+		t += 3;
+		goto finish_add;
+
+	op_cf:				/* RST 08 */
+		W = 0x08;
+		goto finish_call;
+
+	op_d0:				/* RET NC */
+		res = !(F & C_FLAG);
+		goto finish_retc;
+
+	op_d1:				/* POP DE */
+		E = memrdr(SP++);
+		D = memrdr(SP++);
+		t += 6;
+		NEXT;
+
+	op_d2:				/* JP NC,nn */
+		res = !(F & C_FLAG);
+		goto finish_jpc;
+
+	op_d3:				/* OUT (n),A */
+		P = memrdr(PC++);
+		IO_OUT(P, A, A);
+		t += 7;
+		NEXT;
+
+	op_d4:				/* CALL NC,nn */
+		res = !(F & C_FLAG);
+		goto finish_callc;
+
+	op_d5:				/* PUSH DE */
+		memwrt(--SP, D);
+		memwrt(--SP, E);
+		t += 7;
+		NEXT;
+
+	op_d6:				/* SUB A,n */
+		P = memrdr(PC++);
+		res = 0;
+		t += 3;
+		goto finish_sub;
+
+	op_d7:				/* RST 10 */
+		W = 0x10;
+		goto finish_call;
+
+	op_d8:				/* RET C */
+		res = F & C_FLAG;
+		goto finish_retc;
+
+	op_d9:				/* EXX */
+		W = BC;
+		BC = BC_;
+		BC_ = W;
+		W = DE;
+		DE = DE_;
+		DE_ = W;
+		W = HL;
+		HL = HL_;
+		HL_ = W;
+		curr_ir = IR_HL;
+		IR = HL;
+		NEXT;
+
+	op_da:				/* JP C,nn */
+		res = F & C_FLAG;
+		goto finish_jpc;
+
+	op_db:				/* IN A,(n) */
+		P = memrdr(PC++);
+		A = IO_IN(P, A);
+		t += 7;
+		NEXT;
+
+	op_dc:				/* CALL C,nn */
+		res = F & C_FLAG;
+		goto finish_callc;
+
+	op_dd:				/* 0xdd prefix */
+#ifdef BUS_8080
+		/* M1 opcode fetch */
+		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
+		m1_step = true;
+#endif
+#ifdef FRONTPANEL
+		if (F_flag) {
+			/* update frontpanel */
+			fp_clock++;
+			fp_sampleLightGroup(0, 0);
+		}
+#endif
+
+		R++;			/* increment refresh register */
+
+		curr_ir = IR_IX;
+		IR = IX;
+		goto next_opcode;
+
+	op_de:				/* SBC A,n */
+		P = memrdr(PC++);
+		res = (F >> C_SHIFT) & 1;
+		t += 3;
+		goto finish_sub;
+
+	op_df:				/* RST 18 */
+		W = 0x18;
+		goto finish_call;
+
+	op_e0:				/* RET PO */
+		res = !(F & P_FLAG);
+		goto finish_retc;
+
+	op_e1:				/* POP ir */
+		IRL = memrdr(SP++);
+		IRH = memrdr(SP++);
+		t += 6;
+		NEXT;
+
+	op_e2:				/* JP PO,nn */
+		res = !(F & P_FLAG);
+		goto finish_jpc;
+
+	op_e3:				/* EX (SP),ir */
+		WL = memrdr(SP);
+		WH = memrdr(SP + 1);
+		memwrt(SP, IRL);
+		memwrt(SP + 1, IRH);
+		IR = W;
+		t += 15;
+		NEXT;
+
+	op_e4:				/* CALL PO,nn */
+		res = !(F & P_FLAG);
+		goto finish_callc;
+
+	op_e5:				/* PUSH ir */
+		memwrt(--SP, IRH);
+		memwrt(--SP, IRL);
+		t += 7;
+		NEXT;
+
+	op_e6:				/* AND n */
+		P = memrdr(PC++);
+		t += 3;
+		goto finish_and;
+
+	op_e7:				/* RST 20 */
+		W = 0x20;
+		goto finish_call;
+
+	op_e8:				/* RET PE */
+		res = F & P_FLAG;
+		goto finish_retc;
+
+	op_e9:				/* JP (ir) */
+		PC = IR;
+		NEXT;
+
+	op_ea:				/* JP PE,nn */
+		res = F & P_FLAG;
+		goto finish_jpc;
+
+	op_eb:				/* EX DE,HL */
+		W = DE;
+		DE = HL;
+		HL = W;
+	        curr_ir = IR_HL;
+		IR = HL;
+		NEXT;
+
+	op_ec:				/* CALL PE,nn */
+		res = F & P_FLAG;
+		goto finish_callc;
+
+	op_ed:				/* 0xed prefix */
+#ifdef BUS_8080
+		/* M1 opcode fetch */
+		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
+		m1_step = true;
+#endif
+#ifdef FRONTPANEL
+		if (F_flag) {
+			/* update frontpanel */
+			fp_clock++;
+			fp_sampleLightGroup(0, 0);
+		}
+#endif
+
+		R++;			/* increment refresh register */
+
+		t += 4;
+
+		switch (memrdr(PC++)) {
+		case 0x40:		/* IN B,(C) */
+			B = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[B];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x41:		/* OUT (C),B */
+			IO_OUT(C, B, B);
+			t += 4;
+			break;
+
+		case 0x42:		/* SBC HL,BC */
+			W = HL - BC - ((F >> C_SHIFT) & 1);
+			cout = (~H & B) | ((~H | B) & WH);
+			F = N_FLAG;
+		finish_sachl:
+			F |= ((((cout >> 7) & 1) << C_SHIFT) |
+			      ((((cout + 64) >> 7) & 1) << P_SHIFT) |
+			      (((cout >> 3) & 1) << H_SHIFT) |
+			      ((W == 0) << Z_SHIFT) |
+			      (((WH & 0x80) >> 7) << S_SHIFT));
+			HL = W;
+			t += 7;
+			break;
+
+		case 0x43:		/* LD (nn),BC */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			memwrt(W, C);
+			memwrt(W + 1, B);
+			t += 12;
+			break;
+
+		case 0x44:		/* NEG */
+		case 0x4c:		/* NEG* */
+		case 0x54:		/* NEG* */
+		case 0x5c:		/* NEG* */
+		case 0x64:		/* NEG* */
+		case 0x6c:		/* NEG* */
+		case 0x74:		/* NEG* */
+		case 0x7c:		/* NEG* */
+			P = A;
+			res = A = 0;
+			goto finish_sub;
+
+		case 0x45:		/* RETN */
+		case 0x55:		/* RETN* */
+		case 0x65:		/* RETN* */
+		case 0x75:		/* RETN* */
+			WL = memrdr(SP++);
+			WH = memrdr(SP++);
+			t += 6;
+			PC = W;
+			if (IFF & 2)
+				IFF |= 1;
+			break;
+
+		case 0x46:		/* IM 0 */
+		case 0x4e:		/* IM 0* */
+		case 0x66:		/* IM 0* */
+		case 0x6e:		/* IM 0* */
+			int_mode = 0;
+			break;
+
+		case 0x47:		/* LD I,A */
+			I = A;
+			t++;
+			break;
+
+		case 0x48:		/* IN C,(C) */
+			C = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[C];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x49:		/* OUT (C),C */
+			IO_OUT(C, B, C);
+			t += 4;
+			break;
+
+		case 0x4a:		/* ADC HL,BC */
+			W = HL + BC + ((F >> C_SHIFT) & 1);
+			cout = (H & B) | ((H | B) & ~WH);
+			F = 0;
+			goto finish_sachl;
+
+		case 0x4b:		/* LD BC,(nn) */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			C = memrdr(W);
+			B = memrdr(W + 1);
+			t += 12;
+			break;
+
+		case 0x4d:		/* RETI */
+		case 0x5d:		/* RETI* */
+		case 0x6d:		/* RETI* */
+		case 0x7d:		/* RETI* */
+			WL = memrdr(SP++);
+			WH = memrdr(SP++);
+			t += 6;
+			PC = W;
+			break;
+
+		case 0x4f:		/* LD R,A */
+			R_ = R = A;
+			t++;
+			break;
+
+		case 0x50:		/* IN D,(C) */
+			D = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[D];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x51:		/* OUT (C),D */
+			IO_OUT(C, B, D);
+			t += 4;
+			break;
+
+		case 0x52:		/* SBC HL,DE */
+			W = HL - DE - ((F >> C_SHIFT) & 1);
+			cout = (~H & D) | ((~H | D) & WH);
+			F = N_FLAG;
+			goto finish_sachl;
+
+		case 0x53:		/* LD (nn),DE */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			memwrt(W, E);
+			memwrt(W + 1, D);
+			t += 12;
+			break;
+
+		case 0x56:		/* IM 1 */
+		case 0x76:		/* IM 1* */
+			int_mode = 1;
+			break;
+
+		case 0x57:		/* LD A,I */
+			A = I;
+		finish_ldair:
+			F = ((F & C_FLAG) |
+			     (((IFF >> 1) & 1) << P_SHIFT) |
+			     (szp_flags[A] & ~P_FLAG));
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t++;
+			break;
+
+		case 0x58:		/* IN E,(C) */
+			E = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[E];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x59:		/* OUT (C),E */
+			IO_OUT(C, B, E);
+			t += 4;
+			break;
+
+		case 0x5a:		/* ADC HL,DE */
+			W = HL + DE + ((F >> C_SHIFT) & 1);
+			cout = (H & D) | ((H | D) & ~WH);
+			F = 0;
+			goto finish_sachl;
+
+		case 0x5b:		/* LD DE,(nn) */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			E = memrdr(W);
+			D = memrdr(W + 1);
+			t += 12;
+			break;
+
+		case 0x5e:		/* IM 2 */
+		case 0x7e:		/* IM 2* */
+			int_mode = 2;
+			break;
+
+		case 0x5f:		/* LD A,R */
+			A = (R_ & 0x80) | (R & 0x7f);
+			goto finish_ldair;
+
+		case 0x60:		/* IN H,(C) */
+			H = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[H];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x61:		/* OUT (C),H */
+			IO_OUT(C, B, H);
+			t += 4;
+			break;
+
+		case 0x62:		/* SBC HL,HL */
+			W = -((F >> C_SHIFT) & 1);
+			cout = WH;
+			F = N_FLAG;
+			goto finish_sachl;
+
+		case 0x63:		/* LD (nn),HL */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			memwrt(W, L);
+			memwrt(W + 1, H);
+			t += 12;
+			break;
+
+		case 0x67:		/* RRD (HL) */
+			P = memrdr(HL);
+			res = A & 0x0f;
+			A = (A & 0xf0) | (P & 0x0f);
+			memwrt(HL, ((P >> 4) | (res << 4)));
+			F = (F & C_FLAG) | szp_flags[A];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 10;
+			break;
+
+		case 0x68:		/* IN L,(C) */
+			L = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[L];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x69:		/* OUT (C),L */
+			IO_OUT(C, B, L);
+			t += 4;
+			break;
+
+		case 0x6a:		/* ADC HL,HL */
+			W = (HL << 1) + ((F >> C_SHIFT) & 1);
+			cout = H | (H & ~WH);
+			F = 0;
+			goto finish_sachl;
+
+		case 0x6b:		/* LD HL,(nn) */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			L = memrdr(W);
+			H = memrdr(W + 1);
+			t += 12;
+			break;
+
+		case 0x6f:		/* RLD (HL) */
+			P = memrdr(HL);
+			res = A & 0x0f;
+			A = (A & 0xf0) | (P >> 4);
+			memwrt(HL, (P << 4) | res);
+			F = (F & C_FLAG) | szp_flags[A];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 10;
+			break;
+
+		case 0x70:		/* IN F,(C) */
+			res = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[res];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x71:		/* OUT (C),0 */
+			IO_OUT(C, B, 0); /* NMOS, CMOS outputs 0xff */
+			t += 4;
+			break;
+
+		case 0x72:		/* SBC HL,SP */
+			W = HL - SP - ((F >> C_SHIFT) & 1);
+			cout = (~H & SPH) | ((~H | SPH) & WH);
+			F = N_FLAG;
+			goto finish_sachl;
+
+		case 0x73:		/* LD (nn),SP */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			memwrt(W, SPL);
+			memwrt(W + 1, SPH);
+			t += 12;
+			break;
+
+		case 0x78:		/* IN A,(C) */
+			A = IO_IN(C, B);
+			F = (F & C_FLAG) | szp_flags[A];
+			/* H_FLAG and N_FLAG cleared, C_FLAG unchanged */
+			t += 4;
+			break;
+
+		case 0x79:		/* OUT (C),A */
+			IO_OUT(C, B, A);
+			t += 4;
+			break;
+
+		case 0x7a:		/* ADC HL,SP */
+			W = HL + SP + ((F >> C_SHIFT) & 1);
+			cout = (H & SPH) | ((H | SPH) & ~WH);
+			F = 0;
+			goto finish_sachl;
+
+		case 0x7b:		/* LD SP,(nn) */
+			WL = memrdr(PC++);
+			WH = memrdr(PC++);
+			SPL = memrdr(W);
+			SPH = memrdr(W + 1);
+			t += 12;
+			break;
+
+		case 0xa0:		/* LDI */
+			memwrt(DE++, memrdr(HL++));
+		finish_ldid:
+			BC--;
+			F = ((F & ~(H_FLAG | N_FLAG | P_FLAG)) |
+			     ((BC != 0) << P_SHIFT));
+			/* S_FLAG, Z_FLAG, and C_FLAG unchanged */
+			t += 8;
+			break;
+
+		case 0xa1:		/* CPI */
+			P = memrdr(HL++);
+		finish_cpid:
+			BC--;
+			res = A - P;
+			cout = (~A & P) | ((~A | P) & res);
+			F = ((F & C_FLAG) |
+			     (((cout >> 3) & 1) << H_SHIFT) |
+			     N_FLAG |
+			     ((BC != 0) << P_SHIFT) |
+			     (szp_flags[res] & ~P_FLAG));
+			/* C_FLAG unchanged */
+			t += 8;
+			break;
+
+		case 0xa2:		/* INI */
+			res = IO_IN(C, B--);
+			memwrt(HL++, res);
+			W = (C + 1) & 0xff;
+		finish_ioid:
+			W += res;
+			F = ((WH << H_SHIFT) | (WH << C_SHIFT) |
+			     ((((res & 0x80) >> 7) & 1) << N_SHIFT) |
+			     (szp_flags[(W & 7) ^ B] & P_FLAG) |
+			     (szp_flags[B] & ~P_FLAG));
+			t += 8;
+			break;
+
+		case 0xa3:		/* OUTI */
+			res = memrdr(HL++);
+			IO_OUT(C, --B, res);
+			W = L;
+			goto finish_ioid;
+
+		case 0xa8:		/* LDD */
+			memwrt(DE--, memrdr(HL--));
+			goto finish_ldid;
+
+		case 0xa9:		/* CPD */
+			P = memrdr(HL--);
+			goto finish_cpid;
+
+		case 0xaa:		/* IND */
+			res = IO_IN(C, B--);
+			memwrt(HL--, res);
+			W = (C - 1) & 0xff;
+			goto finish_ioid;
+
+		case 0xab:		/* OUTD */
+			res = memrdr(HL--);
+			IO_OUT(C, --B, res);
+			W = L;
+			goto finish_ioid;
+
+#ifdef FAST_BLOCK
+		case 0xb0:		/* LDIR */
+			W = BC;
+			d = DE;
+			s = HL;
+			tl = -13L;
+			R -= 2;
+			do {
+				memwrt(d++, memrdr(s++));
+				tl += 21L;
+				R += 2;
+			} while (--W);
+		finish_ldidr:
+			BC = 0;
+			DE = d;
+			HL = s;
+			F &= ~(H_FLAG | N_FLAG | P_FLAG);
+			/* S_FLAG, Z_FLAG, and C_FLAG unchanged */
+			T += tl;
+			break;
+
+		case 0xb1:		/* CPIR */
+			W = BC;
+			s = HL;
+			tl = -13L;
+			R -= 2;
+			do {
+				P = memrdr(s++);
+				res = A - P;
+				tl += 21L;
+				R += 2;
+			} while (--W && res);
+		finish_cpidr:
+			BC = W;
+			HL = s;
+			cout = (~A & P) | ((~A | P) & res);
+			F = ((F & C_FLAG) |
+			     (((cout >> 3) & 1) << H_SHIFT) |
+			     N_FLAG |
+			     ((W != 0) << P_SHIFT) |
+			     (szp_flags[res] & ~P_FLAG));
+			/* C_FLAG unchanged */
+			T += tl;
+			break;
+
+		case 0xb2:		/* INIR */
+			s = HL;
+			R -= 2;
+			tl = -13L;
+			do {
+				res = IO_IN(C, B--);
+				memwrt(s++, res);
+				tl += 21L;
+				R += 2;
+			} while (B);
+			W = (C + 1) & 0xff;
+		finish_ioidr:
+			HL = s;
+			W += res;
+			F = ((WH << H_SHIFT) | (WH << C_SHIFT) |
+			     ((((res & 0x80) >> 7) & 1) << N_SHIFT) |
+			     (szp_flags[W & 7] & P_FLAG) |
+			     Z_FLAG);
+			/* S_FLAG cleared */
+			T += tl;
+			break;
+
+		case 0xb3:		/* OTIR */
+			s = HL;
+			tl = -13L;
+			R -= 2;
+			do {
+				res = memrdr(s++);
+				IO_OUT(C, --B, res);
+				tl += 21L;
+				R += 2;
+			} while (B);
+			W = s & 0xff;
+			goto finish_ioidr;
+
+		case 0xb8:		/* LDDR */
+			W = BC;
+			d = DE;
+			s = HL;
+			tl = -13L;
+			R -= 2;
+			do {
+				memwrt(d--, memrdr(s--));
+				tl += 21L;
+				R += 2;
+			} while (--W);
+			goto finish_ldidr;
+
+		case 0xb9:		/* CPDR */
+			W = BC;
+			s = HL;
+			tl = -13L;
+			R -= 2;
+			do {
+				P = memrdr(s--);
+				res = A - P;
+				tl += 21L;
+				R += 2;
+			} while (--W && res);
+			goto finish_cpidr;
+
+		case 0xba:		/* INDR */
+			s = HL;
+			tl = -13L;
+			R -= 2;
+			do {
+				res = IO_IN(C, B--);
+				memwrt(s--, res);
+				tl += 21L;
+				R += 2;
+			} while (B);
+			W = (C - 1) & 0xff;
+			goto finish_ioidr;
+
+		case 0xbb:		/* OTDR */
+			s = HL;
+			tl = -13L;
+			R -= 2;
+			do {
+				res = memrdr(s--);
+				IO_OUT(C, --B, res);
+				tl += 21L;
+				R += 2;
+			} while (B);
+			W = s & 0xff;
+			goto finish_ioidr;
+#else /* !FAST_BLOCK */
+		case 0xb0:		/* LDIR */
+			memwrt(DE++, memrdr(HL++));
+		finish_ldidr:
+			BC--;
+			F = ((F & ~(H_FLAG | N_FLAG | P_FLAG)) |
+			     ((BC != 0) << P_SHIFT));
+			/* S_FLAG, Z_FLAG, and C_FLAG unchanged */
+			t += 8;
+			if (F & P_FLAG) {
+				t += 5;
+				PC -= 2;
+			}
+			break;
+
+		case 0xb1:		/* CPIR */
+			P = memrdr(HL++);
+		finish_cpidr:
+			BC--;
+			res = A - P;
+			cout = (~A & P) | ((~A | P) & res);
+			F = ((F & C_FLAG) |
+			     (((cout >> 3) & 1) << H_SHIFT) |
+			     N_FLAG |
+			     ((BC != 0) << P_SHIFT) |
+			     (szp_flags[res] & ~P_FLAG));
+			/* C_FLAG unchanged */
+			t += 8;
+			if ((F & (P_FLAG | Z_FLAG)) == P_FLAG) {
+				t += 5;
+				PC -= 2;
+			}
+			break;
+
+		case 0xb2:		/* INIR */
+			res = IO_IN(C, B--);
+			memwrt(HL++, res);
+			W = (C + 1) & 0xff;
+		finish_ioidr:
+			W += res;
+			F = ((WH << H_SHIFT) | (WH << C_SHIFT) |
+			     ((((res & 0x80) >> 7) & 1) << N_SHIFT) |
+			     (szp_flags[(W & 7) ^ B] & P_FLAG) |
+			     (szp_flags[B] & ~P_FLAG));
+			t += 8;
+			if (!(F & Z_FLAG)) {
+				t += 5;
+				PC -= 2;
+			}
+			break;
+
+		case 0xb3:		/* OTIR */
+			res = memrdr(HL++);
+			IO_OUT(C, --B, res);
+			W = L;
+			goto finish_ioidr;
+
+		case 0xb8:		/* LDDR */
+			memwrt(DE--, memrdr(HL--));
+			goto finish_ldidr;
+
+		case 0xb9:		/* CPDR */
+			P = memrdr(HL--);
+			goto finish_cpidr;
+
+		case 0xba:		/* INDR */
+			res = IO_IN(C, B--);
+			memwrt(HL--, res);
+			W = (C - 1) & 0xff;
+			goto finish_ioidr;
+
+		case 0xbb:		/* OTDR */
+			res = memrdr(HL--);
+			IO_OUT(C, --B, res);
+			W = L;
+			goto finish_ioidr;
+#endif /* !FAST_BLOCK */
+
+		default:		/* NOP* */
+			break;
+		}
+		curr_ir = IR_HL;
+		IR = HL;
+		NEXT;
+
+	op_ee:				/* XOR n */
+		P = memrdr(PC++);
+		t += 3;
+		goto finish_xor;
+
+	op_ef:				/* RST 28 */
+		W = 0x28;
+		goto finish_call;
+
+	op_f0:				/* RET P */
+		res = !(F & S_FLAG);
+		goto finish_retc;
+
+	op_f1:				/* POP AF */
+		F = memrdr(SP++);
+		A = memrdr(SP++);
+		t += 6;
+		NEXT;
+
+	op_f2:				/* JP P,nn */
+		res = !(F & S_FLAG);
+		goto finish_jpc;
+
+	op_f3:				/* DI */
+		IFF = 0;
+		NEXT;
+
+	op_f4:				/* CALL P,nn */
+		res = !(F & S_FLAG);
+		goto finish_callc;
+
+	op_f5:				/* PUSH AF */
+		memwrt(--SP, A);
+		memwrt(--SP, F);
+		t += 7;
+		NEXT;
+
+	op_f6:				/* OR n */
+		P = memrdr(PC++);
+		t += 3;
+		goto finish_or;
+
+	op_f7:				/* RST 30 */
+		W = 0x30;
+		goto finish_call;
+
+	op_f8:				/* RET M */
+		res = F & S_FLAG;
+		goto finish_retc;
+
+	op_f9:				/* LD SP,ir */
+		SP = IR;
+		t += 2;
+		NEXT;
+
+	op_fa:				/* JP M,nn */
+		res = F & S_FLAG;
+		goto finish_jpc;
+
+	op_fb:				/* EI */
+		IFF = 3;
+		int_protection = true;	/* protect next instruction */
+		NEXT;
+
+	op_fc:				/* CALL M,nn */
+		res = F & S_FLAG;
+		goto finish_callc;
+
+	op_fd:				/* 0xfd prefix */
+#ifdef BUS_8080
+		/* M1 opcode fetch */
+		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
+		m1_step = true;
+#endif
+#ifdef FRONTPANEL
+		if (F_flag) {
+			/* update frontpanel */
+			fp_clock++;
+			fp_sampleLightGroup(0, 0);
+		}
+#endif
+
+		R++;			/* increment refresh register */
+
+		curr_ir = IR_IY;
+		IR = IY;
+		goto next_opcode;
+
+	op_fe:				/* CP n */
+		P = memrdr(PC++);
+		t += 3;
+		goto finish_cp;
+
+	op_ff:				/* RST 38 */
+		W = 0x38;
+		goto finish_call;
+
+thr_leave:
+	*gregs = lregs;		/* write back the CPU registers */
+
+#undef cpu_regs
+
+#undef W
+#undef WH
+#undef WL
+
+#undef IR
+#undef IRH
+#undef IRL
+
+#undef IR_HL
+#undef IR_IX
+#undef IR_IY
+
+#undef VOLATILE
+#undef IO_IN
+#undef IO_OUT
+#undef EVENT
+#undef M1_FETCH
+#undef NEXT
+
+#undef S_SHIFT
+#undef Z_SHIFT
+#undef H_SHIFT
+#undef P_SHIFT
+#undef N_SHIFT
+#undef C_SHIFT
+}
@@ -8,6 +8,9 @@
  *
  * History:
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 18-OCT-2026 stdin is received by the reactor thread
+ * 18-OCT-2026 stdout is sent by the reactor thread
+ * 18-OCT-2026 save the state of the ports into snapshots
  */
 
 /*
@@ -26,13 +29,14 @@
  */
 
 #include <stdio.h>
-#include <sys/poll.h>
 
 #include "sim.h"
 #include "simdefs.h"
 #include "simglb.h"
 #include "simcore.h"
 #include "simio.h"
+#include "simsnap.h"
+#include "unix_reactor.h"
 
 /*
  *	Forward declarations of the I/O functions
@@ -47,6 +51,9 @@ static BYTE hwctl_lock = 0xff;	/* lock status hardware control port */
 static BYTE sio_last;		/* last byte read from sio */
 static BYTE fp_value;		/* port 255 value, can be set with p command */
 
+static void save_io(void);
+static bool load_io(snap_chunk_t *c);
+
 /*
  *	This array contains function pointers for every input
  *	I/O port (0 - 255), to do the required I/O.
@@ -80,6 +87,7 @@ out_func_t *const port_out[256] = {
  */
 void init_io(void)
 {
+	snap_register("IO  ", save_io, load_io);
 }
 
 /*
@@ -93,28 +101,50 @@ void exit_io(void)
 {
 }
 
+/*
+ *	Save the state of the ports into a snapshot
+ */
+static void save_io(void)
+{
+	BYTE regs[3] = { hwctl_lock, sio_last, fp_value };
+
+	snap_put(regs, sizeof(regs));
+}
+
+/*
+ *	Load the state of the ports from a snapshot
+ */
+static bool load_io(snap_chunk_t *c)
+{
+	BYTE regs[3];
+
+	if (!snap_get(c, regs, sizeof(regs)))
+		return false;
+
+	hwctl_lock = regs[0];
+	sio_last = regs[1];
+	fp_value = regs[2];
+	return true;
+}
+
 /*
  *	I/O function port 0 read:
  *	Read status from stdin:
  *	bit 0 = 0, character available for input from stdin
  *	bit 7 = 0, transmitter ready to write character to stdout
- *		   always true
  */
 static BYTE p000_in(void)
 {
-	struct pollfd p[1];
+	int ch;
 	register BYTE tty_stat = 0x01;
 
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (p[0].revents & POLLIN)
-		tty_stat &= ~1;
-	if (p[0].revents & POLLNVAL) {
+	if ((ch = rx_stdin()) == -1) {
 		cpu_error = IOERROR;
 		cpu_state = ST_STOPPED;
-	}
+	} else if (rx_ready(ch))
+		tty_stat &= ~1;
+	if ((ch = tx_stdout()) != -1 && !tx_ready(ch))
+		tty_stat |= 0x80;
 	return tty_stat;
 }
 
@@ -124,16 +154,12 @@ static BYTE p000_in(void)
  */
 static BYTE p001_in(void)
 {
-	struct pollfd p[1];
+	int ch, c;
 
-	p[0].fd = fileno(stdin);
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-	if (!(p[0].revents & POLLIN))
+	if ((ch = rx_stdin()) == -1 || (c = rx_get(ch)) == RX_NONE)
 		return sio_last; /* someone reads without checking status */
 	else {
-		sio_last = getchar();
+		sio_last = (c == RX_EOF) ? 0xff : c;
 		return sio_last;
 	}
 }
@@ -162,8 +188,13 @@ static BYTE p255_in(void)
  */
 static void p001_out(BYTE data)
 {
-	putchar((int) data & 0x7f); /* strip parity, some software won't */
-	fflush(stdout);
+	int ch;
+
+	/* strip parity, some software won't */
+	if ((ch = tx_stdout()) == -1 || !tx_put(ch, data & 0x7f)) {
+		cpu_error = IOERROR;
+		cpu_state = ST_STOPPED;
+	}
 }
 
 /*
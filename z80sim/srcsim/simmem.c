@@ -9,6 +9,7 @@
  * 22-DEC-2016 stuff moved to here for better memory abstraction
  * 03-FEB-2017 added ROM initialization
  * 15-AUG-2017 don't use macros, use inline functions that coerce appropriate
+ * 18-OCT-2026 save the memory into snapshots
  */
 
 #include <stdlib.h>
@@ -17,14 +18,20 @@
 #include "simdefs.h"
 #include "simglb.h"
 #include "simmem.h"
+#include "simsnap.h"
 
 /* 64KB non banked memory */
 BYTE memory[65536];		/* 64KB RAM */
 
+static void save_memory(void);
+static bool load_memory(snap_chunk_t *c);
+
 void init_memory(void)
 {
 	register int i;
 
+	snap_register("MEM ", save_memory, load_memory);
+
 	/* fill memory content with some initial value */
 	if (m_value >= 0) {
 		for (i = 0; i < 65536; i++)
@@ -34,3 +41,19 @@ void init_memory(void)
 			putmem(i, (BYTE) (rand() % 256));
 	}
 }
+
+/*
+ *	Save the memory into a snapshot
+ */
+static void save_memory(void)
+{
+	snap_put_mem(memory, 65536);
+}
+
+/*
+ *	Load the memory from a snapshot
+ */
+static bool load_memory(snap_chunk_t *c)
+{
+	return snap_get_mem(c, memory, 65536);
+}